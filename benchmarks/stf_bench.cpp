@@ -0,0 +1,345 @@
+#include <sys/resource.h>
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "common/synthetic_trace_generator.hpp"
+
+#include "stf-inc/stf_branch_reader.hpp"
+#include "stf-inc/stf_exception.hpp"
+#include "stf-inc/stf_inst_reader.hpp"
+#include "stf-inc/stf_reader.hpp"
+#include "stf-inc/stf_transaction_reader.hpp"
+
+namespace {
+    constexpr size_t BUFFER_SIZE = 1024;
+
+    // Translated addresses are stored here so that the translations can't be optimized out
+    volatile uint64_t pa_sink = 0;
+
+    /**
+     * \struct StageResult
+     *
+     * Measurements for a single benchmark stage
+     */
+    struct StageResult {
+        std::string stage;
+        std::string mode;
+        std::string unit;
+        uint64_t items = 0;
+        std::optional<uint64_t> records;
+        std::optional<uint64_t> bytes;
+        double seconds = 0;
+        uint64_t peak_rss_kb = 0;
+    };
+
+    /**
+     * Resets the peak RSS counter so that each stage reports its own high water mark. Only works on Linux.
+     */
+    void resetPeakRSS() {
+        std::ofstream clear_refs("/proc/self/clear_refs");
+        if(clear_refs) {
+            clear_refs << "5";
+        }
+    }
+
+    /**
+     * Gets the peak RSS in kB
+     */
+    uint64_t getPeakRSS() {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while(std::getline(status, line)) {
+            if(line.rfind("VmHWM:", 0) == 0) {
+                return std::strtoull(line.c_str() + 6, nullptr, 10);
+            }
+        }
+
+        // Falls back to the peak RSS of the whole process
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return static_cast<uint64_t>(usage.ru_maxrss);
+    }
+
+    /**
+     * Runs a benchmark stage
+     * \param stage Stage name
+     * \param mode Reader threading mode
+     * \param unit Name of the items the stage counts
+     * \param records Number of records the stage processes, if known
+     * \param bytes Number of file bytes the stage processes, if known
+     * \param func Stage body. Returns the number of items processed.
+     */
+    StageResult runStage(const std::string& stage,
+                         const std::string& mode,
+                         const std::string& unit,
+                         const std::optional<uint64_t> records,
+                         const std::optional<uint64_t> bytes,
+                         const std::function<uint64_t()>& func) {
+        StageResult result{stage, mode, unit, 0, records, bytes, 0, 0};
+
+        resetPeakRSS();
+        const auto start = std::chrono::steady_clock::now();
+        result.items = func();
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.peak_rss_kb = getPeakRSS();
+
+        return result;
+    }
+
+    /**
+     * Formats a rate, or "-" if the count is unknown
+     * \param count Count
+     * \param seconds Elapsed time
+     * \param scale Divides the rate by this amount
+     */
+    std::string formatRate(const std::optional<uint64_t>& count, const double seconds, const double scale = 1) {
+        if(!count || seconds <= 0) {
+            return "-";
+        }
+
+        std::ostringstream ss;
+        ss << std::fixed << std::setprecision(1) << static_cast<double>(*count) / seconds / scale;
+        return ss.str();
+    }
+
+    void printResults(const std::vector<StageResult>& results) {
+        std::cout << std::left
+                  << std::setw(24) << "stage"
+                  << std::setw(16) << "mode"
+                  << std::right
+                  << std::setw(12) << "time_ms"
+                  << std::setw(14) << "items"
+                  << std::setw(14) << "items/s"
+                  << std::setw(14) << "records/s"
+                  << std::setw(10) << "MB/s"
+                  << std::setw(14) << "peak_rss_MB"
+                  << "  unit"
+                  << std::endl;
+
+        for(const auto& r: results) {
+            std::cout << std::left
+                      << std::setw(24) << r.stage
+                      << std::setw(16) << r.mode
+                      << std::right << std::fixed << std::setprecision(1)
+                      << std::setw(12) << r.seconds * 1000
+                      << std::setw(14) << r.items
+                      << std::setw(14) << formatRate(r.items, r.seconds)
+                      << std::setw(14) << formatRate(r.records, r.seconds)
+                      << std::setw(10) << formatRate(r.bytes, r.seconds, 1024 * 1024)
+                      << std::setw(14) << static_cast<double>(r.peak_rss_kb) / 1024
+                      << "  " << r.unit
+                      << std::endl;
+        }
+    }
+
+    void usage(const char* prog) {
+        std::cerr << "Usage: " << prog << " [options]" << std::endl
+                  << "Generates synthetic traces and measures writer and reader throughput." << std::endl
+                  << std::endl
+                  << "Options:" << std::endl
+                  << "  -d, --work-dir DIR            directory for the generated traces (default .)" << std::endl
+                  << "  --extension EXT               trace extension, which selects compression (default .zstf)" << std::endl
+                  << "  --inst-trace FILE             benchmark an existing instruction trace instead of generating one" << std::endl
+                  << "  --transaction-trace FILE      benchmark an existing transaction trace instead of generating one" << std::endl
+                  << "  --jumps N                     number of random jumpToIndex calls (default 1000)" << std::endl
+                  << "  --mode threaded|single|both   reader threading modes to run (default both)" << std::endl
+                  << "  --keep                        keep the generated traces" << std::endl
+                  << std::endl
+                  << "Generator options:" << std::endl;
+        stf::synthetic::SyntheticTraceConfig::printOptions(std::cerr);
+    }
+} // end anonymous namespace
+
+int main(int argc, char** argv) {
+    stf::synthetic::SyntheticTraceConfig config;
+    std::filesystem::path work_dir = ".";
+    std::string extension = ".zstf";
+    std::string inst_trace;
+    std::string transaction_trace;
+    uint64_t num_jumps = 1000;
+    bool run_threaded = true;
+    bool run_single_threaded = true;
+    bool keep = false;
+
+    for(int i = 1; i < argc; ++i) {
+        const std::string_view opt = argv[i];
+        if(opt == "-h" || opt == "--help") {
+            usage(argv[0]);
+            return 0;
+        }
+        if(opt == "--keep") {
+            keep = true;
+            continue;
+        }
+        if(i + 1 == argc) {
+            usage(argv[0]);
+            return 1;
+        }
+
+        const char* val = argv[++i];
+        if(opt == "-d" || opt == "--work-dir") {
+            work_dir = val;
+        }
+        else if(opt == "--extension") {
+            extension = val;
+        }
+        else if(opt == "--inst-trace") {
+            inst_trace = val;
+        }
+        else if(opt == "--transaction-trace") {
+            transaction_trace = val;
+        }
+        else if(opt == "--jumps") {
+            num_jumps = std::strtoull(val, nullptr, 0);
+        }
+        else if(opt == "--mode") {
+            run_threaded = strcmp(val, "single");
+            run_single_threaded = strcmp(val, "threaded");
+        }
+        else if(!config.parseOption(opt, val)) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<StageResult> results;
+    std::optional<uint64_t> num_inst_records;
+    std::optional<uint64_t> num_transaction_records;
+    std::vector<std::filesystem::path> generated;
+
+    stf::synthetic::SyntheticTraceGenerator generator(config);
+
+    if(inst_trace.empty()) {
+        inst_trace = work_dir / ("stf_bench" + extension);
+        generated.emplace_back(inst_trace);
+        results.emplace_back(runStage("STFWriter", "-", "records", std::nullopt, std::nullopt,
+                                      [&]() { return generator.writeInstTrace(inst_trace); }));
+        num_inst_records = results.back().items;
+        results.back().records = num_inst_records;
+        results.back().bytes = std::filesystem::file_size(inst_trace);
+    }
+
+    if(transaction_trace.empty() && config.num_transactions) {
+        transaction_trace = work_dir / ("stf_bench_transactions" + extension);
+        generated.emplace_back(transaction_trace);
+        results.emplace_back(runStage("STFTransactionWriter", "-", "records", std::nullopt, std::nullopt,
+                                      [&]() { return generator.writeTransactionTrace(transaction_trace); }));
+        num_transaction_records = results.back().items;
+        results.back().records = num_transaction_records;
+        results.back().bytes = std::filesystem::file_size(transaction_trace);
+    }
+
+    const uint64_t inst_trace_size = std::filesystem::file_size(inst_trace);
+
+    std::vector<std::pair<std::string, bool>> modes;
+    if(run_threaded) {
+        modes.emplace_back(std::getenv("STF_SINGLE_THREADED") ? "threaded(env)" : "threaded", false);
+    }
+    if(run_single_threaded) {
+        modes.emplace_back("single", true);
+    }
+
+    for(const auto& [mode, single_threaded] : modes) {
+        results.emplace_back(runStage("STFReader", mode, "records", num_inst_records, inst_trace_size,
+            [&, single_threaded = single_threaded]() {
+                stf::STFReader reader(inst_trace, single_threaded);
+                stf::STFRecord::UniqueHandle rec;
+                uint64_t count = 0;
+                try {
+                    while(true) {
+                        reader >> rec;
+                        ++count;
+                    }
+                }
+                catch(const stf::EOFException&) {
+                }
+                return count;
+            }));
+        // Every later stage reads the same records
+        num_inst_records = results.back().items;
+
+        results.emplace_back(runStage("STFInstReader", mode, "insts", num_inst_records, inst_trace_size,
+            [&, single_threaded = single_threaded]() {
+                stf::STFInstReader reader(inst_trace, false, false, false, BUFFER_SIZE, single_threaded);
+                uint64_t count = 0;
+                for([[maybe_unused]] const auto& inst: reader) {
+                    ++count;
+                }
+                return count;
+            }));
+
+        const uint64_t num_insts = results.back().items;
+
+        results.emplace_back(runStage("STFBranchReader", mode, "branches", num_inst_records, inst_trace_size,
+            [&, single_threaded = single_threaded]() {
+                stf::STFBranchReader reader(inst_trace, false, BUFFER_SIZE, single_threaded);
+                uint64_t count = 0;
+                for([[maybe_unused]] const auto& branch: reader) {
+                    ++count;
+                }
+                return count;
+            }));
+
+        results.emplace_back(runStage("address translation", mode, "accesses", num_inst_records, inst_trace_size,
+            [&, single_threaded = single_threaded]() {
+                stf::STFInstReader reader(inst_trace, false, true, false, BUFFER_SIZE, single_threaded);
+                uint64_t count = 0;
+                for(const auto& inst: reader) {
+                    for(const auto& access: inst.getMemoryAccesses()) {
+                        pa_sink = access.getPhysAddress();
+                        ++count;
+                    }
+                }
+                return count;
+            }));
+
+        results.emplace_back(runStage("jumpToIndex", mode, "jumps", std::nullopt, std::nullopt,
+            [&, single_threaded = single_threaded]() {
+                stf::STFIndexedInstReader reader(inst_trace, false, false, false, BUFFER_SIZE, single_threaded);
+                uint64_t rng = config.seed;
+                uint64_t count = 0;
+                for(uint64_t i = 0; num_insts && i < num_jumps; ++i) {
+                    rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+                    const auto it = reader.jumpToIndex((rng >> 33) % num_insts + 1);
+                    count += it != reader.end();
+                }
+                return count;
+            }));
+
+        if(!transaction_trace.empty()) {
+            results.emplace_back(runStage("STFTransactionReader", mode, "transactions", num_transaction_records,
+                                          std::filesystem::file_size(transaction_trace),
+                [&, single_threaded = single_threaded]() {
+                    stf::STFTransactionReader reader(transaction_trace,
+                                                     stf::protocols::ProtocolId::__RESERVED_END,
+                                                     BUFFER_SIZE,
+                                                     single_threaded);
+                    uint64_t count = 0;
+                    for([[maybe_unused]] const auto& transaction: reader) {
+                        ++count;
+                    }
+                    return count;
+                }));
+        }
+    }
+
+    printResults(results);
+
+    if(!keep) {
+        for(const auto& path: generated) {
+            std::filesystem::remove(path);
+        }
+    }
+
+    return 0;
+}
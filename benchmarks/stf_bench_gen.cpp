@@ -0,0 +1,56 @@
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "common/synthetic_trace_generator.hpp"
+
+static void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [options] inst_trace [transaction_trace]" << std::endl
+              << "Writes a deterministic synthetic instruction trace and, optionally, a TileLink transaction trace." << std::endl
+              << std::endl
+              << "Options:" << std::endl;
+    stf::synthetic::SyntheticTraceConfig::printOptions(std::cerr);
+}
+
+int main(int argc, char** argv) {
+    stf::synthetic::SyntheticTraceConfig config;
+    std::string inst_trace;
+    std::string transaction_trace;
+
+    for(int i = 1; i < argc; ++i) {
+        if(!strcmp(argv[i], "-h") || !strcmp(argv[i], "--help")) {
+            usage(argv[0]);
+            return 0;
+        }
+        if(argv[i][0] == '-') {
+            if(i + 1 == argc || !config.parseOption(argv[i], argv[i + 1])) {
+                usage(argv[0]);
+                return 1;
+            }
+            ++i;
+        }
+        else if(inst_trace.empty()) {
+            inst_trace = argv[i];
+        }
+        else if(transaction_trace.empty()) {
+            transaction_trace = argv[i];
+        }
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if(inst_trace.empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    stf::synthetic::SyntheticTraceGenerator generator(config);
+    std::cout << inst_trace << ": " << generator.writeInstTrace(inst_trace) << " records" << std::endl;
+    if(!transaction_trace.empty()) {
+        std::cout << transaction_trace << ": " << generator.writeTransactionTrace(transaction_trace) << " records" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,483 @@
+#ifndef __STF_SYNTHETIC_TRACE_GENERATOR_HPP__
+#define __STF_SYNTHETIC_TRACE_GENERATOR_HPP__
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "stf-inc/stf_record_id_manager.hpp"
+#include "stf-inc/stf_record_types.hpp"
+#include "stf-inc/stf_transaction_writer.hpp"
+#include "stf-inc/stf_writer.hpp"
+#include "stf-inc/protocols/tilelink.hpp"
+
+namespace stf::synthetic {
+    /**
+     * \struct SyntheticTraceConfig
+     *
+     * Parameters for SyntheticTraceGenerator. Every ratio is a probability in [0, 1].
+     */
+    struct SyntheticTraceConfig {
+        uint64_t seed = 1; /**< PRNG seed. The same seed and config always produce the same trace. */
+        uint64_t num_insts = 1000000; /**< Number of instructions to generate */
+        size_t chunk_size = STFWriter::DEFAULT_CHUNK_SIZE; /**< Compressed chunk size in marker records */
+        double compressed_ratio = 0.25; /**< Fraction of non-memory, non-branch instructions that are 16-bit */
+        double branch_ratio = 0.15; /**< Fraction of instructions that are conditional branches */
+        double taken_ratio = 0.6; /**< Fraction of branches that are taken */
+        double mem_ratio = 0.3; /**< Fraction of instructions that access memory */
+        double store_ratio = 0.35; /**< Fraction of memory accesses that are stores */
+        uint64_t mem_footprint = 16ULL << 20; /**< Size of the region memory accesses fall in, in bytes */
+        double vector_ratio = 0.0; /**< Fraction of instructions that are vector instructions */
+        vlen_t vlen = 256; /**< Vector length in bits */
+        bool pte = true; /**< If true, embed page table walks so that addresses can be translated */
+        double pte_ratio = 0.001; /**< Fraction of memory accesses that re-walk an already mapped page */
+        uint64_t mode_switch_interval = 0; /**< Number of instructions between supervisor mode excursions (0 = never) */
+        uint64_t mode_switch_length = 100; /**< Number of instructions spent in supervisor mode per excursion */
+        uint64_t num_transactions = 200000; /**< Number of TileLink transactions to generate */
+        uint8_t transaction_size = 6; /**< log2 of the TileLink transfer size in bytes */
+        double transaction_write_ratio = 0.3; /**< Fraction of TileLink requests that are writes */
+
+        /**
+         * Parses a command line option into the config. Returns false if the option isn't a config option.
+         * \param opt Option name
+         * \param val Option value
+         */
+        inline bool parseOption(const std::string_view opt, const char* val) {
+            if(opt == "--seed") {
+                seed = std::strtoull(val, nullptr, 0);
+            }
+            else if(opt == "-n" || opt == "--insts") {
+                num_insts = std::strtoull(val, nullptr, 0);
+            }
+            else if(opt == "--chunk-size") {
+                chunk_size = std::strtoull(val, nullptr, 0);
+            }
+            else if(opt == "--compressed-ratio") {
+                compressed_ratio = std::strtod(val, nullptr);
+            }
+            else if(opt == "--branch-ratio") {
+                branch_ratio = std::strtod(val, nullptr);
+            }
+            else if(opt == "--taken-ratio") {
+                taken_ratio = std::strtod(val, nullptr);
+            }
+            else if(opt == "--mem-ratio") {
+                mem_ratio = std::strtod(val, nullptr);
+            }
+            else if(opt == "--store-ratio") {
+                store_ratio = std::strtod(val, nullptr);
+            }
+            else if(opt == "--mem-footprint") {
+                mem_footprint = std::strtoull(val, nullptr, 0);
+            }
+            else if(opt == "--vector-ratio") {
+                vector_ratio = std::strtod(val, nullptr);
+            }
+            else if(opt == "--vlen") {
+                vlen = static_cast<vlen_t>(std::strtoul(val, nullptr, 0));
+            }
+            else if(opt == "--pte") {
+                pte = std::strtoul(val, nullptr, 0) != 0;
+            }
+            else if(opt == "--pte-ratio") {
+                pte_ratio = std::strtod(val, nullptr);
+            }
+            else if(opt == "--mode-switch-interval") {
+                mode_switch_interval = std::strtoull(val, nullptr, 0);
+            }
+            else if(opt == "--mode-switch-length") {
+                mode_switch_length = std::strtoull(val, nullptr, 0);
+            }
+            else if(opt == "--transactions") {
+                num_transactions = std::strtoull(val, nullptr, 0);
+            }
+            else if(opt == "--transaction-size") {
+                transaction_size = static_cast<uint8_t>(std::strtoul(val, nullptr, 0));
+            }
+            else if(opt == "--transaction-write-ratio") {
+                transaction_write_ratio = std::strtod(val, nullptr);
+            }
+            else {
+                return false;
+            }
+
+            return true;
+        }
+
+        /**
+         * Prints the config options accepted by parseOption()
+         * \param os ostream to print to
+         */
+        static inline void printOptions(std::ostream& os) {
+            const SyntheticTraceConfig d;
+            os << "  --seed N                      PRNG seed (default " << d.seed << ")" << std::endl
+               << "  -n, --insts N                 instructions to generate (default " << d.num_insts << ")" << std::endl
+               << "  --chunk-size N                compressed chunk size (default " << d.chunk_size << ")" << std::endl
+               << "  --compressed-ratio R          16-bit instruction ratio (default " << d.compressed_ratio << ")" << std::endl
+               << "  --branch-ratio R              conditional branch ratio (default " << d.branch_ratio << ")" << std::endl
+               << "  --taken-ratio R               taken branch ratio (default " << d.taken_ratio << ")" << std::endl
+               << "  --mem-ratio R                 memory access ratio (default " << d.mem_ratio << ")" << std::endl
+               << "  --store-ratio R               store ratio among memory accesses (default " << d.store_ratio << ")" << std::endl
+               << "  --mem-footprint N             memory footprint in bytes (default " << d.mem_footprint << ")" << std::endl
+               << "  --vector-ratio R              vector instruction ratio (default " << d.vector_ratio << ")" << std::endl
+               << "  --vlen N                      vector length in bits (default " << d.vlen << ")" << std::endl
+               << "  --pte 0|1                     embed page table walks (default " << d.pte << ")" << std::endl
+               << "  --pte-ratio R                 page re-walk ratio among memory accesses (default " << d.pte_ratio << ")" << std::endl
+               << "  --mode-switch-interval N      instructions between supervisor excursions, 0 = never (default " << d.mode_switch_interval << ")" << std::endl
+               << "  --mode-switch-length N        instructions per supervisor excursion (default " << d.mode_switch_length << ")" << std::endl
+               << "  --transactions N              TileLink transactions to generate (default " << d.num_transactions << ")" << std::endl
+               << "  --transaction-size N          log2 of the TileLink transfer size (default " << static_cast<int>(d.transaction_size) << ")" << std::endl
+               << "  --transaction-write-ratio R   TileLink write ratio (default " << d.transaction_write_ratio << ")" << std::endl;
+        }
+    };
+
+    /**
+     * \class SyntheticTraceGenerator
+     *
+     * Writes deterministic synthetic instruction and transaction traces. Uses its own PRNG instead of the standard
+     * distributions so that the output is identical across standard library implementations. Shared by the
+     * benchmarks and the regression tests.
+     */
+    class SyntheticTraceGenerator {
+        private:
+            static constexpr uint64_t START_PC_ = 0x10000;
+            static constexpr uint64_t DATA_BASE_ = 0x40000000;
+            static constexpr uint64_t PAGE_SIZE_ = 4096;
+            static constexpr uint64_t PAGE_TABLE_ROOT_ = 0x80000000;
+            static constexpr uint64_t PAGE_TABLE_L1_BASE_ = 0x81000000;
+            static constexpr uint64_t PAGE_TABLE_L0_BASE_ = 0x82000000;
+            static constexpr uint64_t PHYS_BASE_ = 0x200000000;
+            static constexpr uint64_t SV39_SATP_ = (8ULL << 60) | (PAGE_TABLE_ROOT_ >> 12);
+
+            static constexpr uint32_t OP_ADD_ = 0x00b60733; // add a4, a2, a1
+            static constexpr uint16_t OP_C_LI_ = 0x4501; // c.li a0, 0
+            static constexpr uint32_t OP_LD_ = 0x0005b503; // ld a0, 0(a1)
+            static constexpr uint32_t OP_SD_ = 0x00a5b023; // sd a0, 0(a1)
+            static constexpr uint32_t OP_BEQ_ = 0x04b50063; // beq a0, a1, 64
+            static constexpr uint64_t BEQ_OFFSET_ = 64;
+            static constexpr uint32_t OP_VADD_ = 0x022180d7; // vadd.vv v1, v2, v3
+
+            const SyntheticTraceConfig config_;
+            uint64_t rng_state_;
+            std::unordered_set<uint64_t> mapped_pages_;
+            uint64_t num_records_ = 0;
+
+            /**
+             * Gets the next PRNG value (splitmix64)
+             */
+            inline uint64_t next_() {
+                uint64_t z = (rng_state_ += 0x9e3779b97f4a7c15ULL);
+                z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+                z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+                return z ^ (z >> 31);
+            }
+
+            /**
+             * Returns true with the given probability
+             * \param ratio Probability
+             */
+            inline bool chance_(const double ratio) {
+                return static_cast<double>(next_() >> 11) * 0x1.0p-53 < ratio;
+            }
+
+            /**
+             * Writes a record, counting it
+             * \param writer Writer to use
+             * \param rec Record to write
+             */
+            template<typename WriterType>
+            inline void write_(WriterType& writer, const STFRecord& rec) {
+                writer << rec;
+                ++num_records_;
+            }
+
+            /**
+             * Writes a page table walk that maps the page containing va
+             * \param writer Writer to use
+             * \param va Virtual address
+             * \param index Index of the instruction the walk belongs to
+             */
+            inline void walk_(STFWriter& writer, const uint64_t va, const uint64_t index) {
+                const uint64_t page = va / PAGE_SIZE_;
+                const uint64_t vpn2 = (page >> 18) & 0x1ff;
+                const uint64_t vpn1 = (page >> 9) & 0x1ff;
+                const uint64_t vpn0 = page & 0x1ff;
+                const uint64_t l1 = PAGE_TABLE_L1_BASE_ + vpn2 * PAGE_SIZE_;
+                const uint64_t l0 = PAGE_TABLE_L0_BASE_ + (vpn2 * 512 + vpn1) * PAGE_SIZE_;
+                const uint64_t pa = PHYS_BASE_ + page * PAGE_SIZE_;
+
+                std::vector<PageTableWalkRecord::PTE> ptes;
+                ptes.emplace_back(PAGE_TABLE_ROOT_ + vpn2 * 8, ((l1 >> 12) << 10) | 1);
+                ptes.emplace_back(l1 + vpn1 * 8, ((l0 >> 12) << 10) | 1);
+                ptes.emplace_back(l0 + vpn0 * 8, ((pa >> 12) << 10) | 0xf);
+                write_(writer, PageTableWalkRecord(va, index, PAGE_SIZE_, ptes));
+            }
+
+            /**
+             * Writes a page table walk for va if it hasn't been mapped yet, or (with probability pte_ratio) re-walks it
+             * \param writer Writer to use
+             * \param va Virtual address
+             * \param index Index of the instruction the walk belongs to
+             */
+            inline void maybeWalk_(STFWriter& writer, const uint64_t va, const uint64_t index) {
+                if(mapped_pages_.insert(va / PAGE_SIZE_).second || chance_(config_.pte_ratio)) {
+                    walk_(writer, va, index);
+                }
+            }
+
+            /**
+             * Makes a vector register value
+             * \param seed Value to derive the elements from
+             */
+            inline InstRegRecord::VectorType makeVector_(const uint64_t seed) const {
+                InstRegRecord::VectorType data(InstRegRecord::calcVectorLen(config_.vlen));
+                for(size_t i = 0; i < data.size(); ++i) {
+                    data[i] = seed * 131 + i;
+                }
+                return data;
+            }
+
+        public:
+            /**
+             * Constructs a SyntheticTraceGenerator
+             * \param config Trace parameters
+             */
+            explicit SyntheticTraceGenerator(const SyntheticTraceConfig& config) :
+                config_(config),
+                rng_state_(config.seed)
+            {
+            }
+
+            /**
+             * Writes an instruction trace
+             * \param filename Trace to write
+             * \returns Number of records written
+             */
+            inline uint64_t writeInstTrace(const std::string& filename) {
+                rng_state_ = config_.seed;
+                mapped_pages_.clear();
+                num_records_ = 0;
+
+                const bool has_vectors = config_.vector_ratio > 0;
+                const uint64_t num_data_pages = std::max<uint64_t>(config_.mem_footprint / PAGE_SIZE_, 1);
+
+                STFWriter writer;
+                writer.open(filename, -1, config_.chunk_size);
+                writer.addTraceInfo(TraceInfoRecord(STF_GEN::STF_GEN_RESERVED, 1, 0, 0, "stf_lib synthetic trace"));
+                writer.setISA(ISA::RISCV);
+                writer.setHeaderIEM(INST_IEM::STF_INST_IEM_RV64);
+                writer.setTraceFeature(TRACE_FEATURES::STF_CONTAIN_RV64);
+                writer.setTraceFeature(TRACE_FEATURES::STF_CONTAIN_PHYSICAL_ADDRESS);
+                writer.setTraceFeature(TRACE_FEATURES::STF_CONTAIN_EVENT);
+                if(config_.pte) {
+                    writer.setTraceFeature(TRACE_FEATURES::STF_CONTAIN_PTE);
+                }
+                if(has_vectors) {
+                    writer.setTraceFeature(TRACE_FEATURES::STF_CONTAIN_VEC);
+                    writer.setVLen(config_.vlen);
+                }
+                writer.setHeaderPC(START_PC_);
+                writer.finalizeHeader();
+
+                uint64_t pc = START_PC_;
+                uint64_t supervisor_until = 0;
+
+                for(uint64_t i = 0; i < config_.num_insts; ++i) {
+                    // Instruction indices in the trace are 1-based
+                    const uint64_t index = i + 1;
+                    // The first instruction sets up translation, so it can't access memory
+                    const bool is_mem = i != 0 && chance_(config_.mem_ratio);
+                    const bool is_store = is_mem && chance_(config_.store_ratio);
+                    const bool is_branch = !is_mem && chance_(config_.branch_ratio);
+                    const bool is_vector = !is_mem && !is_branch && has_vectors && chance_(config_.vector_ratio);
+                    const uint64_t va = is_mem ? DATA_BASE_ + (next_() % num_data_pages) * PAGE_SIZE_ + (next_() % (PAGE_SIZE_ / 8)) * 8 : 0;
+
+                    if(config_.pte && i != 0) {
+                        maybeWalk_(writer, pc, index);
+                        if(is_mem) {
+                            maybeWalk_(writer, va, index);
+                        }
+                    }
+
+                    if(config_.pte && i == 0) {
+                        write_(writer, InstRegRecord(Registers::STF_REG::STF_REG_CSR_SATP,
+                                                     Registers::STF_REG_OPERAND_TYPE::REG_STATE,
+                                                     SV39_SATP_));
+                        // The first instruction is fetched in user mode, so its page has to be mapped as soon as the
+                        // SATP is known
+                        maybeWalk_(writer, pc, index);
+                    }
+
+                    if(is_vector) {
+                        write_(writer, InstRegRecord(Registers::STF_REG::STF_REG_V2,
+                                                     Registers::STF_REG_OPERAND_TYPE::REG_SOURCE,
+                                                     makeVector_(i)));
+                        write_(writer, InstRegRecord(Registers::STF_REG::STF_REG_V3,
+                                                     Registers::STF_REG_OPERAND_TYPE::REG_SOURCE,
+                                                     makeVector_(i + 1)));
+                        write_(writer, InstRegRecord(Registers::STF_REG::STF_REG_V1,
+                                                     Registers::STF_REG_OPERAND_TYPE::REG_DEST,
+                                                     makeVector_(2 * i + 1)));
+                    }
+                    else {
+                        write_(writer, InstRegRecord(Registers::STF_REG::STF_REG_X11,
+                                                     Registers::STF_REG_OPERAND_TYPE::REG_SOURCE,
+                                                     is_mem ? va : i));
+                        if(is_store || is_branch) {
+                            write_(writer, InstRegRecord(Registers::STF_REG::STF_REG_X10,
+                                                         Registers::STF_REG_OPERAND_TYPE::REG_SOURCE,
+                                                         i * 3));
+                        }
+                        else {
+                            write_(writer, InstRegRecord(Registers::STF_REG::STF_REG_X10,
+                                                         Registers::STF_REG_OPERAND_TYPE::REG_DEST,
+                                                         i * 3));
+                        }
+                    }
+
+                    const bool taken = is_branch && chance_(config_.taken_ratio);
+                    if(taken) {
+                        write_(writer, InstPCTargetRecord(pc + BEQ_OFFSET_));
+                    }
+
+                    if(is_mem) {
+                        write_(writer, InstMemAccessRecord(va, 8, 0, is_store ? INST_MEM_ACCESS::WRITE : INST_MEM_ACCESS::READ));
+                        write_(writer, InstMemContentRecord(i * 7));
+                    }
+
+                    if(config_.pte && i == 0) {
+                        write_(writer, EventRecord(EventRecord::TYPE::MODE_CHANGE, static_cast<uint64_t>(EXECUTION_MODE::USER_MODE)));
+                        write_(writer, EventPCTargetRecord(pc + 4));
+                    }
+
+                    // Periodically trap into supervisor mode and return after mode_switch_length instructions
+                    uint64_t next_pc = pc + 4;
+                    if(config_.mode_switch_interval && !is_branch) {
+                        if(supervisor_until == 0 && index % config_.mode_switch_interval == 0) {
+                            write_(writer, EventRecord(EventRecord::TYPE::USER_ECALL, uint64_t(0)));
+                            write_(writer, EventPCTargetRecord(pc + 0x1000));
+                            write_(writer, EventRecord(EventRecord::TYPE::MODE_CHANGE, static_cast<uint64_t>(EXECUTION_MODE::SUPERVISOR_MODE)));
+                            write_(writer, EventPCTargetRecord(pc + 0x1000));
+                            supervisor_until = index + config_.mode_switch_length;
+                            next_pc = pc + 0x1000;
+                        }
+                        else if(supervisor_until != 0 && index >= supervisor_until) {
+                            write_(writer, EventRecord(EventRecord::TYPE::MODE_CHANGE, static_cast<uint64_t>(EXECUTION_MODE::USER_MODE)));
+                            write_(writer, EventPCTargetRecord(pc + 0x100));
+                            supervisor_until = 0;
+                            next_pc = pc + 0x100;
+                        }
+                    }
+
+                    if(is_mem) {
+                        write_(writer, InstOpcode32Record(is_store ? OP_SD_ : OP_LD_));
+                    }
+                    else if(is_branch) {
+                        write_(writer, InstOpcode32Record(OP_BEQ_));
+                        next_pc = taken ? pc + BEQ_OFFSET_ : pc + 4;
+                    }
+                    else if(is_vector) {
+                        write_(writer, InstOpcode32Record(OP_VADD_));
+                    }
+                    else if(chance_(config_.compressed_ratio)) {
+                        write_(writer, InstOpcode16Record(OP_C_LI_));
+                        if(next_pc == pc + 4) {
+                            next_pc = pc + 2;
+                        }
+                    }
+                    else {
+                        write_(writer, InstOpcode32Record(OP_ADD_));
+                    }
+
+                    pc = next_pc;
+                }
+
+                writer.close();
+                return num_records_;
+            }
+
+            /**
+             * Writes a TileLink transaction trace. Each request on channel A gets a response on channel D, and a
+             * small fraction of the traffic is channel C releases acknowledged on channel E.
+             * \param filename Trace to write
+             * \returns Number of records written
+             */
+            inline uint64_t writeTransactionTrace(const std::string& filename) {
+                using protocols::TileLink;
+                namespace tilelink = protocols::tilelink;
+
+                static constexpr ClockId CLOCK_ID = 1;
+                static constexpr uint8_t TL_GET = 4;
+                static constexpr uint8_t TL_PUT_FULL_DATA = 0;
+                static constexpr uint8_t TL_ACCESS_ACK = 0;
+                static constexpr uint8_t TL_ACCESS_ACK_DATA = 1;
+                static constexpr uint8_t TL_RELEASE_DATA = 7;
+
+                rng_state_ = config_.seed;
+                num_records_ = 0;
+
+                const size_t transfer_bytes = 1ULL << config_.transaction_size;
+                const uint64_t num_lines = std::max<uint64_t>(config_.mem_footprint / transfer_bytes, 1);
+
+                STFTransactionWriter writer(filename, -1, config_.chunk_size);
+                writer.addTraceInfo(TraceInfoRecord(STF_GEN::STF_GEN_RESERVED, 1, 0, 0, "stf_lib synthetic trace"));
+                writer.setTraceFeature(TRACE_FEATURES::STF_CONTAIN_TRANSACTIONS);
+                writer.setProtocolId(protocols::ProtocolId::TILELINK);
+                writer.addClock(CLOCK_ID, "core");
+                writer.finalizeHeader();
+
+                RecordIdManager id_manager;
+                std::vector<uint8_t> data(transfer_bytes);
+                const std::vector<uint8_t> mask(transfer_bytes, 1);
+                const std::vector<uint8_t> no_data;
+
+                for(uint64_t i = 0; i < config_.num_transactions; ++i) {
+                    const uint64_t address = PHYS_BASE_ + (next_() % num_lines) * transfer_bytes;
+                    const uint64_t source = next_() % 16;
+                    const uint64_t delta = 1 + next_() % 4;
+                    for(size_t j = 0; j < data.size(); ++j) {
+                        data[j] = static_cast<uint8_t>(i + j);
+                    }
+
+                    if(chance_(0.05)) {
+                        write_(writer, TileLink::makeTransactionWithDelta<tilelink::ChannelC>(id_manager, CLOCK_ID, delta,
+                                                                                             TL_RELEASE_DATA, uint8_t(0),
+                                                                                             config_.transaction_size,
+                                                                                             source, data, address));
+                        write_(writer, TileLink::makeTransactionWithDelta<tilelink::ChannelE>(id_manager, CLOCK_ID, delta,
+                                                                                             source));
+                    }
+                    else if(chance_(config_.transaction_write_ratio)) {
+                        write_(writer, TileLink::makeTransactionWithDelta<tilelink::ChannelA>(id_manager, CLOCK_ID, delta,
+                                                                                             TL_PUT_FULL_DATA, uint8_t(0),
+                                                                                             config_.transaction_size,
+                                                                                             source, data, address, mask));
+                        write_(writer, TileLink::makeTransactionWithDelta<tilelink::ChannelD>(id_manager, CLOCK_ID, delta,
+                                                                                             TL_ACCESS_ACK, uint8_t(0),
+                                                                                             config_.transaction_size,
+                                                                                             source, no_data, uint64_t(0)));
+                    }
+                    else {
+                        write_(writer, TileLink::makeTransactionWithDelta<tilelink::ChannelA>(id_manager, CLOCK_ID, delta,
+                                                                                             TL_GET, uint8_t(0),
+                                                                                             config_.transaction_size,
+                                                                                             source, no_data, address, mask));
+                        write_(writer, TileLink::makeTransactionWithDelta<tilelink::ChannelD>(id_manager, CLOCK_ID, delta,
+                                                                                             TL_ACCESS_ACK_DATA, uint8_t(0),
+                                                                                             config_.transaction_size,
+                                                                                             source, data, uint64_t(0)));
+                    }
+                }
+
+                writer.close();
+                return num_records_;
+            }
+    };
+} // end namespace stf::synthetic
+
+#endif
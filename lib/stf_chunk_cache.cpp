@@ -0,0 +1,141 @@
+#include <map>
+#include <tuple>
+
+#include "stf_chunk_cache.hpp"
+#include "stf_exception.hpp"
+
+namespace stf {
+    std::shared_ptr<STFChunkCache> STFChunkCache::attach(const struct stat& file_stat) {
+        // Size and modification time are part of the key so that a rewritten trace doesn't pick up stale chunks
+        using FileKey = std::tuple<dev_t, ino_t, off_t, time_t, long>;
+        static std::mutex registry_mutex;
+        static std::map<FileKey, std::weak_ptr<STFChunkCache>> registry;
+
+        const FileKey key(file_stat.st_dev,
+                          file_stat.st_ino,
+                          file_stat.st_size,
+                          file_stat.st_mtim.tv_sec,
+                          file_stat.st_mtim.tv_nsec);
+
+        std::lock_guard<std::mutex> lock(registry_mutex);
+
+        // Forget caches for files that nobody is reading anymore
+        for(auto it = registry.begin(); it != registry.end();) {
+            if(it->second.expired()) {
+                it = registry.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+
+        auto& entry = registry[key];
+        auto cache = entry.lock();
+        if(!cache) {
+            cache = std::make_shared<STFChunkCache>();
+            entry = cache;
+        }
+
+        return cache;
+    }
+
+    void STFChunkCache::reserve(const size_t num_bytes) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(num_bytes > capacity_) {
+            capacity_ = num_bytes;
+        }
+    }
+
+    void STFChunkCache::evict_(const size_t num_bytes) {
+        while(num_bytes_ > num_bytes) {
+            const auto& entry = entries_.back();
+            num_bytes_ -= entry.buf.getActualSize();
+            index_.erase(entry.chunk_idx);
+            entries_.pop_back();
+            ++evictions_;
+        }
+    }
+
+    void STFChunkCache::setCapacity(const size_t num_bytes) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        capacity_ = num_bytes;
+        evict_(capacity_);
+    }
+
+    size_t STFChunkCache::getCapacity() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return capacity_;
+    }
+
+    bool STFChunkCache::find(const size_t chunk_idx, STFCompressionBuffer& buf) {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if(STF_EXPECT_TRUE(capacity_ == 0)) {
+            return false;
+        }
+
+        const auto it = index_.find(chunk_idx);
+        if(it == index_.end()) {
+            ++misses_;
+            return false;
+        }
+
+        entries_.splice(entries_.begin(), entries_, it->second);
+        buf.shareFrom(it->second->buf);
+        ++hits_;
+
+        return true;
+    }
+
+    void STFChunkCache::insert(const size_t chunk_idx, const STFCompressionBuffer& buf) {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        const size_t num_bytes = buf.getActualSize();
+        // A disabled cache has a capacity of 0, so nothing fits in it
+        if(num_bytes > capacity_) {
+            return;
+        }
+
+        if(const auto it = index_.find(chunk_idx); it != index_.end()) {
+            num_bytes_ -= it->second->buf.getActualSize();
+            entries_.erase(it->second);
+            index_.erase(it);
+        }
+
+        evict_(capacity_ - num_bytes);
+
+        auto& entry = entries_.emplace_front();
+        entry.chunk_idx = chunk_idx;
+        entry.buf.shareFrom(buf);
+        index_.emplace(chunk_idx, entries_.begin());
+        num_bytes_ += num_bytes;
+    }
+
+    void STFChunkCache::clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.clear();
+        index_.clear();
+        num_bytes_ = 0;
+    }
+
+    STFChunkCache::Stats STFChunkCache::getStats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        Stats stats;
+        stats.capacity = capacity_;
+        stats.num_bytes = num_bytes_;
+        stats.num_chunks = entries_.size();
+        stats.hits = hits_;
+        stats.misses = misses_;
+        stats.evictions = evictions_;
+
+        return stats;
+    }
+
+    void STFChunkCache::resetStats() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        hits_ = 0;
+        misses_ = 0;
+        evictions_ = 0;
+    }
+} // end namespace stf
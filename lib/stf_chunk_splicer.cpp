@@ -0,0 +1,369 @@
+#include <algorithm>
+#include <map>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "stf_chunk_splicer.hpp"
+#include "stf_chunk_state.hpp"
+#include "stf_compressed_chunk.hpp"
+#include "stf_exception.hpp"
+#include "stf_reader.hpp"
+#include "stf_record_types.hpp"
+
+namespace stf {
+    namespace {
+        /**
+         * \class TranslationStateTracker
+         *
+         * Follows the SATP value, execution mode and page table walks in a source trace so that the page table in
+         * effect at the start of a range can be replayed into the output. Only the page table for the SATP value in
+         * effect at the start of the range is kept.
+         */
+        class TranslationStateTracker {
+            private:
+                /**
+                 * \struct Walk
+                 * Virtual page mapped by a page table walk, and the addresses of the PTEs it went through
+                 */
+                struct Walk {
+                    uint64_t va = 0; /**< Virtual address */
+                    uint32_t page_size = 0; /**< Page size in bytes */
+                    std::vector<uint64_t> pte_addrs; /**< Physical addresses of the PTEs */
+                };
+
+                /**
+                 * \struct PageTable
+                 * Latest PTE values and walks seen for a single SATP value
+                 */
+                struct PageTable {
+                    std::unordered_map<uint64_t, uint64_t> ptes; /**< Maps PTE physical addresses to their latest values */
+                    std::map<uint64_t, Walk> walks; /**< Maps leaf PTE physical addresses to the latest walk that used them */
+                };
+
+                std::map<uint64_t, uint64_t> satp_values_; /**< Maps instruction indices to the SATP value that takes effect there */
+                std::unordered_map<uint64_t, PageTable> page_tables_; /**< Page tables for each SATP value */
+                bool has_mode_ = false; /**< Set to true once a mode change event has been seen */
+                EXECUTION_MODE mode_ = EXECUTION_MODE::MACHINE_MODE; /**< Current execution mode */
+
+                /**
+                 * Gets the SATP value in effect at the given instruction index. Returns nullptr if there isn't one.
+                 * \param index Instruction index
+                 */
+                inline const uint64_t* getSatp_(const uint64_t index) const {
+                    const auto it = satp_values_.upper_bound(index);
+                    return it == satp_values_.begin() ? nullptr : &std::prev(it)->second;
+                }
+
+            public:
+                /**
+                 * Updates the state with the given record. The effective instruction indices match STFPTEReader.
+                 * \param rec Record to inspect
+                 * \param num_insts_read Number of instructions read before the record
+                 */
+                void track(const STFRecord& rec, const uint64_t num_insts_read) {
+                    switch(rec.getId()) {
+                        case descriptors::internal::Descriptor::STF_INST_REG:
+                            {
+                                const auto& reg_rec = rec.as<InstRegRecord>();
+                                const auto type = reg_rec.getOperandType();
+                                if(reg_rec.getReg() == Registers::STF_REG::STF_REG_CSR_SATP &&
+                                   (type == Registers::STF_REG_OPERAND_TYPE::REG_STATE ||
+                                    type == Registers::STF_REG_OPERAND_TYPE::REG_DEST)) {
+                                    const bool is_state = type == Registers::STF_REG_OPERAND_TYPE::REG_STATE;
+                                    satp_values_.try_emplace(num_insts_read + 2*(!is_state), reg_rec.getScalarData());
+                                }
+                            }
+                            break;
+                        case descriptors::internal::Descriptor::STF_EVENT:
+                            if(const auto& event = rec.as<EventRecord>(); event.isModeChange()) {
+                                has_mode_ = true;
+                                mode_ = static_cast<EXECUTION_MODE>(event.getData().front());
+                            }
+                            break;
+                        case descriptors::internal::Descriptor::STF_PAGE_TABLE_WALK:
+                            {
+                                const auto& walk_rec = rec.as<PageTableWalkRecord>();
+                                const auto satp = getSatp_(walk_rec.getFirstAccessIndex());
+                                if(!satp || walk_rec.getPTEs().empty()) {
+                                    break;
+                                }
+
+                                auto& page_table = page_tables_[*satp];
+                                Walk& walk = page_table.walks[walk_rec.getLeafPTE().getPA()];
+                                walk.va = walk_rec.getVA();
+                                walk.page_size = walk_rec.getPageSize();
+                                walk.pte_addrs.clear();
+                                for(const auto& pte: walk_rec.getPTEs()) {
+                                    walk.pte_addrs.emplace_back(pte.getPA());
+                                    page_table.ptes[pte.getPA()] = pte.getPTE();
+                                }
+                            }
+                            break;
+                        default:
+                            break;
+                    }
+                }
+
+                /**
+                 * Builds the records that restore the translation state at the given point in the source
+                 * \param src_index Index of the first source instruction that the records apply to
+                 * \param dest_index Instruction index in the output that the page table walks are replayed at
+                 * \param include_mode If false, the execution mode is only restored if a mode change event was seen
+                 * \param satp_rec Receives the SATP record, if the source has a SATP value at src_index
+                 * \param mode_rec Receives the mode change record, if there is one
+                 * \param walks Receives the page table walks
+                 */
+                void getRecords(const uint64_t src_index,
+                                const uint64_t dest_index,
+                                const bool include_mode,
+                                std::optional<InstRegRecord>& satp_rec,
+                                std::optional<EventRecord>& mode_rec,
+                                std::vector<PageTableWalkRecord>& walks) const {
+                    if(has_mode_ || include_mode) {
+                        mode_rec.emplace(EventRecord::TYPE::MODE_CHANGE, static_cast<uint64_t>(mode_));
+                    }
+
+                    const auto satp = getSatp_(src_index);
+                    if(!satp) {
+                        return;
+                    }
+
+                    satp_rec.emplace(Registers::STF_REG::STF_REG_CSR_SATP, Registers::STF_REG_OPERAND_TYPE::REG_STATE, *satp);
+
+                    const auto page_table_it = page_tables_.find(*satp);
+                    if(page_table_it == page_tables_.end()) {
+                        return;
+                    }
+
+                    // Every PTE gets its latest value, so PTEs shared by several walks never conflict
+                    const auto& page_table = page_table_it->second;
+                    walks.reserve(page_table.walks.size());
+                    for(const auto& [leaf_addr, walk]: page_table.walks) {
+                        std::vector<PageTableWalkRecord::PTE> ptes;
+                        ptes.reserve(walk.pte_addrs.size());
+                        for(const auto addr: walk.pte_addrs) {
+                            ptes.emplace_back(addr, page_table.ptes.at(addr));
+                        }
+                        walks.emplace_back(walk.va, dest_index, walk.page_size, std::move(ptes));
+                    }
+                }
+        };
+    } // end anonymous namespace
+
+    STFChunkSplicer::STFChunkSplicer(const std::string_view filename) :
+        filename_(filename)
+    {
+    }
+
+    STFChunkSplicer::~STFChunkSplicer() = default;
+
+    void STFChunkSplicer::openOutput_(const STFReader& reader, const ChunkStateSnapshot& state) {
+        chunk_size_ = reader.getChunkSize() ? reader.getChunkSize() : STFWriter::DEFAULT_CHUNK_SIZE;
+        writer_.open(filename_, -1, chunk_size_);
+
+        reader.copyHeader(writer_);
+        writer_.setHeaderPC(reader.getNextPC());
+
+        if(state.getIEM() != INST_IEM::STF_INST_IEM_INVALID) {
+            writer_.setHeaderIEM(state.getIEM());
+        }
+        if(state.hasProcessIDs()) {
+            writer_.setHeaderProcessID(state.getHardwareTID(), state.getPID(), state.getTID());
+        }
+
+        writer_.finalizeHeader();
+    }
+
+    uint64_t STFChunkSplicer::copyChunks_(STFReader& reader,
+                                          const uint64_t start,
+                                          const uint64_t end,
+                                          bool& copyable) {
+        // Copied chunks have to start on a chunk boundary in both traces. The first output chunk also holds the
+        // header, so it is always rewritten.
+        if(!copyable || start % chunk_size_ || !num_markers_ || num_markers_ % chunk_size_) {
+            return 0;
+        }
+
+        CompressedChunk chunk;
+        uint64_t num_copied = 0;
+
+        for(size_t chunk_idx = start / chunk_size_; start + num_copied + chunk_size_ <= end; ++chunk_idx) {
+            // Either this was the last chunk in the source, or the output needs something the source doesn't have
+            if(!reader.readCompressedChunk(chunk_idx, chunk) || !writer_.appendCompressedChunk(chunk)) {
+                copyable = false;
+                break;
+            }
+
+            num_copied += chunk_size_;
+            num_markers_ += chunk_size_;
+            ++num_copied_chunks_;
+        }
+
+        return num_copied;
+    }
+
+    void STFChunkSplicer::append(const std::string_view filename, const uint64_t start, const uint64_t end) {
+        stf_assert(start <= end, "Range start (" << start << ") comes after its end (" << end << ")");
+
+        if(start == end) {
+            return;
+        }
+
+        // Chunks are only decompressed when they are read, so copied chunks are never decompressed
+        STFReader reader(filename, true);
+        const size_t src_chunk_size = reader.getChunkSize();
+        const auto& snapshots = reader.getChunkStateSnapshots();
+
+        // Chunk snapshots don't hold the page table, so it has to be rebuilt from the beginning of the source
+        const bool has_ptes = reader.getTraceFeatures()->hasAnyFeatures(TRACE_FEATURES::STF_CONTAIN_PTE,
+                                                                        TRACE_FEATURES::STF_CONTAIN_PTE_ONLY,
+                                                                        TRACE_FEATURES::STF_CONTAIN_PTE_HW_AD);
+
+        // The state at the start of the range comes from replaying the records before it, starting from the nearest
+        // snapshot if the source has them or from the beginning of the trace if it doesn't
+        const size_t start_chunk = (src_chunk_size && !snapshots.empty() && !has_ptes) ? start / src_chunk_size : 0;
+
+        if(start_chunk) {
+            reader.seek(start_chunk * src_chunk_size);
+        }
+
+        ChunkStateTracker state_tracker;
+        state_tracker.setState(snapshots.empty() ? ChunkStateSnapshot() : snapshots[start_chunk]);
+        TranslationStateTracker translation_tracker;
+
+        STFRecord::UniqueHandle rec;
+        try {
+            while(reader.numMarkerRecordsRead() < start) {
+                reader >> rec;
+                state_tracker.track(*rec);
+                if(has_ptes) {
+                    translation_tracker.track(*rec, reader.numInstsRead());
+                }
+            }
+        }
+        catch(const EOFException&) {
+            stf_throw("Range start (" << start << ") is past the end of " << filename);
+        }
+
+        const ChunkStateSnapshot state = state_tracker.getSnapshot(num_markers_);
+        const bool first_range = !writer_;
+
+        // Records that restore the state where the range starts. They have to be merged into the first record group
+        // in descriptor order. The second member is true if the record is dropped when the source sets it too.
+        const ForcePCRecord force_pc(reader.getNextPC());
+        const InstIEMRecord iem(state.getIEM() == INST_IEM::STF_INST_IEM_INVALID ? reader.getInitialIEM() : state.getIEM());
+        const ProcessIDExtRecord process_id(state.hasProcessIDs() ? state.getHardwareTID() : reader.getInitialHardwareTID(),
+                                            state.hasProcessIDs() ? state.getPID() : reader.getInitialPID(),
+                                            state.hasProcessIDs() ? state.getTID() : reader.getInitialTID());
+        std::vector<std::pair<const STFRecord*, bool>> pending_records;
+
+        if(first_range) {
+            openOutput_(reader, state);
+            // STFInstReader doesn't take thread IDs from the header, so they still have to be set in the trace
+            if(state.hasProcessIDs()) {
+                pending_records.emplace_back(&process_id, true);
+            }
+        }
+        else {
+            pending_records = {{&iem, true}, {&process_id, true}, {&force_pc, true}};
+        }
+
+        // The SATP value, execution mode and live page table walks are replayed into the first record group. Walks
+        // take effect at the last instruction before the range so that walks in the range itself take precedence.
+        // Later ranges always set the mode, since the previous range may have left the output in a different one.
+        std::optional<InstRegRecord> satp_rec;
+        std::optional<EventRecord> mode_rec;
+        std::vector<PageTableWalkRecord> walks;
+        if(has_ptes) {
+            translation_tracker.getRecords(start + 1, num_markers_, !first_range, satp_rec, mode_rec, walks);
+            for(const auto& walk: walks) {
+                pending_records.emplace_back(&walk, false);
+            }
+            if(satp_rec) {
+                pending_records.emplace_back(&*satp_rec, false);
+            }
+            if(mode_rec) {
+                pending_records.emplace_back(&*mode_rec, false);
+            }
+            std::stable_sort(pending_records.begin(),
+                             pending_records.end(),
+                             [](const auto& lhs, const auto& rhs) {
+                                 return descriptors::conversion::toEncoded(lhs.first->getId()) <
+                                        descriptors::conversion::toEncoded(rhs.first->getId());
+                             });
+        }
+
+        writer_.setChunkState(state);
+
+        // Page table walks are tagged with the instruction index they take effect at, so they have to be shifted to
+        // match the output. Copied chunks can't be changed, so they are only copied if no shift is needed.
+        const uint64_t range_start_index = num_markers_;
+        bool copyable = src_chunk_size == chunk_size_ && (!has_ptes || range_start_index == start);
+        uint64_t pos = start;
+
+        while(pos < end) {
+            if(pending_records.empty()) {
+                if(const uint64_t num_copied = copyChunks_(reader, pos, end, copyable)) {
+                    pos += num_copied;
+                    // Don't bother decompressing the next chunk if we aren't going to read it
+                    if(pos < end) {
+                        reader.seek(pos - reader.numMarkerRecordsRead());
+                    }
+                    continue;
+                }
+            }
+
+            // Rewrite the records up to the end of the current source chunk
+            const uint64_t stop = src_chunk_size ? std::min(end, (pos / src_chunk_size + 1) * src_chunk_size) : end;
+            const uint64_t rewrite_start = pos;
+            bool eof = false;
+
+            try {
+                while(pos < stop) {
+                    reader >> rec;
+
+                    const auto desc = descriptors::conversion::toEncoded(rec->getId());
+                    auto it = pending_records.begin();
+                    for(; it != pending_records.end() && descriptors::conversion::toEncoded(it->first->getId()) <= desc; ++it) {
+                        // The source already sets this at the start of the range, so it doesn't need to be restored
+                        if(!it->second || descriptors::conversion::toEncoded(it->first->getId()) != desc) {
+                            writer_ << *it->first;
+                        }
+                    }
+                    pending_records.erase(pending_records.begin(), it);
+
+                    if(STF_EXPECT_FALSE(has_ptes && rec->getId() == descriptors::internal::Descriptor::STF_PAGE_TABLE_WALK)) {
+                        auto walk = rec->as<PageTableWalkRecord>();
+                        const uint64_t index = walk.getFirstAccessIndex();
+                        walk.setFirstAccessIndex(range_start_index + (index > start ? index - start : 1));
+                        writer_ << walk;
+                    }
+                    else {
+                        writer_ << *rec;
+                    }
+                    pos = reader.numMarkerRecordsRead();
+                }
+            }
+            catch(const EOFException&) {
+                eof = true;
+            }
+
+            if(pos != rewrite_start) {
+                num_markers_ += pos - rewrite_start;
+                ++num_rewritten_chunks_;
+            }
+
+            if(eof) {
+                break;
+            }
+        }
+    }
+
+    void STFChunkSplicer::close() {
+        if(writer_) {
+            writer_.close();
+        }
+    }
+} // end namespace stf
@@ -0,0 +1,51 @@
+#include "stf_chunk_state.hpp"
+#include "stf_record_types.hpp"
+
+namespace stf {
+    void ChunkStateTracker::track(const STFRecord& rec) {
+        if(STF_EXPECT_FALSE(!header_done_)) {
+            header_done_ = rec.getId() == descriptors::internal::Descriptor::STF_END_HEADER;
+            return;
+        }
+
+        switch(rec.getId()) {
+            case descriptors::internal::Descriptor::STF_INST_REG:
+                {
+                    const auto& reg_rec = rec.as<InstRegRecord>();
+                    auto& values = state_.registers_[reg_rec.getReg()];
+                    if(reg_rec.isVector()) {
+                        const auto& data = reg_rec.getVectorData();
+                        values.assign(data.begin(), data.end());
+                    }
+                    else {
+                        values.assign(1, reg_rec.getScalarData());
+                    }
+                }
+                break;
+            case descriptors::internal::Descriptor::STF_INST_IEM:
+                state_.iem_ = rec.as<InstIEMRecord>().getMode();
+                break;
+            case descriptors::internal::Descriptor::STF_EVENT:
+                {
+                    const auto& event = rec.as<EventRecord>();
+                    if(event.isModeChange() &&
+                       !event.getData().empty() &&
+                       event.getData().front() <= enums::to_int(EXECUTION_MODE::MACHINE_MODE)) {
+                        state_.mode_ = static_cast<EXECUTION_MODE>(event.getData().front());
+                    }
+                }
+                break;
+            case descriptors::internal::Descriptor::STF_PROCESS_ID_EXT:
+                {
+                    const auto& pid_rec = rec.as<ProcessIDExtRecord>();
+                    state_.has_process_ids_ = true;
+                    state_.hart_ = pid_rec.getHardwareTID();
+                    state_.pid_ = pid_rec.getPID();
+                    state_.tid_ = pid_rec.getTID();
+                }
+                break;
+            default:
+                break;
+        }
+    }
+} // end namespace stf
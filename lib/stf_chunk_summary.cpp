@@ -0,0 +1,41 @@
+#include "stf_chunk_summary.hpp"
+#include "stf_record_types.hpp"
+
+namespace stf {
+    void ChunkSummaryTracker::track(const STFRecord& rec) {
+        const auto desc = rec.getId();
+        ++summary_.descriptor_counts_[enums::to_int(descriptors::conversion::toEncoded(desc))];
+
+        switch(desc) {
+            case descriptors::internal::Descriptor::STF_INST_MEM_ACCESS:
+                ++summary_.num_mem_accesses_;
+                break;
+            case descriptors::internal::Descriptor::STF_EVENT:
+                {
+                    ++summary_.num_events_;
+                    const auto& event = rec.as<EventRecord>();
+                    if(event.isModeChange() &&
+                       !event.getData().empty() &&
+                       event.getData().front() <= enums::to_int(EXECUTION_MODE::MACHINE_MODE)) {
+                        mode_ = static_cast<EXECUTION_MODE>(event.getData().front());
+                        summary_.addExecutionMode(mode_);
+                    }
+                }
+                break;
+            case descriptors::internal::Descriptor::STF_PROCESS_ID_EXT:
+                {
+                    const auto& pid_rec = rec.as<ProcessIDExtRecord>();
+                    has_process_ids_ = true;
+                    hart_ = pid_rec.getHardwareTID();
+                    pid_ = pid_rec.getPID();
+                    tid_ = pid_rec.getTID();
+                    summary_.hart_range_.add(hart_);
+                    summary_.pid_range_.add(pid_);
+                    summary_.tid_range_.add(tid_);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+} // end namespace stf
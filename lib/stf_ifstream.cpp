@@ -5,11 +5,18 @@ namespace stf {
     // cppcheck-suppress unusedFunction
     void STFIFstream::seek(size_t num_marker_records) {
         const size_t end_marker_num = num_marker_records_ + num_marker_records;
-        STFRecord::UniqueHandle rec;
 
         try {
+            // Skipped records are never returned, so we don't need to construct them
             while(operator bool() && (num_marker_records_ < end_marker_num)) {
-                operator>>(rec);
+                try {
+                    STFRecord::factory_type::skip(*this);
+                }
+                catch(const InvalidDescriptorException&) {
+                    // Check to see if the invalid descriptor was because the file ended
+                    checkStream_();
+                    throw;
+                }
             }
         }
         catch(const EOFException&) {
@@ -26,6 +33,36 @@ namespace stf {
         }
     }
 
+    const std::vector<ChunkSummary>& STFIFstream::getChunkSummaries() const {
+        static const std::vector<ChunkSummary> NO_SUMMARIES;
+        return NO_SUMMARIES;
+    }
+
+    const std::vector<ChunkStateSnapshot>& STFIFstream::getChunkStateSnapshots() const {
+        static const std::vector<ChunkStateSnapshot> NO_SNAPSHOTS;
+        return NO_SNAPSHOTS;
+    }
+
+    size_t STFIFstream::getNumChunks() const {
+        return 1;
+    }
+
+    size_t STFIFstream::getChunkSize() const {
+        return 0;
+    }
+
+    bool STFIFstream::readCompressedChunk(const size_t, CompressedChunk&) {
+        return false;
+    }
+
+    STFChunkCache::Stats STFIFstream::getChunkCacheStats() const {
+        return STFChunkCache::Stats();
+    }
+
+    STFSharedChunkCache::Stats STFIFstream::getSharedChunkCacheStats() const {
+        return STFSharedChunkCache::Stats();
+    }
+
     void STFIFstream::rewind() {
         num_marker_records_ = 0;
         fseek(stream_, static_cast<ssize_t>(trace_start_), SEEK_SET);
@@ -0,0 +1,147 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "stf_env_var.hpp"
+#include "stf_index_sidecar.hpp"
+
+namespace stf {
+    namespace {
+        /**
+         * Fixed-size header at the start of a sidecar file
+         */
+        struct SidecarHeader {
+            uint32_t magic = 0;
+            uint32_t version = 0;
+            uint64_t granularity = 0;
+            uint64_t trace_size = 0;
+            int64_t trace_mtime_sec = 0;
+            int64_t trace_mtime_nsec = 0;
+            uint64_t num_entries = 0;
+        };
+
+        constexpr size_t ENTRY_WORDS = 3; /**< Each entry holds a marker index, trace offset, and PC */
+        constexpr size_t ENTRY_SIZE = ENTRY_WORDS * sizeof(uint64_t); /**< Size of each entry in bytes */
+    } // end anonymous namespace
+
+    STFIndexSidecar::STFIndexSidecar(const std::string_view trace) :
+        trace_(trace)
+    {
+        struct stat trace_stat;
+        trace_valid_ = !trace_.empty() && trace_ != "-" && stat(trace_.c_str(), &trace_stat) == 0 && S_ISREG(trace_stat.st_mode);
+        if(trace_valid_) {
+            trace_size_ = static_cast<uint64_t>(trace_stat.st_size);
+            trace_mtime_sec_ = static_cast<int64_t>(trace_stat.st_mtim.tv_sec);
+            trace_mtime_nsec_ = static_cast<int64_t>(trace_stat.st_mtim.tv_nsec);
+        }
+    }
+
+    bool STFIndexSidecar::enabledByDefault() {
+        return STFBooleanEnvVar("STF_INDEX_SIDECAR").get();
+    }
+
+    std::string STFIndexSidecar::getPath(const std::string_view trace) {
+        return std::string(trace) + ".stfidx";
+    }
+
+    bool STFIndexSidecar::load(const size_t granularity, IndexMap& index_map) const {
+        if(!trace_valid_) {
+            return false;
+        }
+
+        FILE* const file = fopen(getPath(trace_).c_str(), "rb");
+        if(!file) {
+            return false;
+        }
+
+        struct stat sidecar_stat;
+        SidecarHeader header;
+        std::vector<uint64_t> entries;
+        bool valid = fstat(fileno(file), &sidecar_stat) == 0 &&
+                     fread(&header, sizeof(header), 1, file) == 1 &&
+                     header.magic == MAGIC &&
+                     header.version == VERSION &&
+                     header.granularity == granularity &&
+                     header.trace_size == trace_size_ &&
+                     header.trace_mtime_sec == trace_mtime_sec_ &&
+                     header.trace_mtime_nsec == trace_mtime_nsec_ &&
+                     static_cast<uint64_t>(sidecar_stat.st_size) == sizeof(header) + ENTRY_SIZE * header.num_entries;
+
+        if(valid) {
+            entries.resize(ENTRY_WORDS * header.num_entries);
+            valid = fread(entries.data(), sizeof(uint64_t), entries.size(), file) == entries.size();
+        }
+
+        fclose(file);
+
+        if(!valid) {
+            return false;
+        }
+
+        index_map.clear();
+        for(size_t i = 0; i < entries.size(); i += ENTRY_WORDS) {
+            index_map.emplace_hint(index_map.end(), entries[i], Entry{entries[i + 1], entries[i + 2]});
+        }
+
+        return true;
+    }
+
+    void STFIndexSidecar::save(const size_t granularity, const IndexMap& index_map) const {
+        if(!trace_valid_) {
+            return;
+        }
+
+        // Don't save an index for a trace that changed while it was being scanned
+        if(const STFIndexSidecar current(trace_); current.trace_size_ != trace_size_ ||
+                                                  current.trace_mtime_sec_ != trace_mtime_sec_ ||
+                                                  current.trace_mtime_nsec_ != trace_mtime_nsec_) {
+            return;
+        }
+
+        SidecarHeader header;
+        header.magic = MAGIC;
+        header.version = VERSION;
+        header.granularity = granularity;
+        header.trace_size = trace_size_;
+        header.trace_mtime_sec = trace_mtime_sec_;
+        header.trace_mtime_nsec = trace_mtime_nsec_;
+        header.num_entries = index_map.size();
+
+        std::vector<uint64_t> entries;
+        entries.reserve(ENTRY_WORDS * index_map.size());
+        for(const auto& entry: index_map) {
+            entries.emplace_back(entry.first);
+            entries.emplace_back(entry.second.offset);
+            entries.emplace_back(entry.second.pc);
+        }
+
+        const auto path = getPath(trace_);
+        auto tmp_path = path + ".XXXXXX";
+
+        const int fd = mkstemp(tmp_path.data());
+        if(fd < 0) {
+            return;
+        }
+
+        // mkstemp only grants access to the owner, but the sidecar should be as readable as the trace
+        fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+
+        FILE* const file = fdopen(fd, "wb");
+        if(!file) {
+            close(fd);
+            remove(tmp_path.c_str());
+            return;
+        }
+
+        const bool success = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                             fwrite(entries.data(), sizeof(uint64_t), entries.size(), file) == entries.size();
+
+        if(fclose(file) != 0 || !success || rename(tmp_path.c_str(), path.c_str()) != 0) {
+            remove(tmp_path.c_str());
+        }
+    }
+} // end namespace stf
@@ -11,4 +11,11 @@ namespace stf {
         rec.pack(*this);
         return *this;
     }
+
+    bool STFOFstream::appendCompressedChunk(const CompressedChunk&) {
+        return false;
+    }
+
+    void STFOFstream::setChunkState(const ChunkStateSnapshot&) {
+    }
 } // end namespace stf
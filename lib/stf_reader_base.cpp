@@ -4,6 +4,7 @@
 #include "stf_record_types.hpp"
 #include "stf_compressed_ifstream.hpp"
 #include "stf_compressed_ifstream_single_threaded.hpp"
+#include "stf_decompressing_ifstream.hpp"
 #include "zstd/stf_zstd_decompressor.hpp"
 
 namespace stf {
@@ -25,23 +26,49 @@ namespace stf {
         stream_->openWithProcess(cmd, filename);
     }
 
+    template<typename Decoder>
+    void STFReaderBase::initDecompressingStreamAndOpen_(const std::string_view filename, const bool force_single_threaded_stream) {
+        using StreamType = STFDecompressingIFstream<Decoder>;
+        auto decompressing_stream = std::make_unique<StreamType>();
+        decompressing_stream->setSingleThreaded(force_single_threaded_stream || STFBooleanEnvVar("STF_SINGLE_THREADED"));
+        decompressing_stream->setReadAheadDepth(STFIntegerEnvVar<size_t>("STF_READ_AHEAD_DEPTH",
+                                                                         StreamType::DEFAULT_READ_AHEAD_DEPTH));
+        decompressing_stream->open(filename);
+        stream_ = std::move(decompressing_stream);
+    }
+
     void STFReaderBase::open(const std::string_view filename, const bool force_single_threaded_stream) {
         stf_assert(!operator bool(), "Attempted to open STFReaderBase that was already open");
 
         switch(getFileType_(filename)) {
             case STF_FILE_TYPE::ZSTF:
                 if(force_single_threaded_stream || STFBooleanEnvVar("STF_SINGLE_THREADED")) {
-                    stream_ = std::make_unique<STFCompressedIFstreamSingleThreaded<ZSTDDecompressor>>(filename);
+                    auto zstf_stream = std::make_unique<STFCompressedIFstreamSingleThreaded<ZSTDDecompressor>>();
+                    zstf_stream->setUseMmap(STFBooleanEnvVar("STF_USE_MMAP"));
+                    zstf_stream->setUseRecordViews(STFBooleanEnvVar("STF_RECORD_VIEWS"));
+                    zstf_stream->setChunkCacheSize(STFIntegerEnvVar<size_t>("STF_CHUNK_CACHE_MB") << 20);
+                    zstf_stream->setSharedChunkCacheSize(STFIntegerEnvVar<size_t>("STF_SHARED_CHUNK_CACHE_MB") << 20);
+                    zstf_stream->open(filename);
+                    stream_ = std::move(zstf_stream);
                 }
                 else {
-                    stream_ = std::make_unique<STFCompressedIFstream<ZSTDDecompressor>>(filename);
+                    using StreamType = STFCompressedIFstream<ZSTDDecompressor>;
+                    auto zstf_stream = std::make_unique<StreamType>();
+                    zstf_stream->setReadAheadDepth(STFIntegerEnvVar<size_t>("STF_READ_AHEAD_DEPTH",
+                                                                            StreamType::DEFAULT_READ_AHEAD_DEPTH));
+                    zstf_stream->setUseMmap(STFBooleanEnvVar("STF_USE_MMAP"));
+                    zstf_stream->setUseRecordViews(STFBooleanEnvVar("STF_RECORD_VIEWS"));
+                    zstf_stream->setChunkCacheSize(STFIntegerEnvVar<size_t>("STF_CHUNK_CACHE_MB") << 20);
+                    zstf_stream->setSharedChunkCacheSize(STFIntegerEnvVar<size_t>("STF_SHARED_CHUNK_CACHE_MB") << 20);
+                    zstf_stream->open(filename);
+                    stream_ = std::move(zstf_stream);
                 }
                 break;
             case STF_FILE_TYPE::STF_GZ:
-                initSimpleStreamAndOpenProcess_("gzip -dc ", filename);
+                initDecompressingStreamAndOpen_<ZlibDecoder>(filename, force_single_threaded_stream);
                 break;
             case STF_FILE_TYPE::STF_XZ:
-                initSimpleStreamAndOpenProcess_("xz -dc ", filename);
+                initDecompressingStreamAndOpen_<LZMADecoder>(filename, force_single_threaded_stream);
                 break;
             case STF_FILE_TYPE::STF_SH:
                 initSimpleStreamAndOpenProcess_("sh ", filename);
@@ -10,14 +10,14 @@ namespace stf {
     // cppcheck-suppress unusedFunction
     void STFRegState::writeRegState(STFWriter& stf_writer) const {
         applyRegState(
-            [&stf_writer](const auto& r) {
-                stf_writer << *r.second;
+            [&stf_writer](const InstRegRecord& rec) {
+                stf_writer << rec;
             }
         );
     }
 
     void STFRegState::initRegBank(const ISA isa, const INST_IEM iem) {
-        regbank_.clear();
+        clearRegBank_();
 
         uint64_t machine_length_mask = RegMapInfo::MASK64;
         uint64_t fp_length_mask = RegMapInfo::MASK64;
@@ -0,0 +1,477 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <thread>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "stf_exception.hpp"
+#include "stf_shared_chunk_cache.hpp"
+
+namespace stf {
+    namespace {
+        constexpr uint32_t SHARED_CHUNK_CACHE_MAGIC = 0x43435a53; // "SZCC"
+        constexpr uint32_t SHARED_CHUNK_CACHE_VERSION = 2;
+        constexpr size_t SLOT_ALIGNMENT = 4096;
+        constexpr size_t MAX_SLOT_READERS = 16; // Maximum number of simultaneous references to a slot
+
+        // How long to wait for another process to create the region, or to publish a chunk before checking whether
+        // it is still alive
+        constexpr auto REGION_INIT_TIMEOUT = std::chrono::seconds(5);
+        constexpr auto PUBLISH_WAIT_INTERVAL = std::chrono::milliseconds(50);
+
+        enum class SlotState : uint32_t {
+            EMPTY,
+            LOADING,
+            READY
+        };
+
+        inline size_t alignUp(const size_t val, const size_t alignment) {
+            return (val + alignment - 1) / alignment * alignment;
+        }
+
+        inline bool processExited(const pid_t pid) {
+            return kill(pid, 0) != 0 && errno == ESRCH;
+        }
+    } // end anonymous namespace
+
+    /**
+     * \struct STFSharedChunkCache::Header
+     * Start of the shared memory region
+     */
+    struct STFSharedChunkCache::Header {
+        std::atomic<uint32_t> magic; /**< Set once the creator has finished initializing the region */
+        uint32_t version; /**< Layout version */
+        uint64_t region_size; /**< Size of the region */
+        uint64_t num_slots; /**< Number of slots */
+        uint64_t slot_size; /**< Size of each slot */
+        uint64_t clock; /**< Incremented on every slot access to order slots by last use */
+        uint64_t num_attached; /**< Number of processes that have the region open */
+        pthread_mutex_t mutex; /**< Guards everything but the slot data */
+        pthread_cond_t cond; /**< Signaled whenever a slot is published or abandoned */
+    };
+
+    /**
+     * \struct STFSharedChunkCache::Slot
+     * Slot table entry
+     */
+    struct STFSharedChunkCache::Slot {
+        uint64_t chunk_idx; /**< Index of the chunk held in the slot */
+        uint64_t num_bytes; /**< Size of the chunk */
+        uint64_t last_use; /**< Header clock value when the slot was last used */
+        uint32_t ref_count; /**< Number of readers copying out of the slot */
+        SlotState state; /**< Slot state */
+        pid_t owner; /**< Process loading the chunk while the slot is LOADING */
+        pid_t readers[MAX_SLOT_READERS]; /**< Process holding each reference to the slot, or 0 if the entry is unused */
+    };
+
+    size_t STFSharedChunkCache::addReader_(Slot& slot) {
+        for(size_t i = 0; i < MAX_SLOT_READERS; ++i) {
+            if(slot.readers[i] == 0) {
+                slot.readers[i] = getpid();
+                ++slot.ref_count;
+                return i;
+            }
+        }
+
+        return NO_SLOT;
+    }
+
+    void STFSharedChunkCache::removeReader_(Slot& slot, const size_t reader) {
+        slot.readers[reader] = 0;
+        --slot.ref_count;
+    }
+
+    bool STFSharedChunkCache::reclaimReaders_(Slot& slot) {
+        bool reclaimed = false;
+
+        for(size_t i = 0; i < MAX_SLOT_READERS && slot.ref_count; ++i) {
+            if(slot.readers[i] != 0 && processExited(slot.readers[i])) {
+                removeReader_(slot, i);
+                reclaimed = true;
+            }
+        }
+
+        return reclaimed;
+    }
+
+    bool STFSharedChunkCache::ownsSlot_(const Slot& slot, const size_t chunk_idx) {
+        return slot.state == SlotState::LOADING && slot.owner == getpid() && slot.chunk_idx == chunk_idx;
+    }
+
+    size_t STFSharedChunkCache::getRegionSize_(const size_t num_slots, const size_t slot_size) {
+        return alignUp(sizeof(Header) + num_slots * sizeof(Slot), SLOT_ALIGNMENT) + num_slots * slot_size;
+    }
+
+    bool STFSharedChunkCache::map_(const int fd,
+                                   const bool created,
+                                   size_t region_size,
+                                   size_t num_slots,
+                                   size_t slot_size) {
+        if(!created) {
+            // The creator may still be sizing the region
+            const auto deadline = std::chrono::steady_clock::now() + REGION_INIT_TIMEOUT;
+            struct stat region_stat;
+            while(fstat(fd, &region_stat) == 0 && static_cast<size_t>(region_stat.st_size) < sizeof(Header)) {
+                if(std::chrono::steady_clock::now() > deadline) {
+                    return false;
+                }
+                std::this_thread::yield();
+            }
+            region_size = static_cast<size_t>(region_stat.st_size);
+        }
+
+        void* const region = mmap(nullptr, region_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if(region == MAP_FAILED) {
+            return false;
+        }
+
+        region_ = region;
+        region_size_ = region_size;
+        header_ = static_cast<Header*>(region);
+
+        if(created) {
+            new (&header_->magic) std::atomic<uint32_t>(0);
+            header_->version = SHARED_CHUNK_CACHE_VERSION;
+            header_->region_size = region_size;
+            header_->num_slots = num_slots;
+            header_->slot_size = slot_size;
+            header_->clock = 0;
+            header_->num_attached = 0;
+
+            pthread_mutexattr_t mutex_attr;
+            pthread_mutexattr_init(&mutex_attr);
+            pthread_mutexattr_setpshared(&mutex_attr, PTHREAD_PROCESS_SHARED);
+#ifdef __linux__
+            pthread_mutexattr_setrobust(&mutex_attr, PTHREAD_MUTEX_ROBUST);
+#endif
+            pthread_mutex_init(&header_->mutex, &mutex_attr);
+            pthread_mutexattr_destroy(&mutex_attr);
+
+            pthread_condattr_t cond_attr;
+            pthread_condattr_init(&cond_attr);
+            pthread_condattr_setpshared(&cond_attr, PTHREAD_PROCESS_SHARED);
+            pthread_cond_init(&header_->cond, &cond_attr);
+            pthread_condattr_destroy(&cond_attr);
+
+            auto slots = reinterpret_cast<Slot*>(header_ + 1);
+            for(size_t i = 0; i < num_slots; ++i) {
+                slots[i] = Slot{0, 0, 0, 0, SlotState::EMPTY, 0, {}};
+            }
+
+            header_->magic.store(SHARED_CHUNK_CACHE_MAGIC, std::memory_order_release);
+        }
+        else {
+            const auto deadline = std::chrono::steady_clock::now() + REGION_INIT_TIMEOUT;
+            while(header_->magic.load(std::memory_order_acquire) != SHARED_CHUNK_CACHE_MAGIC) {
+                if(std::chrono::steady_clock::now() > deadline) {
+                    return false;
+                }
+                std::this_thread::yield();
+            }
+
+            num_slots = header_->num_slots;
+            slot_size = header_->slot_size;
+
+            if(header_->version != SHARED_CHUNK_CACHE_VERSION ||
+               header_->region_size != region_size ||
+               getRegionSize_(num_slots, slot_size) != region_size) {
+                return false;
+            }
+        }
+
+        num_slots_ = num_slots;
+        slot_size_ = slot_size;
+        slots_ = reinterpret_cast<Slot*>(header_ + 1);
+        data_ = static_cast<uint8_t*>(region) + alignUp(sizeof(Header) + num_slots * sizeof(Slot), SLOT_ALIGNMENT);
+
+        return true;
+    }
+
+    std::unique_ptr<STFSharedChunkCache> STFSharedChunkCache::open(const struct stat& file_stat,
+                                                                   const size_t num_bytes,
+                                                                   const size_t max_chunk_size) {
+        std::unique_ptr<STFSharedChunkCache> cache(new STFSharedChunkCache());
+
+        std::ostringstream name;
+        name << "/stf-chunks-" << std::hex
+             << file_stat.st_dev << '-'
+             << file_stat.st_ino << '-'
+             << file_stat.st_size << '-'
+             << file_stat.st_mtim.tv_sec << '.' << file_stat.st_mtim.tv_nsec;
+        cache->name_ = name.str();
+
+        const size_t slot_size = alignUp(std::max(max_chunk_size, size_t(1)), SLOT_ALIGNMENT);
+        const size_t num_slots = num_bytes / slot_size;
+
+        if(num_slots == 0) {
+            std::cerr << "WARNING: Shared chunk cache size (" << num_bytes
+                      << " bytes) is smaller than a single chunk (" << slot_size
+                      << " bytes). Disabling the shared chunk cache." << std::endl;
+            return nullptr;
+        }
+
+        const size_t region_size = getRegionSize_(num_slots, slot_size);
+
+        bool created = true;
+        int fd = shm_open(cache->name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if(fd < 0 && errno == EEXIST) {
+            created = false;
+            fd = shm_open(cache->name_.c_str(), O_RDWR, 0600);
+        }
+
+        bool success = fd >= 0;
+        if(success && created) {
+            success = ftruncate(fd, static_cast<off_t>(region_size)) == 0;
+        }
+        if(success) {
+            success = cache->map_(fd, created, region_size, num_slots, slot_size);
+        }
+        if(success && cache->slot_size_ < max_chunk_size) {
+            success = false;
+        }
+
+        const int error = errno;
+        if(fd >= 0) {
+            close(fd);
+        }
+
+        if(!success) {
+            if(created && fd >= 0) {
+                shm_unlink(cache->name_.c_str());
+            }
+            std::cerr << "WARNING: Failed to open shared chunk cache " << cache->name_ << ": "
+                      << std::strerror(error) << ". Disabling the shared chunk cache." << std::endl;
+            errno = 0;
+            return nullptr;
+        }
+
+        cache->lock_();
+        ++cache->header_->num_attached;
+        cache->unlock_();
+
+        return cache;
+    }
+
+    STFSharedChunkCache::~STFSharedChunkCache() {
+        if(!region_) {
+            return;
+        }
+
+        if(header_->magic.load(std::memory_order_acquire) == SHARED_CHUNK_CACHE_MAGIC) {
+            lock_();
+            // Unlinking while still holding the lock keeps anyone else from attaching to a region that is going away
+            if(header_->num_attached && --header_->num_attached == 0) {
+                shm_unlink(name_.c_str());
+            }
+            unlock_();
+        }
+
+        munmap(region_, region_size_);
+    }
+
+    void STFSharedChunkCache::lock_() {
+        const int result = pthread_mutex_lock(&header_->mutex);
+#ifdef __linux__
+        // A process died while holding the lock. Slots it was loading are reclaimed when someone waits on them.
+        if(STF_EXPECT_FALSE(result == EOWNERDEAD)) {
+            pthread_mutex_consistent(&header_->mutex);
+            return;
+        }
+#endif
+        stf_assert(result == 0, "Failed to lock shared chunk cache: " << std::strerror(result));
+    }
+
+    void STFSharedChunkCache::unlock_() {
+        pthread_mutex_unlock(&header_->mutex);
+    }
+
+    void STFSharedChunkCache::wait_() {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += std::chrono::duration_cast<std::chrono::nanoseconds>(PUBLISH_WAIT_INTERVAL).count();
+        deadline.tv_sec += deadline.tv_nsec / 1000000000;
+        deadline.tv_nsec %= 1000000000;
+
+        const int result = pthread_cond_timedwait(&header_->cond, &header_->mutex, &deadline);
+#ifdef __linux__
+        if(STF_EXPECT_FALSE(result == EOWNERDEAD)) {
+            pthread_mutex_consistent(&header_->mutex);
+        }
+#else
+        static_cast<void>(result);
+#endif
+    }
+
+    void STFSharedChunkCache::notify_() {
+        pthread_cond_broadcast(&header_->cond);
+    }
+
+    bool STFSharedChunkCache::find(const size_t chunk_idx, STFCompressionBuffer& buf, size_t& reserved_slot) {
+        reserved_slot = NO_SLOT;
+        bool waited = false;
+
+        lock_();
+
+        while(true) {
+            Slot* match = nullptr;
+            Slot* victim = nullptr;
+
+            for(size_t i = 0; i < num_slots_; ++i) {
+                auto& slot = slots_[i];
+
+                if(slot.state == SlotState::EMPTY) {
+                    if(!victim || victim->state != SlotState::EMPTY) {
+                        victim = &slot;
+                    }
+                    continue;
+                }
+
+                if(slot.chunk_idx == chunk_idx) {
+                    match = &slot;
+                    break;
+                }
+
+                if(slot.state == SlotState::READY &&
+                   slot.ref_count == 0 &&
+                   (!victim || (victim->state != SlotState::EMPTY && slot.last_use < victim->last_use))) {
+                    victim = &slot;
+                }
+            }
+
+            if(match && match->state == SlotState::READY) {
+                const size_t reader = addReader_(*match);
+
+                // Too many readers are copying out of the slot at once. Entries held by processes that have exited
+                // can be reused, otherwise wait for one of the readers to finish.
+                if(STF_EXPECT_FALSE(reader == NO_SLOT)) {
+                    if(!reclaimReaders_(*match)) {
+                        wait_();
+                    }
+                    continue;
+                }
+
+                match->last_use = ++header_->clock;
+                unlock_();
+
+                // The reference keeps the slot from being evicted while it is copied
+                const size_t num_bytes = match->num_bytes;
+                std::copy_n(data_ + static_cast<size_t>(match - slots_) * slot_size_, num_bytes, buf.get() + buf.end());
+                buf.advanceWritePtr(num_bytes);
+
+                lock_();
+                removeReader_(*match, reader);
+                unlock_();
+
+                ++hits_;
+                return true;
+            }
+
+            if(match) {
+                // Someone else is decompressing this chunk. Take it over if they have exited.
+                if(processExited(match->owner)) {
+                    match->state = SlotState::EMPTY;
+                    continue;
+                }
+
+                if(!waited) {
+                    waited = true;
+                    ++waits_;
+                }
+                wait_();
+                continue;
+            }
+
+            // Every slot is in use. Slots still being loaded by processes that have exited can be reused, as can
+            // slots that are only referenced by processes that have exited.
+            if(!victim) {
+                for(size_t i = 0; i < num_slots_ && !victim; ++i) {
+                    auto& slot = slots_[i];
+                    if((slot.state == SlotState::LOADING && processExited(slot.owner)) ||
+                       (slot.state == SlotState::READY && reclaimReaders_(slot) && slot.ref_count == 0)) {
+                        victim = &slot;
+                    }
+                }
+            }
+
+            if(victim) {
+                victim->chunk_idx = chunk_idx;
+                victim->num_bytes = 0;
+                victim->state = SlotState::LOADING;
+                victim->owner = getpid();
+                reserved_slot = static_cast<size_t>(victim - slots_);
+            }
+            else {
+                ++num_bypassed_;
+            }
+
+            unlock_();
+
+            ++misses_;
+            return false;
+        }
+    }
+
+    void STFSharedChunkCache::publish(const size_t slot, const size_t chunk_idx, const STFCompressionBuffer& buf) {
+        const size_t num_bytes = buf.end();
+
+        if(STF_EXPECT_FALSE(num_bytes > slot_size_)) {
+            abandon(slot, chunk_idx);
+            return;
+        }
+
+        // Another process reclaims the reservation if it can't see this one (e.g. they are in different PID
+        // namespaces), so make sure the slot is still ours before writing into it
+        lock_();
+        const bool owned = ownsSlot_(slots_[slot], chunk_idx);
+        unlock_();
+
+        if(STF_EXPECT_FALSE(!owned)) {
+            return;
+        }
+
+        // Nobody else touches the slot data while the slot is LOADING
+        std::copy_n(buf.get(), num_bytes, data_ + slot * slot_size_);
+
+        lock_();
+        if(STF_EXPECT_TRUE(ownsSlot_(slots_[slot], chunk_idx))) {
+            slots_[slot].num_bytes = num_bytes;
+            slots_[slot].last_use = ++header_->clock;
+            slots_[slot].state = SlotState::READY;
+            notify_();
+            ++num_published_;
+        }
+        unlock_();
+    }
+
+    void STFSharedChunkCache::abandon(const size_t slot, const size_t chunk_idx) {
+        lock_();
+        if(ownsSlot_(slots_[slot], chunk_idx)) {
+            slots_[slot].state = SlotState::EMPTY;
+            notify_();
+        }
+        unlock_();
+    }
+
+    STFSharedChunkCache::Stats STFSharedChunkCache::getStats() const {
+        Stats stats;
+        stats.num_slots = num_slots_;
+        stats.slot_size = slot_size_;
+        stats.hits = hits_;
+        stats.misses = misses_;
+        stats.waits = waits_;
+        stats.num_published = num_published_;
+        stats.num_bypassed = num_bypassed_;
+        return stats;
+    }
+} // end namespace stf
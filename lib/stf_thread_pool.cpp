@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <thread>
+
+#include "stf_env_var.hpp"
+#include "stf_exception.hpp"
+#include "stf_thread_pool.hpp"
+
+namespace stf {
+    STFThreadPool::STFThreadPool() :
+        num_threads_(std::max(1U, std::thread::hardware_concurrency()))
+    {
+        const size_t max_threads = STFIntegerEnvVar<size_t>("STF_NUM_HELPER_THREADS", num_threads_);
+        stf_assert(max_threads > 0, "STF_NUM_HELPER_THREADS must be at least 1");
+        num_threads_ = max_threads;
+    }
+
+    STFThreadPool& STFThreadPool::get() {
+        // The pool is intentionally never destroyed so that streams closed by the STFFstream atexit handler can
+        // still hand their final chunks off to it
+        static STFThreadPool* const pool = new STFThreadPool();
+        return *pool;
+    }
+
+    void STFThreadPool::workerLoop_() {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        while(true) {
+            ++num_idle_threads_;
+            cv_.wait(lock, [this]() { return num_threads_to_stop_ || !queue_.empty(); });
+            --num_idle_threads_;
+
+            if(STF_EXPECT_FALSE(num_threads_to_stop_)) {
+                --num_threads_to_stop_;
+                --num_running_threads_;
+                return;
+            }
+
+            Job job = std::move(queue_.front());
+            queue_.pop_front();
+            ++num_busy_threads_;
+            lock.unlock();
+
+            const auto start = Clock::now();
+            job();
+            const auto elapsed = Clock::now() - start;
+
+            lock.lock();
+            --num_busy_threads_;
+            busy_time_ += elapsed;
+            ++num_jobs_completed_;
+        }
+    }
+
+    void STFThreadPool::enqueue_(Job&& job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.emplace_back(std::move(job));
+            max_queue_depth_ = std::max(max_queue_depth_, queue_.size());
+
+            // Only start a new thread if the idle threads can't handle everything in the queue
+            if(num_idle_threads_ < queue_.size() && num_running_threads_ - num_threads_to_stop_ < num_threads_) {
+                ++num_running_threads_;
+                std::thread(&STFThreadPool::workerLoop_, this).detach();
+            }
+        }
+
+        cv_.notify_one();
+    }
+
+    double STFThreadPool::calcUtilization_() const {
+        const auto available_time = (Clock::now() - stats_start_) * num_threads_;
+        if(STF_EXPECT_FALSE(available_time.count() <= 0)) {
+            return 0.0;
+        }
+
+        return std::chrono::duration<double>(busy_time_) / std::chrono::duration<double>(available_time);
+    }
+
+    void STFThreadPool::setNumThreads(const size_t num_threads) {
+        stf_assert(num_threads > 0, "Thread pool must have at least 1 thread");
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            num_threads_ = num_threads;
+
+            const size_t num_active_threads = num_running_threads_ - num_threads_to_stop_;
+            if(num_active_threads > num_threads_) {
+                num_threads_to_stop_ += num_active_threads - num_threads_;
+            }
+        }
+
+        cv_.notify_all();
+    }
+
+    size_t STFThreadPool::getNumThreads() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return num_threads_;
+    }
+
+    size_t STFThreadPool::getQueueDepth() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return queue_.size();
+    }
+
+    double STFThreadPool::getUtilization() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return calcUtilization_();
+    }
+
+    STFThreadPool::Stats STFThreadPool::getStats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        Stats stats;
+        stats.num_threads = num_threads_;
+        stats.num_running_threads = num_running_threads_ - num_threads_to_stop_;
+        stats.num_busy_threads = num_busy_threads_;
+        stats.queue_depth = queue_.size();
+        stats.max_queue_depth = max_queue_depth_;
+        stats.num_jobs_completed = num_jobs_completed_;
+        stats.utilization = calcUtilization_();
+
+        return stats;
+    }
+
+    void STFThreadPool::resetStats() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        max_queue_depth_ = queue_.size();
+        num_jobs_completed_ = 0;
+        busy_time_ = Clock::duration::zero();
+        stats_start_ = Clock::now();
+    }
+} // end namespace stf
@@ -1,6 +1,7 @@
 #include <cerrno>
 
 #include "stf.hpp"
+#include "stf_env_var.hpp"
 #include "stf_writer_base.hpp"
 #include "stf_record_types.hpp"
 #include "stf_compressed_ofstream.hpp"
@@ -23,7 +24,10 @@ namespace stf {
         stream_->openWithProcess(cmd, filename);
     }
 
-    void STFWriterBase::open(const std::string_view filename, int compression_level, const size_t chunk_size) {
+    void STFWriterBase::open(const std::string_view filename,
+                             int compression_level,
+                             const size_t chunk_size,
+                             size_t num_compression_threads) {
         static const STFIdentifierRecord STF_IDENTIFIER_RECORD = STFIdentifierRecord();
         static const VersionRecord CUR_VERSION_RECORD(STF_CUR_VERSION_MAJOR, STF_CUR_VERSION_MINOR);
 
@@ -34,7 +38,22 @@ namespace stf {
                 if(compression_level == -1) {
                     compression_level = ZSTDCompressor::DEFAULT_COMPRESSION_LEVEL;
                 }
-                stream_ = std::make_unique<STFCompressedOFstream<ZSTDCompressor>>(filename, chunk_size, compression_level);
+                if(num_compression_threads == 0) {
+                    num_compression_threads =
+                        STFIntegerEnvVar<size_t>("STF_COMPRESSION_THREADS",
+                                                 STFCompressedOFstream<ZSTDCompressor>::DEFAULT_NUM_COMPRESSION_THREADS);
+                }
+                {
+                    auto zstf_stream = std::make_unique<STFCompressedOFstream<ZSTDCompressor>>(compression_level);
+                    zstf_stream->setChunkSize(chunk_size);
+                    zstf_stream->setNumCompressionThreads(num_compression_threads);
+                    zstf_stream->setChunkJournal(STFBooleanEnvVar("STF_CHUNK_JOURNAL"));
+                    zstf_stream->setChunkSummaries(STFBooleanEnvVar("STF_CHUNK_SUMMARIES"));
+                    zstf_stream->setChunkSnapshots(STFBooleanEnvVar("STF_CHUNK_SNAPSHOTS"));
+                    zstf_stream->setStreaming(STFBooleanEnvVar("STF_ZSTF_STREAMING"));
+                    zstf_stream->open(filename);
+                    stream_ = std::move(zstf_stream);
+                }
                 break;
             case STF_FILE_TYPE::STF_GZ:
                 if(compression_level == -1) {
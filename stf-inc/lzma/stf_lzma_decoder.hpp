@@ -0,0 +1,370 @@
+#ifndef __STF_LZMA_DECODER_HPP__
+#define __STF_LZMA_DECODER_HPP__
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <lzma.h>
+
+#include "stf_exception.hpp"
+
+namespace stf {
+    /**
+     * \class LZMADecoder
+     *
+     * Decodes xz-compressed traces in-process for STFDecompressingIFstream
+     *
+     * Every block in an xz file can be decoded independently, and the index at the end of the file lists where each
+     * one starts. If the index can be read, the decoder uses the blocks as its restart points and decodes the file one
+     * block at a time. Files written by a single-threaded xz only have one block, so they can only be restarted from
+     * the beginning. Files with more than one stream, or that are being read from a pipe, are decoded as a single
+     * stream without restart points.
+     */
+    class LZMADecoder {
+        private:
+            static constexpr size_t IN_BUF_SIZE_ = 256 * 1024; /**< Size of the compressed input buffer */
+
+            /**
+             * \struct Block
+             * Location of an xz block
+             */
+            struct Block {
+                off_t in_offset = 0; /**< Offset of the block header in the compressed file */
+                size_t out_offset = 0; /**< Uncompressed offset of the block */
+            };
+
+            FILE* file_ = nullptr; /**< Compressed file */
+            lzma_stream strm_ = LZMA_STREAM_INIT; /**< liblzma state */
+            std::unique_ptr<uint8_t[]> in_buf_; /**< Compressed input buffer */ // NOLINT: modernize-avoid-c-arrays
+            bool input_ended_ = false; /**< True if the end of the compressed file has been reached */
+            size_t out_pos_ = 0; /**< Number of uncompressed bytes produced so far */
+            bool done_ = false; /**< True once all of the data has been decoded */
+            bool use_blocks_ = false; /**< True if the file is decoded one block at a time */
+            std::vector<Block> blocks_; /**< Blocks listed in the index, sorted by uncompressed offset */
+            lzma_check check_ = LZMA_CHECK_NONE; /**< Integrity check used by every block */
+            size_t next_block_ = 0; /**< Index of the next block to decode */
+            bool in_block_ = false; /**< True while a block is being decoded */
+            lzma_block block_{}; /**< Options for the current block. liblzma updates this while decoding. */
+            std::array<lzma_filter, LZMA_FILTERS_MAX + 1> filters_{}; /**< Filter chain for the current block */
+
+            /**
+             * Moves any unconsumed input to the front of the input buffer and refills the rest of it. Returns false if
+             * nothing could be read.
+             */
+            inline bool refill_() {
+                if(strm_.avail_in && strm_.next_in != in_buf_.get()) {
+                    std::memmove(in_buf_.get(), strm_.next_in, strm_.avail_in);
+                }
+                strm_.next_in = in_buf_.get();
+
+                const size_t num_read = fread(in_buf_.get() + strm_.avail_in, 1, IN_BUF_SIZE_ - strm_.avail_in, file_);
+                strm_.avail_in += num_read;
+                input_ended_ = !num_read;
+                return num_read;
+            }
+
+            /**
+             * Ensures that the input buffer holds at least the given number of bytes. Returns false if the file ended
+             * first.
+             * \param num_bytes Number of bytes needed
+             */
+            inline bool ensureInput_(const size_t num_bytes) {
+                while(strm_.avail_in < num_bytes) {
+                    if(!refill_()) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            /**
+             * Frees the filter options allocated by the last block header
+             */
+            inline void freeFilters_() {
+                for(auto& filter: filters_) {
+                    free(filter.options); // NOLINT: cppcoreguidelines-no-malloc
+                    filter.options = nullptr;
+                    filter.id = LZMA_VLI_UNKNOWN;
+                }
+            }
+
+            /**
+             * Reads the stream flags and block list from the index at the end of the file. Returns false if the file
+             * isn't a single xz stream with a valid index.
+             */
+            inline bool readIndex_() {
+                struct stat file_stat;
+                if(fstat(fileno(file_), &file_stat) != 0 || !S_ISREG(file_stat.st_mode)) {
+                    return false;
+                }
+
+                const off_t file_size = file_stat.st_size;
+                if(file_size < 2 * LZMA_STREAM_HEADER_SIZE) {
+                    return false;
+                }
+
+                std::array<uint8_t, LZMA_STREAM_HEADER_SIZE> header;
+                std::array<uint8_t, LZMA_STREAM_HEADER_SIZE> footer;
+                lzma_stream_flags header_flags;
+                lzma_stream_flags footer_flags;
+
+                if(fseeko(file_, 0, SEEK_SET) != 0 ||
+                   fread(header.data(), 1, header.size(), file_) != header.size() ||
+                   lzma_stream_header_decode(&header_flags, header.data()) != LZMA_OK ||
+                   fseeko(file_, file_size - LZMA_STREAM_HEADER_SIZE, SEEK_SET) != 0 ||
+                   fread(footer.data(), 1, footer.size(), file_) != footer.size() ||
+                   lzma_stream_footer_decode(&footer_flags, footer.data()) != LZMA_OK ||
+                   lzma_stream_flags_compare(&header_flags, &footer_flags) != LZMA_OK) {
+                    return false;
+                }
+
+                const auto index_size = static_cast<off_t>(footer_flags.backward_size);
+                if(index_size > file_size - 2 * LZMA_STREAM_HEADER_SIZE) {
+                    return false;
+                }
+
+                std::vector<uint8_t> index_buf(static_cast<size_t>(index_size));
+                if(fseeko(file_, file_size - LZMA_STREAM_HEADER_SIZE - index_size, SEEK_SET) != 0 ||
+                   fread(index_buf.data(), 1, index_buf.size(), file_) != index_buf.size()) {
+                    return false;
+                }
+
+                lzma_index* index = nullptr;
+                uint64_t memlimit = UINT64_MAX;
+                size_t index_pos = 0;
+                if(lzma_index_buffer_decode(&index, &memlimit, nullptr, index_buf.data(), &index_pos, index_buf.size()) != LZMA_OK) {
+                    return false;
+                }
+
+                // Concatenated streams and stream padding would need every index in the file, so just decode them as
+                // a single stream
+                const bool single_stream = lzma_index_stream_size(index) == static_cast<lzma_vli>(file_size);
+                if(single_stream) {
+                    lzma_index_iter iter;
+                    lzma_index_iter_init(&iter, index);
+                    while(!lzma_index_iter_next(&iter, LZMA_INDEX_ITER_BLOCK)) {
+                        blocks_.emplace_back(Block{static_cast<off_t>(iter.block.compressed_file_offset),
+                                                   static_cast<size_t>(iter.block.uncompressed_file_offset)});
+                    }
+                    check_ = header_flags.check;
+                }
+
+                lzma_index_end(index, nullptr);
+                return single_stream;
+            }
+
+            /**
+             * Starts decoding the file from the beginning as a single stream
+             */
+            inline void startStream_() {
+                stf_assert(fseeko(file_, 0, SEEK_SET) == 0, "Failed to seek xz trace");
+                stf_assert(lzma_stream_decoder(&strm_, UINT64_MAX, LZMA_CONCATENATED) == LZMA_OK,
+                           "Failed to initialize xz decoder");
+            }
+
+            /**
+             * Reads the header of the next block and starts decoding it
+             */
+            inline void startBlock_() {
+                stf_assert(ensureInput_(1), "Failed to read xz block header");
+
+                freeFilters_();
+                block_ = lzma_block{};
+                block_.version = 1;
+                block_.check = check_;
+                block_.filters = filters_.data();
+                block_.header_size = lzma_block_header_size_decode(*strm_.next_in);
+
+                stf_assert(ensureInput_(block_.header_size), "Failed to read xz block header");
+                stf_assert(lzma_block_header_decode(&block_, nullptr, strm_.next_in) == LZMA_OK,
+                           "Invalid xz block header");
+                strm_.next_in += block_.header_size;
+                strm_.avail_in -= block_.header_size;
+
+                stf_assert(lzma_block_decoder(&strm_, &block_) == LZMA_OK, "Failed to initialize xz block decoder");
+                in_block_ = true;
+            }
+
+            /**
+             * Resets the decoder state after the compressed file has been repositioned
+             */
+            inline void resetState_() {
+                strm_.next_in = in_buf_.get();
+                strm_.avail_in = 0;
+                input_ended_ = false;
+                in_block_ = false;
+                done_ = false;
+            }
+
+            /**
+             * Gets the first block that starts after the given uncompressed offset
+             * \param offset Uncompressed offset
+             */
+            inline auto findBlock_(const size_t offset) const {
+                return std::upper_bound(blocks_.begin(),
+                                        blocks_.end(),
+                                        offset,
+                                        [](const size_t val, const Block& block) {
+                                            return val < block.out_offset;
+                                        });
+            }
+
+        public:
+            LZMADecoder() = default;
+
+            LZMADecoder(const LZMADecoder&) = delete;
+            LZMADecoder& operator=(const LZMADecoder&) = delete;
+
+            ~LZMADecoder() {
+                close();
+            }
+
+            /**
+             * Starts decoding a file from the beginning
+             * \param file Compressed file
+             * \param seekable Whether the file can be repositioned
+             */
+            inline void open(FILE* file, const bool seekable) {
+                close();
+                file_ = file;
+                in_buf_ = std::make_unique<uint8_t[]>(IN_BUF_SIZE_); // NOLINT: modernize-avoid-c-arrays
+                out_pos_ = 0;
+                next_block_ = 0;
+                use_blocks_ = seekable && readIndex_();
+                resetState_();
+
+                if(use_blocks_) {
+                    stf_assert(fseeko(file_, blocks_.empty() ? 0 : blocks_.front().in_offset, SEEK_SET) == 0,
+                               "Failed to seek xz trace");
+                }
+                else {
+                    // readIndex_ may have moved the file position
+                    blocks_.clear();
+                    if(seekable) {
+                        startStream_();
+                    }
+                    else {
+                        stf_assert(lzma_stream_decoder(&strm_, UINT64_MAX, LZMA_CONCATENATED) == LZMA_OK,
+                                   "Failed to initialize xz decoder");
+                    }
+                }
+            }
+
+            /**
+             * Releases the liblzma state and forgets the block list
+             */
+            inline void close() {
+                lzma_end(&strm_);
+                strm_ = LZMA_STREAM_INIT;
+                freeFilters_();
+                file_ = nullptr;
+                in_buf_.reset();
+                blocks_.clear();
+            }
+
+            /**
+             * Decodes up to size bytes. Returns the number of bytes decoded, which is only less than size at the end
+             * of the file.
+             * \param out Buffer to decode into
+             * \param size Size of out
+             */
+            inline size_t decode(uint8_t* out, const size_t size) {
+                strm_.next_out = out;
+                strm_.avail_out = size;
+
+                while(strm_.avail_out && !done_) {
+                    if(use_blocks_ && !in_block_) {
+                        if(next_block_ == blocks_.size()) {
+                            done_ = true;
+                            break;
+                        }
+                        startBlock_();
+                    }
+
+                    if(!strm_.avail_in && !input_ended_) {
+                        refill_();
+                    }
+
+                    const size_t avail_out = strm_.avail_out;
+                    const lzma_ret result = lzma_code(&strm_, input_ended_ && !use_blocks_ ? LZMA_FINISH : LZMA_RUN);
+                    out_pos_ += avail_out - strm_.avail_out;
+
+                    if(result == LZMA_STREAM_END) {
+                        if(use_blocks_) {
+                            in_block_ = false;
+                            ++next_block_;
+                        }
+                        else {
+                            done_ = true;
+                        }
+                        continue;
+                    }
+
+                    if(result == LZMA_BUF_ERROR && input_ended_) {
+                        std::cerr << "WARNING: xz trace ended unexpectedly. It may be truncated." << std::endl;
+                        done_ = true;
+                        break;
+                    }
+
+                    stf_assert(result == LZMA_OK, "xz decoder error " << result);
+                }
+
+                return size - strm_.avail_out;
+            }
+
+            /**
+             * Gets the number of uncompressed bytes decoded so far
+             */
+            inline size_t tell() const {
+                return out_pos_;
+            }
+
+            /**
+             * Gets the uncompressed offset that restart() would resume decoding from
+             * \param offset Uncompressed offset to restart at
+             */
+            inline size_t getRestartOffset(const size_t offset) const {
+                const auto it = findBlock_(offset);
+                return it == blocks_.begin() ? 0 : std::prev(it)->out_offset;
+            }
+
+            /**
+             * Resumes decoding from the start of the block containing the given offset. Returns the uncompressed offset
+             * of the block.
+             * \param offset Uncompressed offset to restart at
+             */
+            inline size_t restart(const size_t offset) {
+                resetState_();
+
+                const auto it = findBlock_(offset);
+                if(it == blocks_.begin()) {
+                    out_pos_ = 0;
+                    next_block_ = 0;
+                    if(use_blocks_) {
+                        stf_assert(fseeko(file_, blocks_.empty() ? 0 : blocks_.front().in_offset, SEEK_SET) == 0,
+                                   "Failed to seek xz trace");
+                    }
+                    else {
+                        startStream_();
+                    }
+                    return out_pos_;
+                }
+
+                const auto& block = *std::prev(it);
+                stf_assert(fseeko(file_, block.in_offset, SEEK_SET) == 0, "Failed to seek xz trace");
+                next_block_ = static_cast<size_t>(std::distance(blocks_.cbegin(), it)) - 1;
+                out_pos_ = block.out_offset;
+                return out_pos_;
+            }
+    };
+} // end namespace stf
+
+#endif
@@ -229,7 +229,8 @@ namespace stf {
                      * Constructs a FieldChannel from an STFIFstream
                      */
                     explicit FieldChannel(STFIFstream& reader) :
-                        fields_(Fields(reader)...)
+                        // Braced initialization guarantees the fields are read in order
+                        fields_{Fields(reader)...}
                     {
                     }
 
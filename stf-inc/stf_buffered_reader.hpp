@@ -59,11 +59,18 @@ namespace stf {
 
             bool last_item_read_ = false; /**< If true, we have read to the end of the trace */
 
+            /**
+             * \typedef ItemPtr
+             * \brief Owning pointer to a buffered item. Items are held by pointer so that a subclass can hand over
+             * items it constructed elsewhere without copying them.
+             */
+            using ItemPtr = std::unique_ptr<ItemType>;
+
             /**
              * \typedef BufferT
              * \brief Underlying buffer type
              */
-            using BufferT = ItemType[]; // NOLINT: Use C-array here so we can use [] operator on the unique_ptr
+            using BufferT = ItemPtr[]; // NOLINT: Use C-array here so we can use [] operator on the unique_ptr
             std::unique_ptr<BufferT> buf_; /**< Circular buffer */
 
             size_t head_ = 0;         /**< index of head of current item in circular buffer */
@@ -144,20 +151,39 @@ namespace stf {
                 static_cast<ReaderType*>(this)->skippingDone_(item);
             }
 
+            /**
+             * Default callback for when the buffer is about to be refilled from the current position in the trace.
+             * Does nothing.
+             */
+            __attribute__((always_inline))
+            inline void bufferInitCallback_() {
+            }
+
+            /**
+             * Default callback for every record read from the trace, including filtered records. Does nothing.
+             */
+            __attribute__((always_inline))
+            inline void recordReadCallback_(const STFRecord&) {
+            }
+
             /**
              * Initializes the internal buffer
              */
             bool initItemBuffer_() {
+                static_cast<ReaderType*>(this)->bufferInitCallback_();
                 buf_ = std::make_unique<BufferT>(static_cast<size_t>(buffer_size_));
+                for(size_t i = 0; i < buffer_size_; ++i) {
+                    buf_[i] = std::make_unique<ItemType>();
+                }
 
                 size_t i = 0;
                 bool did_skip = false;
                 while(i < buffer_size_) {
-                    auto& item = buf_[i];
+                    auto& item_ptr = buf_[i];
                     try {
-                        readNextItem_(item);
-                        if(STF_EXPECT_FALSE(itemSkipped_(item))) {
-                            skippedItemCleanup_(item);
+                        readNextItem_(item_ptr);
+                        if(STF_EXPECT_FALSE(itemSkipped_(*item_ptr))) {
+                            skippedItemCleanup_(*item_ptr);
                             did_skip = true;
                             continue;
                         }
@@ -167,7 +193,7 @@ namespace stf {
                         break;
                     }
                     if(STF_EXPECT_FALSE(did_skip)) {
-                        finishedSkippingCleanup_(item);
+                        finishedSkippingCleanup_(*item_ptr);
                         did_skip = false;
                     }
                     ++tail_;
@@ -192,8 +218,8 @@ namespace stf {
              */
             __attribute__((always_inline))
             inline void validateItemIndex_(const uint64_t index) const {
-                const auto& tail = buf_[tail_];
-                stf_assert(index >= buf_[head_].index() && (itemSkipped_(tail) || index <= tail.index()),
+                const auto& tail = *buf_[tail_];
+                stf_assert(index >= buf_[head_]->index() && (itemSkipped_(tail) || index <= tail.index()),
                            "sliding window index out of range");
             }
 
@@ -205,7 +231,7 @@ namespace stf {
             __attribute__((always_inline))
             inline const ItemType* getItem_(const uint64_t index, const size_t loc) const {
                 validateItemIndex_(index);
-                return &buf_[loc];
+                return buf_[loc].get();
             }
 
             /**
@@ -216,7 +242,7 @@ namespace stf {
             __attribute__((always_inline))
             inline ItemType* getItem_(const uint64_t index, const size_t loc) {
                 validateItemIndex_(index);
-                return &buf_[loc];
+                return buf_[loc].get();
             }
 
             /**
@@ -338,17 +364,18 @@ namespace stf {
              */
             size_t fillHalfBuffer_() {
                 size_t pos = tail_;
+                const bool buffer_full = (head_ == ((tail_ + 1) & buffer_mask_));
                 const size_t init_item_cnt = numItemsReadFromReader_();
                 const size_t max_item_cnt = init_item_cnt + (buffer_size_ / 2);
                 bool did_skip = false;
                 while(numItemsReadFromReader_() < max_item_cnt) {
                     pos = (pos + 1) & buffer_mask_;
 
-                    auto& item = buf_[pos];
+                    auto& item_ptr = buf_[pos];
                     try {
-                        readNextItem_(item);
-                        if(STF_EXPECT_FALSE(itemSkipped_(item))) {
-                            skippedItemCleanup_(item);
+                        readNextItem_(item_ptr);
+                        if(STF_EXPECT_FALSE(itemSkipped_(*item_ptr))) {
+                            skippedItemCleanup_(*item_ptr);
                             did_skip = true;
                             pos = (pos - 1) & buffer_mask_;
                             continue;
@@ -360,7 +387,7 @@ namespace stf {
                     }
 
                     if(STF_EXPECT_FALSE(did_skip)) {
-                        finishedSkippingCleanup_(item);
+                        finishedSkippingCleanup_(*item_ptr);
                         did_skip = false;
                     }
                 }
@@ -372,16 +399,34 @@ namespace stf {
                     head_ = (head_ + item_cnt) & buffer_mask_;
                 }
 
+                // When the end of the trace is reached, the slot after the new tail has already been passed to
+                // readNextItem_ and may hold a skipped item or a partially read one. If the buffer was full, that
+                // slot held the oldest item, so it has to leave the window.
+                if (STF_EXPECT_FALSE(last_item_read_ && buffer_full)) {
+                    head_ = (head_ + 1) & buffer_mask_;
+                }
+
                 return item_cnt;
             }
 
             /**
-             * read STF records to construct a ItemType instance. readNext_ must be implemented by subclass
+             * Default buffered item read. Constructs the item in place with readNext_, which must be implemented by
+             * subclass.
              * \param item Item to modify with the record
              */
             __attribute__((hot, always_inline))
-            inline void readNextItem_(ItemType &item) {
-                static_cast<ReaderType*>(this)->readNext_(item);
+            inline void readNextBuffered_(ItemPtr& item) {
+                static_cast<ReaderType*>(this)->readNext_(*item);
+            }
+
+            /**
+             * read STF records to construct a ItemType instance. Delegates to the subclass if it defines a
+             * readNextBuffered_ method, which may replace the item with one it constructed elsewhere.
+             * \param item Item to modify with the record
+             */
+            __attribute__((hot, always_inline))
+            inline void readNextItem_(ItemPtr& item) {
+                static_cast<ReaderType*>(this)->readNextBuffered_(item);
             }
 
             /**
@@ -403,6 +448,7 @@ namespace stf {
             inline const STFRecord* readRecord_(ItemType& item) {
                 STFRecord::UniqueHandle urec;
                 BaseReaderType::operator>>(urec);
+                static_cast<ReaderType*>(this)->recordReadCallback_(*urec);
 
                 if(STF_EXPECT(filter_.isFiltered(urec->getId()), assume_filtered)) {
                         return nullptr;
@@ -415,7 +461,7 @@ namespace stf {
              * Gets the index of the first item in the buffer
              */
             inline uint64_t getFirstIndex_() {
-                return buf_[head_].index();
+                return buf_[head_]->index();
             }
 
             /**
@@ -666,7 +712,7 @@ namespace stf {
                 BaseReaderType::open(filename, force_single_threaded_stream);
 
                 if constexpr(Indexed) {
-                    indexer_.open(filename);
+                    indexer_.open(filename, BaseReaderType::getChunkSize() != 0);
                 }
 
                 resetBuffer_();
@@ -732,8 +778,32 @@ namespace stf {
             inline std::enable_if_t<IsIndexed && std::is_same_v<U, ReaderType>, typename U::iterator> jumpToIndex(const size_t index) {
                 stf_assert(num_skipped_items_ == 0, "Indexed seeking does not support item skipping");
 
-                auto it = indexer_.findNearestEntry(index);
-                stream_->seekFromOffset(it->second, it->first, index - it->first);
+                if(indexer_.usesChunkIndex()) {
+                    stream_->seekFromOffset(0, index, 0);
+                }
+                else {
+                    auto it = indexer_.findNearestEntry(index);
+                    // Uncompressed streams can't recover the PC on their own after seeking to an offset
+                    stream_->seekFromOffset(it->second.offset, it->first, 0);
+                    stream_->forcePC(it->second.pc);
+                    if(index > it->first) {
+                        stream_->seek(index - it->first);
+                    }
+                }
+                head_ = 0;
+                tail_ = 0;
+                initItemBuffer_();
+                return begin();
+            }
+
+            /**
+             * \brief Jumps the reader to the given marker record in a compressed trace, returning an iterator to the
+             * item that starts there
+             * \param num_markers Number of marker records that come before the jump target. Must be at a chunk boundary.
+             */
+            template<typename U = ReaderType>
+            inline typename U::iterator jumpToMarker_(const size_t num_markers) {
+                stream_->seekFromOffset(0, num_markers, 0);
                 head_ = 0;
                 tail_ = 0;
                 initItemBuffer_();
@@ -0,0 +1,136 @@
+#ifndef __STF_CHUNK_CACHE_HPP__
+#define __STF_CHUNK_CACHE_HPP__
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include <sys/stat.h>
+
+#include "stf_compression_buffer.hpp"
+
+namespace stf {
+    /**
+     * \class STFChunkCache
+     *
+     * Bounded LRU cache of decompressed chunks, keyed by chunk index. Chunks are shared with the buffers they were
+     * decompressed into instead of being copied, so inserting a chunk or handing one back out doesn't copy any data.
+     *
+     * The cache is disabled until it is given a capacity. It is safe to use from multiple threads, so the read-ahead
+     * helpers of a stream can fill it while the stream itself reads from it.
+     *
+     * Streams get their cache from attach(), which hands every stream reading the same file in this process the same
+     * cache. Helper readers opened on a trace, such as the ones used to decode chunks in parallel, reuse the chunks
+     * that any of the others have already decompressed.
+     */
+    class STFChunkCache {
+        public:
+            /**
+             * \struct Stats
+             * Snapshot of the cache state
+             */
+            struct Stats {
+                size_t capacity = 0; /**< Maximum number of bytes the cache can hold */
+                size_t num_bytes = 0; /**< Number of bytes currently held */
+                size_t num_chunks = 0; /**< Number of chunks currently held */
+                size_t hits = 0; /**< Number of lookups that found their chunk since the last reset */
+                size_t misses = 0; /**< Number of lookups that had to decompress their chunk since the last reset */
+                size_t evictions = 0; /**< Number of chunks evicted to make room for others since the last reset */
+            };
+
+        private:
+            /**
+             * \struct Entry
+             * Cached chunk
+             */
+            struct Entry {
+                size_t chunk_idx; /**< Chunk index */
+                STFCompressionBuffer buf; /**< Decompressed chunk */
+            };
+
+            using EntryList = std::list<Entry>;
+
+            mutable std::mutex mutex_; /**< Guards all cache state */
+            EntryList entries_; /**< Cached chunks, most recently used first */
+            std::unordered_map<size_t, EntryList::iterator> index_; /**< Maps chunk indices to entries */
+            size_t capacity_ = 0; /**< Maximum number of bytes to hold */
+            size_t num_bytes_ = 0; /**< Number of bytes currently held */
+            size_t hits_ = 0; /**< Number of hits since the last reset */
+            size_t misses_ = 0; /**< Number of misses since the last reset */
+            size_t evictions_ = 0; /**< Number of evictions since the last reset */
+
+            /**
+             * Evicts least recently used chunks until the cache holds no more than the given number of bytes. The
+             * caller must hold mutex_.
+             * \param num_bytes Number of bytes to shrink to
+             */
+            void evict_(size_t num_bytes);
+
+        public:
+            STFChunkCache() = default;
+            STFChunkCache(const STFChunkCache&) = delete;
+            STFChunkCache& operator=(const STFChunkCache&) = delete;
+
+            /**
+             * Gets the cache shared by every stream in this process that is reading the given file, creating it if
+             * necessary. The cache is destroyed once the last stream using it lets go of it.
+             * \param file_stat Result of calling fstat() on the trace file
+             */
+            static std::shared_ptr<STFChunkCache> attach(const struct stat& file_stat);
+
+            /**
+             * Grows the cache to hold at least the given number of bytes. Caches shared between several streams are
+             * as large as the largest size any of them asked for.
+             * \param num_bytes Minimum capacity in bytes
+             */
+            void reserve(size_t num_bytes);
+
+            /**
+             * Sets the maximum number of bytes the cache can hold, evicting chunks if it shrinks. A capacity of 0
+             * disables the cache.
+             * \param num_bytes Capacity in bytes
+             */
+            void setCapacity(size_t num_bytes);
+
+            /**
+             * Gets the maximum number of bytes the cache can hold
+             */
+            size_t getCapacity() const;
+
+            /**
+             * Looks up a chunk. On a hit, buf is pointed at the cached chunk and the chunk becomes the most recently
+             * used one. Decompressing into buf afterwards leaves the cached copy untouched, since the buffer gets its
+             * own memory back as soon as it is written to.
+             * \param chunk_idx Chunk index
+             * \param buf Buffer that receives the chunk
+             * \returns True if the chunk was found
+             */
+            bool find(size_t chunk_idx, STFCompressionBuffer& buf);
+
+            /**
+             * Adds a freshly decompressed chunk, evicting the least recently used chunks to make room for it
+             * \param chunk_idx Chunk index
+             * \param buf Buffer holding the decompressed chunk
+             */
+            void insert(size_t chunk_idx, const STFCompressionBuffer& buf);
+
+            /**
+             * Removes all chunks from the cache
+             */
+            void clear();
+
+            /**
+             * Gets a snapshot of the cache statistics
+             */
+            Stats getStats() const;
+
+            /**
+             * Resets the hit, miss, and eviction counts
+             */
+            void resetStats();
+    };
+} // end namespace stf
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef __STF_CHUNK_PARALLEL_HPP__
+#define __STF_CHUNK_PARALLEL_HPP__
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <future>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "stf_inst_reader.hpp"
+#include "stf_thread_pool.hpp"
+
+namespace stf {
+    /**
+     * Runs a function on every compressed chunk in a trace in parallel. Each worker opens its own STFInstReader
+     * and claims chunks one at a time until none are left, so chunks are not processed in order. The calling thread
+     * acts as one of the workers, and the rest run on the STFThreadPool. Uncompressed traces are processed as a
+     * single chunk.
+     *
+     * Readers are opened without non-user-mode skipping or address translation. Chunk state is restored from the
+     * trace's chunk snapshots if it has them, otherwise only the PC is restored at the start of each chunk.
+     *
+     * If a worker throws, the other workers stop claiming chunks, and the first exception is rethrown once every
+     * worker has finished.
+     *
+     * \param filename Trace to read
+     * \param func Callable that takes a worker index, the worker's STFInstReader, and a chunk index. Called
+     * concurrently from multiple threads, but never concurrently with the same worker index.
+     * \param max_workers Maximum number of workers to use. If 0, uses one worker per STFThreadPool thread.
+     * \returns Number of workers used
+     */
+    template<typename ChunkFunc>
+    size_t parallelForEachChunk(const std::string_view filename, ChunkFunc&& func, const size_t max_workers = 0) {
+        // Only used if func iterates over the reader instead of calling forEachInstInChunk
+        static constexpr size_t READER_BUFFER_SIZE = 1024;
+
+        const std::string filename_str(filename);
+
+        // Helper threads can't wait on each other, so every reader uses a single-threaded stream
+        auto open_reader = [&filename_str]() {
+            return std::make_unique<STFInstReader>(filename_str, false, false, false, READER_BUFFER_SIZE, true);
+        };
+
+        auto first_reader = open_reader();
+        const size_t num_chunks = first_reader->getNumChunks();
+        const size_t num_workers = std::min(num_chunks,
+                                            max_workers ? max_workers : std::max<size_t>(STFThreadPool::get().getNumThreads(), 1));
+
+        std::atomic<size_t> next_chunk{0};
+        auto run_worker = [&func, &next_chunk, num_chunks](const size_t worker_idx, STFInstReader& reader) {
+            for(size_t chunk_idx = next_chunk++; chunk_idx < num_chunks; chunk_idx = next_chunk++) {
+                func(worker_idx, reader, chunk_idx);
+            }
+        };
+
+        // Keeps the other workers from claiming any more chunks once one of them fails
+        auto stop_on_error = [&next_chunk, num_chunks](auto&& worker) {
+            try {
+                worker();
+            }
+            catch(...) {
+                next_chunk = num_chunks;
+                throw;
+            }
+        };
+
+        std::vector<std::future<void>> results;
+        results.reserve(num_workers);
+        for(size_t i = 1; i < num_workers; ++i) {
+            results.emplace_back(STFThreadPool::get().submit([&stop_on_error, &run_worker, &open_reader, i]() {
+                                                                 stop_on_error([&run_worker, &open_reader, i]() {
+                                                                     run_worker(i, *open_reader());
+                                                                 });
+                                                             }));
+        }
+
+        std::exception_ptr error;
+        try {
+            stop_on_error([&run_worker, &first_reader]() { run_worker(0, *first_reader); });
+        }
+        catch(...) {
+            error = std::current_exception();
+        }
+
+        // Make sure every helper thread is done with our stack before propagating any exceptions
+        for(auto& result: results) {
+            try {
+                result.get();
+            }
+            catch(...) {
+                if(!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+
+        if(error) {
+            std::rethrow_exception(error);
+        }
+
+        return num_workers;
+    }
+
+    /**
+     * Computes an aggregate over every instruction in a trace, processing compressed chunks in parallel. Each worker
+     * builds its own Accumulator, and the accumulators are merged once all chunks have been processed. Since
+     * instructions are visited in chunk order within a worker, but chunks are spread across workers, the result must
+     * not depend on the order of the instructions.
+     *
+     * \tparam Accumulator Default-constructible type with a merge(const Accumulator&) method
+     * \param filename Trace to read
+     * \param map_func Callable that adds a const STFInst& to an Accumulator&
+     * \param max_workers Maximum number of workers to use. If 0, uses one worker per STFThreadPool thread.
+     * \returns Merged accumulator
+     */
+    template<typename Accumulator, typename MapFunc>
+    Accumulator mapReduceChunks(const std::string_view filename, MapFunc&& map_func, const size_t max_workers = 0) {
+        std::vector<Accumulator> accumulators(max_workers ? max_workers : std::max<size_t>(STFThreadPool::get().getNumThreads(), 1));
+
+        const size_t num_workers = parallelForEachChunk(
+            filename,
+            [&accumulators, &map_func](const size_t worker_idx, STFInstReader& reader, const size_t chunk_idx) {
+                auto& accumulator = accumulators[worker_idx];
+                reader.forEachInstInChunk(chunk_idx, [&accumulator, &map_func](const STFInst& inst) {
+                    map_func(accumulator, inst);
+                });
+            },
+            accumulators.size()
+        );
+
+        Accumulator result;
+        for(size_t i = 0; i < num_workers; ++i) {
+            result.merge(accumulators[i]);
+        }
+
+        return result;
+    }
+} // end namespace stf
+
+#endif
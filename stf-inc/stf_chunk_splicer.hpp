@@ -0,0 +1,114 @@
+#ifndef __STF_CHUNK_SPLICER_HPP__
+#define __STF_CHUNK_SPLICER_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+
+#include "stf_record_types.hpp"
+#include "stf_writer.hpp"
+
+namespace stf {
+    class STFReader;
+
+    /**
+     * \class STFChunkSplicer
+     *
+     * Builds an instruction trace out of marker record ranges taken from other traces, e.g. to extract a window from
+     * a long trace or to concatenate per-region traces.
+     *
+     * Compressed (.zstf) chunks that fall entirely within a range are copied into the output byte-for-byte, so only
+     * the chunks at the edges of each range are decompressed and rewritten record by record. Chunks can only be
+     * copied if the source and output use the same chunk size and the copied chunk lands on a chunk boundary in the
+     * output, so ranges should start on chunk boundaries and every range but the last should hold a multiple of the
+     * chunk size. Ranges that don't line up still work, they are just rewritten instead of copied. The first chunk
+     * of each range and the last chunk of each source are always rewritten.
+     *
+     * The output header is copied from the first source. Each later range starts with INST_IEM, PROCESS_ID_EXT and
+     * FORCE_PC records that restore the state in effect where the range starts. That state is
+     * found by replaying the source from the nearest chunk state snapshot (see STF_CHUNK_SNAPSHOTS), or from the
+     * beginning of the source if it doesn't have snapshots.
+     *
+     * Sources with page table walks are handled more slowly. Chunk snapshots don't hold the page table, so it is
+     * always rebuilt by replaying the source from its beginning. Page table walk records also hold the index of the
+     * instruction they take effect at, which has to be shifted whenever a range lands at a different index in the
+     * output than in its source. As a result, chunks are only copied from ranges that land at the same index they
+     * came from (e.g. a range that starts at the beginning of the first source). Every other range is rewritten.
+     */
+    class STFChunkSplicer {
+        public:
+            static constexpr uint64_t END_OF_TRACE = std::numeric_limits<uint64_t>::max(); /**< Range end that extends to the end of the source */
+
+        private:
+            std::string filename_; /**< Output filename */
+            STFWriter writer_; /**< Output trace */
+            size_t chunk_size_ = 0; /**< Output chunk size */
+            uint64_t num_markers_ = 0; /**< Number of marker records written to the output */
+            size_t num_copied_chunks_ = 0; /**< Number of chunks copied without decompressing them */
+            size_t num_rewritten_chunks_ = 0; /**< Number of chunks that were decompressed and rewritten */
+
+            /**
+             * Opens the output and writes its header
+             * \param reader First source, positioned at the start of the first range
+             * \param state State at the start of the first range
+             */
+            void openOutput_(const STFReader& reader, const ChunkStateSnapshot& state);
+
+            /**
+             * Copies as many whole chunks as possible from the source without decompressing them. Returns the number
+             * of marker records copied.
+             * \param reader Source
+             * \param start Marker record index in the source to copy from
+             * \param end Marker record index in the source to stop at
+             * \param copyable Set to false once the source has no more chunks that the output can take
+             */
+            uint64_t copyChunks_(STFReader& reader, uint64_t start, uint64_t end, bool& copyable);
+
+        public:
+            /**
+             * Constructs an STFChunkSplicer. The output is opened when the first range is appended.
+             * \param filename Output filename
+             */
+            explicit STFChunkSplicer(std::string_view filename);
+
+            ~STFChunkSplicer();
+
+            /**
+             * Appends a range of marker records from a trace
+             * \param filename Source filename
+             * \param start Number of marker records to skip at the start of the source
+             * \param end Number of marker records in the source to stop after
+             */
+            void append(std::string_view filename, uint64_t start = 0, uint64_t end = END_OF_TRACE);
+
+            /**
+             * Finishes and closes the output
+             */
+            void close();
+
+            /**
+             * Gets the number of marker records written so far
+             */
+            inline uint64_t getNumMarkers() const {
+                return num_markers_;
+            }
+
+            /**
+             * Gets the number of chunks that were copied without decompressing them
+             */
+            inline size_t getNumCopiedChunks() const {
+                return num_copied_chunks_;
+            }
+
+            /**
+             * Gets the number of source chunks that were decompressed and rewritten record by record
+             */
+            inline size_t getNumRewrittenChunks() const {
+                return num_rewritten_chunks_;
+            }
+    };
+} // end namespace stf
+
+#endif
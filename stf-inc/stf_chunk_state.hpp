@@ -0,0 +1,203 @@
+#ifndef __STF_CHUNK_STATE_HPP__
+#define __STF_CHUNK_STATE_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "boost_wrappers/flat_map.hpp"
+
+#include "stf_enum_utils.hpp"
+#include "stf_enums.hpp"
+#include "stf_reg_def.hpp"
+
+namespace stf {
+    class STFRecord;
+
+    /**
+     * \class ChunkStateSnapshot
+     *
+     * Holds the architectural state that is in effect at the start of a compressed trace chunk, so that the chunk can
+     * be decoded without reading any of the chunks that come before it.
+     */
+    class ChunkStateSnapshot {
+        public:
+            /**
+             * \typedef RegisterMap
+             * Maps registers to their last known values. Scalar registers hold a single value.
+             */
+            using RegisterMap = boost::container::flat_map<Registers::STF_REG, std::vector<uint64_t>>;
+
+        private:
+            uint64_t marker_index_ = 0; /**< Number of marker records that come before the chunk */
+            INST_IEM iem_ = INST_IEM::STF_INST_IEM_INVALID; /**< Current IEM */
+            EXECUTION_MODE mode_ = EXECUTION_MODE::USER_MODE; /**< Current execution mode */
+            bool has_process_ids_ = false; /**< Set to true if a ProcessIDExtRecord came before the chunk */
+            uint32_t hart_ = 0; /**< Current hardware thread ID */
+            uint32_t pid_ = 0; /**< Current PID */
+            uint32_t tid_ = 0; /**< Current TID */
+            RegisterMap registers_; /**< Last known value of every register seen before the chunk */
+
+            friend class ChunkStateTracker;
+
+        public:
+            /**
+             * Gets the number of marker records that come before the chunk
+             */
+            inline uint64_t getMarkerIndex() const {
+                return marker_index_;
+            }
+
+            /**
+             * Gets the IEM in effect at the start of the chunk
+             */
+            inline INST_IEM getIEM() const {
+                return iem_;
+            }
+
+            /**
+             * Gets the execution mode in effect at the start of the chunk
+             */
+            inline EXECUTION_MODE getExecutionMode() const {
+                return mode_;
+            }
+
+            /**
+             * Returns whether any ProcessIDExtRecords came before the chunk
+             */
+            inline bool hasProcessIDs() const {
+                return has_process_ids_;
+            }
+
+            /**
+             * Gets the hardware thread ID in effect at the start of the chunk
+             */
+            inline uint32_t getHardwareTID() const {
+                return hart_;
+            }
+
+            /**
+             * Gets the PID in effect at the start of the chunk
+             */
+            inline uint32_t getPID() const {
+                return pid_;
+            }
+
+            /**
+             * Gets the TID in effect at the start of the chunk
+             */
+            inline uint32_t getTID() const {
+                return tid_;
+            }
+
+            /**
+             * Gets the last known value of every register seen before the chunk
+             */
+            inline const RegisterMap& getRegisters() const {
+                return registers_;
+            }
+
+            /**
+             * Serializes the snapshot
+             * \param write Callable that writes a single arithmetic value
+             */
+            template<typename WriteFunc>
+            inline void write(WriteFunc&& write) const {
+                write(marker_index_);
+                write(enums::to_int(iem_));
+                write(enums::to_int(mode_));
+                write(static_cast<uint8_t>(has_process_ids_));
+                write(hart_);
+                write(pid_);
+                write(tid_);
+                write(static_cast<uint64_t>(registers_.size()));
+                for(const auto& reg: registers_) {
+                    write(enums::to_int(reg.first));
+                    write(static_cast<uint64_t>(reg.second.size()));
+                    for(const auto val: reg.second) {
+                        write(val);
+                    }
+                }
+            }
+
+            /**
+             * Deserializes the snapshot
+             * \param read Callable that reads a single arithmetic value
+             */
+            template<typename ReadFunc>
+            inline void read(ReadFunc&& read) {
+                enums::int_t<INST_IEM> iem;
+                enums::int_t<EXECUTION_MODE> mode;
+                uint8_t has_process_ids;
+                uint64_t num_registers;
+
+                read(marker_index_);
+                read(iem);
+                read(mode);
+                read(has_process_ids);
+                read(hart_);
+                read(pid_);
+                read(tid_);
+                read(num_registers);
+
+                iem_ = static_cast<INST_IEM>(iem);
+                mode_ = static_cast<EXECUTION_MODE>(mode);
+                has_process_ids_ = has_process_ids;
+
+                registers_.clear();
+                registers_.reserve(num_registers);
+                for(uint64_t i = 0; i < num_registers; ++i) {
+                    enums::int_t<Registers::STF_REG> reg;
+                    uint64_t num_values;
+                    read(reg);
+                    read(num_values);
+                    auto& values = registers_[static_cast<Registers::STF_REG>(reg)];
+                    values.resize(num_values);
+                    for(auto& val: values) {
+                        read(val);
+                    }
+                }
+            }
+    };
+
+    /**
+     * \class ChunkStateTracker
+     *
+     * Follows the architectural state of a trace as it is written so that a ChunkStateSnapshot can be taken at each
+     * chunk boundary. The trace is assumed to start in user mode, matching the behavior of STFInstReader. Header
+     * records are ignored since readers handle them separately from the instruction stream.
+     */
+    class ChunkStateTracker {
+        private:
+            ChunkStateSnapshot state_; /**< Current state */
+            bool header_done_ = false; /**< Set to true once the end of the header has been written */
+
+        public:
+            /**
+             * Updates the state with the given record
+             * \param rec Record to inspect
+             */
+            void track(const STFRecord& rec);
+
+            /**
+             * Replaces the current state, e.g. when records from another trace are spliced in
+             * \param state State to switch to
+             */
+            inline void setState(const ChunkStateSnapshot& state) {
+                state_ = state;
+                header_done_ = true;
+            }
+
+            /**
+             * Takes a snapshot of the current state
+             * \param marker_index Number of marker records written so far
+             */
+            inline ChunkStateSnapshot getSnapshot(const uint64_t marker_index) const {
+                ChunkStateSnapshot snapshot = state_;
+                snapshot.marker_index_ = marker_index;
+                return snapshot;
+            }
+    };
+} // end namespace stf
+
+#endif
@@ -0,0 +1,384 @@
+#ifndef __STF_CHUNK_SUMMARY_HPP__
+#define __STF_CHUNK_SUMMARY_HPP__
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "stf_chunk_state.hpp"
+#include "stf_descriptor.hpp"
+#include "stf_enum_utils.hpp"
+#include "stf_enums.hpp"
+
+namespace stf {
+    class STFRecord;
+
+    /**
+     * \class ChunkSummary
+     *
+     * Summarizes the contents of a compressed trace chunk so that tools can decide whether to process a chunk without
+     * decompressing it.
+     */
+    class ChunkSummary {
+        public:
+            static constexpr size_t NUM_DESCRIPTORS = enums::size<descriptors::encoded::Descriptor>(); /**< Number of histogram bins */
+
+            /**
+             * \typedef DescriptorHistogram
+             * Holds the number of records seen for each encoded descriptor
+             */
+            using DescriptorHistogram = std::array<uint64_t, NUM_DESCRIPTORS>;
+
+            /**
+             * \class Range
+             * Tracks the minimum and maximum of a set of values
+             */
+            template<typename T>
+            class Range {
+                private:
+                    T min_ = std::numeric_limits<T>::max(); /**< Minimum value */
+                    T max_ = std::numeric_limits<T>::min(); /**< Maximum value */
+
+                public:
+                    /**
+                     * Adds a value to the range
+                     * \param val Value to add
+                     */
+                    inline void add(const T val) {
+                        min_ = std::min(min_, val);
+                        max_ = std::max(max_, val);
+                    }
+
+                    /**
+                     * Adds another range to this one
+                     * \param rhs Range to add
+                     */
+                    inline void merge(const Range& rhs) {
+                        min_ = std::min(min_, rhs.min_);
+                        max_ = std::max(max_, rhs.max_);
+                    }
+
+                    /**
+                     * Returns whether any values have been added to the range
+                     */
+                    inline bool valid() const {
+                        return min_ <= max_;
+                    }
+
+                    /**
+                     * Returns whether the range overlaps [lo, hi]
+                     * \param lo Lower bound
+                     * \param hi Upper bound
+                     */
+                    inline bool overlaps(const T lo, const T hi) const {
+                        return valid() && min_ <= hi && lo <= max_;
+                    }
+
+                    /**
+                     * Gets the minimum value
+                     */
+                    inline T getMin() const {
+                        return min_;
+                    }
+
+                    /**
+                     * Gets the maximum value
+                     */
+                    inline T getMax() const {
+                        return max_;
+                    }
+
+                    /**
+                     * Sets the minimum and maximum values
+                     * \param min Minimum value
+                     * \param max Maximum value
+                     */
+                    inline void set(const T min, const T max) {
+                        min_ = min;
+                        max_ = max;
+                    }
+            };
+
+        private:
+            uint64_t num_markers_ = 0; /**< Number of marker records (instructions) in the chunk */
+            Range<uint64_t> pc_range_; /**< Range of instruction PCs */
+            uint8_t execution_modes_ = 0; /**< Bitmask of EXECUTION_MODEs active at any point in the chunk */
+            Range<uint32_t> hart_range_; /**< Range of hardware thread IDs */
+            Range<uint32_t> pid_range_; /**< Range of PIDs */
+            Range<uint32_t> tid_range_; /**< Range of TIDs */
+            uint64_t num_mem_accesses_ = 0; /**< Number of memory access records */
+            uint64_t num_events_ = 0; /**< Number of event records */
+            DescriptorHistogram descriptor_counts_{}; /**< Number of records seen for each descriptor */
+
+            static inline uint8_t getModeMask_(const EXECUTION_MODE mode) {
+                return static_cast<uint8_t>(1U << enums::to_int(mode));
+            }
+
+            friend class ChunkSummaryTracker;
+
+        public:
+            /**
+             * Gets the number of marker records (instructions) in the chunk
+             */
+            inline uint64_t getNumMarkers() const {
+                return num_markers_;
+            }
+
+            /**
+             * Gets the range of instruction PCs in the chunk
+             */
+            inline const Range<uint64_t>& getPCRange() const {
+                return pc_range_;
+            }
+
+            /**
+             * Returns whether any instruction in the chunk has a PC in [lo, hi]
+             * \param lo Lower bound
+             * \param hi Upper bound
+             */
+            inline bool overlapsPCRange(const uint64_t lo, const uint64_t hi) const {
+                return pc_range_.overlaps(lo, hi);
+            }
+
+            /**
+             * Adds an execution mode to the chunk
+             * \param mode Mode to add
+             */
+            inline void addExecutionMode(const EXECUTION_MODE mode) {
+                execution_modes_ |= getModeMask_(mode);
+            }
+
+            /**
+             * Returns whether the given execution mode was active at any point in the chunk
+             * \param mode Mode to check
+             */
+            inline bool hasExecutionMode(const EXECUTION_MODE mode) const {
+                return execution_modes_ & getModeMask_(mode);
+            }
+
+            /**
+             * Gets the bitmask of execution modes active in the chunk. Bit N is set if EXECUTION_MODE N was active.
+             */
+            inline uint8_t getExecutionModes() const {
+                return execution_modes_;
+            }
+
+            /**
+             * Gets the range of hardware thread IDs in the chunk
+             */
+            inline const Range<uint32_t>& getHartRange() const {
+                return hart_range_;
+            }
+
+            /**
+             * Gets the range of PIDs in the chunk
+             */
+            inline const Range<uint32_t>& getPIDRange() const {
+                return pid_range_;
+            }
+
+            /**
+             * Gets the range of TIDs in the chunk
+             */
+            inline const Range<uint32_t>& getTIDRange() const {
+                return tid_range_;
+            }
+
+            /**
+             * Gets the number of memory access records in the chunk
+             */
+            inline uint64_t getNumMemAccesses() const {
+                return num_mem_accesses_;
+            }
+
+            /**
+             * Gets the number of event records in the chunk
+             */
+            inline uint64_t getNumEvents() const {
+                return num_events_;
+            }
+
+            /**
+             * Gets the number of records with the given descriptor in the chunk
+             * \param desc Descriptor to look up
+             */
+            inline uint64_t getDescriptorCount(const descriptors::encoded::Descriptor desc) const {
+                return descriptor_counts_[enums::to_int(desc)];
+            }
+
+            /**
+             * Gets the number of records with the given descriptor in the chunk
+             * \param desc Descriptor to look up
+             */
+            inline uint64_t getDescriptorCount(const descriptors::internal::Descriptor desc) const {
+                return getDescriptorCount(descriptors::conversion::toEncoded(desc));
+            }
+
+            /**
+             * Gets the descriptor histogram, indexed by encoded descriptor value
+             */
+            inline const DescriptorHistogram& getDescriptorCounts() const {
+                return descriptor_counts_;
+            }
+
+            /**
+             * Adds another summary to this one, e.g. to build whole-trace statistics
+             * \param rhs Summary to add
+             */
+            inline void merge(const ChunkSummary& rhs) {
+                num_markers_ += rhs.num_markers_;
+                pc_range_.merge(rhs.pc_range_);
+                execution_modes_ |= rhs.execution_modes_;
+                hart_range_.merge(rhs.hart_range_);
+                pid_range_.merge(rhs.pid_range_);
+                tid_range_.merge(rhs.tid_range_);
+                num_mem_accesses_ += rhs.num_mem_accesses_;
+                num_events_ += rhs.num_events_;
+                for(size_t i = 0; i < NUM_DESCRIPTORS; ++i) {
+                    descriptor_counts_[i] += rhs.descriptor_counts_[i];
+                }
+            }
+
+            /**
+             * Serializes the summary
+             * \param write Callable that writes a single arithmetic value
+             */
+            template<typename WriteFunc>
+            inline void write(WriteFunc&& write) const {
+                write(num_markers_);
+                write(pc_range_.getMin());
+                write(pc_range_.getMax());
+                write(execution_modes_);
+                for(const auto* range: {&hart_range_, &pid_range_, &tid_range_}) {
+                    write(range->getMin());
+                    write(range->getMax());
+                }
+                write(num_mem_accesses_);
+                write(num_events_);
+                write(static_cast<uint64_t>(NUM_DESCRIPTORS));
+                for(const auto count: descriptor_counts_) {
+                    write(count);
+                }
+            }
+
+            /**
+             * Deserializes the summary
+             * \param read Callable that reads a single arithmetic value
+             */
+            template<typename ReadFunc>
+            inline void read(ReadFunc&& read) {
+                uint64_t min_pc;
+                uint64_t max_pc;
+
+                read(num_markers_);
+                read(min_pc);
+                read(max_pc);
+                pc_range_.set(min_pc, max_pc);
+                read(execution_modes_);
+                for(auto* range: {&hart_range_, &pid_range_, &tid_range_}) {
+                    uint32_t min;
+                    uint32_t max;
+                    read(min);
+                    read(max);
+                    range->set(min, max);
+                }
+                read(num_mem_accesses_);
+                read(num_events_);
+
+                // Traces written by newer versions may have more descriptors than we know about
+                uint64_t num_descriptors;
+                read(num_descriptors);
+                descriptor_counts_.fill(0);
+                for(uint64_t i = 0; i < num_descriptors; ++i) {
+                    uint64_t count;
+                    read(count);
+                    if(i < NUM_DESCRIPTORS) {
+                        descriptor_counts_[i] = count;
+                    }
+                }
+            }
+    };
+
+    /**
+     * \class ChunkSummaryTracker
+     *
+     * Builds ChunkSummary objects from the records written to a compressed trace.
+     * The trace is assumed to start in user mode, matching the behavior of STFInstReader.
+     */
+    class ChunkSummaryTracker {
+        private:
+            ChunkSummary summary_; /**< Summary of the current chunk */
+            EXECUTION_MODE mode_ = EXECUTION_MODE::USER_MODE; /**< Current execution mode */
+            bool has_process_ids_ = false; /**< Set to true once a ProcessIDExtRecord has been seen */
+            uint32_t hart_ = 0; /**< Current hardware thread ID */
+            uint32_t pid_ = 0; /**< Current PID */
+            uint32_t tid_ = 0; /**< Current TID */
+
+            /**
+             * Adds the current execution mode and process IDs to the summary
+             */
+            inline void addCurrentState_() {
+                summary_.addExecutionMode(mode_);
+                if(has_process_ids_) {
+                    summary_.hart_range_.add(hart_);
+                    summary_.pid_range_.add(pid_);
+                    summary_.tid_range_.add(tid_);
+                }
+            }
+
+        public:
+            ChunkSummaryTracker() {
+                addCurrentState_();
+            }
+
+            /**
+             * Adds a record to the current chunk summary
+             * \param rec Record to add
+             */
+            void track(const STFRecord& rec);
+
+            /**
+             * Switches to the execution mode and process IDs in the given state, e.g. when records from another trace
+             * are spliced in
+             * \param state State to switch to
+             * \param chunk_start If true, nothing has been added to the current chunk yet, so its summary is restarted
+             * with only the new state
+             */
+            inline void setState(const ChunkStateSnapshot& state, const bool chunk_start) {
+                mode_ = state.getExecutionMode();
+                has_process_ids_ = state.hasProcessIDs();
+                hart_ = state.getHardwareTID();
+                pid_ = state.getPID();
+                tid_ = state.getTID();
+
+                if(chunk_start) {
+                    summary_ = ChunkSummary();
+                }
+
+                addCurrentState_();
+            }
+
+            /**
+             * Adds a marker record (instruction) to the current chunk summary
+             * \param pc PC of the instruction
+             */
+            inline void trackMarker(const uint64_t pc) {
+                ++summary_.num_markers_;
+                summary_.pc_range_.add(pc);
+            }
+
+            /**
+             * Returns the summary of the current chunk and starts a new one
+             */
+            inline ChunkSummary finishChunk() {
+                ChunkSummary result = summary_;
+                summary_ = ChunkSummary();
+                addCurrentState_();
+                return result;
+            }
+    };
+} // end namespace stf
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef __STF_COMPRESSED_CHUNK_HPP__
+#define __STF_COMPRESSED_CHUNK_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "stf_chunk_state.hpp"
+#include "stf_chunk_summary.hpp"
+
+namespace stf {
+    /**
+     * \struct CompressedChunk
+     *
+     * A compressed chunk exactly as it is stored in a trace file, along with everything another trace needs in order
+     * to append it without decompressing it. Only full chunks can be copied this way, so the last chunk of a trace
+     * is never read into a CompressedChunk.
+     */
+    struct CompressedChunk {
+        std::vector<uint8_t> data; /**< Compressed chunk data */
+        size_t uncompressed_size = 0; /**< Uncompressed size of the chunk */
+        uint64_t next_pc = 0; /**< PC of the first instruction in the chunk that follows this one */
+        std::optional<ChunkSummary> summary; /**< Summary of the chunk, if the trace has summaries */
+        std::optional<ChunkStateSnapshot> next_state; /**< State at the start of the chunk that follows this one, if the trace has snapshots */
+    };
+} // end namespace stf
+
+#endif
@@ -3,9 +3,12 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <limits>
 #include <vector>
 #include <fcntl.h>
 
+#include "stf_chunk_state.hpp"
+#include "stf_chunk_summary.hpp"
 #include "stf_pc_tracker.hpp"
 
 namespace stf {
@@ -18,6 +21,70 @@ namespace stf {
         public:
             static constexpr size_t DEFAULT_CHUNK_SIZE = 100000; /**< Default chunk size, in number of marker records */
 
+            /**
+             * Size of the payload in a chunk journal entry. Each entry is a frame header (magic + payload size) followed
+             * by the compressed size, start PC, and uncompressed size of the chunk that precedes it.
+             */
+            static constexpr uint32_t JOURNAL_ENTRY_PAYLOAD_SIZE = 3 * sizeof(uint64_t);
+
+            /**
+             * Total size of a chunk journal entry
+             */
+            static constexpr size_t JOURNAL_ENTRY_SIZE = 2 * sizeof(uint32_t) + JOURNAL_ENTRY_PAYLOAD_SIZE;
+
+            /**
+             * Marks the optional block of chunk summaries that follows the chunk index
+             */
+            static constexpr uint32_t CHUNK_SUMMARY_MAGIC = 0x59524D53; // "SMRY"
+
+            /**
+             * Version of the chunk summary block format
+             */
+            static constexpr uint32_t CHUNK_SUMMARY_VERSION = 1;
+
+            /**
+             * Marks the optional block of chunk state snapshots that follows the chunk index
+             */
+            static constexpr uint32_t CHUNK_SNAPSHOT_MAGIC = 0x50414E53; // "SNAP"
+
+            /**
+             * Version of the chunk state snapshot block format
+             */
+            static constexpr uint32_t CHUNK_SNAPSHOT_VERSION = 1;
+
+            /**
+             * Value of the end-of-last-chunk header field in a streaming trace. Streaming traces are written without
+             * seeking, so the header can't point at the chunk index.
+             */
+            static constexpr off_t STREAMING_HEADER_MARKER = std::numeric_limits<off_t>::max();
+
+            /**
+             * Size of the payload in a streaming chunk frame. In a streaming trace each chunk is preceded by a frame
+             * header (magic + payload size) followed by the compressed size, start PC, and uncompressed size of the
+             * chunk.
+             */
+            static constexpr uint32_t STREAM_FRAME_PAYLOAD_SIZE = 3 * sizeof(uint64_t);
+
+            /**
+             * Total size of a streaming chunk frame header
+             */
+            static constexpr size_t STREAM_FRAME_SIZE = 2 * sizeof(uint32_t) + STREAM_FRAME_PAYLOAD_SIZE;
+
+            /**
+             * Size of the empty frame that follows the last chunk in a streaming trace
+             */
+            static constexpr size_t STREAM_END_FRAME_SIZE = 2 * sizeof(uint32_t);
+
+            /**
+             * Marks the trailer that locates the chunk index when a streaming trace is written to a regular file
+             */
+            static constexpr uint32_t STREAM_TRAILER_MAGIC = 0x58444E49; // "INDX"
+
+            /**
+             * Size of the streaming trace trailer (end-of-last-chunk offset + magic)
+             */
+            static constexpr size_t STREAM_TRAILER_SIZE = sizeof(off_t) + sizeof(uint32_t);
+
         protected:
             /**
              * \class ChunkOffset
@@ -96,6 +163,8 @@ namespace stf {
             size_t marker_record_chunk_size_ = DEFAULT_CHUNK_SIZE; /**< Number of marker records per compressed chunk */
             size_t next_chunk_end_ = 0; /**< The number of marker records that will have been seen when this chunk ends */
             std::vector<ChunkOffset> chunk_indices_; /**< Holds file offsets for each compressed chunk */
+            std::vector<ChunkSummary> chunk_summaries_; /**< Holds summaries of each compressed chunk, if available */
+            std::vector<ChunkStateSnapshot> chunk_snapshots_; /**< Holds the state at the start of each compressed chunk, if available */
 
             STFCompressedChunkedBase() = default;
 
@@ -2,19 +2,32 @@
 #define __STF_COMPRESSED_IFSTREAM_HPP__
 
 #include <algorithm>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
+#include <deque>
+#include <exception>
 #include <future>
+#include <memory>
+#include <mutex>
 #include <string_view>
+#include <thread>
+#include <vector>
 
 #include "stf_compression_buffer.hpp"
 #include "stf_compressed_ifstream_base.hpp"
+#include "stf_thread_pool.hpp"
 
 namespace stf {
     /**
      * \class STFCompressedIFstream
      *
-     * Provides transparent on-the-fly decompression of a compressed STF file
+     * Provides transparent on-the-fly decompression of a compressed STF file.
+     * Up to read_ahead_depth chunks past the current one are decompressed concurrently in the background.
+     *
+     * Streaming traces read from a pipe have to be read in order. A dedicated reader thread reads their chunks from
+     * the pipe one at a time and hands each one to the thread pool to be decompressed, so that pool threads never
+     * block waiting for the writer.
      */
     template<typename Decompressor>
     class STFCompressedIFstream final : public STFCompressedIFstreamBase<Decompressor, STFCompressedIFstream<Decompressor>> {
@@ -24,15 +37,17 @@ namespace stf {
             friend base_class;
 
             // From STFCompressedIFstreamBase
-            using base_class::decompressor_;
             using base_class::in_buf_;
             using base_class::out_buf_;
-            using base_class::decompress_result_;
-            using base_class::next_chunk_index_it_;
-            using base_class::last_read_pos_;
+            using base_class::next_chunk_idx_;
             using base_class::block_size_;
             using base_class::readChunk_;
+            using base_class::setCurrentChunk_;
             using base_class::endChunk_;
+            using base_class::streaming_;
+            using base_class::end_of_stream_;
+            using base_class::readStreamFrame_;
+            using base_class::decompressStreamChunk_;
 
             // From STFCompressedChunkedBase
             using base_class::marker_record_chunk_size_;
@@ -44,36 +59,150 @@ namespace stf {
             using base_class::pc_tracker_;
             using base_class::num_marker_records_;
 
-            bool decompression_in_progress_ = false; /**< Flag indicating whether a chunk is currently being decompressed */
-            STFCompressionBuffer decompressed_buf_; /**< Decompressed data pointer */
+            /**
+             * \struct DecompressionSlot
+             * Holds the state needed to decompress a single chunk in the background
+             */
+            struct DecompressionSlot {
+                Decompressor decompressor; /**< Decompressor used for this slot */
+                STFCompressionBuffer in_buf; /**< Holds compressed data read from the file */
+                STFCompressionBuffer out_buf; /**< Holds the decompressed chunk */
+                std::future<void> result; /**< Future used to indicate when the chunk has been decompressed */
+                std::promise<void> stream_done; /**< Fulfills result for a chunk read by the stream reader thread */
+                size_t chunk_idx = 0; /**< Index of the chunk being decompressed */
+                typename base_class::ChunkOffset chunk; /**< Location of the chunk, filled in when reading a streaming input */
+                bool valid = false; /**< False if a streaming input ended before this chunk */
+            };
+
+            size_t read_ahead_depth_ = DEFAULT_READ_AHEAD_DEPTH; /**< Maximum number of chunks that can be decompressed in the background */
+            std::vector<std::unique_ptr<DecompressionSlot>> slots_; /**< Ring of decompression slots */
+            size_t head_slot_ = 0; /**< Slot holding the oldest in-flight chunk */
+            size_t num_in_flight_ = 0; /**< Number of chunks currently being decompressed */
+            std::thread stream_reader_thread_; /**< Reads chunks from a streaming input */
+            std::mutex stream_mutex_; /**< Guards stream_read_queue_ and stop_stream_reader_ */
+            std::condition_variable stream_cv_; /**< Signaled whenever a slot is queued or the stream reader thread should stop */
+            std::deque<DecompressionSlot*> stream_read_queue_; /**< Slots waiting for the stream reader thread, in chunk order */
+            bool stop_stream_reader_ = false; /**< Set when the stream reader thread should exit */
+            bool stream_input_done_ = false; /**< Set once the stream reader thread reaches the end of a streaming input. Only used by that thread. */
+
+            /**
+             * Reads the next chunk from a streaming input, then submits it to the thread pool to be decompressed.
+             * Fulfills the slot's result once the chunk has been decompressed, or right away if the input has ended.
+             * \param slot Slot to read into
+             */
+            void readStreamChunk_(DecompressionSlot& slot) {
+                try {
+                    slot.valid = !stream_input_done_ && readStreamFrame_(slot.in_buf, slot.chunk);
+                }
+                catch(...) {
+                    // Later chunks can't be read without this one, so an error also ends the input
+                    slot.valid = false;
+                    stream_input_done_ = true;
+                    slot.stream_done.set_exception(std::current_exception());
+                    return;
+                }
+
+                stream_input_done_ = !slot.valid;
+
+                if(!slot.valid) {
+                    slot.stream_done.set_value();
+                    return;
+                }
+
+                STFThreadPool::get().submit([&slot]() {
+                                                try {
+                                                    decompressStreamChunk_(slot.chunk, slot.decompressor, slot.in_buf, slot.out_buf);
+                                                    slot.stream_done.set_value();
+                                                }
+                                                catch(...) {
+                                                    slot.stream_done.set_exception(std::current_exception());
+                                                }
+                                            });
+            }
 
             /**
-             * Returns true if all data has been consumed from the file and decompression buffers
+             * Stream reader thread. Reads chunks for queued slots in order until it is told to stop.
              */
-            inline bool allInputConsumedImpl_() const {
-                return base_class::allInputConsumedImpl_() && decompressed_buf_.consumed();
+            void streamReaderThread_() {
+                while(true) {
+                    DecompressionSlot* slot;
+                    {
+                        std::unique_lock<std::mutex> lock(stream_mutex_);
+                        stream_cv_.wait(lock, [this]() { return stop_stream_reader_ || !stream_read_queue_.empty(); });
+
+                        // Queued slots are always finished so that nobody waits on them forever
+                        if(stream_read_queue_.empty()) {
+                            return;
+                        }
+
+                        slot = stream_read_queue_.front();
+                        stream_read_queue_.pop_front();
+                    }
+
+                    readStreamChunk_(*slot);
+                }
+            }
+
+            /**
+             * Stops the stream reader thread, if it is running
+             */
+            inline void stopStreamReader_() {
+                if(!stream_reader_thread_.joinable()) {
+                    return;
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(stream_mutex_);
+                    stop_stream_reader_ = true;
+                }
+                stream_cv_.notify_one();
+                stream_reader_thread_.join();
             }
 
             /**
-             * Asynchronously read and decompress the next chunk in the file
+             * Asynchronously read and decompress chunks until the read-ahead window is full
              */
-            void readNextChunk_() {
-                // Make sure there are still chunks left to read
-                if(STF_EXPECT_FALSE(next_chunk_index_it_ == chunk_indices_.end())) {
-                    decompressed_buf_.consume();
+            void readNextChunks_() {
+                if(STF_EXPECT_FALSE(streaming_)) {
+                    {
+                        std::lock_guard<std::mutex> lock(stream_mutex_);
+                        while(num_in_flight_ < slots_.size() && !end_of_stream_) {
+                            auto& slot = *slots_[(head_slot_ + num_in_flight_) % slots_.size()];
+                            slot.chunk_idx = next_chunk_idx_++;
+                            slot.stream_done = std::promise<void>();
+                            slot.result = slot.stream_done.get_future();
+                            stream_read_queue_.emplace_back(&slot);
+                            ++num_in_flight_;
+                        }
+                    }
+                    stream_cv_.notify_one();
                     return;
                 }
-                const size_t uncompressed_chunk_size = next_chunk_index_it_->getUncompressedChunkSize();
-                const auto chunk_it = ++next_chunk_index_it_;
-
-                // Decompress the chunk in a separate thread
-                decompression_in_progress_ = true;
-                decompress_result_ = std::move(std::async(std::launch::async,
-                                                          [this, chunk_it, uncompressed_chunk_size]() {
-                                                            this->readChunk_(chunk_it,
-                                                                             uncompressed_chunk_size,
-                                                                             this->decompressed_buf_);
-                                                          }));
+
+                while(num_in_flight_ < slots_.size() && next_chunk_idx_ < chunk_indices_.size()) {
+                    auto& slot = *slots_[(head_slot_ + num_in_flight_) % slots_.size()];
+                    slot.chunk_idx = next_chunk_idx_++;
+
+                    // Decompress the chunk on a helper thread
+                    slot.result = STFThreadPool::get().submit([this, &slot]() {
+                                                                this->readChunk_(slot.chunk_idx,
+                                                                                 slot.decompressor,
+                                                                                 slot.in_buf,
+                                                                                 slot.out_buf);
+                                                              });
+                    ++num_in_flight_;
+                }
+            }
+
+            /**
+             * Waits for all in-flight chunks to finish decompressing and discards them
+             */
+            inline void waitForAllChunks_() {
+                for(size_t i = 0; i < num_in_flight_; ++i) {
+                    slots_[(head_slot_ + i) % slots_.size()]->result.get();
+                }
+                head_slot_ = 0;
+                num_in_flight_ = 0;
             }
 
             /**
@@ -84,45 +213,67 @@ namespace stf {
                     return 0;
                 }
 
-                if(decompression_in_progress_) {
-                    decompress_result_.get();
-                }
+                // The stream reader thread finishes every queued slot before it exits
+                stopStreamReader_();
+                waitForAllChunks_();
 
-                return STFIFstream::close_();
+                return base_class::close_();
             }
 
+            /**
+             * Moves the oldest in-flight chunk into the output buffer
+             */
             inline void finishDecompression_() {
-                if(STF_EXPECT_TRUE(decompression_in_progress_)) {
+                if(STF_EXPECT_TRUE(num_in_flight_)) {
+                    auto& slot = *slots_[head_slot_];
+
                     // Wait for decompressor to finish
-                    decompress_result_.get();
-                    decompression_in_progress_ = false;
-                    std::swap(out_buf_, decompressed_buf_);
+                    slot.result.get();
+                    head_slot_ = (head_slot_ + 1) % slots_.size();
+                    --num_in_flight_;
+
+                    if(STF_EXPECT_FALSE(streaming_)) {
+                        // Nothing left to read, so the current chunk was the last one
+                        if(!slot.valid) {
+                            end_of_stream_ = true;
+                            return;
+                        }
+                        chunk_indices_.emplace_back(slot.chunk);
+                    }
+
+                    std::swap(out_buf_, slot.out_buf);
+                    setCurrentChunk_(slot.chunk_idx);
                 }
             }
 
             inline void cancelCurrentChunks_() override final {
                 out_buf_.consume();
-                finishDecompression_();
+                waitForAllChunks_();
                 in_buf_.reset();
                 endChunk_();
             }
 
             inline void seekToChunk_(const size_t chunk_idx) override final {
                 base_class::seekToChunk_(chunk_idx);
-                readNextChunk_();
+                readNextChunks_();
             }
 
         public:
+            static constexpr size_t DEFAULT_READ_AHEAD_DEPTH = 1; /**< Default number of chunks to decompress ahead of the reader */
+
             STFCompressedIFstream() = default;
 
             /**
              * Constructs an STFCompressedIFstream
              *
              * \param filename Filename to open
+             * \param read_ahead_depth Maximum number of chunks to decompress in the background
              */
-            explicit STFCompressedIFstream(const std::string_view filename) : // cppcheck-suppress passedByValue
+            explicit STFCompressedIFstream(const std::string_view filename, // cppcheck-suppress passedByValue
+                                           const size_t read_ahead_depth = DEFAULT_READ_AHEAD_DEPTH) :
                 STFCompressedIFstream()
             {
+                setReadAheadDepth(read_ahead_depth);
                 STFCompressedIFstream::open(filename);
             }
 
@@ -138,9 +289,34 @@ namespace stf {
              */
             void open(const std::string_view filename) override final { // cppcheck-suppress passedByValue
                 base_class::open(filename);
-                decompressed_buf_.initSize(block_size_);
-                // Read the next chunk
-                readNextChunk_();
+
+                slots_.clear();
+                for(size_t i = 0; i < read_ahead_depth_; ++i) {
+                    auto& slot = slots_.emplace_back(std::make_unique<DecompressionSlot>());
+                    slot->in_buf.initSize(block_size_);
+                    slot->out_buf.initSize(block_size_);
+                }
+
+                if(streaming_) {
+                    stream_read_queue_.clear();
+                    stop_stream_reader_ = false;
+                    stream_input_done_ = false;
+                    stream_reader_thread_ = std::thread(&STFCompressedIFstream::streamReaderThread_, this);
+                }
+
+                // Start reading the next chunks
+                readNextChunks_();
+            }
+
+            /**
+             * Sets the maximum number of chunks that will be decompressed ahead of the reader
+             * \note Once the stream is open this cannot be changed
+             * \param read_ahead_depth Number of chunks
+             */
+            void setReadAheadDepth(const size_t read_ahead_depth) {
+                stf_assert(!stream_, "Must set read-ahead depth before opening file.");
+                stf_assert(read_ahead_depth > 0, "Read-ahead depth must be at least 1");
+                read_ahead_depth_ = read_ahead_depth;
             }
 
             /**
@@ -156,8 +332,8 @@ namespace stf {
                     // There should be a decompressed chunk ready to go
                     finishDecompression_();
 
-                    // Start decompressing the next chunk
-                    readNextChunk_();
+                    // Refill the read-ahead window
+                    readNextChunks_();
                 }
             }
     };
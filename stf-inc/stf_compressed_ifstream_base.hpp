@@ -1,18 +1,32 @@
 #ifndef __STF_COMPRESSED_IFSTREAM_BASE_HPP__
 #define __STF_COMPRESSED_IFSTREAM_BASE_HPP__
 
-#include <future>
+#include <algorithm>
+#include <cerrno>
+#include <iostream>
 #include <iterator>
+#include <memory>
+#include <vector>
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "stf_chunk_cache.hpp"
 #include "stf_compression_buffer.hpp"
 #include "stf_compressed_chunked_base.hpp"
 #include "stf_ifstream.hpp"
+#include "stf_shared_chunk_cache.hpp"
 
 namespace stf {
     /**
      * \class STFCompressedIFstreamBase
      *
      * Base class for common variables/methods used by STFCompressedIFstream* classes
+     *
+     * Streaming traces (see STFCompressedOFstream) that are read from a pipe are decompressed strictly in order as
+     * their chunks arrive, and the chunk index is built up as each chunk is read. Such traces can only be read
+     * forward. Streaming traces stored in regular files are read through their chunk index like any other trace.
      */
     template<typename Decompressor, typename STFCompressedIFstreamImpl>
     class STFCompressedIFstreamBase : public STFIFstream, public STFCompressedChunkedBase {
@@ -20,18 +34,114 @@ namespace stf {
             Decompressor decompressor_; /**< Decompressor object */
             STFCompressionBuffer in_buf_; /**< Input data buffer - holds compressed data read from the file */
             STFCompressionBuffer out_buf_; /**< Output data pointer */
-            std::future<void> decompress_result_; /**< Future used to indicate when the next chunk has been decompressed */
-            std::vector<ChunkOffset>::const_iterator next_chunk_index_it_ = chunk_indices_.end(); /**< Iterator to next chunk offset */
-            off_t last_read_pos_ = 0; /**< File offset of last read */
+            size_t cur_chunk_idx_ = 0; /**< Index of the chunk currently held in out_buf_ */
+            size_t next_chunk_idx_ = 0; /**< Index of the next chunk that should be read from the file */
+            int fd_ = -1; /**< File descriptor of the underlying file - used for lock-free positional reads */
+            bool use_mmap_ = false; /**< If true, the compressed chunks are memory-mapped instead of read into in_buf */
+            const uint8_t* mapped_file_ = nullptr; /**< Start of the memory-mapped file, or nullptr if the file isn't mapped */
+            size_t mapped_size_ = 0; /**< Size of the memory-mapped region */
+            off_t last_read_pos_ = 0; /**< File offset of the current chunk */
             off_t end_of_last_chunk_; /**< File offset of the end of the last compressed chunk - needed so we can know when to stop reading */
             bool successful_read_ = false; /**< Indicates whether the last read succeeded - needed so we can know if we still have valid data in our buffers */
             size_t block_size_ = 0; /**< Block size of the filesystem containing the trace */
+            bool streaming_ = false; /**< True if the trace is a streaming trace read from a non-seekable input */
+            bool end_of_stream_ = false; /**< Set once the reader has consumed the last chunk of a streaming input */
+            off_t stream_pos_ = 0; /**< Number of bytes read from a streaming input so far */
+            size_t chunk_cache_size_ = 0; /**< Size of the chunk cache to use, or 0 to disable it */
+            std::shared_ptr<STFChunkCache> chunk_cache_; /**< Recently decompressed chunks of this trace, shared with every other stream in this process that is reading it */
+            size_t shared_chunk_cache_size_ = 0; /**< Size of the shared memory chunk cache to create, or 0 to disable it */
+            std::unique_ptr<STFSharedChunkCache> shared_chunk_cache_; /**< Chunks decompressed by any process reading this trace */
+
+            /**
+             * Size of the file header (magic + chunk size + end of last chunk)
+             */
+            static constexpr off_t HEADER_SIZE_ = static_cast<off_t>(Decompressor::getMagic().size() + sizeof(size_t) + sizeof(off_t));
+
+            static constexpr size_t SEEK_CHECKPOINT_GRANULARITY = 1024; /**< Number of marker records between seek checkpoints */
+
+            /**
+             * \struct SeekCheckpoint
+             * Position within a decompressed chunk that a seek can resume from
+             */
+            struct SeekCheckpoint {
+                size_t marker_index; /**< Number of marker records that come before the checkpoint */
+                size_t buf_pos; /**< Read position within the decompressed chunk */
+                uint64_t pc; /**< PC of the next instruction */
+            };
+
+            std::vector<SeekCheckpoint> seek_checkpoints_; /**< Checkpoints within chunks that have been seeked through, sorted by marker index */
+
+            /**
+             * Adds a seek checkpoint at the current position
+             */
+            inline void addSeekCheckpoint_() {
+                const auto it = std::lower_bound(seek_checkpoints_.begin(),
+                                                 seek_checkpoints_.end(),
+                                                 num_marker_records_,
+                                                 [](const SeekCheckpoint& checkpoint, const size_t marker_index) {
+                                                     return checkpoint.marker_index < marker_index;
+                                                 });
+                if(it == seek_checkpoints_.end() || it->marker_index != num_marker_records_) {
+                    seek_checkpoints_.insert(it, SeekCheckpoint{num_marker_records_, out_buf_.getReadPos(), pc_tracker_.getNextPC()});
+                }
+            }
+
+            /**
+             * Returns whether the given position is inside the chunk held in out_buf_. The start of a chunk doesn't
+             * count, since seeking to it never needs a checkpoint.
+             * \param marker_index Number of marker records that come before the position
+             */
+            inline bool inCurrentChunk_(const size_t marker_index) const {
+                return marker_index % marker_record_chunk_size_ != 0 &&
+                       marker_index / marker_record_chunk_size_ == cur_chunk_idx_;
+            }
+
+            /**
+             * Seeks forward within the current chunk. Skips ahead to the closest checkpoint left behind by an earlier
+             * seek, and leaves new checkpoints behind for any records that have to be parsed.
+             * \param num_markers Number of marker records to seek by
+             */
+            void seekWithinChunk_(const size_t num_markers) {
+                const size_t target = num_marker_records_ + num_markers;
+
+                auto it = std::upper_bound(seek_checkpoints_.begin(),
+                                           seek_checkpoints_.end(),
+                                           target,
+                                           [](const size_t marker_index, const SeekCheckpoint& checkpoint) {
+                                               return marker_index < checkpoint.marker_index;
+                                           });
+                if(it != seek_checkpoints_.begin() &&
+                   (--it)->marker_index > num_marker_records_ &&
+                   inCurrentChunk_(it->marker_index)) {
+                    out_buf_.setReadPtr(it->buf_pos);
+                    num_marker_records_ = it->marker_index;
+                    pc_tracker_.forcePC(it->pc);
+                }
+
+                while(num_marker_records_ < target) {
+                    const size_t start = num_marker_records_;
+                    const size_t num_to_seek = std::min(target - start,
+                                                        SEEK_CHECKPOINT_GRANULARITY - (start % SEEK_CHECKPOINT_GRANULARITY));
+                    STFIFstream::seek(num_to_seek);
+
+                    if(STF_EXPECT_FALSE(num_marker_records_ != start + num_to_seek)) {
+                        break;
+                    }
+
+                    if(num_marker_records_ % SEEK_CHECKPOINT_GRANULARITY == 0 && inCurrentChunk_(num_marker_records_)) {
+                        addSeekCheckpoint_();
+                    }
+                }
+            }
 
             /**
              * Returns true if we have read all of the compressed chunks from the file
              */
             inline bool reachedEndOfChunks_() const {
-                return last_read_pos_ + static_cast<off_t>(in_buf_.getReadPos()) >= end_of_last_chunk_;
+                // The chunk index of a streaming input only covers the chunks that have arrived so far. Every chunk
+                // but the last one is replaced as soon as its final marker record is read, so running out of data
+                // in the current chunk means it was the last one.
+                return STF_EXPECT_FALSE(streaming_) || cur_chunk_idx_ + 1 >= chunk_indices_.size();
             }
 
             /**
@@ -64,19 +174,14 @@ namespace stf {
              */
             template <typename T>
             inline size_t direct_read_(T* data, size_t size, const bool ignore_end_of_chunks = false) {
-                last_read_pos_ = ftell(stream_);
-                const off_t next_read_end = last_read_pos_ + static_cast<off_t>(size);
-
-                const off_t next_chunk_end =
-                    STF_EXPECT_TRUE(!ignore_end_of_chunks && next_chunk_index_it_ != chunk_indices_.end()) ? next_chunk_index_it_->getOffset() : 0;
-
                 // Don't read past the end of the last chunk
-                if(STF_EXPECT_FALSE(!ignore_end_of_chunks && (next_read_end > end_of_last_chunk_))) {
-                    size = static_cast<size_t>(end_of_last_chunk_ - last_read_pos_) / sizeof(T);
-                }
-                // Don't read past the end of the current chunk
-                else if(STF_EXPECT_FALSE(next_chunk_end && (next_read_end > next_chunk_end))) {
-                    size = static_cast<size_t>(next_chunk_end - last_read_pos_) / sizeof(T);
+                if(STF_EXPECT_FALSE(!ignore_end_of_chunks)) {
+                    const off_t read_pos = ftell(stream_);
+                    const off_t next_read_end = read_pos + static_cast<off_t>(size * sizeof(T));
+
+                    if(next_read_end > end_of_last_chunk_) {
+                        size = static_cast<size_t>(end_of_last_chunk_ - read_pos) / sizeof(T);
+                    }
                 }
                 STFIFstream::fread_(data, sizeof(T), size);
                 return size;
@@ -123,6 +228,26 @@ namespace stf {
                 return 1;
             }
 
+            /**
+             * Reads a ChunkSummary directly from the underlying file without decompressing the data
+             * \param data Buffer to read data into
+             * \param ignore_end_of_chunks if true, will allow reading past the end of the compressed chunks
+             */
+            inline size_t direct_read_(ChunkSummary& data, const bool ignore_end_of_chunks = false) {
+                data.read([this, ignore_end_of_chunks](auto& val) { direct_read_(val, ignore_end_of_chunks); });
+                return 1;
+            }
+
+            /**
+             * Reads a ChunkStateSnapshot directly from the underlying file without decompressing the data
+             * \param data Buffer to read data into
+             * \param ignore_end_of_chunks if true, will allow reading past the end of the compressed chunks
+             */
+            inline size_t direct_read_(ChunkStateSnapshot& data, const bool ignore_end_of_chunks = false) {
+                data.read([this, ignore_end_of_chunks](auto& val) { direct_read_(val, ignore_end_of_chunks); });
+                return 1;
+            }
+
             /**
              * Reads an array directly from the underlying file without decompressing the data
              * \param data Buffer to read data into
@@ -177,40 +302,211 @@ namespace stf {
             }
 
             /**
-             * Reads and decompresses an entire chunk from the file
-             * \param chunk_it Iterator pointing to metadata of the next chunk
-             * \param uncompressed_chunk_size Size of the decompressed chunk
+             * Gets the file offset where the given chunk ends
+             * \param chunk_idx Chunk index
+             */
+            inline off_t getChunkEnd_(const size_t chunk_idx) const {
+                const size_t next_chunk_idx = chunk_idx + 1;
+                return STF_EXPECT_FALSE(next_chunk_idx >= chunk_indices_.size()) ? end_of_last_chunk_ : chunk_indices_[next_chunk_idx].getOffset();
+            }
+
+            /**
+             * Reads bytes from the given file offset without touching the shared file position
+             * \param data Buffer to read data into
+             * \param num_bytes Number of bytes to read
+             * \param offset File offset to read from
+             * \returns Number of bytes actually read
+             */
+            inline size_t pread_(uint8_t* data, const size_t num_bytes, const off_t offset) const {
+                size_t num_bytes_read = 0;
+
+                while(num_bytes_read < num_bytes) {
+                    const ssize_t result = pread(fd_,
+                                                 data + num_bytes_read,
+                                                 num_bytes - num_bytes_read,
+                                                 offset + static_cast<off_t>(num_bytes_read));
+
+                    if(STF_EXPECT_FALSE(result <= 0)) {
+                        if(result < 0 && errno == EINTR) {
+                            continue;
+                        }
+                        break;
+                    }
+
+                    num_bytes_read += static_cast<size_t>(result);
+                }
+
+                return num_bytes_read;
+            }
+
+            /**
+             * Decompresses an entire chunk
+             * \param decompressor Decompressor to use
+             * \param in_buf Buffer holding the compressed chunk
              * \param out_buf Buffer to store decompressed chunk in
              */
-            void readChunk_(const std::vector<ChunkOffset>::const_iterator& chunk_it,
-                            const size_t uncompressed_chunk_size,
-                            STFCompressionBuffer& out_buf) {
+            template<typename InputBufferType>
+            static inline void decompressChunk_(Decompressor& decompressor,
+                                                InputBufferType& in_buf,
+                                                STFCompressionBuffer& out_buf) {
+                const bool keep_reading = decompressor.decompress(out_buf, in_buf);
+
+                // Since we allocated enough room for the entire uncompressed chunk, this should complete in a single shot
+                stf_assert(!keep_reading, "Failed to decompress entire chunk");
+
+                // Reset the decompressor
+                decompressor.reset();
+            }
+
+            /**
+             * Reads and decompresses an entire chunk from the file into a buffer that has already been sized for it
+             * \param chunk_idx Index of the chunk to read
+             * \param decompressor Decompressor to use
+             * \param in_buf Buffer to store compressed chunk in. Unused if the file is memory-mapped.
+             * \param out_buf Buffer to store decompressed chunk in
+             */
+            void decompressChunkFromFile_(const size_t chunk_idx,
+                                          Decompressor& decompressor,
+                                          STFCompressionBuffer& in_buf,
+                                          STFCompressionBuffer& out_buf) {
                 // Calculate the number of bytes to read from the file
-                const auto num_bytes =
-                    static_cast<size_t>((STF_EXPECT_FALSE(chunk_it == chunk_indices_.end()) ? end_of_last_chunk_ : chunk_it->getOffset()) - ftell(stream_));
+                const off_t chunk_start = chunk_indices_[chunk_idx].getOffset();
+                const auto num_bytes = static_cast<size_t>(getChunkEnd_(chunk_idx) - chunk_start);
+
+                // Decompress straight out of the mapping if we have one
+                if(mapped_file_) {
+                    STFCompressionPointerWrapper<const uint8_t*> mapped_chunk(mapped_file_ + chunk_start);
+                    mapped_chunk.resize(num_bytes);
+                    decompressChunk_(decompressor, mapped_chunk, out_buf);
+                    return;
+                }
 
-                // Reset and resize buffers
-                in_buf_.reset();
-                in_buf_.fit(num_bytes);
-                out_buf.reset();
-                out_buf.fit(uncompressed_chunk_size);
+                in_buf.reset();
+                in_buf.fit(num_bytes);
 
                 // Read entire compressed chunk
-                const size_t num_bytes_read = direct_read_(in_buf_.get(), num_bytes);
-                in_buf_.advanceWritePtr(num_bytes);
+                const size_t num_bytes_read = pread_(in_buf.get(), num_bytes, chunk_start);
+                in_buf.advanceWritePtr(num_bytes);
 
                 // Read should complete successfully
                 stf_assert(num_bytes_read == num_bytes,
                            "Failed to read entire chunk from file: requested " << num_bytes << " but read " << num_bytes_read);
 
-                // Decompress chunk
-                const bool keep_reading = decompressor_.decompress(out_buf, in_buf_);
+                decompressChunk_(decompressor, in_buf, out_buf);
+            }
 
-                // Since we allocated enough room for the entire uncompressed chunk, this should complete in a single shot
-                stf_assert(!keep_reading, "Failed to decompress entire chunk");
+            /**
+             * Reads and decompresses an entire chunk from the file.
+             *
+             * Safe to call from multiple threads at once as long as each caller uses its own decompressor and buffers.
+             * Chunks found in the chunk cache or the shared chunk cache are reused instead of being decompressed again.
+             * \param chunk_idx Index of the chunk to read
+             * \param decompressor Decompressor to use
+             * \param in_buf Buffer to store compressed chunk in. Unused if the file is memory-mapped.
+             * \param out_buf Buffer to store decompressed chunk in
+             */
+            void readChunk_(const size_t chunk_idx,
+                            Decompressor& decompressor,
+                            STFCompressionBuffer& in_buf,
+                            STFCompressionBuffer& out_buf) {
+                if(chunk_cache_ && chunk_cache_->find(chunk_idx, out_buf)) {
+                    return;
+                }
 
-                // Reset the decompressor
-                endChunk_();
+                out_buf.reset();
+                out_buf.fit(chunk_indices_[chunk_idx].getUncompressedChunkSize());
+
+                // Records may still be viewing the previous chunk, so make sure we don't overwrite it
+                out_buf.unshare();
+
+                size_t shared_slot = STFSharedChunkCache::NO_SLOT;
+                if(shared_chunk_cache_ && shared_chunk_cache_->find(chunk_idx, out_buf, shared_slot)) {
+                    insertIntoChunkCache_(chunk_idx, out_buf);
+                    return;
+                }
+
+                try {
+                    decompressChunkFromFile_(chunk_idx, decompressor, in_buf, out_buf);
+                }
+                catch(...) {
+                    // Let other processes decompress the chunk themselves
+                    if(shared_slot != STFSharedChunkCache::NO_SLOT) {
+                        shared_chunk_cache_->abandon(shared_slot, chunk_idx);
+                    }
+                    throw;
+                }
+
+                if(shared_slot != STFSharedChunkCache::NO_SLOT) {
+                    shared_chunk_cache_->publish(shared_slot, chunk_idx, out_buf);
+                }
+                insertIntoChunkCache_(chunk_idx, out_buf);
+            }
+
+            /**
+             * Adds a freshly decompressed chunk to the chunk cache, if it is enabled
+             * \param chunk_idx Chunk index
+             * \param out_buf Buffer holding the decompressed chunk
+             */
+            inline void insertIntoChunkCache_(const size_t chunk_idx, const STFCompressionBuffer& out_buf) {
+                if(chunk_cache_) {
+                    chunk_cache_->insert(chunk_idx, out_buf);
+                }
+            }
+
+            /**
+             * Memory-maps the compressed chunks. Falls back to positional reads if the mapping fails.
+             */
+            inline void mapFile_() {
+                const auto map_size = static_cast<size_t>(end_of_last_chunk_);
+                void* const mapping = mmap(nullptr, map_size, PROT_READ, MAP_SHARED, fd_, 0);
+
+                if(STF_EXPECT_FALSE(mapping == MAP_FAILED)) {
+                    errno = 0;
+                    return;
+                }
+
+                mapped_file_ = static_cast<const uint8_t*>(mapping);
+                mapped_size_ = map_size;
+            }
+
+            /**
+             * Unmaps the file if it was memory-mapped
+             */
+            inline void unmapFile_() {
+                if(mapped_file_) {
+                    munmap(const_cast<uint8_t*>(mapped_file_), mapped_size_);
+                    mapped_file_ = nullptr;
+                    mapped_size_ = 0;
+                }
+            }
+
+            /**
+             * Closes the file
+             */
+            int close_() override {
+                chunk_cache_.reset();
+                shared_chunk_cache_.reset();
+                unmapFile_();
+                fd_ = -1;
+                return STFIFstream::close_();
+            }
+
+            /**
+             * Marks the given chunk as the one currently held in out_buf_
+             * \param chunk_idx Chunk index
+             */
+            inline void setCurrentChunk_(const size_t chunk_idx) {
+                cur_chunk_idx_ = chunk_idx;
+                last_read_pos_ = chunk_indices_[chunk_idx].getOffset();
+            }
+
+            /**
+             * Synchronously reads and decompresses a chunk into out_buf_
+             * \param chunk_idx Chunk index
+             */
+            inline void readCurrentChunk_(const size_t chunk_idx) {
+                readChunk_(chunk_idx, decompressor_, in_buf_, out_buf_);
+                setCurrentChunk_(chunk_idx);
             }
 
             /**
@@ -363,6 +659,35 @@ namespace stf {
                 return fread_multiple_<uint8_t>(data, size * num);
             }
 
+            /**
+             * Gets a view of data in the decompression buffer that keeps the current chunk alive
+             * \param num_bytes Number of bytes to view
+             */
+            inline std::shared_ptr<const uint8_t> freadView_(const size_t num_bytes) override final {
+                if(STF_EXPECT_FALSE(!checkIfReadIsPossible_())) {
+                    return nullptr;
+                }
+
+                auto view = out_buf_.share(out_buf_.getReadPos());
+                out_buf_.advanceReadPtr(num_bytes);
+                successful_read_ = true;
+
+                return view;
+            }
+
+            /**
+             * Skips over data in the decompression buffer by advancing the read pointer
+             * \param num_bytes Number of bytes to skip
+             */
+            inline void fskip_(const size_t num_bytes) override final {
+                if(STF_EXPECT_FALSE(!checkIfReadIsPossible_())) {
+                    return;
+                }
+
+                out_buf_.advanceReadPtr(num_bytes);
+                successful_read_ = true;
+            }
+
             /**
              * Ends the current compressed chunk and resets the decompressor for the next chunk
              */
@@ -375,22 +700,13 @@ namespace stf {
              * \param chunk_idx Chunk index to seek
              */
             inline virtual void seekToChunk_(const size_t chunk_idx) {
-                next_chunk_index_it_ = std::next(chunk_indices_.begin(), static_cast<ssize_t>(chunk_idx));
                 num_marker_records_ = chunk_idx * marker_record_chunk_size_;
                 next_chunk_end_ = num_marker_records_ + marker_record_chunk_size_;
 
-                fseek(stream_, next_chunk_index_it_->getOffset(), SEEK_SET);
-                last_read_pos_ = next_chunk_index_it_->getOffset();
+                pc_tracker_.forcePC(chunk_indices_[chunk_idx].getStartPC());
 
-                const auto force_pc = next_chunk_index_it_->getStartPC();
-
-                pc_tracker_.forcePC(force_pc);
-                const auto current_chunk_size = next_chunk_index_it_->getUncompressedChunkSize();
-                if(STF_EXPECT_TRUE(next_chunk_index_it_ != chunk_indices_.end())) {
-                    ++next_chunk_index_it_;
-                }
-
-                readChunk_(next_chunk_index_it_, current_chunk_size, out_buf_);
+                readCurrentChunk_(chunk_idx);
+                next_chunk_idx_ = chunk_idx + 1;
 
                 if(chunk_idx == 0) {
                     out_buf_.setReadPtr(trace_start_);
@@ -402,15 +718,390 @@ namespace stf {
              */
             virtual void cancelCurrentChunks_() = 0;
 
+            /**
+             * Rebuilds the chunk index from the chunk journal entries that follow each chunk.
+             * Stops at the first chunk that is truncated or isn't followed by a matching journal entry.
+             * \param file_size Size of the trace file
+             * \returns True if at least one complete chunk was found
+             */
+            bool recoverChunkIndex_(const off_t file_size) {
+                chunk_indices_.clear();
+
+                auto pos = static_cast<off_t>(Decompressor::getMagic().size() + sizeof(marker_record_chunk_size_) + sizeof(end_of_last_chunk_));
+
+                while(pos < file_size) {
+                    // Find the end of the compressed chunk
+                    size_t compressed_size = 0;
+                    const bool found_chunk = Decompressor::findFrameSize(
+                        [this, pos](const size_t offset, void* data, const size_t num_bytes) {
+                            fseek(stream_, pos + static_cast<off_t>(offset), SEEK_SET);
+                            return STFIFstream::fread_(data, sizeof(uint8_t), num_bytes);
+                        },
+                        compressed_size
+                    );
+
+                    const off_t entry_pos = pos + static_cast<off_t>(compressed_size);
+
+                    // The writer died while this chunk or its journal entry was being written
+                    if(!found_chunk || entry_pos + static_cast<off_t>(JOURNAL_ENTRY_SIZE) > file_size) {
+                        break;
+                    }
+
+                    uint32_t magic;
+                    uint32_t payload_size;
+                    uint64_t entry_compressed_size;
+                    uint64_t start_pc;
+                    uint64_t uncompressed_size;
+
+                    fseek(stream_, entry_pos, SEEK_SET);
+                    direct_read_(magic, true);
+                    direct_read_(payload_size, true);
+                    direct_read_(entry_compressed_size, true);
+                    direct_read_(start_pc, true);
+                    direct_read_(uncompressed_size, true);
+
+                    if(magic != Decompressor::getJournalMagic() ||
+                       payload_size != JOURNAL_ENTRY_PAYLOAD_SIZE ||
+                       entry_compressed_size != compressed_size) {
+                        break;
+                    }
+
+                    chunk_indices_.emplace_back(pos, start_pc, uncompressed_size);
+                    pos = entry_pos + static_cast<off_t>(JOURNAL_ENTRY_SIZE);
+                }
+
+                end_of_last_chunk_ = pos;
+
+                return !chunk_indices_.empty();
+            }
+
+            /**
+             * Reads bytes from the current position in the file. Used for streaming traces, which may not be seekable.
+             * \param data Buffer to read data into
+             * \param num_bytes Number of bytes to read
+             * \returns True if all of the bytes were read
+             */
+            inline bool streamRead_(void* data, const size_t num_bytes) {
+                const size_t num_bytes_read = STFIFstream::fread_(data, sizeof(uint8_t), num_bytes);
+                stream_pos_ += static_cast<off_t>(num_bytes_read);
+                return num_bytes_read == num_bytes;
+            }
+
+            /**
+             * Reads the frame header preceding the next chunk in a streaming trace
+             * \param chunk Set to the offset, start PC, and uncompressed size of the chunk
+             * \param compressed_size Set to the compressed size of the chunk
+             * \returns False if the end-of-stream frame was read instead, or the trace ended early
+             */
+            bool readStreamFrameHeader_(ChunkOffset& chunk, uint64_t& compressed_size) {
+                uint32_t magic;
+                uint32_t payload_size;
+
+                if(STF_EXPECT_FALSE(!streamRead_(&magic, sizeof(magic)) || !streamRead_(&payload_size, sizeof(payload_size)))) {
+                    return false;
+                }
+
+                if(magic == Decompressor::getStreamEndMagic()) {
+                    return false;
+                }
+
+                stf_assert(magic == Decompressor::getStreamFrameMagic() && payload_size == STREAM_FRAME_PAYLOAD_SIZE,
+                           "Invalid chunk frame at offset " << stream_pos_ << ". Trace file may be corrupt.");
+
+                uint64_t start_pc;
+                uint64_t uncompressed_size;
+                if(STF_EXPECT_FALSE(!streamRead_(&compressed_size, sizeof(compressed_size)) ||
+                                    !streamRead_(&start_pc, sizeof(start_pc)) ||
+                                    !streamRead_(&uncompressed_size, sizeof(uncompressed_size)))) {
+                    return false;
+                }
+
+                chunk.set(stream_pos_, start_pc, uncompressed_size);
+
+                return true;
+            }
+
+            /**
+             * Reads the next chunk of a streaming trace into a buffer without decompressing it.
+             * If the trace ends without an end-of-stream frame, the writer probably didn't exit cleanly. Every complete
+             * chunk up to that point is still returned.
+             * \param in_buf Buffer to store the compressed chunk in
+             * \param chunk Set to the offset, start PC, and uncompressed size of the chunk
+             * \returns False if there are no more chunks
+             */
+            bool readStreamFrame_(STFCompressionBuffer& in_buf, ChunkOffset& chunk) {
+                uint64_t compressed_size = 0;
+
+                bool found_chunk = readStreamFrameHeader_(chunk, compressed_size);
+
+                if(found_chunk) {
+                    in_buf.reset();
+                    in_buf.fit(compressed_size);
+                    found_chunk = streamRead_(in_buf.get(), compressed_size);
+                    in_buf.advanceWritePtr(compressed_size);
+                }
+
+                if(STF_EXPECT_FALSE(!found_chunk && (ferror(stream_) || feof(stream_)))) {
+                    stf_assert(!ferror(stream_), "Error reading streaming trace");
+                    std::cerr << "WARNING: Streaming trace ended without an end-of-stream marker. The writer may not have exited cleanly." << std::endl;
+                }
+
+                return found_chunk;
+            }
+
+            /**
+             * Decompresses a chunk read by readStreamFrame_
+             * \param chunk Chunk info returned by readStreamFrame_
+             * \param decompressor Decompressor to use
+             * \param in_buf Buffer holding the compressed chunk
+             * \param out_buf Buffer to store decompressed chunk in
+             */
+            static inline void decompressStreamChunk_(const ChunkOffset& chunk,
+                                                      Decompressor& decompressor,
+                                                      STFCompressionBuffer& in_buf,
+                                                      STFCompressionBuffer& out_buf) {
+                out_buf.reset();
+                out_buf.fit(chunk.getUncompressedChunkSize());
+
+                // Records may still be viewing the previous chunk, so make sure we don't overwrite it
+                out_buf.unshare();
+
+                decompressChunk_(decompressor, in_buf, out_buf);
+            }
+
+            /**
+             * Synchronously reads and decompresses the next chunk of a streaming input into out_buf_, and adds it to
+             * the chunk index
+             * \returns False if there are no more chunks
+             */
+            inline bool readCurrentStreamChunk_() {
+                ChunkOffset chunk;
+
+                if(STF_EXPECT_FALSE(end_of_stream_ || !readStreamFrame_(in_buf_, chunk))) {
+                    end_of_stream_ = true;
+                    return false;
+                }
+
+                decompressStreamChunk_(chunk, decompressor_, in_buf_, out_buf_);
+                chunk_indices_.emplace_back(chunk);
+                setCurrentChunk_(chunk_indices_.size() - 1);
+
+                return true;
+            }
+
+            /**
+             * Reads the chunk index of a streaming trace stored in a regular file, using the trailer at the end of
+             * the file to find it
+             * \param file_size Size of the trace file
+             * \returns False if the file doesn't end with a valid trailer
+             */
+            bool readStreamIndex_(const off_t file_size) {
+                const off_t trailer_pos = file_size - static_cast<off_t>(STREAM_TRAILER_SIZE);
+                if(trailer_pos < HEADER_SIZE_) {
+                    return false;
+                }
+
+                off_t end;
+                uint32_t trailer_magic;
+                fseek(stream_, trailer_pos, SEEK_SET);
+                direct_read_(end, true);
+                direct_read_(trailer_magic, true);
+
+                if(trailer_magic != STREAM_TRAILER_MAGIC ||
+                   end < HEADER_SIZE_ ||
+                   end + static_cast<off_t>(STREAM_END_FRAME_SIZE) > trailer_pos) {
+                    return false;
+                }
+
+                uint32_t end_magic;
+                uint32_t payload_size;
+                fseek(stream_, end, SEEK_SET);
+                direct_read_(end_magic, true);
+                direct_read_(payload_size, true);
+
+                if(end_magic != Decompressor::getStreamEndMagic() || payload_size != 0) {
+                    return false;
+                }
+
+                end_of_last_chunk_ = end;
+                direct_read_(chunk_indices_, true);
+                readIndexExtensions_(trailer_pos);
+
+                return true;
+            }
+
+            /**
+             * Rebuilds the chunk index of a streaming trace stored in a regular file by walking its chunk frames.
+             * Stops at the end-of-stream frame, or at the first truncated chunk if the writer didn't finish.
+             * \param file_size Size of the trace file
+             * \returns True if the end-of-stream frame was found
+             */
+            bool scanStreamFrames_(const off_t file_size) {
+                chunk_indices_.clear();
+                stream_pos_ = HEADER_SIZE_;
+                fseek(stream_, stream_pos_, SEEK_SET);
+
+                ChunkOffset chunk;
+                uint64_t compressed_size = 0;
+                off_t end = stream_pos_;
+
+                while(readStreamFrameHeader_(chunk, compressed_size)) {
+                    const off_t chunk_end = stream_pos_ + static_cast<off_t>(compressed_size);
+                    if(chunk_end > file_size) {
+                        break;
+                    }
+
+                    chunk_indices_.emplace_back(chunk);
+                    end = chunk_end;
+                    stream_pos_ = chunk_end;
+                    fseek(stream_, stream_pos_, SEEK_SET);
+                }
+
+                // The frame that ended the loop starts right after the last complete chunk
+                const bool found_end = stream_pos_ == end + static_cast<off_t>(STREAM_END_FRAME_SIZE) &&
+                                       !feof(stream_);
+                clearerr(stream_);
+                end_of_last_chunk_ = end;
+
+                return found_end;
+            }
+
+            /**
+             * Opens a streaming trace. Traces in regular files are indexed up front so that they can be seeked.
+             * \param filename Filename of the trace
+             * \param file_stat Result of calling fstat() on the trace
+             */
+            void openStream_(const std::string_view filename, const struct stat& file_stat) { // cppcheck-suppress passedByValue
+                streaming_ = !S_ISREG(file_stat.st_mode);
+                end_of_stream_ = false;
+                stream_pos_ = HEADER_SIZE_;
+                chunk_indices_.clear();
+                chunk_summaries_.clear();
+                chunk_snapshots_.clear();
+
+                if(streaming_) {
+                    return;
+                }
+
+                if(!readStreamIndex_(file_stat.st_size)) {
+                    chunk_indices_.clear();
+                    chunk_summaries_.clear();
+                    chunk_snapshots_.clear();
+                    if(!scanStreamFrames_(file_stat.st_size)) {
+                        std::cerr << "WARNING: " << filename << " was not closed cleanly. Recovered "
+                                  << chunk_indices_.size() << " chunks from the stream." << std::endl;
+                    }
+                }
+            }
+
+            /**
+             * Reads the chunk summaries and state snapshots that follow the chunk index, if the writer included them.
+             * Must be called with the file positioned at the end of the chunk index.
+             * \param file_size Size of the trace file
+             */
+            void readIndexExtensions_(const off_t file_size) {
+                chunk_summaries_.clear();
+                chunk_snapshots_.clear();
+
+                while(ftell(stream_) + static_cast<off_t>(2 * sizeof(uint32_t) + sizeof(size_t)) <= file_size) {
+                    uint32_t magic;
+                    uint32_t version;
+                    direct_read_(magic, true);
+                    direct_read_(version, true);
+
+                    if(magic == CHUNK_SUMMARY_MAGIC && version == CHUNK_SUMMARY_VERSION) {
+                        direct_read_(chunk_summaries_, true);
+                    }
+                    else if(magic == CHUNK_SNAPSHOT_MAGIC && version == CHUNK_SNAPSHOT_VERSION) {
+                        direct_read_(chunk_snapshots_, true);
+                    }
+                    else {
+                        break;
+                    }
+                }
+
+                // Summaries and snapshots are only useful if there is exactly one per chunk
+                if(STF_EXPECT_FALSE(ferror(stream_) || feof(stream_))) {
+                    chunk_summaries_.clear();
+                    chunk_snapshots_.clear();
+                    clearerr(stream_);
+                }
+                if(chunk_summaries_.size() != chunk_indices_.size()) {
+                    chunk_summaries_.clear();
+                }
+                if(chunk_snapshots_.size() != chunk_indices_.size()) {
+                    chunk_snapshots_.clear();
+                }
+            }
+
         public:
-            STFCompressedIFstreamBase() = default;
+            STFCompressedIFstreamBase() {
+                // Chunks are fully decompressed before they are read, so records can be decoded straight out of out_buf_
+                direct_read_buf_ = &out_buf_;
+            }
+
+            // Have to override the base class destructor to ensure that *our* close method gets called before destruction
+            inline ~STFCompressedIFstreamBase() override {
+                STF_FSTREAM_ACQUIRE_OPEN_CLOSE_LOCK();
+                STFCompressedIFstreamBase::close_();
+            }
+
+            /**
+             * Sets whether the compressed chunks should be memory-mapped instead of read into a buffer.
+             * Must be called before the file is opened.
+             * \param use_mmap If true, memory-map the file
+             */
+            inline void setUseMmap(const bool use_mmap) {
+                stf_assert(!stream_, "Cannot change the mmap setting after the file is opened");
+                use_mmap_ = use_mmap;
+            }
+
+            /**
+             * Sets the maximum number of bytes of decompressed chunks to keep around, so that seeking back to a
+             * recently read chunk doesn't have to decompress it again. A size of 0 disables the cache. Only traces
+             * read from regular files use the cache. Every stream in this process that reads the same trace shares one
+             * cache, which is as large as the largest size any of them asked for. Must be called before the file is
+             * opened.
+             * \param num_bytes Cache size in bytes
+             */
+            inline void setChunkCacheSize(const size_t num_bytes) {
+                stf_assert(!stream_, "Cannot change the chunk cache size after the file is opened");
+                chunk_cache_size_ = num_bytes;
+            }
+
+            /**
+             * Gets the chunk cache statistics. The statistics cover every stream sharing the cache.
+             */
+            STFChunkCache::Stats getChunkCacheStats() const override final {
+                return chunk_cache_ ? chunk_cache_->getStats() : STFChunkCache::Stats();
+            }
+
+            /**
+             * Sets the size of the shared memory chunk cache to create if no other process has created one for this
+             * trace yet. Processes reading the same trace share the chunks that any of them have decompressed. A size
+             * of 0 disables the shared cache. Must be called before the file is opened, and has no effect on traces
+             * read from a pipe.
+             * \param num_bytes Cache size in bytes
+             */
+            inline void setSharedChunkCacheSize(const size_t num_bytes) {
+                stf_assert(!stream_, "Cannot change the shared chunk cache size after the file is opened");
+                shared_chunk_cache_size_ = num_bytes;
+            }
+
+            /**
+             * Gets the shared chunk cache statistics
+             */
+            STFSharedChunkCache::Stats getSharedChunkCacheStats() const override final {
+                return shared_chunk_cache_ ? shared_chunk_cache_->getStats() : STFSharedChunkCache::Stats();
+            }
 
             /**
              * Opens a file
              * \param filename Filename to open
              */
             void open(const std::string_view filename) override { // cppcheck-suppress passedByValue
-                STFFstream::open(filename, "r");
+                STFFstream::open(filename, "rb");
+                seek_checkpoints_.clear();
                 // Check the magic string
                 std::array<char, Decompressor::getMagic().size() + 1> magic_str = {'\0'};
                 direct_read_(magic_str, Decompressor::getMagic().size(), true);
@@ -424,23 +1115,57 @@ namespace stf {
                 // Get the end of the last chunk
                 direct_read_(end_of_last_chunk_, true);
 
-                stf_assert(end_of_last_chunk_ != 0,
-                           "Last chunk pointer is 0. Trace file may be corrupt.");
-
                 const auto file_stat = getFileStat_();
-                stf_assert(end_of_last_chunk_ < file_stat.st_size,
-                           "Last chunk pointer (" << end_of_last_chunk_ << ") is larger than the trace file size (" << file_stat.st_size << "). Trace file may be corrupt.");
 
-                // Save current position so we can rewind later
-                const auto cur_pos = ftell(stream_);
+                streaming_ = false;
+                if(STF_EXPECT_FALSE(end_of_last_chunk_ == STREAMING_HEADER_MARKER)) {
+                    openStream_(filename, file_stat);
+                }
+                else if(STF_EXPECT_FALSE(!S_ISREG(file_stat.st_mode))) {
+                    stf_throw(filename << " is not seekable. Only streaming traces can be read from a pipe.");
+                }
+                // If the writer didn't finish, the index may be missing. Try to rebuild it from the chunk journal.
+                else if(STF_EXPECT_FALSE(end_of_last_chunk_ == 0 || end_of_last_chunk_ >= file_stat.st_size)) {
+                    const off_t last_chunk_ptr = end_of_last_chunk_;
+
+                    if(!recoverChunkIndex_(file_stat.st_size)) {
+                        stf_assert(last_chunk_ptr != 0,
+                                   "Last chunk pointer is 0. Trace file may be corrupt.");
+                        stf_throw("Last chunk pointer (" << last_chunk_ptr << ") is larger than the trace file size (" << file_stat.st_size << "). Trace file may be corrupt.");
+                    }
 
-                // Read in the chunk indices
-                fseek(stream_, end_of_last_chunk_, SEEK_SET);
-                direct_read_(chunk_indices_, true);
+                    std::cerr << "WARNING: " << filename << " was not closed cleanly. Recovered "
+                              << chunk_indices_.size() << " chunks from the chunk journal." << std::endl;
+                }
+                else {
+                    // Read in the chunk indices
+                    fseek(stream_, end_of_last_chunk_, SEEK_SET);
+                    direct_read_(chunk_indices_, true);
+                    readIndexExtensions_(file_stat.st_size);
+                }
+
+                stf_assert(streaming_ || !chunk_indices_.empty(), "Chunk index is empty. Trace file may be corrupt.");
+
+                fd_ = fileno(stream_);
+                if(use_mmap_ && !streaming_) {
+                    mapFile_();
+                }
+
+                if(chunk_cache_size_ && !streaming_) {
+                    chunk_cache_ = STFChunkCache::attach(file_stat);
+                    chunk_cache_->reserve(chunk_cache_size_);
+                }
 
-                // Rewind to beginning of first chunk
-                fseek(stream_, cur_pos, SEEK_SET);
-                last_read_pos_ = cur_pos; // Reset last_read_pos_ so we don't think we already read the whole file
+                if(shared_chunk_cache_size_ && !streaming_) {
+                    const auto max_chunk = std::max_element(chunk_indices_.begin(),
+                                                            chunk_indices_.end(),
+                                                            [](const ChunkOffset& lhs, const ChunkOffset& rhs) {
+                                                                return lhs.getUncompressedChunkSize() < rhs.getUncompressedChunkSize();
+                                                            });
+                    shared_chunk_cache_ = STFSharedChunkCache::open(file_stat,
+                                                                    shared_chunk_cache_size_,
+                                                                    max_chunk->getUncompressedChunkSize());
+                }
 
                 // Size the input buffer to match the FS block size
                 block_size_ = static_cast<size_t>(file_stat.st_blksize);
@@ -448,15 +1173,15 @@ namespace stf {
                 out_buf_.initSize(block_size_);
 
                 next_chunk_end_ = marker_record_chunk_size_;
-                if(chunk_indices_.empty()) {
-                    next_chunk_index_it_ = chunk_indices_.end();
+
+                // Read the first chunk synchronously so we can actually do some work
+                if(STF_EXPECT_FALSE(streaming_)) {
+                    stf_assert(readCurrentStreamChunk_(), "Streaming trace " << filename << " does not contain any chunks");
                 }
                 else {
-                    next_chunk_index_it_ = std::next(chunk_indices_.begin());
+                    readCurrentChunk_(0);
                 }
-
-                // Read the first chunk synchronously so we can actually do some work
-                readChunk_(next_chunk_index_it_, chunk_indices_.front().getUncompressedChunkSize(), out_buf_);
+                next_chunk_idx_ = 1;
             }
 
             /**
@@ -464,6 +1189,12 @@ namespace stf {
              * \param num_markers Number of marker records to seek by
              */
             inline void seek(size_t num_markers) override final {
+                // Streaming inputs can only be read forward, so the skipped records have to be read as well
+                if(STF_EXPECT_FALSE(streaming_)) {
+                    STFIFstream::seek(num_markers);
+                    return;
+                }
+
                 // If the seek point comes before the next chunk boundary, just seek normally within the chunk
                 if(num_marker_records_ + num_markers >= next_chunk_end_) {
                     // Throw away what's currently in the buffer since we're moving to a new chunk
@@ -478,13 +1209,15 @@ namespace stf {
                     seekToChunk_(chunk_idx);
                 }
 
-                STFIFstream::seek(num_markers);
+                seekWithinChunk_(num_markers);
             }
 
             /**
              * Rewinds the trace to the beginning
              */
             inline void rewind() override final {
+                stf_assert(!streaming_, "Cannot rewind a streaming trace that is being read from a pipe");
+
                 // Throw away what's currently in the buffer since we're moving to a new chunk
                 cancelCurrentChunks_();
                 seekToChunk_(0);
@@ -503,6 +1236,8 @@ namespace stf {
              * \param num_markers_to_seek Number of marker records to skip
              */
             void seekFromOffset(const size_t, const size_t num_markers_at_offset, const size_t num_markers_to_seek) override final {
+                stf_assert(!streaming_, "Cannot seek within a streaming trace that is being read from a pipe");
+
                 // Throw away what's currently in the buffer since we're moving to a new chunk
                 cancelCurrentChunks_();
                 seekToChunk_(num_markers_at_offset / marker_record_chunk_size_);
@@ -527,6 +1262,89 @@ namespace stf {
                 trace_start_ = out_buf_.getReadPos();
             }
 
+            /**
+             * Gets the summaries for each chunk, or an empty vector if the trace doesn't have them
+             */
+            const std::vector<ChunkSummary>& getChunkSummaries() const override final {
+                return chunk_summaries_;
+            }
+
+            /**
+             * Gets the state at the start of each chunk, or an empty vector if the trace doesn't have it
+             */
+            const std::vector<ChunkStateSnapshot>& getChunkStateSnapshots() const override final {
+                return chunk_snapshots_;
+            }
+
+            /**
+             * Gets the number of chunks in the trace
+             */
+            size_t getNumChunks() const override final {
+                return chunk_indices_.size();
+            }
+
+            /**
+             * Gets the number of marker records in each chunk
+             */
+            size_t getChunkSize() const override final {
+                return marker_record_chunk_size_;
+            }
+
+            /**
+             * Reads a compressed chunk without decompressing it. Returns false if the chunk is the last one in the
+             * trace or the trace is being read from a pipe.
+             * \param chunk_idx Index of the chunk to read
+             * \param chunk Receives the chunk
+             */
+            bool readCompressedChunk(const size_t chunk_idx, CompressedChunk& chunk) override final {
+                // The last chunk may not be full
+                if(streaming_ || chunk_idx + 1 >= chunk_indices_.size()) {
+                    return false;
+                }
+
+                const auto& index = chunk_indices_[chunk_idx];
+                const auto& next_index = chunk_indices_[chunk_idx + 1];
+                const off_t chunk_start = index.getOffset();
+                const auto num_bytes = static_cast<size_t>(getChunkEnd_(chunk_idx) - chunk_start);
+
+                chunk.data.resize(num_bytes);
+                const size_t num_bytes_read = pread_(chunk.data.data(), num_bytes, chunk_start);
+                stf_assert(num_bytes_read == num_bytes,
+                           "Failed to read entire chunk from file: requested " << num_bytes << " but read " << num_bytes_read);
+
+                // Journal entries and stream frames that follow the chunk belong to this trace, so leave them behind
+                size_t frame_size = 0;
+                const bool found_frame = Decompressor::findFrameSize(
+                    [&chunk](const size_t offset, void* data, const size_t size) {
+                        const size_t num_copied = offset < chunk.data.size() ? std::min(size, chunk.data.size() - offset) : 0;
+                        std::copy_n(chunk.data.data() + offset, num_copied, static_cast<uint8_t*>(data));
+                        return num_copied;
+                    },
+                    frame_size
+                );
+                stf_assert(found_frame && frame_size <= num_bytes, "Chunk " << chunk_idx << " is corrupt");
+                chunk.data.resize(frame_size);
+
+                chunk.uncompressed_size = index.getUncompressedChunkSize();
+                chunk.next_pc = next_index.getStartPC();
+
+                if(chunk_summaries_.empty()) {
+                    chunk.summary.reset();
+                }
+                else {
+                    chunk.summary = chunk_summaries_[chunk_idx];
+                }
+
+                if(chunk_snapshots_.empty()) {
+                    chunk.next_state.reset();
+                }
+                else {
+                    chunk.next_state = chunk_snapshots_[chunk_idx + 1];
+                }
+
+                return true;
+            }
+
             /**
              * Sets the initial PC in the trace
              */
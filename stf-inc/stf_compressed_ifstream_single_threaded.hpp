@@ -25,11 +25,12 @@ namespace stf {
             using base_class::decompressor_;
             using base_class::in_buf_;
             using base_class::out_buf_;
-            using base_class::decompress_result_;
-            using base_class::next_chunk_index_it_;
+            using base_class::next_chunk_idx_;
             using base_class::last_read_pos_;
             using base_class::block_size_;
-            using base_class::readChunk_;
+            using base_class::readCurrentChunk_;
+            using base_class::readCurrentStreamChunk_;
+            using base_class::streaming_;
             using base_class::endChunk_;
 
             // From STFCompressedChunkedBase
@@ -43,17 +44,21 @@ namespace stf {
             using base_class::num_marker_records_;
 
             /**
-             * Asynchronously read and decompress the next chunk in the file
+             * Read and decompress the next chunk in the file
              */
             void readNextChunk_() {
+                // Streaming inputs don't know how many chunks are left until they reach the end
+                if(STF_EXPECT_FALSE(streaming_)) {
+                    readCurrentStreamChunk_();
+                    return;
+                }
+
                 // Make sure there are still chunks left to read
-                if(STF_EXPECT_FALSE(next_chunk_index_it_ == chunk_indices_.end())) {
+                if(STF_EXPECT_FALSE(next_chunk_idx_ >= chunk_indices_.size())) {
                     return;
                 }
-                const size_t uncompressed_chunk_size = next_chunk_index_it_->getUncompressedChunkSize();
-                const auto chunk_it = ++next_chunk_index_it_;
 
-                readChunk_(chunk_it, uncompressed_chunk_size, out_buf_);
+                readCurrentChunk_(next_chunk_idx_++);
             }
 
             inline void cancelCurrentChunks_() override final {
@@ -2,37 +2,90 @@
 #define __STF_COMPRESSED_OFSTREAM_HPP__
 
 #include <algorithm>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
-#include <future>
+#include <exception>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 #include <signal.h>
+#include <sys/stat.h>
 
 #include "stf_compression_buffer.hpp"
 #include "stf_compressed_chunked_base.hpp"
 #include "stf_ofstream.hpp"
 #include "stf_record.hpp"
+#include "stf_thread_pool.hpp"
 
 namespace stf {
     /**
      * \class STFCompressedOFstream
      *
-     * Provides transparent on-the-fly compression of an STF file
+     * Provides transparent on-the-fly compression of an STF file.
+     * Up to num_compression_threads chunks are compressed concurrently, each with its own compressor. Compressed chunks
+     * are always written to the file in order.
+     *
+     * By default the chunk index is rewritten at the end of the file after every chunk. In chunk journal mode, each
+     * chunk is instead followed by a small journal entry and the index is only written once when the file is closed.
+     * If the writer is killed before then, readers rebuild the index from the journal entries.
+     *
+     * If chunk summaries are enabled, a ChunkSummary is also collected for each chunk and written after the index when
+     * the file is closed. Likewise, if chunk snapshots are enabled, a ChunkStateSnapshot of the state at the start of
+     * each chunk is written after the index so that chunks can be decoded in isolation.
+     *
+     * Streaming traces never seek, so they can be written to pipes. Each chunk is preceded by a frame header
+     * describing it, and the last chunk is followed by an end-of-stream frame. If the output is a regular file, the
+     * chunk index and a trailer pointing at it are written after the end-of-stream frame when the file is closed.
+     * Traces written to non-seekable outputs always use the streaming format.
      */
     template<typename Compressor>
     class STFCompressedOFstream : public STFOFstream, public STFCompressedChunkedBase {
+        public:
+            static constexpr size_t DEFAULT_NUM_COMPRESSION_THREADS = 1; /**< Default number of chunks that can be compressed concurrently */
+
         private:
-            Compressor compressor_; /**< Compressor object */
-            STFCompressionPointerWrapper<const uint8_t*> in_buf_; /**< Input data pointer */
-            STFExponentialCompressionBuffer cur_chunk_buf_;
-            STFExponentialCompressionBuffer compression_chunk_buf_;
-            STFCompressionBuffer out_buf_; /**< Output data buffer - holds compressed data that has not been written to the file */
-            std::future<void> compression_done_;
-            bool compression_in_progress_ = false;
+            /**
+             * \struct CompressionSlot
+             * Holds the state needed to compress a single chunk in the background
+             */
+            struct CompressionSlot {
+                std::unique_ptr<Compressor> compressor; /**< Compressor used for this slot */
+                STFExponentialCompressionBuffer in_buf; /**< Holds the uncompressed chunk */
+                STFCompressionBuffer out_buf; /**< Holds the compressed chunk */
+                uint64_t next_chunk_pc = 0; /**< Starting PC of the chunk that follows this one */
+                size_t uncompressed_size = 0; /**< Uncompressed size of the chunk */
+                bool done = false; /**< Set to true when the chunk is ready to be written */
+                std::exception_ptr error; /**< Holds any exception thrown while compressing the chunk */
+            };
+
+            std::function<std::unique_ptr<Compressor>()> compressor_factory_; /**< Constructs compressors for each slot */
+            STFExponentialCompressionBuffer cur_chunk_buf_; /**< Holds the chunk currently being written */
             bool pending_chunk_ = false; /**< True if there is pending data in the output buffer */
-            size_t bytes_written_ = 0; /**< Number of uncompressed bytes written so far */
             bool incomplete_chunk_ = false; /**< If true, the current chunk in the buffer doesn't end with a marker record */
+            bool chunk_journal_ = false; /**< If true, write a journal entry after each chunk instead of rewriting the index */
+            bool write_chunk_summaries_ = false; /**< If true, write a summary of each chunk after the index */
+            ChunkSummaryTracker summary_tracker_; /**< Builds the summary for the current chunk */
+            bool write_chunk_snapshots_ = false; /**< If true, write a snapshot of the state at the start of each chunk after the index */
+            ChunkStateTracker state_tracker_; /**< Follows the state used for chunk snapshots */
+            bool streaming_requested_ = false; /**< If true, use the streaming format even if the output is seekable */
+            bool streaming_ = false; /**< True if the trace is being written in the streaming format */
+            bool seekable_ = true; /**< False if the output is not a regular file, e.g. a pipe */
+            off_t stream_pos_ = 0; /**< Number of bytes written so far. Streaming traces use this instead of ftell(), since the output may not be seekable. */
+
+            size_t num_compression_threads_ = DEFAULT_NUM_COMPRESSION_THREADS; /**< Maximum number of chunks that can be compressed concurrently */
+            std::vector<std::unique_ptr<CompressionSlot>> slots_; /**< Ring of compression slots */
+            size_t next_fill_slot_ = 0; /**< Slot that will receive the next chunk */
+            size_t next_write_slot_ = 0; /**< Slot holding the next chunk that should be written to the file */
+            size_t num_pending_slots_ = 0; /**< Number of chunks that have been submitted but not yet written */
+            bool writer_active_ = false; /**< Set to true while a thread is writing completed chunks to the file */
+            size_t num_running_jobs_ = 0; /**< Number of compression jobs that have been submitted but have not returned yet */
+            std::exception_ptr error_; /**< Holds the first exception thrown while compressing or writing a chunk */
+            std::mutex slot_mutex_; /**< Guards the slot ring state */
+            std::condition_variable slot_cv_; /**< Signaled whenever a slot is freed, the writer finishes, or a job returns */
 
             /**
              * Writes directly to the file, bypassing the compressor
@@ -42,6 +95,7 @@ namespace stf {
             template <typename T>
             inline void direct_write_(const T* data, size_t size) {
                 STFOFstream::fwrite_(data, sizeof(T), size);
+                stream_pos_ += static_cast<off_t>(sizeof(T) * size);
             }
 
             /**
@@ -74,6 +128,22 @@ namespace stf {
                 direct_write_(data.getUncompressedChunkSize());
             }
 
+            /**
+             * Writes a ChunkSummary directly to the file, bypassing the compressor
+             * \param data Data to write
+             */
+            inline void direct_write_(const ChunkSummary& data) {
+                data.write([this](const auto val) { direct_write_(val); });
+            }
+
+            /**
+             * Writes a ChunkStateSnapshot directly to the file, bypassing the compressor
+             * \param data Data to write
+             */
+            inline void direct_write_(const ChunkStateSnapshot& data) {
+                data.write([this](const auto val) { direct_write_(val); });
+            }
+
             /**
              * Writes a vector directly to the file, bypassing the compressor
              * \param data Data to write
@@ -126,41 +196,219 @@ namespace stf {
                 return num;
             }
 
-            inline void compressChunkAsync_(const uint64_t next_chunk_pc) {
-                const size_t num_bytes = compression_chunk_buf_.end();
-                compressor_.compress(out_buf_, compression_chunk_buf_);
-                bytes_written_ += num_bytes;
-                endChunk_(next_chunk_pc);
+            /**
+             * Compresses the chunk held in a slot, then writes any chunks that are ready. Runs on a helper thread.
+             * \param slot Slot to compress
+             */
+            inline void compressChunkAsync_(CompressionSlot& slot) {
+                try {
+                    slot.uncompressed_size = slot.in_buf.end();
+                    slot.compressor->compress(slot.out_buf, slot.in_buf);
+                    // Flush any data remaining in the internal compressor buffers
+                    slot.compressor->flush(slot.out_buf);
+                }
+                catch(...) {
+                    slot.error = std::current_exception();
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(slot_mutex_);
+                    slot.done = true;
+                }
+
+                writeCompletedChunks_();
+
+                // This must be the last time the job touches the stream, since close() may return as soon as it sees
+                // that no jobs are left
+                std::lock_guard<std::mutex> lock(slot_mutex_);
+                --num_running_jobs_;
+                slot_cv_.notify_all();
             }
 
-            inline void compressChunk_() {
-                if(STF_EXPECT_TRUE(compression_in_progress_)) {
-                    compression_done_.get();
-                    compression_in_progress_ = false;
+            /**
+             * Writes completed chunks to the file in order. Only one thread writes at a time - if another thread is
+             * already writing, it will pick up any chunks completed in the meantime.
+             */
+            inline void writeCompletedChunks_() {
+                std::unique_lock<std::mutex> lock(slot_mutex_);
+
+                if(writer_active_) {
+                    return;
                 }
+
+                writer_active_ = true;
+
+                while(num_pending_slots_ && slots_[next_write_slot_]->done) {
+                    auto& slot = *slots_[next_write_slot_];
+
+                    // Once anything has failed, stop writing to the file
+                    if(STF_EXPECT_FALSE(slot.error && !error_)) {
+                        error_ = slot.error;
+                    }
+                    const bool failed = static_cast<bool>(error_);
+                    std::exception_ptr write_error;
+
+                    lock.unlock();
+
+                    if(STF_EXPECT_TRUE(!failed)) {
+                        try {
+                            if(streaming_) {
+                                writeStreamFrame_(slot);
+                            }
+                            writeChunk_(slot);
+                            if(chunk_journal_ && !streaming_) {
+                                writeJournalEntry_(slot);
+                            }
+                            endChunk_(slot.uncompressed_size, slot.next_chunk_pc);
+                        }
+                        catch(...) {
+                            write_error = std::current_exception();
+                        }
+                    }
+
+                    slot.out_buf.reset();
+                    slot.error = nullptr;
+
+                    lock.lock();
+                    if(STF_EXPECT_FALSE(write_error && !error_)) {
+                        error_ = write_error;
+                    }
+                    slot.done = false;
+                    next_write_slot_ = (next_write_slot_ + 1) % slots_.size();
+                    --num_pending_slots_;
+                    slot_cv_.notify_all();
+                }
+
+                writer_active_ = false;
+                slot_cv_.notify_all();
+            }
+
+            /**
+             * Returns whether compressing or writing a chunk has failed
+             */
+            inline bool hasErrors_() {
+                std::lock_guard<std::mutex> lock(slot_mutex_);
+                return static_cast<bool>(error_);
+            }
+
+            /**
+             * Rethrows any exception raised while compressing or writing a chunk
+             */
+            inline void checkForErrors_() {
+                std::lock_guard<std::mutex> lock(slot_mutex_);
+                if(STF_EXPECT_FALSE(error_)) {
+                    std::rethrow_exception(error_);
+                }
+            }
+
+            /**
+             * Waits for a free compression slot and returns it
+             */
+            inline CompressionSlot& acquireSlot_() {
+                std::unique_lock<std::mutex> lock(slot_mutex_);
+                slot_cv_.wait(lock, [this]() { return num_pending_slots_ < slots_.size(); });
+
+                if(STF_EXPECT_FALSE(error_)) {
+                    std::rethrow_exception(error_);
+                }
+
+                auto& slot = *slots_[next_fill_slot_];
+                next_fill_slot_ = (next_fill_slot_ + 1) % slots_.size();
+                ++num_pending_slots_;
+
+                return slot;
+            }
+
+            /**
+             * Waits for all in-flight chunks to be compressed and written. Waiting on the jobs themselves isn't enough,
+             * since the job that is writing to the file may belong to a slot that has already been reused.
+             */
+            inline void waitForAllChunks_() {
+                std::unique_lock<std::mutex> lock(slot_mutex_);
+                slot_cv_.wait(lock, [this]() { return num_pending_slots_ == 0 && !writer_active_ && num_running_jobs_ == 0; });
+            }
+
+            inline void compressChunk_() {
                 if(STF_EXPECT_TRUE(pending_chunk_)) {
                     // Every chunk needs to end with a marker record, otherwise any tools that try to read the trace will
                     // probably throw an exception when they reach the end
                     stf_assert(!incomplete_chunk_, "Attempted to write a chunk that doesn't end with a marker record");
                     pending_chunk_ = false;
-                    compression_in_progress_ = true;
-                    std::swap(cur_chunk_buf_, compression_chunk_buf_);
+
+                    auto& slot = acquireSlot_();
+                    std::swap(cur_chunk_buf_, slot.in_buf);
+
+                    if(write_chunk_summaries_) {
+                        chunk_summaries_.emplace_back(summary_tracker_.finishChunk());
+                    }
+                    if(write_chunk_snapshots_) {
+                        chunk_snapshots_.emplace_back(state_tracker_.getSnapshot(num_marker_records_));
+                    }
 
                     // Grab the next chunk's PC now since compression is happening asynchronously
-                    const uint64_t next_chunk_pc = pc_tracker_.getNextPC();
-                    compression_done_ = std::move(std::async(std::launch::async,
-                                                             [this, next_chunk_pc](){ this->compressChunkAsync_(next_chunk_pc); }));
+                    slot.next_chunk_pc = pc_tracker_.getNextPC();
+                    {
+                        std::lock_guard<std::mutex> lock(slot_mutex_);
+                        ++num_running_jobs_;
+                    }
+                    STFThreadPool::get().submit([this, &slot](){ this->compressChunkAsync_(slot); });
                 }
             }
 
             /**
-             * Writes compressed data out to the file
+             * Writes a journal entry describing the chunk that was just written
+             * \param slot Slot holding the compressed chunk
              */
-            inline void writeChunk_() {
+            inline void writeJournalEntry_(const CompressionSlot& slot) {
+                direct_write_(Compressor::getJournalMagic());
+                direct_write_(JOURNAL_ENTRY_PAYLOAD_SIZE);
+                direct_write_(static_cast<uint64_t>(slot.out_buf.end()));
+                direct_write_(static_cast<uint64_t>(chunk_indices_.back().getStartPC()));
+                direct_write_(static_cast<uint64_t>(slot.uncompressed_size));
+            }
+
+            /**
+             * Writes the frame header that precedes a chunk in a streaming trace and points the chunk index at the
+             * compressed data that follows it
+             * \param slot Slot holding the compressed chunk
+             */
+            inline void writeStreamFrame_(const CompressionSlot& slot) {
+                auto& chunk = chunk_indices_.back();
+                direct_write_(Compressor::getStreamFrameMagic());
+                direct_write_(STREAM_FRAME_PAYLOAD_SIZE);
+                direct_write_(static_cast<uint64_t>(slot.out_buf.end()));
+                direct_write_(static_cast<uint64_t>(chunk.getStartPC()));
+                direct_write_(static_cast<uint64_t>(slot.uncompressed_size));
+                chunk.set(stream_pos_, chunk.getStartPC(), slot.uncompressed_size);
+            }
+
+            /**
+             * Writes the end-of-stream frame that follows the last chunk in a streaming trace. If the output is
+             * seekable, the chunk index, its extensions, and a trailer pointing at them are written afterward.
+             * \param num_chunks Number of chunks in the file
+             */
+            inline void writeStreamEnd_(const size_t num_chunks) {
+                const off_t end = stream_pos_;
+
+                direct_write_(Compressor::getStreamEndMagic());
+                direct_write_(static_cast<uint32_t>(0));
+
+                if(seekable_) {
+                    direct_write_(chunk_indices_, num_chunks);
+                    writeIndexExtensions_(num_chunks);
+                    direct_write_(end);
+                    direct_write_(STREAM_TRAILER_MAGIC);
+                }
+            }
+
+            /**
+             * Writes a compressed chunk out to the file
+             * \param slot Slot holding the compressed chunk
+             */
+            inline void writeChunk_(const CompressionSlot& slot) {
                 // Only bother trying to write if there's some data in the buffer
-                if(out_buf_.end()) {
-                    direct_write_(out_buf_.get(), out_buf_.end());
-                    out_buf_.reset();
+                if(slot.out_buf.end()) {
+                    direct_write_(slot.out_buf.get(), slot.out_buf.end());
                 }
             }
 
@@ -176,9 +424,12 @@ namespace stf {
             }
 
             /**
-             * Ends the current compressed chunk and flushes it to the file
+             * Writes the first num_chunks chunk offsets to the end of the file and points the header at them.
+             * Signals are masked while the index is written.
+             * \param num_chunks Number of chunks to write to the index
+             * \returns File offset of the end of the last chunk
              */
-            inline void endChunk_(const uint64_t next_chunk_pc) {
+            inline off_t writeIndex_(const size_t num_chunks) {
                 static const sigset_t set = initSigSet_();
 
                 // Mask signals until we're done writing to the file
@@ -186,23 +437,11 @@ namespace stf {
 
                 stf_assert(err == 0, "Failed to mask signals with error: " << strerror(err));
 
-                // Empty the buffer if it's full
-                if(out_buf_.full()) {
-                    writeChunk_();
-                }
-
-                // Flush any data remaining in the internal compressor buffers
-                compressor_.flush(out_buf_);
-                // Write any remaining data that was flushed
-                writeChunk_();
-                chunk_indices_.back().setUncompressedChunkSize(bytes_written_);
-                bytes_written_ = 0;
-
                 // Get the current file offset so we can write it back at the beginning
                 const off_t end = ftell(stream_);
 
                 // Write the chunk offsets to the end of the file
-                direct_write_(chunk_indices_, chunk_indices_.size());
+                direct_write_(chunk_indices_, num_chunks);
 
                 // Write the end of the last chunk into the spot we reserved when we opened the file
                 fseek(stream_, Compressor::getMagic().size() + sizeof(marker_record_chunk_size_), SEEK_SET);
@@ -216,14 +455,59 @@ namespace stf {
 
                 stf_assert(err == 0, "Failed to unmask signals with error: " << strerror(err));
 
+                return end;
+            }
+
+            /**
+             * Writes the chunk summaries and/or snapshots to the end of the file
+             * \param num_chunks Number of chunks in the file
+             */
+            inline void writeIndexExtensions_(const size_t num_chunks) {
+                fseek(stream_, 0, SEEK_END);
+
+                if(write_chunk_summaries_) {
+                    direct_write_(CHUNK_SUMMARY_MAGIC);
+                    direct_write_(CHUNK_SUMMARY_VERSION);
+                    direct_write_(chunk_summaries_, num_chunks);
+                }
+
+                if(write_chunk_snapshots_) {
+                    direct_write_(CHUNK_SNAPSHOT_MAGIC);
+                    direct_write_(CHUNK_SNAPSHOT_VERSION);
+                    direct_write_(chunk_snapshots_, num_chunks);
+                }
+            }
+
+            /**
+             * Ends the chunk that was just written to the file and updates the chunk index
+             * \param uncompressed_chunk_size Uncompressed size of the chunk
+             * \param next_chunk_pc Starting PC of the next chunk
+             */
+            inline void endChunk_(const size_t uncompressed_chunk_size, const uint64_t next_chunk_pc) {
+                chunk_indices_.back().setUncompressedChunkSize(uncompressed_chunk_size);
+
+                // In journal mode the index is only written when the file is closed, and streaming traces never
+                // write it until then
+                off_t end;
+                if(streaming_) {
+                    end = stream_pos_;
+                    // Hand each chunk to the reader as soon as it is complete
+                    fflush(stream_);
+                }
+                else {
+                    end = chunk_journal_ ? ftell(stream_) : writeIndex_(chunk_indices_.size());
+                }
+
                 // Start a new chunk
                 chunk_indices_.emplace_back(end, next_chunk_pc, 0);
             }
 
             /**
              * Closes the file
+             * \param report_errors If true, rethrow any exception raised while compressing or writing a chunk.
+             * Otherwise, print a warning.
              */
-            int close_() override {
+            int closeStream_(const bool report_errors) {
                 if(stream_) {
                     // Finish any pending chunk
                     if(pending_chunk_) {
@@ -235,13 +519,60 @@ namespace stf {
                             compressChunk_();
                         }
                     }
-                    if(compression_in_progress_) {
-                        compression_done_.get();
-                        compression_in_progress_ = false;
+                    waitForAllChunks_();
+                    const bool failed = hasErrors_();
+
+                    // The last entry in chunk_indices_ is always the next (empty) chunk
+                    if(streaming_) {
+                        if(!failed) {
+                            writeStreamEnd_(chunk_indices_.size() - 1);
+                        }
+                    }
+                    else if(chunk_journal_ && !failed && chunk_indices_.size() > 1) {
+                        // Overwrite the journal entry for the last chunk with the index. This keeps the end of the
+                        // last chunk where older readers expect it.
+                        fseek(stream_, -static_cast<off_t>(JOURNAL_ENTRY_SIZE), SEEK_CUR);
+                        writeIndex_(chunk_indices_.size() - 1);
+                    }
+
+                    // Summaries and snapshots go after the index so that older readers ignore them
+                    if(!streaming_ && (write_chunk_summaries_ || write_chunk_snapshots_) && !failed && chunk_indices_.size() > 1) {
+                        writeIndexExtensions_(chunk_indices_.size() - 1);
                     }
                 }
 
-                return STFOFstream::close_();
+                const int result = STFOFstream::close_();
+
+                std::exception_ptr error;
+                {
+                    std::lock_guard<std::mutex> lock(slot_mutex_);
+                    std::swap(error, error_);
+                }
+
+                if(STF_EXPECT_FALSE(error)) {
+                    if(report_errors) {
+                        std::rethrow_exception(error);
+                    }
+
+                    try {
+                        std::rethrow_exception(error);
+                    }
+                    catch(const std::exception& e) {
+                        std::cerr << "WARNING: Failed to write compressed STF chunk: " << e.what() << std::endl;
+                    }
+                    catch(...) {
+                        std::cerr << "WARNING: Failed to write compressed STF chunk" << std::endl;
+                    }
+                }
+
+                return result;
+            }
+
+            /**
+             * Closes the file, rethrowing any exception raised while compressing or writing a chunk
+             */
+            int close_() override {
+                return closeStream_(true);
             }
 
         public:
@@ -251,7 +582,7 @@ namespace stf {
              */
             template<typename ... CompressorArgs>
             explicit STFCompressedOFstream(CompressorArgs... args) :
-                compressor_(args...)
+                compressor_factory_([args...]() { return std::make_unique<Compressor>(args...); })
             {
             }
 
@@ -281,9 +612,10 @@ namespace stf {
             }
 
             // Have to override the base class destructor to ensure that *our* close method gets called before destruction
+            // Errors can't be thrown from here, so they are only reported as warnings. Call close() to catch them.
             inline ~STFCompressedOFstream() override {
                 STF_FSTREAM_ACQUIRE_OPEN_CLOSE_LOCK();
-                STFCompressedOFstream::close_();
+                closeStream_(false);
             }
 
             /**
@@ -296,6 +628,58 @@ namespace stf {
                 marker_record_chunk_size_ = chunk_size;
             }
 
+            /**
+             * Sets the maximum number of chunks that can be compressed concurrently
+             * \note Once the stream is open this cannot be changed
+             * \param num_compression_threads Number of chunks
+             */
+            void setNumCompressionThreads(const size_t num_compression_threads) {
+                stf_assert(!stream_, "Must set number of compression threads before opening file.");
+                stf_assert(num_compression_threads > 0, "Number of compression threads must be at least 1");
+                num_compression_threads_ = num_compression_threads;
+            }
+
+            /**
+             * Enables or disables chunk journal mode
+             * \note Once the stream is open this cannot be changed
+             * \param chunk_journal If true, write a journal entry after each chunk and only write the index on close
+             */
+            void setChunkJournal(const bool chunk_journal) {
+                stf_assert(!stream_, "Must set chunk journal mode before opening file.");
+                chunk_journal_ = chunk_journal;
+            }
+
+            /**
+             * Enables or disables writing chunk summaries
+             * \note Once the stream is open this cannot be changed
+             * \param chunk_summaries If true, write a summary of each chunk after the index when the file is closed
+             */
+            void setChunkSummaries(const bool chunk_summaries) {
+                stf_assert(!stream_, "Must set chunk summary mode before opening file.");
+                write_chunk_summaries_ = chunk_summaries;
+            }
+
+            /**
+             * Enables or disables writing chunk state snapshots
+             * \note Once the stream is open this cannot be changed
+             * \param chunk_snapshots If true, write a snapshot of the state at the start of each chunk after the index
+             * when the file is closed
+             */
+            void setChunkSnapshots(const bool chunk_snapshots) {
+                stf_assert(!stream_, "Must set chunk snapshot mode before opening file.");
+                write_chunk_snapshots_ = chunk_snapshots;
+            }
+
+            /**
+             * Enables or disables the streaming format. Traces written to non-seekable outputs always use it.
+             * \note Once the stream is open this cannot be changed
+             * \param streaming If true, write the trace without seeking so that it can be read from a pipe
+             */
+            void setStreaming(const bool streaming) {
+                stf_assert(!stream_, "Must set streaming mode before opening file.");
+                streaming_requested_ = streaming;
+            }
+
             /**
              * Opens a file using the specified chunk size
              * \param filename Filename to open
@@ -315,6 +699,11 @@ namespace stf {
 
                 // Open the file
                 STFFstream::open(filename, "wb");
+                stream_pos_ = 0;
+
+                // Pipes and other non-seekable outputs can only be written in the streaming format
+                seekable_ = S_ISREG(getFileStat_().st_mode);
+                streaming_ = streaming_requested_ || !seekable_;
 
                 // Write the magic string for the compressor
                 direct_write_(Compressor::getMagic().data(), Compressor::getMagic().size());
@@ -323,27 +712,134 @@ namespace stf {
                 direct_write_(marker_record_chunk_size_);
 
                 // Write a placeholder value for the end of the last chunk (since we don't know how much data we're going to have)
-                direct_write_(ZERO);
+                // Streaming traces can't come back to fill it in, so they are marked instead
+                direct_write_(streaming_ ? STREAMING_HEADER_MARKER : ZERO);
 
                 // The first chunk starts here
-                chunk_indices_.emplace_back(ftell(stream_), 0, 0);
+                chunk_indices_.emplace_back(streaming_ ? stream_pos_ : ftell(stream_), 0, 0);
+                chunk_summaries_.clear();
+                summary_tracker_ = ChunkSummaryTracker();
+                state_tracker_ = ChunkStateTracker();
+                chunk_snapshots_.clear();
+                if(write_chunk_snapshots_) {
+                    chunk_snapshots_.emplace_back(state_tracker_.getSnapshot(0));
+                }
 
-                // Size the output buffer to match the filesystem block size
+                // Size the buffers to match the filesystem block size
                 const size_t block_size = getFSBlockSize_();
-                out_buf_.initSize(block_size);
                 cur_chunk_buf_.initSize(block_size, true);
-                compression_chunk_buf_.initSize(block_size, true);
 
-                // ...but also make sure it can fit a reasonable amount of compressed data
-                out_buf_.fit(Compressor::getInitialBoundedSize());
+                slots_.clear();
+                next_fill_slot_ = 0;
+                next_write_slot_ = 0;
+                num_pending_slots_ = 0;
+                num_running_jobs_ = 0;
+                error_ = nullptr;
+                for(size_t i = 0; i < num_compression_threads_; ++i) {
+                    auto& slot = slots_.emplace_back(std::make_unique<CompressionSlot>());
+                    slot->compressor = compressor_factory_();
+                    slot->in_buf.initSize(block_size, true);
+                    slot->out_buf.initSize(block_size);
+                    // ...but also make sure it can fit a reasonable amount of compressed data
+                    slot->out_buf.fit(Compressor::getInitialBoundedSize());
+                }
 
                 next_chunk_end_ = marker_record_chunk_size_;
             }
 
+            using STFOFstream::operator<<;
+
+            /**
+             * Writes a record, adding it to the chunk summary and state snapshot if they are enabled
+             * \param rec Record to write
+             */
+            STFOFstream& operator<<(const STFBaseObject& rec) override {
+                if(STF_EXPECT_FALSE(write_chunk_summaries_ || write_chunk_snapshots_)) {
+                    if(const auto stf_rec = dynamic_cast<const STFRecord*>(&rec)) {
+                        if(write_chunk_summaries_) {
+                            summary_tracker_.track(*stf_rec);
+                        }
+                        if(write_chunk_snapshots_) {
+                            state_tracker_.track(*stf_rec);
+                        }
+                    }
+                }
+                return STFOFstream::operator<<(rec);
+            }
+
+            /**
+             * Appends a chunk that was read from another compressed trace without recompressing it. Must be called
+             * when the previous chunk has just ended. Returns false if the chunk is missing a summary or snapshot
+             * that this stream writes.
+             * \param chunk Chunk to append
+             */
+            bool appendCompressedChunk(const CompressedChunk& chunk) override {
+                stf_assert(!pending_chunk_, "Compressed chunks can only be appended at a chunk boundary");
+
+                // The summary and snapshot trackers have to pick up where the chunk leaves off
+                const bool needs_state = write_chunk_summaries_ || write_chunk_snapshots_;
+                if((write_chunk_summaries_ && !chunk.summary) || (needs_state && !chunk.next_state)) {
+                    return false;
+                }
+
+                auto& slot = acquireSlot_();
+                slot.out_buf.reset();
+                slot.out_buf.fit(chunk.data.size());
+                std::copy(chunk.data.begin(), chunk.data.end(), slot.out_buf.get());
+                slot.out_buf.advanceWritePtr(chunk.data.size());
+                slot.uncompressed_size = chunk.uncompressed_size;
+                slot.next_chunk_pc = chunk.next_pc;
+
+                if(write_chunk_summaries_) {
+                    chunk_summaries_.emplace_back(*chunk.summary);
+                }
+
+                num_marker_records_ += marker_record_chunk_size_;
+                next_chunk_end_ += marker_record_chunk_size_;
+                pc_tracker_.forcePC(chunk.next_pc);
+
+                if(needs_state) {
+                    summary_tracker_.setState(*chunk.next_state, true);
+                    state_tracker_.setState(*chunk.next_state);
+                }
+                if(write_chunk_snapshots_) {
+                    chunk_snapshots_.emplace_back(state_tracker_.getSnapshot(num_marker_records_));
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(slot_mutex_);
+                    slot.done = true;
+                }
+
+                writeCompletedChunks_();
+                checkForErrors_();
+
+                return true;
+            }
+
+            /**
+             * Sets the state that the following records are written in, so that chunk summaries and snapshots stay
+             * correct when records from another trace are spliced in
+             * \param state State to switch to
+             */
+            void setChunkState(const ChunkStateSnapshot& state) override {
+                summary_tracker_.setState(state, !pending_chunk_);
+                state_tracker_.setState(state);
+
+                // If the current chunk hasn't started yet, it starts in the new state
+                if(write_chunk_snapshots_ && !pending_chunk_) {
+                    chunk_snapshots_.back() = state_tracker_.getSnapshot(num_marker_records_);
+                }
+            }
+
             void markerRecordCallback() override {
                 STFOFstream::markerRecordCallback();
                 incomplete_chunk_ = false; // This chunk is safe to write now
 
+                if(STF_EXPECT_FALSE(write_chunk_summaries_)) {
+                    summary_tracker_.trackMarker(pc_tracker_.getPC());
+                }
+
                 // If we've crossed the chunk boundary, close the current chunk and start a new one
                 if(STF_EXPECT_FALSE(num_marker_records_ >= next_chunk_end_)) {
                     compressChunk_();
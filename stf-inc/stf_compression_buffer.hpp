@@ -63,10 +63,10 @@ namespace stf {
 
         public:
             /**
-             * Gets the underlying raw pointer managed by an std::unique_ptr
+             * Gets the underlying raw pointer managed by a smart pointer
              */
             template<typename T = PointerType>
-            std::enable_if_t<pointer_utils::is_unique_ptr_v<T>, typename std::pointer_traits<T>::element_type*>
+            std::enable_if_t<pointer_utils::is_smart_ptr<T>::value, typename T::element_type*>
             get() const {
                 return buf_.get();
             }
@@ -80,15 +80,6 @@ namespace stf {
                 return buf_;
             }
 
-            /**
-             * Gets the buffer if it is already a raw pointer
-             */
-            template<typename T = PointerType>
-            std::enable_if_t<std::is_pointer_v<T>, const T>
-            get() const {
-                return buf_;
-            }
-
             /**
              * Reinterprets the underlying buffer as the specified type
              */
@@ -207,9 +198,11 @@ namespace stf {
      * \class STFCompressionBuffer
      * Compression buffer class that manages its own memory
      */
-    class STFCompressionBuffer : public STFCompressionBufferBase<std::unique_ptr<uint8_t[]>> { // NOLINT: modernize-avoid-c-arrays
+    class STFCompressionBuffer : public STFCompressionBufferBase<std::shared_ptr<uint8_t[]>> { // NOLINT: modernize-avoid-c-arrays
         protected:
             size_t allocation_granule_ = 0; /**< Allocation granule - when growing the size of this buffer with fit, the actual allocated size will increase by a multiple of this */
+            std::shared_ptr<uint8_t[]> spare_buf_; /**< Memory given up by unshare() that can be reused once it is no longer shared */ // NOLINT: modernize-avoid-c-arrays
+            size_t spare_buf_actual_size_ = 0; /**< Allocated size of spare_buf_ */
 
             /**
              * Resizes the buffer, reallocating and copying into a new buffer if necessary.
@@ -250,7 +243,7 @@ namespace stf {
              * \param size Size of the buffer in bytes
              */
             explicit STFCompressionBuffer(const size_t size) :
-                STFCompressionBufferBase(std::make_unique<uint8_t[]>(size), size), // NOLINT: modernize-avoid-c-arrays
+                STFCompressionBufferBase(std::make_shared<uint8_t[]>(size), size), // NOLINT: modernize-avoid-c-arrays
                 allocation_granule_(size)
             {
             }
@@ -282,6 +275,52 @@ namespace stf {
                 }
             }
 
+            /**
+             * Gets a pointer to the given offset in the buffer that shares ownership of the underlying memory. The
+             * memory stays alive for as long as the returned pointer does, even if the buffer is unshared and reused.
+             * \param offset Offset into the buffer
+             */
+            std::shared_ptr<const uint8_t> share(const size_t offset) const {
+                return std::shared_ptr<const uint8_t>(buf_, buf_.get() + offset);
+            }
+
+            /**
+             * Makes this buffer hold the same data as another buffer by sharing its memory instead of copying it. The
+             * read pointer is moved to the start of the data. Call unshare() before writing to either buffer.
+             * \param other Buffer to share memory with
+             */
+            void shareFrom(const STFCompressionBuffer& other) {
+                buf_ = other.buf_;
+                buf_actual_size_ = other.buf_actual_size_;
+                buf_size_ = other.buf_size_;
+                buf_write_ptr_ = other.buf_write_ptr_;
+                buf_read_ptr_ = 0;
+            }
+
+            /**
+             * Ensures that the buffer does not share its memory with any pointers returned by share(), so that it can
+             * be overwritten. Preserves any data that has already been written. The shared memory is kept as a spare
+             * and reused by a later call once nothing else refers to it, so that alternating between two chunks
+             * doesn't need a fresh allocation every time.
+             */
+            void unshare() {
+                if(STF_EXPECT_FALSE(buf_.use_count() > 1)) {
+                    if(spare_buf_.use_count() != 1 || spare_buf_actual_size_ < buf_actual_size_) {
+                        try {
+                            spare_buf_.reset(new uint8_t[buf_actual_size_]); // NOLINT: modernize-avoid-c-arrays
+                            spare_buf_actual_size_ = buf_actual_size_;
+                        }
+                        catch(const std::bad_alloc&) {
+                            stf_throw("Failed to allocate " << buf_actual_size_ << " bytes");
+                        }
+                    }
+
+                    std::copy(buf_.get(), buf_.get() + buf_write_ptr_, spare_buf_.get());
+                    std::swap(buf_, spare_buf_);
+                    std::swap(buf_actual_size_, spare_buf_actual_size_);
+                }
+            }
+
             /**
              * Write into the buffer, automatically moving the write pointer
              * \param data Buffer to write from
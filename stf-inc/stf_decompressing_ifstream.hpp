@@ -0,0 +1,470 @@
+#ifndef __STF_DECOMPRESSING_IFSTREAM_HPP__
+#define __STF_DECOMPRESSING_IFSTREAM_HPP__
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+#include <sys/stat.h>
+
+#include "stf_compression_buffer.hpp"
+#include "stf_ifstream.hpp"
+#include "stf_thread_pool.hpp"
+#include "lzma/stf_lzma_decoder.hpp"
+#include "zlib/stf_zlib_decoder.hpp"
+
+namespace stf {
+    /**
+     * \class STFDecompressingIFstream
+     *
+     * Provides transparent in-process decompression of a trace compressed with a general-purpose format such as gzip
+     * or xz.
+     *
+     * Unlike a zstf, these formats aren't split into chunks at marker record boundaries, so records can span the
+     * decoded blocks. Offsets returned by tell() are uncompressed offsets, which lets the indexer and seekFromOffset()
+     * work the same way they do for an uncompressed trace. Seeking moves the decoder to the closest restart point it
+     * knows about (see the Decoder class for how restart points are found), then decodes forward to the offset.
+     *
+     * Unless the stream is single-threaded, up to read_ahead_depth blocks are decoded in the background on the
+     * STFThreadPool. The formats can only be decoded in order, so each background job waits for the previous one
+     * before it runs the decoder.
+     */
+    template<typename Decoder>
+    class STFDecompressingIFstream final : public STFIFstream {
+        private:
+            /**
+             * \struct DecodeSlot
+             * Holds a block that is being decoded in the background
+             */
+            struct DecodeSlot {
+                STFCompressionBuffer buf; /**< Holds the decoded block */
+                std::future<void> result; /**< Future used to indicate when the block has been decoded */
+                size_t ticket = 0; /**< Order in which this block has to be decoded */
+            };
+
+            Decoder decoder_; /**< Decoder state */
+            bool seekable_ = false; /**< Whether the compressed file can be repositioned */
+            bool single_threaded_ = false; /**< If true, blocks are decoded synchronously */
+            size_t block_size_ = DEFAULT_BLOCK_SIZE; /**< Size of each decoded block */
+            size_t read_ahead_depth_ = DEFAULT_READ_AHEAD_DEPTH; /**< Maximum number of blocks that can be decoded in the background */
+            STFCompressionBuffer out_buf_; /**< Holds the block that is currently being read */
+            size_t out_buf_offset_ = 0; /**< Uncompressed offset of the start of out_buf_ */
+            bool eof_ = false; /**< Set when a read runs past the end of the decoded data */
+            std::vector<std::unique_ptr<DecodeSlot>> slots_; /**< Ring of decode slots */
+            size_t head_slot_ = 0; /**< Slot holding the oldest in-flight block */
+            size_t num_in_flight_ = 0; /**< Number of blocks currently being decoded */
+            std::mutex decode_mutex_; /**< Serializes access to the decoder from background jobs */
+            std::condition_variable decode_cv_; /**< Signaled whenever a background job finishes with the decoder */
+            size_t next_ticket_ = 0; /**< Ticket given to the next background job */
+            size_t next_decode_ticket_ = 0; /**< Ticket of the background job that may use the decoder next */
+
+            /**
+             * Decodes the next block into the given buffer
+             * \param buf Buffer to decode into
+             */
+            inline void decodeBlock_(STFCompressionBuffer& buf) {
+                buf.reset();
+                buf.setWritePtr(decoder_.decode(buf.get(), buf.size()));
+            }
+
+            /**
+             * Decodes the next block once all of the blocks before it have been decoded. Runs on a helper thread.
+             * \param slot Slot to decode into
+             */
+            void decodeBlockAsync_(DecodeSlot& slot) {
+                std::exception_ptr error;
+
+                {
+                    std::unique_lock<std::mutex> lock(decode_mutex_);
+                    decode_cv_.wait(lock, [this, &slot]() { return next_decode_ticket_ == slot.ticket; });
+
+                    try {
+                        decodeBlock_(slot.buf);
+                    }
+                    catch(...) {
+                        error = std::current_exception();
+                    }
+
+                    // The next job still has to be let through so that it doesn't wait forever
+                    ++next_decode_ticket_;
+                }
+                decode_cv_.notify_all();
+
+                if(STF_EXPECT_FALSE(error)) {
+                    std::rethrow_exception(error);
+                }
+            }
+
+            /**
+             * Asynchronously decodes blocks until the read-ahead window is full
+             */
+            inline void readAhead_() {
+                while(num_in_flight_ < slots_.size()) {
+                    auto& slot = *slots_[(head_slot_ + num_in_flight_) % slots_.size()];
+                    slot.ticket = next_ticket_++;
+                    slot.result = STFThreadPool::get().submit([this, &slot]() { this->decodeBlockAsync_(slot); });
+                    ++num_in_flight_;
+                }
+            }
+
+            /**
+             * Waits for all in-flight blocks to finish decoding and discards them. Errors from discarded blocks are
+             * ignored, since the decoder is either restarted or closed afterwards.
+             */
+            inline void waitForAllBlocks_() {
+                for(size_t i = 0; i < num_in_flight_; ++i) {
+                    slots_[(head_slot_ + i) % slots_.size()]->result.wait();
+                }
+                head_slot_ = 0;
+                num_in_flight_ = 0;
+            }
+
+            /**
+             * Moves on to the next decoded block. Returns false if there is no more data.
+             */
+            inline bool nextBlock_() {
+                out_buf_offset_ += out_buf_.end();
+                out_buf_.reset();
+
+                if(single_threaded_) {
+                    decodeBlock_(out_buf_);
+                }
+                else if(STF_EXPECT_TRUE(num_in_flight_)) {
+                    auto& slot = *slots_[head_slot_];
+                    head_slot_ = (head_slot_ + 1) % slots_.size();
+                    --num_in_flight_;
+                    slot.result.get();
+                    std::swap(out_buf_, slot.buf);
+
+                    // An empty block means the decoder has finished, so there's no point in starting more jobs
+                    if(!out_buf_.empty()) {
+                        readAhead_();
+                    }
+                }
+
+                return !out_buf_.empty();
+            }
+
+            /**
+             * Reads bytes from the decoded data, moving on to the next block as needed. Returns the number of bytes
+             * read.
+             * \param data Buffer to read into. If nullptr, the bytes are skipped.
+             * \param num_bytes Number of bytes to read
+             */
+            inline size_t readBytes_(uint8_t* data, const size_t num_bytes) {
+                size_t remaining = num_bytes;
+
+                while(remaining) {
+                    if(STF_EXPECT_FALSE(out_buf_.getReadPos() == out_buf_.end()) && !nextBlock_()) {
+                        eof_ = true;
+                        break;
+                    }
+
+                    const size_t read_pos = out_buf_.getReadPos();
+                    const size_t num_copied = std::min(remaining, out_buf_.end() - read_pos);
+                    if(data) {
+                        std::memcpy(data, out_buf_.get() + read_pos, num_copied);
+                        data += num_copied;
+                    }
+                    out_buf_.advanceReadPtr(num_copied);
+                    remaining -= num_copied;
+                }
+
+                return num_bytes - remaining;
+            }
+
+            /**
+             * Reads the specified number of T objects from the decoded data
+             * \param data Buffer to read data into
+             * \param num Number of elements to read
+             */
+            template<typename T>
+            inline size_t readElements_(void* data, const size_t num) {
+                return readBytes_(static_cast<uint8_t*>(data), num * sizeof(T)) / sizeof(T);
+            }
+
+            /**
+             * Moves the stream to the given uncompressed offset
+             * \param offset Offset to move to
+             */
+            inline void seekTo_(const size_t offset) {
+                eof_ = false;
+
+                // Seeking within the current block doesn't need the decoder
+                if(offset >= out_buf_offset_ && offset <= out_buf_offset_ + out_buf_.end()) {
+                    out_buf_.setReadPtr(offset - out_buf_offset_);
+                    return;
+                }
+
+                waitForAllBlocks_();
+
+                // Decoding forward from where the decoder stopped is cheaper than restarting it unless there's a
+                // restart point closer to the offset
+                size_t decoder_pos = decoder_.tell();
+                if(offset < decoder_pos || decoder_.getRestartOffset(offset) > decoder_pos) {
+                    stf_assert(seekable_, "Cannot seek backwards in a compressed trace that is being read from a pipe");
+                    decoder_pos = decoder_.restart(offset);
+                }
+
+                out_buf_.reset();
+                out_buf_offset_ = decoder_pos;
+                if(!single_threaded_) {
+                    readAhead_();
+                }
+                readBytes_(nullptr, offset - decoder_pos);
+            }
+
+            /**
+             * Closes the file
+             */
+            int close_() override {
+                if(!stream_) {
+                    return 0;
+                }
+
+                waitForAllBlocks_();
+                slots_.clear();
+                decoder_.close();
+                direct_read_buf_ = nullptr;
+                eof_ = false;
+
+                return STFIFstream::close_();
+            }
+
+            /**
+             * Reads a single uint8_t from the decoded data
+             * \param data Buffer to read data into
+             */
+            inline size_t fread_u8_(void* data) override final {
+                return readElements_<uint8_t>(data, 1);
+            }
+
+            /**
+             * Reads a single uint16_t from the decoded data
+             * \param data Buffer to read data into
+             */
+            inline size_t fread_u16_(void* data) override final {
+                return readElements_<uint16_t>(data, 1);
+            }
+
+            /**
+             * Reads multiple uint16_t's from the decoded data
+             * \param data Buffer to read data into
+             * \param num Number of elements to read
+             */
+            inline size_t fread_u16_(void* data, const size_t num) override final {
+                return readElements_<uint16_t>(data, num);
+            }
+
+            /**
+             * Reads a single uint32_t from the decoded data
+             * \param data Buffer to read data into
+             */
+            inline size_t fread_u32_(void* data) override final {
+                return readElements_<uint32_t>(data, 1);
+            }
+
+            /**
+             * Reads multiple uint32_t's from the decoded data
+             * \param data Buffer to read data into
+             * \param num Number of elements to read
+             */
+            inline size_t fread_u32_(void* data, const size_t num) override final {
+                return readElements_<uint32_t>(data, num);
+            }
+
+            /**
+             * Reads a single uint64_t from the decoded data
+             * \param data Buffer to read data into
+             */
+            inline size_t fread_u64_(void* data) override final {
+                return readElements_<uint64_t>(data, 1);
+            }
+
+            /**
+             * Reads multiple uint64_t's from the decoded data
+             * \param data Buffer to read data into
+             * \param num Number of elements to read
+             */
+            inline size_t fread_u64_(void* data, const size_t num) override final {
+                return readElements_<uint64_t>(data, num);
+            }
+
+            /**
+             * Reads a PackedContainerView by allocating and copying into a buffer of the correct size. Records can
+             * span decoded blocks, so the view can't point into the block.
+             * \param data PackedContainerView to read data into
+             * \param size Size of the PackedContainer pointed to by data
+             */
+            inline size_t freadPackedContainer_(PackedContainerViewBase& data, const size_t size) override final {
+                data.allocateView();
+                return readBytes_(static_cast<uint8_t*>(data.get()), size) == size;
+            }
+
+            /**
+             * Reads data from the decoded data
+             * \param data Buffer to read data into
+             * \param size Size of an element
+             * \param num Number of elements to read
+             */
+            inline size_t fread_(void* data, const size_t size, const size_t num) override final {
+                return readBytes_(static_cast<uint8_t*>(data), size * num) / size;
+            }
+
+            /**
+             * Skips over decoded data
+             * \param num_bytes Number of bytes to skip
+             */
+            inline void fskip_(const size_t num_bytes) override final {
+                readBytes_(nullptr, num_bytes);
+            }
+
+            /**
+             * Returns true if a read has run past the end of the decoded data
+             */
+            inline bool feof_() const override final {
+                return eof_;
+            }
+
+        public:
+            static constexpr size_t DEFAULT_BLOCK_SIZE = 1024 * 1024; /**< Default size of each decoded block */
+            static constexpr size_t DEFAULT_READ_AHEAD_DEPTH = 1; /**< Default number of blocks to decode ahead of the reader */
+
+            STFDecompressingIFstream() = default;
+
+            /**
+             * Constructs an STFDecompressingIFstream
+             *
+             * \param filename Filename to open
+             * \param single_threaded If true, decode synchronously instead of in the background
+             */
+            explicit STFDecompressingIFstream(const std::string_view filename, // cppcheck-suppress passedByValue
+                                              const bool single_threaded = false) :
+                STFDecompressingIFstream()
+            {
+                setSingleThreaded(single_threaded);
+                STFDecompressingIFstream::open(filename);
+            }
+
+            // Have to override the base class destructor to ensure that *our* close method gets called before destruction
+            inline ~STFDecompressingIFstream() override {
+                STF_FSTREAM_ACQUIRE_OPEN_CLOSE_LOCK();
+                STFDecompressingIFstream::close_();
+            }
+
+            /**
+             * Opens a file
+             * \param filename Filename to open
+             */
+            void open(const std::string_view filename) override final { // cppcheck-suppress passedByValue
+                STFIFstream::open(filename);
+
+                seekable_ = S_ISREG(getFileStat_().st_mode);
+                decoder_.open(stream_, seekable_);
+
+                out_buf_.initSize(block_size_);
+                out_buf_.reset();
+                out_buf_offset_ = 0;
+                eof_ = false;
+                direct_read_buf_ = &out_buf_;
+
+                head_slot_ = 0;
+                num_in_flight_ = 0;
+                next_ticket_ = 0;
+                next_decode_ticket_ = 0;
+                slots_.clear();
+
+                if(!single_threaded_) {
+                    for(size_t i = 0; i < read_ahead_depth_; ++i) {
+                        auto& slot = slots_.emplace_back(std::make_unique<DecodeSlot>());
+                        slot->buf.initSize(block_size_);
+                    }
+
+                    // Start decoding the first blocks
+                    readAhead_();
+                }
+            }
+
+            /**
+             * Sets whether blocks are decoded synchronously instead of in the background
+             * \note Once the stream is open this cannot be changed
+             * \param single_threaded If true, decode synchronously
+             */
+            void setSingleThreaded(const bool single_threaded) {
+                stf_assert(!stream_, "Must set threading mode before opening file.");
+                single_threaded_ = single_threaded;
+            }
+
+            /**
+             * Sets the maximum number of blocks that will be decoded ahead of the reader
+             * \note Once the stream is open this cannot be changed
+             * \param read_ahead_depth Number of blocks
+             */
+            void setReadAheadDepth(const size_t read_ahead_depth) {
+                stf_assert(!stream_, "Must set read-ahead depth before opening file.");
+                stf_assert(read_ahead_depth > 0, "Read-ahead depth must be at least 1");
+                read_ahead_depth_ = read_ahead_depth;
+            }
+
+            /**
+             * Returns whether the stream is valid
+             */
+            inline explicit operator bool() const override final {
+                return !feof_() && STFFstream::operator bool();
+            }
+
+            /**
+             * Rewinds the trace to the beginning
+             */
+            void rewind() override final {
+                seekTo_(trace_start_);
+                num_marker_records_ = 0;
+                pc_tracker_.forcePC(initial_pc_);
+            }
+
+            /**
+             * Gets the current uncompressed offset within the trace
+             */
+            size_t tell() const override final {
+                return out_buf_offset_ + out_buf_.getReadPos();
+            }
+
+            /**
+             * Seeks forward from an uncompressed offset by the given number of marker records
+             * \param offset Offset to seek from
+             * \param num_markers_at_offset Number of marker records present in the trace up to offset
+             * \param num_markers_to_seek Number of marker records to skip
+             */
+            void seekFromOffset(const size_t offset,
+                                const size_t num_markers_at_offset,
+                                const size_t num_markers_to_seek) override final {
+                seekTo_(offset);
+                num_marker_records_ = num_markers_at_offset;
+
+                if(num_markers_to_seek) {
+                    seek(num_markers_to_seek);
+                }
+            }
+    };
+
+    /**
+     * \typedef STFGzipIFstream
+     * Reads a gzip-compressed trace
+     */
+    using STFGzipIFstream = STFDecompressingIFstream<ZlibDecoder>;
+
+    /**
+     * \typedef STFXzIFstream
+     * Reads an xz-compressed trace
+     */
+    using STFXzIFstream = STFDecompressingIFstream<LZMADecoder>;
+} // end namespace stf
+
+#endif
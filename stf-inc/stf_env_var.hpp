@@ -1,10 +1,12 @@
 #ifndef __STF_ENV_VAR_HPP__
 #define __STF_ENV_VAR_HPP__
 
+#include <charconv>
 #include <cstdlib>
 #include <cstring>
 #include <set>
 #include <string>
+#include <type_traits>
 
 #include "stf_exception.hpp"
 
@@ -144,6 +146,62 @@ namespace stf {
                 return get();
             }
     };
+
+    /**
+     * \class STFIntegerEnvVar
+     * Interface for reading environment variables that should be interpreted as integer values
+     */
+    template<typename T>
+    class STFIntegerEnvVar : public STFEnvVar {
+        static_assert(std::is_integral_v<T>, "STFIntegerEnvVar only supports integral types");
+
+        private:
+            const T int_val_;
+
+            /**
+             * Parses the integer value of an environment variable
+             * \param var_name Name of the environment variable
+             * \param val String value of the variable
+             */
+            static inline T parse_(const std::string& var_name, const std::string& val) {
+                T result = 0;
+                const auto val_end = val.data() + val.size();
+                const auto [ptr, ec] = std::from_chars(val.data(), val_end, result);
+                stf_assert(ec == std::errc() && ptr == val_end,
+                           "Invalid value specified for " << var_name << ": " << val << ". Value must be an integer.");
+                return result;
+            }
+
+        public:
+            /**
+             * Constructs an STFIntegerEnvVar
+             * \param var_name Name of the environment variable
+             * \param default_value Default value that should be returned if the variable is unset
+             */
+            explicit STFIntegerEnvVar(const std::string& var_name,
+                                      const T default_value = 0) :
+                STFEnvVar(var_name, std::to_string(default_value)),
+                int_val_(parse_(var_name, val_))
+            {
+            }
+
+            /**
+             * Gets the value of the variable
+             * \returns Value of the variable, or the default value if it is unset
+             */
+            // cppcheck-suppress duplInheritedMember
+            inline T get() const {
+                return int_val_;
+            }
+
+            /**
+             * Integer conversion operator
+             * \returns Value of the variable, or the default value if it is unset
+             */
+            inline operator T() const {
+                return get();
+            }
+    };
 } // end namespace stf
 
 #endif
@@ -37,6 +37,18 @@ namespace stf {
              */
             using ConstructorArray = enums::EnumArray<Constructor, Enum>;
 
+            /**
+             * \typedef Skipper
+             * type of function used to skip over a registered record type without constructing it
+             */
+            using Skipper = void(*)(STFIFstream& strm);
+
+            /**
+             * \typedef SkipperArray
+             * Array of Skipper handles
+             */
+            using SkipperArray = enums::EnumArray<Skipper, Enum>;
+
             /**
              * Default constructor for unregistered objects. Just throws an exception.
              */
@@ -44,6 +56,29 @@ namespace stf {
                 invalid_descriptor_throw("Attempted to construct unregistered object");
             }
 
+            /**
+             * Default skipper for unregistered objects. Just throws an exception.
+             */
+            static inline void defaultSkipper_(STFIFstream&) {
+                invalid_descriptor_throw("Attempted to skip unregistered object");
+            }
+
+            /**
+             * Skips over an object of the given type. Types that define a static skip(STFIFstream&) method use it to
+             * advance past their encoding. All other types are constructed on the stack and immediately discarded,
+             * which still runs any side effects of reading them (e.g. PC tracking) but bypasses the object pool.
+             * \param strm STFIFstream to skip over
+             */
+            template<typename T>
+            static inline void skipObject_(STFIFstream& strm) {
+                if constexpr(requires { T::skip(strm); }) {
+                    T::skip(strm);
+                }
+                else {
+                    [[maybe_unused]] const T obj(strm);
+                }
+            }
+
             /**
              * Converts an enum into a value that can be used for array lookups. Can be specialized to handle cases where the enum values used in the STF are different from the ones used internally (e.g. STFRecord)
              * \param object_id ID to convert
@@ -129,6 +164,79 @@ namespace stf {
 
             static inline constexpr ConstructorArray constructors_ = populateConstructorArray_(); /**< Array mapping record descriptors to constructors */
 
+            /**
+             * Translates an object ID to the skipper for that object
+             */
+            template<Enum ObjectId, typename dummy_type = void>
+            struct skipper_generator {
+                static inline constexpr Skipper get();
+            };
+
+            template<typename dummy_type>
+            struct skipper_generator<Enum::__RESERVED_START, dummy_type> {
+                /**
+                 * get specialization for __RESERVED_START object ID.
+                 * Ensures we always throw an exception if we attempt to skip a __RESERVED_START ID.
+                 */
+                static inline constexpr Skipper get() {
+                    return &defaultSkipper_;
+                }
+            };
+
+            template<typename dummy_type>
+            struct skipper_generator<Enum::__RESERVED_END, dummy_type> {
+                /**
+                 * get specialization for __RESERVED_END object ID.
+                 * Ensures we always throw an exception if we attempt to skip a __RESERVED_END ID.
+                 */
+                static inline constexpr Skipper get() {
+                    return &defaultSkipper_;
+                }
+            };
+
+            /**
+             * Used to initialize the skippers_ array at compile time.
+             * Automatically iterates over all object IDs and adds their respective skip callback functions to the array.
+             */
+            static inline constexpr SkipperArray populateSkipperArray_() {
+                return enums::populateEnumArray<Skipper, Enum, &defaultSkipper_>(
+                    [](auto Index, SkipperArray skipper_array) {
+                        if constexpr(const auto start_idx = convertToIndex_(Index); start_idx < skipper_array.size()) {
+                            skipper_array[start_idx] = skipper_generator<Index>::get();
+                        }
+                        return skipper_array;
+                    }
+                );
+            }
+
+            static inline constexpr SkipperArray skippers_ = populateSkipperArray_(); /**< Array mapping record descriptors to skippers */
+
+            /**
+             * Gets the skipper for the given object ID
+             * \param object_id ID of object to skip
+             */
+            static Skipper getSkipper_(const Enum object_id);
+
+            /**
+             * Skips over the next object in the stream
+             * \param strm STFIFstream to skip over
+             */
+            __attribute__((always_inline))
+            inline void skip_(STFIFstream& strm) const {
+                Enum object_id;
+                strm.readObjectId_(object_id);
+                try {
+                    getSkipper_(object_id)(strm);
+                    strm.readCallback<typename PoolType::base_type>();
+                }
+                catch(const InvalidDescriptorException&) {
+                    invalid_descriptor_throw("Attempted to skip unregistered object: " << object_id);
+                }
+                catch(const std::out_of_range&) {
+                    invalid_descriptor_throw("Attempted to skip invalid object: " << object_id);
+                }
+            }
+
             /**
              * Gets the constructor for the given object ID
              * \param object_id ID of object to construct
@@ -142,7 +250,7 @@ namespace stf {
             __attribute__((always_inline))
             inline PtrType construct_(STFIFstream& strm) const {
                 Enum object_id;
-                strm >> object_id;
+                strm.readObjectId_(object_id);
                 return construct_(strm, object_id);
             }
 
@@ -175,6 +283,15 @@ namespace stf {
             static inline PtrType construct(STFIFstream& strm, const Enum object_id) {
                 return get_().construct_(strm, object_id);
             }
+
+            /**
+             * Skips over the next STFObject in a trace without allocating it from the object pool
+             * \param strm Stream to skip over
+             */
+            __attribute__((always_inline))
+            static inline void skip(STFIFstream& strm) {
+                get_().skip_(strm);
+            }
     };
 } // end namespace stf
 
@@ -190,6 +307,10 @@ namespace stf {
         return constructors_[convertToIndex_(object_id)]; \
     } \
     template<> \
+    object_type::factory_type::Skipper object_type::factory_type::getSkipper_(const object_type::factory_type::ConstructionIdType object_id) { \
+        return skippers_[convertToIndex_(object_id)]; \
+    } \
+    template<> \
     object_type::pool_type::DeleterFuncType object_type::pool_type::getDeleter_(const size_t object_id) { \
         return deleters_[object_id]; \
     }
@@ -236,6 +357,13 @@ namespace stf {
     }; \
     template<> \
     template<> \
+    struct object_type::factory_type::skipper_generator<ObjectIdConverter::toTrace(cls::getTypeId())> { \
+        static inline constexpr object_type::factory_type::Skipper get() { \
+            return &object_type::factory_type::skipObject_<cls>; \
+        } \
+    }; \
+    template<> \
+    template<> \
     struct object_type::pool_type::deleter_generator<cls::getTypeId()> { \
         static inline constexpr object_type::pool_type::DeleterFuncType get() { \
             return &object_type::pool_type::deleter_func_<cls>; \
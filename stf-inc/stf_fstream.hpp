@@ -190,8 +190,9 @@ namespace stf {
                 stf_assert(!stream_, "Stream is already open. Call close() first.");
 
                 // special handling for stdin/stdout
-                if(filename.compare("-") == 0) {
-                    if(rw_mode.compare("rb") == 0) {
+                // Compressed traces use "-.zstf" so that the file type can still be determined from the extension
+                if(filename.compare("-") == 0 || filename.compare("-.zstf") == 0) {
+                    if(rw_mode.compare("rb") == 0 || rw_mode.compare("r") == 0) {
                         stream_ = stdin;
                     }
                     else if(rw_mode.compare("wb") == 0) {
@@ -224,6 +225,21 @@ namespace stf {
                 return pc_tracker_.getPC();
             }
 
+            /**
+             * Gets the PC of the next instruction
+             */
+            inline uint64_t getNextPC() const {
+                return pc_tracker_.getNextPC();
+            }
+
+            /**
+             * Forces the PC of the next instruction to the given value
+             * \param pc PC to set
+             */
+            inline void forcePC(const uint64_t pc) {
+                pc_tracker_.forcePC(pc);
+            }
+
             /**
              * Updates the PC tracker with the given record
              * \param rec Record to update PC tracker with
@@ -233,6 +249,16 @@ namespace stf {
                 pc_tracker_.track(rec);
             }
 
+            /**
+             * Updates the PC tracker with a record that was skipped without being constructed
+             * \tparam RecordType Type of the skipped record
+             * \param addr Address held by the record. Unused for opcode records.
+             */
+            template<typename RecordType>
+            inline void trackSkippedPC(const uint64_t addr = 0) {
+                pc_tracker_.template trackSkipped<RecordType>(addr);
+            }
+
             /**
              * Callback for when any STFObject is read from the trace
              */
@@ -1,17 +1,24 @@
 #ifndef __STF_IFSTREAM_HPP__
 #define __STF_IFSTREAM_HPP__
 
+#include <algorithm>
 #include <array>
 #include <cstring>
 #include <memory>
 #include <type_traits>
 #include <vector>
 
+#include "stf_chunk_cache.hpp"
+#include "stf_chunk_state.hpp"
+#include "stf_chunk_summary.hpp"
+#include "stf_compressed_chunk.hpp"
+#include "stf_compression_buffer.hpp"
 #include "stf_enum_utils.hpp"
 #include "stf_fstream.hpp"
 #include "stf_factory_decl.hpp"
 #include "stf_packed_container.hpp"
 #include "stf_protocol_fields.hpp"
+#include "stf_shared_chunk_cache.hpp"
 #include "stf_vector_view.hpp"
 #include "type_utils.hpp"
 
@@ -27,6 +34,8 @@ namespace stf {
         protected:
             size_t trace_start_ = 0; /**< Trace file offset pointing to the first record */
             uint64_t initial_pc_ = 0; /**< Initial PC in the trace */
+            bool use_record_views_ = false; /**< If true, records may view the stream's buffers instead of copying them */
+            STFCompressionBuffer* direct_read_buf_ = nullptr; /**< If set, the in-memory buffer that the stream reads from. Objects are decoded straight out of it instead of through the virtual read methods. */
 
             /**
              * Virtual method that reads arbitrary buffers from a file
@@ -117,6 +126,34 @@ namespace stf {
                 return STFIFstream::fread_(data.get(), size, 1);
             }
 
+            /**
+             * Virtual method that gets a view of the next num_bytes bytes in the stream and skips over them. The view
+             * shares ownership of the memory it points to. Streams that can't provide views return nullptr without
+             * consuming anything, in which case the caller should read the data normally.
+             * \param num_bytes Number of bytes to view
+             */
+            virtual inline std::shared_ptr<const uint8_t> freadView_(const size_t num_bytes) {
+                (void)num_bytes;
+                return nullptr;
+            }
+
+            /**
+             * Virtual method that skips over data without returning it
+             * Can be overridden for e.g. transparent decompression
+             * \param num_bytes Number of bytes to skip
+             */
+            virtual inline void fskip_(size_t num_bytes) {
+                // Read into a scratch buffer instead of calling fseek so that we can still skip through pipes
+                std::array<uint8_t, 64> scratch;
+                while(num_bytes) {
+                    const size_t chunk_size = std::min(num_bytes, scratch.size());
+                    if(STF_EXPECT_FALSE(STFIFstream::fread_(scratch.data(), sizeof(uint8_t), chunk_size) != chunk_size)) {
+                        break;
+                    }
+                    num_bytes -= chunk_size;
+                }
+            }
+
             /**
              * Virtual method that indicates whether we have reached the end of the stream
              */
@@ -142,12 +179,32 @@ namespace stf {
             }
 
             /**
-             * Reads data into an arbitrary pointer
+             * Gets a pointer to the next num_bytes bytes in direct_read_buf_ and skips over them. Returns nullptr
+             * without consuming anything if the stream doesn't have a direct read buffer or the data doesn't fit in
+             * what is left of it, in which case the caller should fall back to the virtual read methods.
+             * \param num_bytes Number of bytes to read
+             */
+            inline uint8_t* directReadPtr_(const size_t num_bytes) {
+                if(!direct_read_buf_) {
+                    return nullptr;
+                }
+
+                const size_t read_pos = direct_read_buf_->getReadPos();
+                if(STF_EXPECT_FALSE(read_pos + num_bytes > direct_read_buf_->end())) {
+                    return nullptr;
+                }
+
+                direct_read_buf_->advanceReadPtr(num_bytes);
+                return direct_read_buf_->get() + read_pos;
+            }
+
+            /**
+             * Reads data through the virtual read methods
              * \param data Buffer to read into
              * \param size Number of elements to read
              */
             template<typename T>
-            inline void readIntoPtr_(T* data, const size_t size) {
+            inline void readIntoPtrIndirect_(T* data, const size_t size) {
                 switch(sizeof(T)) {
                     case sizeof(uint16_t):
                         fread_u16_(data, size);
@@ -165,11 +222,11 @@ namespace stf {
             }
 
             /**
-             * Reads a single data element into an arbitrary pointer
+             * Reads a single data element through the virtual read methods
              * \param data Buffer to read into
              */
             template<typename T>
-            inline void readIntoPtr_(T* data) {
+            inline void readIntoPtrIndirect_(T* data) {
                 switch(sizeof(T)) {
                     case sizeof(uint8_t):
                         fread_u8_(data);
@@ -201,12 +258,54 @@ namespace stf {
 
                         // T is an unusual size, so just do a byte-by-byte copy
                         else {
-                            readIntoPtr_(data, 1);
+                            readIntoPtrIndirect_(data, 1);
                         }
                         break;
                 }
             }
 
+            /**
+             * Reads data into an arbitrary pointer
+             * \param data Buffer to read into
+             * \param size Number of elements to read
+             */
+            template<typename T>
+            inline void readIntoPtr_(T* data, const size_t size) {
+                if(const auto read_ptr = directReadPtr_(size * sizeof(T))) {
+                    std::memcpy(data, read_ptr, size * sizeof(T));
+                    return;
+                }
+
+                readIntoPtrIndirect_(data, size);
+            }
+
+            /**
+             * Reads a single data element into an arbitrary pointer
+             * \param data Buffer to read into
+             */
+            template<typename T>
+            inline void readIntoPtr_(T* data) {
+                if(const auto read_ptr = directReadPtr_(sizeof(T))) {
+                    std::memcpy(data, read_ptr, sizeof(T));
+                    return;
+                }
+
+                readIntoPtrIndirect_(data);
+            }
+
+            /**
+             * Reads the ID at the start of an object. IDs always go through the virtual read methods so that the
+             * stream checks once per object whether it has reached the end of the trace. The rest of the object can
+             * then be decoded directly from the stream's buffer.
+             * \param object_id Value is read into this variable
+             */
+            template<typename T>
+            inline void readObjectId_(T& object_id) {
+                enums::int_t<T> val = 0;
+                readIntoPtrIndirect_(&val);
+                object_id = static_cast<T>(val);
+            }
+
             /**
              * Reads an enum value
              */
@@ -254,6 +353,11 @@ namespace stf {
              */
             template<typename ... Ts>
             inline STFIFstream& operator>>(PackedContainerView<Ts...>& data) {
+                if(const auto read_ptr = directReadPtr_(PackedContainerView<Ts...>::size())) {
+                    data.setView(read_ptr);
+                    return *this;
+                }
+
                 freadPackedContainer_(data, PackedContainerView<Ts...>::size());
                 return *this;
             }
@@ -406,6 +510,23 @@ namespace stf {
                 }
             }
 
+            /**
+             * Sets whether records read from this stream may hold views into its buffers instead of copying their
+             * data. Only compressed streams support views - a view keeps its decompressed chunk alive for as long as
+             * the record that holds it. Records read from other streams are always copied.
+             * \param use_record_views If true, enable record views
+             */
+            inline void setUseRecordViews(const bool use_record_views) {
+                use_record_views_ = use_record_views;
+            }
+
+            /**
+             * Returns whether records read from this stream may hold views into its buffers
+             */
+            inline bool usesRecordViews() const {
+                return use_record_views_;
+            }
+
             /**
              * Skips the stream forward by the given number of marker records
              * \param num_marker_records Number of marker records to skip
@@ -435,6 +556,44 @@ namespace stf {
              */
             virtual void setTraceStart();
 
+            /**
+             * Gets the summaries for each compressed chunk, or an empty vector if the stream doesn't have them
+             */
+            virtual const std::vector<ChunkSummary>& getChunkSummaries() const;
+
+            /**
+             * Gets the state at the start of each compressed chunk, or an empty vector if the stream doesn't have it
+             */
+            virtual const std::vector<ChunkStateSnapshot>& getChunkStateSnapshots() const;
+
+            /**
+             * Gets the number of compressed chunks in the stream. Uncompressed streams are treated as a single chunk.
+             */
+            virtual size_t getNumChunks() const;
+
+            /**
+             * Gets the number of marker records in each compressed chunk, or 0 if the stream isn't chunked
+             */
+            virtual size_t getChunkSize() const;
+
+            /**
+             * Reads a compressed chunk without decompressing it. Returns false if the stream isn't chunked, the chunk
+             * is the last one in the trace, or the trace is being read from a pipe.
+             * \param chunk_idx Index of the chunk to read
+             * \param chunk Receives the chunk
+             */
+            virtual bool readCompressedChunk(size_t chunk_idx, CompressedChunk& chunk);
+
+            /**
+             * Gets the decompressed chunk cache statistics. Streams without a chunk cache report an empty one.
+             */
+            virtual STFChunkCache::Stats getChunkCacheStats() const;
+
+            /**
+             * Gets the shared memory chunk cache statistics. Streams without a shared chunk cache report an empty one.
+             */
+            virtual STFSharedChunkCache::Stats getSharedChunkCacheStats() const;
+
             /**
              * Sets the initial PC in the trace
              */
@@ -0,0 +1,86 @@
+#ifndef __STF_INDEX_SIDECAR_HPP__
+#define __STF_INDEX_SIDECAR_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+
+namespace stf {
+    /**
+     * \class STFIndexSidecar
+     *
+     * Saves an STFIndexer index to a file next to the trace (<trace>.stfidx) so that later opens can skip the index
+     * scan. The sidecar records the size and modification time of the trace it was built from, and is ignored if
+     * either of them has changed.
+     *
+     * Sidecars are disabled by default, and can be enabled by setting the STF_INDEX_SIDECAR environment variable.
+     */
+    class STFIndexSidecar {
+        public:
+            /**
+             * \struct Entry
+             * Position in the trace where an indexed item starts
+             */
+            struct Entry {
+                size_t offset = 0; /**< Trace offset */
+                uint64_t pc = 0; /**< PC of the item */
+            };
+
+            /**
+             * \typedef IndexMap
+             * Maps marker record indices to trace positions
+             */
+            using IndexMap = std::map<size_t, Entry>;
+
+            static constexpr uint32_t MAGIC = 0x58444953; /**< Marks the start of a sidecar file ("SIDX") */
+            static constexpr uint32_t VERSION = 1; /**< Version of the sidecar file format */
+
+        private:
+            std::string trace_; /**< Trace file name */
+            bool trace_valid_ = false; /**< Set to true if the trace could be stat'ed */
+            uint64_t trace_size_ = 0; /**< Size of the trace when the sidecar was opened */
+            int64_t trace_mtime_sec_ = 0; /**< Modification time of the trace when the sidecar was opened (seconds) */
+            int64_t trace_mtime_nsec_ = 0; /**< Modification time of the trace when the sidecar was opened (nanoseconds) */
+
+        public:
+            STFIndexSidecar() = default;
+
+            /**
+             * Constructs an STFIndexSidecar, recording the current size and modification time of the trace
+             * \param trace Trace file name
+             */
+            explicit STFIndexSidecar(std::string_view trace);
+
+            /**
+             * Returns whether sidecars are enabled by the STF_INDEX_SIDECAR environment variable
+             */
+            static bool enabledByDefault();
+
+            /**
+             * Gets the sidecar file name for the given trace
+             * \param trace Trace file name
+             */
+            static std::string getPath(std::string_view trace);
+
+            /**
+             * Loads the index from the sidecar file
+             * \param granularity Granularity of the index
+             * \param index_map Map that receives the index entries
+             * \returns True if the sidecar exists and matches the trace
+             */
+            bool load(size_t granularity, IndexMap& index_map) const;
+
+            /**
+             * Saves the index to the sidecar file. The file is written to a temporary location first and renamed into
+             * place, so that concurrent readers never see a partial sidecar. Failures (e.g. a read-only directory)
+             * are ignored.
+             * \param granularity Granularity of the index
+             * \param index_map Index entries to save
+             */
+            void save(size_t granularity, const IndexMap& index_map) const;
+    };
+} // end namespace stf
+
+#endif
@@ -9,6 +9,7 @@
 #include <thread>
 
 #include "stf_exception.hpp"
+#include "stf_index_sidecar.hpp"
 #include "stf_record.hpp"
 #include "stf_reader_base.hpp"
 #include "stf_valid_value.hpp"
@@ -17,6 +18,12 @@ namespace stf {
     /**
      * \class STFIndexer
      * \brief Generates an index of a trace for the given reader type to provide random-access seeking
+     *
+     * If sidecars are enabled (see STFIndexSidecar), a completed index is saved next to the trace and reused the
+     * next time the trace is opened instead of scanning it again.
+     *
+     * Compressed traces are not scanned at all, since their chunk index already provides random access. Readers
+     * should seek them directly when usesChunkIndex() returns true.
      */
     template<typename ReaderType, size_t granularity = 1024>
     class STFIndexer {
@@ -24,7 +31,7 @@ namespace stf {
                       "ReaderType must inherit from STFReaderBase");
 
         private:
-            using IndexMap = std::map<size_t, size_t>;
+            using IndexMap = STFIndexSidecar::IndexMap;
 
         public:
             /**
@@ -41,7 +48,10 @@ namespace stf {
             IndexMap index_map_;
             stf::ValidValue<size_t> last_index_;
             bool scan_done_ = false;
+            bool uses_chunk_index_ = false; /**< Set to true if the trace is seeked with its own chunk index */
             std::atomic_bool stop_reading_ = false; /**< Stops the reader thread if set to true */
+            bool use_sidecar_ = STFIndexSidecar::enabledByDefault(); /**< If true, the index is loaded from and saved to a sidecar file */
+            STFIndexSidecar sidecar_; /**< Sidecar for the current trace */
 
             void scan_(const std::string& filename) {
                 stf_assert(!scan_done_);
@@ -49,6 +59,8 @@ namespace stf {
                 ReaderType reader(filename);
                 stf::STFRecord::UniqueHandle rec;
                 size_t cur_offset = reader.getCurrentOffset();
+                uint64_t cur_pc = reader.getNextPC();
+                bool reached_end = false;
 
                 while(STF_EXPECT_TRUE(!stop_reading_.load(std::memory_order_relaxed))) {
                     try {
@@ -58,15 +70,18 @@ namespace stf {
                             if(const auto index = reader.numMarkerRecordsRead() - 1; index % granularity == 0) {
                                 {
                                     std::lock_guard<std::mutex> guard(index_map_mutex_);
-                                    index_map_.emplace(index, cur_offset);
+                                    index_map_.emplace(index, STFIndexSidecar::Entry{cur_offset, cur_pc});
                                     last_index_ = index;
                                 }
                                 sync_cv_.notify_one();
-                                cur_offset = reader.getCurrentOffset();
                             }
+                            // The next item starts after this marker record
+                            cur_offset = reader.getCurrentOffset();
+                            cur_pc = reader.getNextPC();
                         }
                     }
                     catch(const stf::EOFException&) {
+                        reached_end = true;
                         break;
                     }
                 }
@@ -77,6 +92,12 @@ namespace stf {
                 }
 
                 sync_cv_.notify_one();
+
+                // The index map is no longer modified once the scan is done. An aborted scan has an incomplete
+                // index, so it isn't saved.
+                if(use_sidecar_ && reached_end) {
+                    sidecar_.save(granularity, index_map_);
+                }
             }
 
             inline const_iterator findNearestEntryUnsafe_(const size_t index) const {
@@ -107,15 +128,46 @@ namespace stf {
             /**
              * \brief Opens and begins indexing the given trace
              * \param trace Trace to index
+             * \param chunked If true, the trace has a chunk index that can be used instead of scanning it
              */
-            inline void open(const std::string_view trace) {
+            inline void open(const std::string_view trace, const bool chunked = false) {
                 scan_done_ = false;
                 stop_reading_ = false;
+                index_map_.clear();
+                last_index_.invalidate();
+                uses_chunk_index_ = chunked;
+
+                if(chunked) {
+                    scan_done_ = true;
+                    return;
+                }
+
+                if(use_sidecar_) {
+                    sidecar_ = STFIndexSidecar(trace);
+                    if(sidecar_.load(granularity, index_map_)) {
+                        if(!index_map_.empty()) {
+                            last_index_ = index_map_.rbegin()->first;
+                        }
+                        scan_done_ = true;
+                        return;
+                    }
+                }
+
                 reader_thread_ = std::thread(&STFIndexer::scan_, this, std::string(trace));
             }
 
             /**
-             * \brief Closes the indexer, aborting any in-flight indexing
+             * \brief Sets whether the index should be loaded from and saved to a sidecar file. Takes effect the next
+             * time a trace is opened.
+             * \param use_sidecar If true, enables the sidecar
+             */
+            inline void setUseSidecar(const bool use_sidecar) {
+                use_sidecar_ = use_sidecar;
+            }
+
+            /**
+             * \brief Closes the indexer, aborting any in-flight indexing. The sidecar is only written if the scan
+             * had already finished.
              */
             void close() {
                 if(!scan_done_ || reader_thread_.joinable()) {
@@ -128,6 +180,11 @@ namespace stf {
                 close();
             }
 
+            /**
+             * \brief Returns true if the trace should be seeked with its own chunk index instead of this index
+             */
+            bool usesChunkIndex() const { return uses_chunk_index_; }
+
             /**
              * \brief Returns an iterator to the end of the internal index map
              */
@@ -171,7 +228,7 @@ namespace stf {
             bool scanComplete() const { return scan_done_; }
 
             /**
-             * \brief Returns how many items have been scanned so far
+             * \brief Returns how many items have been scanned so far. Always 0 for traces that use their chunk index.
              */
             size_t numItemsScanned() const { return last_index_.valid() ? last_index_.get() + 1 : 0; }
     };
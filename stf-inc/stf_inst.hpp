@@ -7,6 +7,7 @@
 #include <numeric>
 #include <queue>
 #include <set>
+#include <span>
 #include <type_traits>
 #include <vector>
 
@@ -27,7 +28,7 @@
 #include "util.hpp"
 
 namespace stf {
-    template<bool Indexed, typename FilterType>
+    template<bool Indexed, typename FilterType, bool KeepRecords>
     class STFInstReaderBase;
 
     namespace delegates {
@@ -460,19 +461,27 @@ namespace stf {
                 return rec_->getVectorData();
             }
 
+            /**
+             * Gets the vector operand value without copying it if the record is a view into the trace
+             */
+            inline std::span<const InstRegRecord::ValueType> getVectorValueView() const {
+                return rec_->getVectorDataView();
+            }
+
             /**
              * Gets the vector element value by the given index
              */
             template<typename ElementType>
             inline ElementType getVectorValueAt(size_t idx) const
             {
-                stf_assert((idx*sizeof(ElementType)/sizeof(InstRegRecord::VectorType::value_type)) < rec_->getVectorData().size(),
+                const auto data = rec_->getVectorDataView();
+                stf_assert((idx*sizeof(ElementType)/sizeof(InstRegRecord::ValueType)) < data.size(),
                             "Invalid element index to access vector data");
-                if constexpr (std::is_same_v<ElementType, InstRegRecord::VectorType::value_type>) {
-                    return rec_->getVectorData()[idx];
+                if constexpr (std::is_same_v<ElementType, InstRegRecord::ValueType>) {
+                    return data[idx];
                 }
                 else {
-                    return reinterpret_cast<const ElementType*>(rec_->getVectorData().data())[idx];
+                    return reinterpret_cast<const ElementType*>(data.data())[idx];
                 }
             }
 
@@ -1952,6 +1961,12 @@ namespace stf {
              */
             inline uint8_t opcodeSize() const { return opcode_size_; }
 
+            /**
+             * \brief Instruction flags
+             * \return Bitwise OR of INSTFLAGS values
+             */
+            inline enums::int_t<INSTFLAGS> flags() const { return inst_flags_; }
+
             /**
              * \brief whether the information in this instance is valid
              * \return True if valid
@@ -1996,6 +2011,208 @@ namespace stf {
             }
     };
 
+    /**
+     * \class STFLightweightInst
+     * \brief STFInst that stores copies of its operand, memory access and event records instead of pointing to
+     * the original records. Used by readers that don't keep the original records, so the record-keeping STFInst
+     * doesn't have to carry the extra storage.
+     */
+    class STFLightweightInst final : public STFInst {
+        private:
+            friend class delegates::STFInstDelegate;
+
+            // Copies of the records that operands, memory accesses and events point to.
+            // Capacity is kept between instructions.
+            std::vector<InstRegRecord> operand_copies_; /**< Source and destination operand records */
+            std::vector<InstRegRecord> reg_state_copies_; /**< Register state records */
+            std::vector<InstMemAccessRecord> mem_access_copies_; /**< Memory access records */
+            std::vector<InstMemContentRecord> mem_content_copies_; /**< Memory content records */
+            std::vector<size_t> mem_content_owners_; /**< Index of the access in mem_access_copies_ that each content record belongs to */
+            std::vector<EventRecord> event_copies_; /**< Event records */
+            std::vector<EventPCTargetRecord> event_target_copies_; /**< Event target records */
+            std::vector<size_t> event_target_owners_; /**< Index of the event in events_ that each target record belongs to */
+
+            /**
+             * Appends a copy of a record to a vector
+             * \param copies Vector to append to
+             * \param rec Record to copy
+             * \returns true if the vector reallocated, invalidating any pointers to the records already in it
+             */
+            template<typename RecordType>
+            static inline bool appendCopy_(std::vector<RecordType>& copies, const RecordType& rec) {
+                const auto old_data = copies.data();
+                copies.emplace_back(rec);
+                return STF_EXPECT_FALSE(copies.data() != old_data);
+            }
+
+            /**
+             * Repoints the source and destination operands at their copied records
+             */
+            inline void relinkOperands_() {
+                register_records_[REG_SOURCE_IDX].clear();
+                register_records_[REG_DEST_IDX].clear();
+                for(const auto& rec: operand_copies_) {
+                    appendOperand_(rec.getOperandType(), rec);
+                }
+            }
+
+            /**
+             * Repoints the register state operands at their copied records
+             */
+            inline void relinkRegStates_() {
+                auto& reg_state_records = register_records_[REG_STATE_IDX];
+                reg_state_records.clear();
+                for(const auto& rec: reg_state_copies_) {
+                    appendOperand_(reg_state_records, rec);
+                }
+            }
+
+            /**
+             * Appends an operand that points to a copy of the given record
+             * \param operand_type Operand type
+             * \param rec Record to copy
+             */
+            inline void appendOperandCopy_(const Registers::STF_REG_OPERAND_TYPE operand_type, const InstRegRecord& rec) {
+                if(STF_EXPECT_FALSE(operand_type == Registers::STF_REG_OPERAND_TYPE::REG_STATE)) {
+                    if(appendCopy_(reg_state_copies_, rec)) {
+                        relinkRegStates_();
+                        return;
+                    }
+                    appendOperand_(operand_type, reg_state_copies_.back());
+                    return;
+                }
+
+                if(appendCopy_(operand_copies_, rec)) {
+                    relinkOperands_();
+                    return;
+                }
+                appendOperand_(operand_type, operand_copies_.back());
+            }
+
+            /**
+             * Repoints every memory access at its copied records
+             */
+            inline void relinkMemAccesses_() {
+                for(auto& m: mem_access_records_) {
+                    m.clear();
+                }
+
+                size_t content_idx = 0;
+                for(size_t i = 0; i < mem_access_copies_.size(); ++i) {
+                    const auto& access = mem_access_copies_[i];
+                    appendMemAccess_(access.getType(), &access);
+                    for(; content_idx < mem_content_copies_.size() && mem_content_owners_[content_idx] == i; ++content_idx) {
+                        last_mem_access_->appendContent(&mem_content_copies_[content_idx]);
+                    }
+                }
+            }
+
+            /**
+             * Appends a memory access that points to a copy of the given record
+             * \param type Type of memory access
+             * \param rec Record to copy
+             */
+            inline void appendMemAccessCopy_(const INST_MEM_ACCESS type, const InstMemAccessRecord& rec) {
+                if(appendCopy_(mem_access_copies_, rec)) {
+                    relinkMemAccesses_();
+                    return;
+                }
+                appendMemAccess_(type, &mem_access_copies_.back());
+            }
+
+            /**
+             * Appends a copy of the given content record to the last memory access
+             * \param rec Record to copy
+             */
+            inline void appendMemContentCopy_(const InstMemContentRecord& rec) {
+                stf_assert(last_mem_access_, "Attempted to attach a memory content record without an accompanying access record");
+                mem_content_owners_.emplace_back(mem_access_copies_.size() - 1);
+                if(appendCopy_(mem_content_copies_, rec)) {
+                    relinkMemAccesses_();
+                    return;
+                }
+                appendMemContent_(&mem_content_copies_.back());
+            }
+
+            /**
+             * Repoints every event at its copied records
+             */
+            inline void relinkEvents_() {
+                events_.clear();
+                for(const auto& event: event_copies_) {
+                    events_.emplace_back(&event);
+                }
+                for(size_t i = 0; i < event_target_copies_.size(); ++i) {
+                    events_[event_target_owners_[i]].setTarget(&event_target_copies_[i]);
+                }
+            }
+
+            /**
+             * Appends an event that points to a copy of the given record
+             * \param rec Record to copy
+             */
+            inline void appendEventCopy_(const EventRecord& rec) {
+                if(appendCopy_(event_copies_, rec)) {
+                    relinkEvents_();
+                    return;
+                }
+                events_.emplace_back(&event_copies_.back());
+            }
+
+            /**
+             * Sets the last event's target to a copy of the given record
+             * \param rec Record to copy
+             */
+            inline void setLastEventTargetCopy_(const EventPCTargetRecord& rec) {
+                event_target_owners_.emplace_back(events_.size() - 1);
+                if(appendCopy_(event_target_copies_, rec)) {
+                    relinkEvents_();
+                    return;
+                }
+                events_.back().setTarget(&event_target_copies_.back());
+            }
+
+            /**
+             * Resets the instruction and its record copies so that it can be reinitialized by an STFInstReader
+             */
+            inline void reset_() {
+                STFInst::reset_();
+                operand_copies_.clear();
+                reg_state_copies_.clear();
+                // Same as the register state operands in STFInst::reset_
+                if(STF_EXPECT_FALSE(reg_state_copies_.capacity() > OPERAND_VEC_SIZE)) {
+                    reg_state_copies_.shrink_to_fit();
+                }
+                mem_access_copies_.clear();
+                mem_content_copies_.clear();
+                mem_content_owners_.clear();
+                event_copies_.clear();
+                event_target_copies_.clear();
+                event_target_owners_.clear();
+            }
+
+        public:
+            /**
+             * Default constructor
+             */
+            STFLightweightInst() = default;
+
+            /**
+             * Move constructor
+             */
+            STFLightweightInst(STFLightweightInst&&) = default;
+
+            // Operands, memory accesses and events point into the record copies, so copying would leave them
+            // pointing at the source instruction
+            STFLightweightInst(const STFLightweightInst&) = delete;
+            STFLightweightInst& operator=(const STFLightweightInst&) = delete;
+
+            /**
+             * Move assignment operator
+             */
+            STFLightweightInst& operator=(STFLightweightInst&&) = default;
+    };
+
     /**
      * Gets physical address of access
      */
@@ -2026,6 +2243,19 @@ namespace stf {
                     inst.appendMemAccess_(type, access_record);
                 }
 
+                /**
+                 * Appends a memory access that points to a copy of the access record
+                 * \param inst STFLightweightInst to modify
+                 * \param type Type of memory access
+                 * \param access_record Memory access record
+                 */
+                __attribute__((always_inline))
+                static inline void appendMemAccess_(STFLightweightInst& inst,
+                                                    const INST_MEM_ACCESS type,
+                                                    const STFRecord* const access_record) {
+                    inst.appendMemAccessCopy_(type, access_record->as<InstMemAccessRecord>());
+                }
+
                 /**
                  * Appends a memory access
                  * \param inst STFInst to modify
@@ -2052,6 +2282,17 @@ namespace stf {
                     inst.appendMemContent_(content_record);
                 }
 
+                /**
+                 * Appends a copy of additional content to the last memory access record
+                 * \param inst STFLightweightInst to modify
+                 * \param content_record Memory content record
+                 */
+                __attribute__((always_inline))
+                static inline void appendMemContent_(STFLightweightInst& inst,
+                                                     const STFRecord* const content_record) {
+                    inst.appendMemContentCopy_(content_record->as<InstMemContentRecord>());
+                }
+
                 /**
                  * Sets an instruction flag
                  * \param inst STFInst to modify
@@ -2072,6 +2313,16 @@ namespace stf {
                     inst.events_.emplace_back(rec);
                 }
 
+                /**
+                 * Appends an event that points to a copy of the event record
+                 * \param inst STFLightweightInst to modify
+                 * \param rec Event record to append
+                 */
+                __attribute__((always_inline))
+                static inline void appendEvent_(STFLightweightInst& inst, const STFRecord* const rec) {
+                    inst.appendEventCopy_(rec->as<EventRecord>());
+                }
+
                 /**
                  * Sets the last event's target info
                  * \param inst STFInst to modify
@@ -2082,6 +2333,16 @@ namespace stf {
                     return inst.events_.back().setTarget(rec);
                 }
 
+                /**
+                 * Sets the last event's target info to a copy of the target record
+                 * \param inst STFLightweightInst to modify
+                 * \param rec Event target record to add
+                 */
+                __attribute__((always_inline))
+                static inline void setLastEventTarget_(STFLightweightInst& inst, const STFRecord* const rec) {
+                    inst.setLastEventTargetCopy_(rec->as<EventPCTargetRecord>());
+                }
+
                 /**
                  * Marks the instruction as a taken branch
                  * \param inst STFInst to modify
@@ -2102,6 +2363,15 @@ namespace stf {
                     inst.reset_();
                 }
 
+                /**
+                 * Resets the instruction and its record copies to their initial state
+                 * \param inst STFLightweightInst to reset
+                 */
+                __attribute__((always_inline))
+                static inline void reset_(STFLightweightInst& inst) {
+                    inst.reset_();
+                }
+
                 /**
                  * Appends an operand to the instruction
                  * \param inst STFInst to modify
@@ -2112,8 +2382,35 @@ namespace stf {
                 static inline void appendOperand_(STFInst& inst,
                                                   const Registers::STF_REG_OPERAND_TYPE type,
                                                   const InstRegRecord& rec) {
-                    const bool not_state = type != Registers::STF_REG_OPERAND_TYPE::REG_STATE;
                     inst.appendOperand_(type, rec);
+                    setOperandFlags_(inst, type, rec);
+                }
+
+                /**
+                 * Appends an operand that points to a copy of the operand record
+                 * \param inst STFLightweightInst to modify
+                 * \param type Operand type
+                 * \param rec Operand record to append
+                 */
+                __attribute__((always_inline))
+                static inline void appendOperand_(STFLightweightInst& inst,
+                                                  const Registers::STF_REG_OPERAND_TYPE type,
+                                                  const InstRegRecord& rec) {
+                    inst.appendOperandCopy_(type, rec);
+                    setOperandFlags_(inst, type, rec);
+                }
+
+                /**
+                 * Sets the FP and vector flags for a newly appended operand
+                 * \param inst STFInst to modify
+                 * \param type Operand type
+                 * \param rec Operand record that was appended
+                 */
+                __attribute__((always_inline))
+                static inline void setOperandFlags_(STFInst& inst,
+                                                    const Registers::STF_REG_OPERAND_TYPE type,
+                                                    const InstRegRecord& rec) {
+                    const bool not_state = type != Registers::STF_REG_OPERAND_TYPE::REG_STATE;
 
                     // Set FP flag if we have an FP source or dest register
                     // Set vector flag if we have a vector source or dest register
@@ -2207,9 +2504,23 @@ namespace stf {
                     inst_reg_state.clear();
                     inst_reg_state.reserve(reg_state.size());
                     reg_state.applyRegState(
-                        [&inst, &inst_reg_state](const auto& r) {
-                            const auto* rec = appendOrigRecord_(inst, r.second->clone());
-                            STFInst::appendOperand_(inst_reg_state, rec->template as<InstRegRecord>());
+                        [&inst, &inst_reg_state](const InstRegRecord& rec) {
+                            const auto* orig_rec = appendOrigRecord_(inst, rec.clone());
+                            STFInst::appendOperand_(inst_reg_state, orig_rec->template as<InstRegRecord>());
+                        }
+                    );
+                }
+
+                __attribute__((always_inline))
+                static inline void applyRegisterState_(STFLightweightInst& inst, const STFRegState& reg_state) {
+                    auto& inst_reg_state = inst.getOperandVector_(Registers::STF_REG_OPERAND_TYPE::REG_STATE);
+                    inst_reg_state.clear();
+                    inst_reg_state.reserve(reg_state.size());
+                    inst.reg_state_copies_.clear();
+                    inst.reg_state_copies_.reserve(reg_state.size());
+                    reg_state.applyRegState(
+                        [&inst](const InstRegRecord& rec) {
+                            inst.appendOperandCopy_(Registers::STF_REG_OPERAND_TYPE::REG_STATE, rec);
                         }
                     );
                 }
@@ -2222,7 +2533,7 @@ namespace stf {
                 /**
                  * \brief Only STFInstReader can modify the content of STFInst
                  */
-                template<bool Indexed, typename FilterType>
+                template<bool Indexed, typename FilterType, bool KeepRecords>
                 friend class stf::STFInstReaderBase;
         };
     } // end namespace delegates
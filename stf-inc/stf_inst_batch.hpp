@@ -0,0 +1,280 @@
+#ifndef __STF_INST_BATCH_HPP__
+#define __STF_INST_BATCH_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "stf_enum_utils.hpp"
+#include "stf_enums.hpp"
+#include "stf_inst.hpp"
+#include "stf_reg_def.hpp"
+
+namespace stf {
+    /**
+     * \class InstBatch
+     *
+     * Holds a batch of instructions as a struct of arrays, so that analysis loops can work on plain columns instead
+     * of STFInst objects. Filled by STFInstReaderBase::readBatch.
+     *
+     * Instruction i owns register operands [getRegOffsets()[i], getRegOffsets()[i + 1]) and memory accesses
+     * [getMemOffsets()[i], getMemOffsets()[i + 1]). Register operands are the instruction's source and destination
+     * operands - register state records are not included. Vector register values are stored in
+     * getRegVectorValues(), with operand j owning [getRegVectorOffsets()[j], getRegVectorOffsets()[j + 1]). The
+     * scalar value of a vector operand is 0. Memory access data is stored the same way in getMemData().
+     *
+     * Clearing a batch keeps its allocations, so reusing one batch for every call to readBatch avoids allocating
+     * anything once it has grown to fit.
+     */
+    class InstBatch {
+        private:
+            // Per-instruction columns
+            std::vector<uint64_t> index_; /**< Instruction indices */
+            std::vector<uint64_t> pc_; /**< Instruction PCs */
+            std::vector<uint32_t> opcode_; /**< Opcodes */
+            std::vector<uint8_t> opcode_size_; /**< Opcode sizes in bytes */
+            std::vector<enums::int_t<STFInst::INSTFLAGS>> flags_; /**< Instruction flags */
+            std::vector<uint64_t> branch_target_; /**< Branch targets */
+            std::vector<size_t> reg_offsets_{0}; /**< Start of each instruction's register operands */
+            std::vector<size_t> mem_offsets_{0}; /**< Start of each instruction's memory accesses */
+
+            // Per-operand columns
+            std::vector<Registers::STF_REG> reg_; /**< Register numbers */
+            std::vector<Registers::STF_REG_OPERAND_TYPE> reg_type_; /**< Operand types */
+            std::vector<uint64_t> reg_value_; /**< Scalar operand values */
+            std::vector<size_t> reg_vector_offsets_{0}; /**< Start of each operand's vector values */
+            std::vector<uint64_t> reg_vector_values_; /**< Vector operand values */
+
+            // Per-access columns
+            std::vector<uint64_t> mem_address_; /**< Access virtual addresses */
+            std::vector<uint16_t> mem_size_; /**< Access sizes */
+            std::vector<INST_MEM_ACCESS> mem_type_; /**< Access types */
+            std::vector<size_t> mem_data_offsets_{0}; /**< Start of each access's data */
+            std::vector<uint64_t> mem_data_; /**< Access data */
+
+        public:
+            /**
+             * Removes every instruction from the batch without releasing memory
+             */
+            inline void clear() {
+                index_.clear();
+                pc_.clear();
+                opcode_.clear();
+                opcode_size_.clear();
+                flags_.clear();
+                branch_target_.clear();
+                reg_offsets_.resize(1);
+                mem_offsets_.resize(1);
+
+                reg_.clear();
+                reg_type_.clear();
+                reg_value_.clear();
+                reg_vector_offsets_.resize(1);
+                reg_vector_values_.clear();
+
+                mem_address_.clear();
+                mem_size_.clear();
+                mem_type_.clear();
+                mem_data_offsets_.resize(1);
+                mem_data_.clear();
+            }
+
+            /**
+             * Reserves space for the given number of instructions
+             * \param num_insts Number of instructions
+             */
+            inline void reserve(const size_t num_insts) {
+                index_.reserve(num_insts);
+                pc_.reserve(num_insts);
+                opcode_.reserve(num_insts);
+                opcode_size_.reserve(num_insts);
+                flags_.reserve(num_insts);
+                branch_target_.reserve(num_insts);
+                reg_offsets_.reserve(num_insts + 1);
+                mem_offsets_.reserve(num_insts + 1);
+            }
+
+            /**
+             * Appends an instruction to the batch
+             * \param inst Instruction to append
+             */
+            inline void append(const STFInst& inst) {
+                index_.emplace_back(inst.index());
+                pc_.emplace_back(inst.pc());
+                opcode_.emplace_back(inst.opcode());
+                opcode_size_.emplace_back(inst.opcodeSize());
+                flags_.emplace_back(inst.flags());
+                branch_target_.emplace_back(inst.branchTarget());
+
+                for(const auto& op: inst.getOperands()) {
+                    reg_.emplace_back(op.getReg());
+                    reg_type_.emplace_back(op.getType());
+                    if(STF_EXPECT_FALSE(op.isVector())) {
+                        reg_value_.emplace_back(0);
+                        const auto values = op.getVectorValueView();
+                        reg_vector_values_.insert(reg_vector_values_.end(), values.begin(), values.end());
+                    }
+                    else {
+                        reg_value_.emplace_back(op.getScalarValue());
+                    }
+                    reg_vector_offsets_.emplace_back(reg_vector_values_.size());
+                }
+                reg_offsets_.emplace_back(reg_.size());
+
+                for(const auto& access: inst.getMemoryAccesses()) {
+                    mem_address_.emplace_back(access.getAddress());
+                    mem_size_.emplace_back(access.getAccessRecord().getSize());
+                    mem_type_.emplace_back(access.getType());
+                    for(const auto data: access.getData()) {
+                        mem_data_.emplace_back(data);
+                    }
+                    mem_data_offsets_.emplace_back(mem_data_.size());
+                }
+                mem_offsets_.emplace_back(mem_address_.size());
+            }
+
+            /**
+             * Gets the number of instructions in the batch
+             */
+            inline size_t size() const {
+                return pc_.size();
+            }
+
+            /**
+             * Returns whether the batch is empty
+             */
+            inline bool empty() const {
+                return pc_.empty();
+            }
+
+            /**
+             * Gets the instruction indices
+             */
+            inline const std::vector<uint64_t>& getIndices() const {
+                return index_;
+            }
+
+            /**
+             * Gets the instruction PCs
+             */
+            inline const std::vector<uint64_t>& getPCs() const {
+                return pc_;
+            }
+
+            /**
+             * Gets the opcodes
+             */
+            inline const std::vector<uint32_t>& getOpcodes() const {
+                return opcode_;
+            }
+
+            /**
+             * Gets the opcode sizes in bytes
+             */
+            inline const std::vector<uint8_t>& getOpcodeSizes() const {
+                return opcode_size_;
+            }
+
+            /**
+             * Gets the instruction flags. Each element is a bitwise OR of STFInst::INSTFLAGS values.
+             */
+            inline const std::vector<enums::int_t<STFInst::INSTFLAGS>>& getFlags() const {
+                return flags_;
+            }
+
+            /**
+             * Gets the branch targets
+             */
+            inline const std::vector<uint64_t>& getBranchTargets() const {
+                return branch_target_;
+            }
+
+            /**
+             * Gets the start of each instruction's register operands. Has one more element than the batch has
+             * instructions.
+             */
+            inline const std::vector<size_t>& getRegOffsets() const {
+                return reg_offsets_;
+            }
+
+            /**
+             * Gets the start of each instruction's memory accesses. Has one more element than the batch has
+             * instructions.
+             */
+            inline const std::vector<size_t>& getMemOffsets() const {
+                return mem_offsets_;
+            }
+
+            /**
+             * Gets the register number of each operand
+             */
+            inline const std::vector<Registers::STF_REG>& getRegs() const {
+                return reg_;
+            }
+
+            /**
+             * Gets the type of each operand
+             */
+            inline const std::vector<Registers::STF_REG_OPERAND_TYPE>& getRegTypes() const {
+                return reg_type_;
+            }
+
+            /**
+             * Gets the scalar value of each operand
+             */
+            inline const std::vector<uint64_t>& getRegValues() const {
+                return reg_value_;
+            }
+
+            /**
+             * Gets the start of each operand's vector values. Has one more element than the batch has operands.
+             */
+            inline const std::vector<size_t>& getRegVectorOffsets() const {
+                return reg_vector_offsets_;
+            }
+
+            /**
+             * Gets the values of every vector operand
+             */
+            inline const std::vector<uint64_t>& getRegVectorValues() const {
+                return reg_vector_values_;
+            }
+
+            /**
+             * Gets the virtual address of each memory access
+             */
+            inline const std::vector<uint64_t>& getMemAddresses() const {
+                return mem_address_;
+            }
+
+            /**
+             * Gets the size of each memory access
+             */
+            inline const std::vector<uint16_t>& getMemSizes() const {
+                return mem_size_;
+            }
+
+            /**
+             * Gets the type of each memory access
+             */
+            inline const std::vector<INST_MEM_ACCESS>& getMemTypes() const {
+                return mem_type_;
+            }
+
+            /**
+             * Gets the start of each memory access's data. Has one more element than the batch has memory accesses.
+             */
+            inline const std::vector<size_t>& getMemDataOffsets() const {
+                return mem_data_offsets_;
+            }
+
+            /**
+             * Gets the data of every memory access
+             */
+            inline const std::vector<uint64_t>& getMemData() const {
+                return mem_data_;
+            }
+    };
+} // end namespace stf
+
+#endif
@@ -13,20 +13,29 @@
 #define __STF_INST_READER_HPP__
 
 #include <sys/stat.h>
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <future>
+#include <limits>
 #include <memory>
 #include <string>
 #include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
 #include "stf_user_mode_skipping_reader.hpp"
+#include "stf_chunk_state.hpp"
 #include "stf_enums.hpp"
 #include "stf_exception.hpp"
 #include "stf_filter_types.hpp"
 #include "stf_inst.hpp"
+#include "stf_inst_batch.hpp"
 #include "stf_page_table.hpp"
 #include "stf_pte_reader.hpp"
 #include "stf_record.hpp"
 #include "stf_record_types.hpp"
+#include "stf_thread_pool.hpp"
 
 /**
  * \namespace stf
@@ -43,16 +52,37 @@ namespace stf {
      * Essentially, this reader will collect instruction record groups (IRGs) and return them in an
      * easy to use format.
      *
+     * \tparam KeepRecords If false, instructions are STFLightweightInsts that store copies of their operand, memory access
+     * and event records, and every record is returned to the record pool as soon as it has been decoded. The original records are not
+     * available, so getOrigRecords(), getComments(), getMicroOps(), getReadyRegs(), getEmbeddedPTEs(), write() and
+     * dumpRecords() see an empty instruction.
      */
-    template<bool Indexed, typename FilterType>
-    class STFInstReaderBase final : public STFUserModeSkippingReader<Indexed, STFInst, FilterType, STFInstReaderBase<Indexed, FilterType>> {
+    template<bool Indexed, typename FilterType, bool KeepRecords = true>
+    class STFInstReaderBase final : public STFUserModeSkippingReader<Indexed,
+                                                                     std::conditional_t<KeepRecords, STFInst, STFLightweightInst>,
+                                                                     FilterType,
+                                                                     STFInstReaderBase<Indexed, FilterType, KeepRecords>> {
         private:
-            using ParentReader = STFUserModeSkippingReader<Indexed, STFInst, FilterType, STFInstReaderBase<Indexed, FilterType>>;
+            /**
+             * \typedef InstType
+             * Instruction type held in the buffer
+             */
+            using InstType = std::conditional_t<KeepRecords, STFInst, STFLightweightInst>;
+
+            using ParentReader = STFUserModeSkippingReader<Indexed, InstType, FilterType, STFInstReaderBase<Indexed, FilterType, KeepRecords>>;
             friend ParentReader;
             /// \cond DOXYGEN_IGNORED
             friend typename ParentReader::BufferedReader;
+            template<bool, typename, bool>
+            friend class STFInstReaderBase;
             /// \endcond
 
+            /**
+             * \typedef ChunkDecoder
+             * Reader used to decode compressed chunks on helper threads
+             */
+            using ChunkDecoder = STFInstReaderBase<false, FilterType, KeepRecords>;
+
             using ParentReader::DEFAULT_BUFFER_SIZE_;
             using IntDescriptor = typename ParentReader::IntDescriptor;
             using ParentReader::getItem_;
@@ -64,6 +94,7 @@ namespace stf {
             using ParentReader::checkSkipping_;
             using ParentReader::onlyUserMode_;
             using ParentReader::skippingEnabled_;
+            using ParentReader::restoreSkipping_;
 
             const bool filter_mode_change_events_ = false; // Filters out all mode change events if true
             bool enable_address_translation_ = false;
@@ -75,6 +106,7 @@ namespace stf {
             uint32_t pid_ = 0;              // current pid
             uint32_t tid_ = 0;              // current tid;
             std::unique_ptr<STFPTEReader> pte_reader_;       // the STF PTE reader;
+            STFPTEReader::UpdateBuffer* page_table_updates_ = nullptr; // Collects page translation records if this is a chunk decoder for a reader with address translation
 
 #ifdef STF_INST_HAS_IEM
             bool initial_iem_ = true;
@@ -85,14 +117,346 @@ namespace stf {
 
             std::unique_ptr<STFRegState> reg_state_; // Tracks register states when instructions are being skipped
 
+            STFRecord::UniqueHandle last_record_; // Most recently read record if KeepRecords is false
+
+            /**
+             * \struct ChunkDecodeSlot
+             * Holds the state needed to decode a single compressed chunk into instructions in the background
+             */
+            struct ChunkDecodeSlot {
+                std::unique_ptr<ChunkDecoder> decoder; /**< Reader used to decode the chunk */
+                std::vector<std::unique_ptr<InstType>> insts; /**< Decoded instructions */
+                size_t num_insts = 0; /**< Number of valid instructions in insts */
+                STFPTEReader::UpdateBuffer page_table_updates; /**< Page translation records read from the chunk */
+                std::future<void> result; /**< Future used to indicate when the chunk has been decoded */
+            };
+
+            std::string filename_; // trace file name, used to open the chunk decoders
+            size_t parallel_decode_depth_ = 0; // Maximum number of chunks to decode in the background, 0 if disabled
+            bool parallel_decode_ = false; // True if instructions are currently coming from the chunk decoders
+            std::vector<ChunkDecodeSlot> decode_slots_; // Ring of chunk decoding slots
+            size_t head_decode_slot_ = 0; // Slot holding the oldest in-flight chunk
+            size_t num_decodes_in_flight_ = 0; // Number of chunks currently being decoded
+            bool head_decode_slot_ready_ = false; // True if the head slot has finished decoding
+            size_t next_decode_chunk_ = 0; // Index of the next chunk to decode
+            size_t decode_pos_ = 0; // Position of the next instruction in the head slot
+            size_t decode_start_offset_ = 0; // Number of instructions to discard from the first decoded chunk
+            size_t parallel_num_read_ = 0; // Number of instructions read from the chunk decoders, including the ones that came before them
+
             __attribute__((hot, always_inline))
             inline size_t rawNumRead_() const {
                 return rawNumInstsRead();
             }
 
+            // read the next buffered STFInst, either from the trace or from the chunk decoders
+            __attribute__((hot, always_inline))
+            inline void readNextBuffered_(std::unique_ptr<InstType>& inst) {
+                if(STF_EXPECT_FALSE(parallel_decode_)) {
+                    readNextDecoded_(inst);
+                }
+                else {
+                    readNext_(*inst);
+                }
+            }
+
+            /**
+             * Feeds every record to the page table if address translation is enabled, including filtered records.
+             * Chunk decoders collect the records instead, and the reader that owns them applies them in trace order.
+             * \param rec Record that was just read
+             */
+            __attribute__((hot, always_inline))
+            inline void recordReadCallback_(const STFRecord& rec) {
+                if(STF_EXPECT_FALSE(enable_address_translation_)) {
+                    pte_reader_->update(rec, STFReader::numInstsRead());
+                }
+                else if(STF_EXPECT_FALSE(page_table_updates_)) {
+                    page_table_updates_->add(rec, STFReader::numInstsRead());
+                }
+            }
+
+            /**
+             * Feeds the page table any records that this reader skipped over when it was repositioned. Only the
+             * skipped part of the trace is read.
+             */
+            inline void catchUpPageTable_() {
+                if(STF_EXPECT_FALSE(enable_address_translation_)) {
+                    pte_reader_->catchUp(STFReader::numInstsRead());
+                }
+            }
+
+            /**
+             * Restores the IEM and process IDs from a chunk state snapshot
+             * \param snapshot Snapshot to restore
+             */
+            inline void restoreChunkState_(const ChunkStateSnapshot& snapshot) {
+                last_iem_ = snapshot.getIEM() == INST_IEM::STF_INST_IEM_INVALID ? getInitialIEM() : snapshot.getIEM();
+                hw_thread_id_ = snapshot.getHardwareTID();
+                pid_ = snapshot.getPID();
+                tid_ = snapshot.getTID();
+            }
+
+            /**
+             * Positions the reader at the start of a chunk, then reads up to the end of the chunk without buffering.
+             * The IEM, process IDs, and execution mode are restored from the chunk's state snapshot if the trace has
+             * one. Otherwise only the PC is restored, and the rest of the state is reset to its initial value.
+             * \param chunk_idx Index of the chunk to read
+             * \param read_inst Callable that reads the next instruction. Takes the index of the instruction within the chunk.
+             * \returns Number of instructions read
+             */
+            template<typename ReadFunc>
+            size_t readChunk_(const size_t chunk_idx, ReadFunc&& read_inst) {
+                const auto& snapshots = ParentReader::getChunkStateSnapshots();
+                const size_t num_chunks = ParentReader::getNumChunks();
+                stf_assert(chunk_idx < num_chunks,
+                           "Attempted to read chunk " << chunk_idx << " but the trace has " << num_chunks << " chunks");
+
+                if(snapshots.empty()) {
+                    stf_assert(!onlyUserMode_() || num_chunks == 1,
+                               "Reading a single chunk with non-user-mode skipping enabled requires chunk snapshots");
+                    restoreChunkState_(ChunkStateSnapshot());
+                    restoreSkipping_(true);
+                }
+                else {
+                    const auto& snapshot = snapshots[chunk_idx];
+                    restoreChunkState_(snapshot);
+                    restoreSkipping_(snapshot.getExecutionMode() == EXECUTION_MODE::USER_MODE);
+                }
+#ifdef STF_INST_HAS_IEM
+                initial_iem_ = (chunk_idx == 0);
+#endif
+
+                if(page_table_updates_) {
+                    page_table_updates_->clear();
+                }
+
+                const size_t chunk_size = ParentReader::getChunkSize();
+                if(chunk_idx == 0) {
+                    ParentReader::stream_->rewind();
+                }
+                else {
+                    ParentReader::stream_->seekFromOffset(0, chunk_idx * chunk_size, 0);
+                }
+                catchUpPageTable_();
+
+                const size_t max_insts = chunk_idx + 1 < num_chunks ? chunk_size : std::numeric_limits<size_t>::max();
+                size_t num_insts = 0;
+                try {
+                    while(num_insts < max_insts) {
+                        read_inst(num_insts);
+                        ++num_insts;
+                    }
+                }
+                catch(const EOFException&) {
+                }
+
+                return num_insts;
+            }
+
+            /**
+             * Collects the registers written by the skipped instructions that come right before a chunk, so that
+             * they can be reported on the chunk's first user-mode instruction. Reads back from the previous chunk to
+             * the last chunk that starts in user mode. Does nothing unless non-user-mode instructions are skipped.
+             * \param chunk_idx Index of the chunk that is about to be read
+             * \param inst Scratch instruction
+             * \returns True if the instructions right before the chunk were skipped
+             */
+            inline bool replaySkippedRegion_(const size_t chunk_idx, InstType& inst) {
+                reg_state_->stateClear();
+
+                const auto& snapshots = ParentReader::getChunkStateSnapshots();
+                if(!onlyUserMode_() || snapshots.empty() || chunk_idx == 0) {
+                    return false;
+                }
+
+                // A chunk that starts in user mode can still follow a skipped instruction, since the instruction that
+                // returns to user mode is skipped as well
+                size_t start_chunk = chunk_idx - 1;
+                while(start_chunk > 0 && snapshots[start_chunk].getExecutionMode() != EXECUTION_MODE::USER_MODE) {
+                    --start_chunk;
+                }
+
+                bool did_skip = false;
+                for(size_t i = start_chunk; i < chunk_idx; ++i) {
+                    readChunk_(i,
+                               [this, &inst, &did_skip](const size_t) {
+                                   readNext_(inst);
+                                   if(STF_EXPECT_FALSE(inst.skipped())) {
+                                       skippedCleanup_(inst);
+                                       did_skip = true;
+                                   }
+                                   else if(STF_EXPECT_FALSE(did_skip)) {
+                                       reg_state_->stateClear();
+                                       did_skip = false;
+                                   }
+                               });
+                }
+
+                return did_skip;
+            }
+
+            /**
+             * Decodes the instructions in a single chunk. Called on a chunk decoder from a helper thread.
+             * \param chunk_idx Index of the chunk to decode
+             * \param insts Vector that receives the decoded instructions. Existing elements are reused.
+             * \returns Number of instructions decoded
+             */
+            inline size_t decodeChunk_(const size_t chunk_idx, std::vector<std::unique_ptr<InstType>>& insts) {
+                return readChunk_(chunk_idx,
+                                  [this, &insts](const size_t inst_idx) {
+                                      if(inst_idx == insts.size()) {
+                                          insts.emplace_back(std::make_unique<InstType>());
+                                      }
+                                      readNext_(*insts[inst_idx]);
+                                  });
+            }
+
+            /**
+             * Submits chunks to the chunk decoders until the decoding window is full
+             */
+            void decodeNextChunks_() {
+                const auto& snapshots = ParentReader::getChunkStateSnapshots();
+                while(num_decodes_in_flight_ < decode_slots_.size() && next_decode_chunk_ < snapshots.size()) {
+                    auto& slot = decode_slots_[(head_decode_slot_ + num_decodes_in_flight_) % decode_slots_.size()];
+                    const size_t chunk_idx = next_decode_chunk_++;
+
+                    // Decode the chunk on a helper thread
+                    slot.result = STFThreadPool::get().submit([&slot, chunk_idx]() {
+                                                                slot.num_insts = slot.decoder->decodeChunk_(chunk_idx, slot.insts);
+                                                              });
+                    ++num_decodes_in_flight_;
+                }
+            }
+
+            /**
+             * Waits for all in-flight chunks to finish decoding and discards them
+             */
+            inline void waitForAllDecodes_() {
+                for(size_t i = 0; i < num_decodes_in_flight_; ++i) {
+                    // The head slot's result has already been retrieved if it is ready
+                    if(auto& result = decode_slots_[(head_decode_slot_ + i) % decode_slots_.size()].result; result.valid()) {
+                        result.wait();
+                    }
+                }
+                head_decode_slot_ = 0;
+                num_decodes_in_flight_ = 0;
+                head_decode_slot_ready_ = false;
+            }
+
+            /**
+             * Stops parallel decoding and destroys the chunk decoders
+             */
+            inline void stopParallelDecode_() {
+                waitForAllDecodes_();
+                decode_slots_.clear();
+                parallel_decode_ = false;
+            }
+
+            /**
+             * Restarts the chunk decoders from the current position in the trace. Called whenever the instruction
+             * buffer is about to be refilled, e.g. when the reader is first used or after a seek.
+             */
+            inline void bufferInitCallback_() {
+                if(!parallel_decode_depth_) {
+                    catchUpPageTable_();
+                    return;
+                }
+
+                waitForAllDecodes_();
+
+                const auto& snapshots = ParentReader::getChunkStateSnapshots();
+                parallel_decode_ = !snapshots.empty();
+                catchUpPageTable_();
+
+                // Traces without chunk snapshots are read serially
+                if(!parallel_decode_) {
+                    return;
+                }
+
+                if(decode_slots_.empty()) {
+                    decode_slots_.resize(parallel_decode_depth_);
+                    for(auto& slot: decode_slots_) {
+                        slot.decoder = std::make_unique<ChunkDecoder>(filename_,
+                                                                      onlyUserMode_(),
+                                                                      false,
+                                                                      filter_mode_change_events_,
+                                                                      DEFAULT_BUFFER_SIZE_,
+                                                                      true); // Helper threads can't wait on each other
+                        slot.decoder->getFilter() = ParentReader::getFilter();
+                        if(enable_address_translation_) {
+                            slot.decoder->page_table_updates_ = &slot.page_table_updates;
+                        }
+                    }
+                }
+
+                // The trace may have been positioned partway through a chunk
+                const size_t start_marker = STFReader::numInstsRead();
+                const auto chunk_it = std::prev(std::upper_bound(std::next(snapshots.begin()),
+                                                                 snapshots.end(),
+                                                                 start_marker,
+                                                                 [](const size_t marker, const ChunkStateSnapshot& snapshot) {
+                                                                     return marker < snapshot.getMarkerIndex();
+                                                                 }));
+                next_decode_chunk_ = static_cast<size_t>(std::distance(snapshots.begin(), chunk_it));
+                decode_start_offset_ = start_marker - chunk_it->getMarkerIndex();
+                parallel_num_read_ = start_marker;
+
+                decodeNextChunks_();
+            }
+
+            /**
+             * Waits for the next chunk to finish decoding, releasing the current one
+             */
+            void nextDecodedChunk_() {
+                if(head_decode_slot_ready_) {
+                    head_decode_slot_ready_ = false;
+                    head_decode_slot_ = (head_decode_slot_ + 1) % decode_slots_.size();
+                    --num_decodes_in_flight_;
+                    decodeNextChunks_();
+                }
+
+                if(STF_EXPECT_FALSE(!num_decodes_in_flight_)) {
+                    throw EOFException();
+                }
+
+                auto& slot = decode_slots_[head_decode_slot_];
+                slot.result.get();
+                // The chunk's page translation records have to be applied before any of its instructions are used
+                if(enable_address_translation_) {
+                    pte_reader_->update(slot.page_table_updates);
+                }
+                head_decode_slot_ready_ = true;
+                decode_pos_ = decode_start_offset_;
+                decode_start_offset_ = 0;
+            }
+
+            /**
+             * Gets the next instruction from the chunk decoders, then assigns its index the same way the serial
+             * reader would. The decoded instruction is exchanged with the buffered one, which the chunk decoder
+             * will reuse.
+             * \param inst Buffered instruction to replace
+             */
+            __attribute__((hot, always_inline))
+            inline void readNextDecoded_(std::unique_ptr<InstType>& inst) {
+                while(STF_EXPECT_FALSE(!head_decode_slot_ready_ ||
+                                       decode_pos_ >= decode_slots_[head_decode_slot_].num_insts)) {
+                    nextDecodedChunk_();
+                }
+
+                inst.swap(decode_slots_[head_decode_slot_].insts[decode_pos_]);
+                ++decode_pos_;
+                ++parallel_num_read_;
+
+                countSkipped_(inst->skipped());
+                initItemIndex_(*inst);
+
+                if(enable_address_translation_) {
+                    delegates::STFInstDelegate::setPTEReader_(*inst, pte_reader_.get());
+                }
+            }
+
             // read STF records to construct an STFInst instance
             __attribute__((hot, always_inline))
-            inline void readNext_(STFInst& inst) {
+            inline void readNext_(InstType& inst) {
                 delegates::STFInstDelegate::reset_(inst);
 #ifdef STF_INST_HAS_IEM
                 bool iem_changed = initial_iem_;
@@ -295,12 +659,20 @@ namespace stf {
             }
 
             __attribute__((always_inline))
-            inline const STFRecord* handleNewRecord_(STFInst& inst, STFRecord::UniqueHandle&& urec) {
-                return delegates::STFInstDelegate::appendOrigRecord_(inst, std::move(urec));
+            inline const STFRecord* handleNewRecord_(InstType& inst, STFRecord::UniqueHandle&& urec) {
+                if constexpr(KeepRecords) {
+                    return delegates::STFInstDelegate::appendOrigRecord_(inst, std::move(urec));
+                }
+                else {
+                    // Anything the instruction needs is copied out before the next record is read, so the previous
+                    // record can go back to the pool now
+                    last_record_ = std::move(urec);
+                    return last_record_.get();
+                }
             }
 
             template<typename InstRecordType>
-            inline void finalizeInst_(STFInst& inst, const STFRecord* const rec) {
+            inline void finalizeInst_(InstType& inst, const STFRecord* const rec) {
                 const auto& inst_rec = rec->as<InstRecordType>();
                 delegates::STFInstDelegate::setInstInfo_(inst,
                                                          inst_rec,
@@ -342,7 +714,7 @@ namespace stf {
             }
 
             __attribute__((always_inline))
-            inline void skippingDone_(STFInst& inst) {
+            inline void skippingDone_(InstType& inst) {
                 delegates::STFInstDelegate::applyRegisterState_(inst, *reg_state_);
                 reg_state_->stateClear();
             }
@@ -352,7 +724,8 @@ namespace stf {
              */
             __attribute__((always_inline))
             inline bool slowSeek_() const {
-                return ParentReader::slowSeek_();
+                // The chunk decoders can only be restarted from an absolute position in the trace
+                return ParentReader::slowSeek_() || parallel_decode_;
             }
 
         public:
@@ -363,7 +736,7 @@ namespace stf {
              * \brief Constructor
              * \param filename The trace file name
              * \param only_user_mode If true, non-user-mode instructions will be skipped
-             * \param enable_address_translation If true, will spawn an additional thread to read page translations
+             * \param enable_address_translation If true, will track page translations so that physical addresses are available
              * \param filter_mode_change_events If true, all mode change events will be filtered out
              * \param buffer_size The size of the instruction sliding window
              * \param force_single_threaded_stream If true, forces single threaded mode in reader
@@ -381,6 +754,11 @@ namespace stf {
                 open(filename, enable_address_translation, force_single_threaded_stream);
             }
 
+            // Have to wait for the chunk decoders to finish before destruction
+            ~STFInstReaderBase() {
+                waitForAllDecodes_();
+            }
+
             /**
              * \class iterator
              * \brief Instruction stream iterator
@@ -407,16 +785,25 @@ namespace stf {
                     }
             };
 
+        private:
+            iterator batch_it_; // Position of the next instruction returned by readBatch
+            bool batch_started_ = false; // True if batch_it_ has been initialized
+
+        public:
+
             /**
              * \brief Opens a file
              * \param filename The trace file name
-             * \param enable_address_translation If true, will spawn an additional thread to read page translations
+             * \param enable_address_translation If true, will track page translations so that physical addresses are available
              * \param force_single_threaded_stream If true, forces single threaded mode in reader
              */
             void open(const std::string_view filename,
                       const bool enable_address_translation = false,
                       const bool force_single_threaded_stream = false) {
+                stopParallelDecode_();
                 ParentReader::open(filename, force_single_threaded_stream);
+                filename_ = filename;
+                batch_started_ = false;
                 hw_thread_id_ = 0;
                 pid_ = 0;
                 tid_ = 0;
@@ -427,13 +814,13 @@ namespace stf {
                                                                                                TRACE_FEATURES::STF_CONTAIN_PTE_ONLY,
                                                                                                TRACE_FEATURES::STF_CONTAIN_PTE_HW_AD);
 
+                // Page translation records are fed to the page table as the trace is read, either by this reader or by
+                // its chunk decoders
                 if(enable_address_translation_) {
                     if(!pte_reader_) {
-                        pte_reader_ = std::make_unique<STFPTEReader>(filename);
-                    }
-                    else {
-                        pte_reader_->open(filename);
+                        pte_reader_ = std::make_unique<STFPTEReader>();
                     }
+                    pte_reader_->openInline(filename, getInitialIEM());
                 }
 
                 if(STF_EXPECT_TRUE(reg_state_)) {
@@ -444,10 +831,118 @@ namespace stf {
                 }
             }
 
+            /**
+             * \brief Jumps to the start of the given compressed chunk, restoring the IEM and process IDs from the
+             * chunk's state snapshot. Requires a trace that was written with chunk snapshots enabled.
+             * \param chunk_idx Index of the chunk to jump to
+             */
+            inline iterator jumpToChunk(const size_t chunk_idx) {
+                const auto& snapshots = ParentReader::getChunkStateSnapshots();
+                stf_assert(chunk_idx < snapshots.size(),
+                           "Attempted to jump to chunk " << chunk_idx << " but the trace has " << snapshots.size() << " chunk snapshots");
+                stf_assert(!onlyUserMode_(), "Jumping to a chunk is not supported when non-user-mode skipping is enabled");
+
+                const auto& snapshot = snapshots[chunk_idx];
+                restoreChunkState_(snapshot);
+
+                return ParentReader::jumpToMarker_(snapshot.getMarkerIndex());
+            }
+
+            /**
+             * \brief Reads every instruction in the given compressed chunk without buffering, passing each one to
+             * func. Chunks can be read independently of each other, so separate readers can process different chunks
+             * of the same trace concurrently. The IEM and process IDs are restored from the chunk's state snapshot if
+             * the trace has one. Otherwise only the PC is restored. Instruction indices count from the start of the
+             * trace and include skipped instructions. When non-user-mode instructions are skipped, the registers they
+             * wrote are reported on the next user-mode instruction just like they are during iteration, so a chunk
+             * that starts right after or partway through a skipped region also reads the chunks before it back to
+             * the start of that region. The reader must be repositioned (e.g. with jumpToChunk) before it is iterated
+             * again.
+             * \param chunk_idx Index of the chunk to read
+             * \param func Callable that takes a const STFInst&
+             * \returns Number of instructions in the chunk, including skipped instructions
+             */
+            template<typename InstFunc>
+            size_t forEachInstInChunk(const size_t chunk_idx, InstFunc&& func) {
+                // Any background decoding is restarted the next time the buffer is filled
+                waitForAllDecodes_();
+                parallel_decode_ = false;
+
+                InstType inst;
+                bool did_skip = replaySkippedRegion_(chunk_idx, inst);
+
+                const size_t first_index = chunk_idx * ParentReader::getChunkSize() + 1;
+                const size_t num_insts = readChunk_(chunk_idx,
+                                                    [this, &inst, &func, &did_skip, first_index](const size_t inst_idx) {
+                                                        readNext_(inst);
+                                                        if(STF_EXPECT_FALSE(inst.skipped())) {
+                                                            skippedCleanup_(inst);
+                                                            did_skip = true;
+                                                            return;
+                                                        }
+                                                        if(STF_EXPECT_FALSE(did_skip)) {
+                                                            skippingDone_(inst);
+                                                            did_skip = false;
+                                                        }
+                                                        delegates::STFInstDelegate::setIndex_(inst,
+                                                                                              first_index + inst_idx,
+                                                                                              first_index + inst_idx);
+                                                        if(enable_address_translation_) {
+                                                            delegates::STFInstDelegate::setPTEReader_(inst, pte_reader_.get());
+                                                        }
+                                                        func(std::as_const(inst));
+                                                    });
+
+                // Registers from a skipped region at the end of the chunk belong to an instruction that wasn't read
+                reg_state_->stateClear();
+
+                return num_insts;
+            }
+
+            /**
+             * \brief Reads the next instructions into a columnar InstBatch. Instructions come from the same buffer
+             * that backs iteration, so skipping, filtering and parallel decoding behave exactly as they do for an
+             * iterator.
+             * \param it Iterator pointing to the first instruction to read. Advanced past the last instruction read.
+             * \param batch Batch to fill. Any instructions already in the batch are discarded.
+             * \param num_insts Maximum number of instructions to read
+             * \returns Number of instructions read. Fewer than num_insts are read only at the end of the trace.
+             */
+            inline size_t readBatch(iterator& it, InstBatch& batch, const size_t num_insts) {
+                batch.clear();
+                batch.reserve(num_insts);
+
+                const auto& end_it = ParentReader::end();
+                size_t num_read = 0;
+                for(; num_read < num_insts && it != end_it; ++num_read, ++it) {
+                    batch.append(*it);
+                }
+
+                return num_read;
+            }
+
+            /**
+             * \brief Reads the next instructions into a columnar InstBatch, starting from the beginning of the trace
+             * and continuing from where the previous call left off. Should not be mixed with other iterators over
+             * the same reader.
+             * \param batch Batch to fill. Any instructions already in the batch are discarded.
+             * \param num_insts Maximum number of instructions to read
+             * \returns Number of instructions read. Fewer than num_insts are read only at the end of the trace.
+             */
+            inline size_t readBatch(InstBatch& batch, const size_t num_insts) {
+                if(STF_EXPECT_FALSE(!batch_started_)) {
+                    batch_it_ = ParentReader::begin();
+                    batch_started_ = true;
+                }
+
+                return readBatch(batch_it_, batch, num_insts);
+            }
+
             /**
              * \brief Closes the file
              */
             int close() final {
+                stopParallelDecode_();
                 last_iem_ = INST_IEM::STF_INST_IEM_INVALID;
                 if(enable_address_translation_ && pte_reader_) {
                     pte_reader_->close();
@@ -467,8 +962,32 @@ namespace stf {
              */
             __attribute__((always_inline))
             inline size_t rawNumInstsRead() const {
+                if(STF_EXPECT_FALSE(parallel_decode_)) {
+                    return parallel_num_read_;
+                }
                 return STFReader::numInstsRead();
             }
+
+            /**
+             * \brief Decodes instructions on helper threads, one compressed chunk per thread. Instructions, indices
+             * and skipped instruction counts are identical to the serial reader. Requires a trace that was written
+             * with chunk snapshots enabled; other traces are read serially. Every in-flight chunk is held in memory
+             * until it has been read, and fast seeking is disabled while parallel decoding is active. Must be called
+             * before any instructions are read.
+             * \param depth Maximum number of chunks to decode at once. 0 disables parallel decoding.
+             */
+            inline void setParallelDecodeDepth(const size_t depth) {
+                stf_assert(!ParentReader::buf_, "Parallel decoding must be configured before reading any instructions");
+                stopParallelDecode_();
+                parallel_decode_depth_ = depth;
+            }
+
+            /**
+             * \brief Returns whether instructions are being decoded on helper threads
+             */
+            inline bool parallelDecodeEnabled() const {
+                return parallel_decode_;
+            }
     };
 
     /**
@@ -489,6 +1008,12 @@ namespace stf {
      */
     using STFIndexedInstReader = STFInstReaderBase<true, DummyFilter>;
 
+    /**
+     * \typedef STFLightweightInstReader
+     * \brief STFInst reader that doesn't keep the original records
+     */
+    using STFLightweightInstReader = STFInstReaderBase<false, DummyFilter, false>;
+
 } //end namespace stf
 
 // __STF_INST_READER_HPP__
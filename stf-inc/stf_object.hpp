@@ -201,6 +201,52 @@ namespace stf {
                 return data.size();
             }
 
+            /**
+             * Gets a view of an array of the given type in an STFIFstream if record views are enabled
+             * \param reader STFIFstream to use
+             * \param num Number of elements to view
+             * \returns Pointer to the first element that keeps the underlying buffer alive, or nullptr if the data
+             * has to be read normally
+             */
+            template<typename T>
+            static inline std::shared_ptr<const T> readView_(STFIFstream& reader, const size_t num) {
+                if(!reader.usesRecordViews()) {
+                    return nullptr;
+                }
+
+                auto view = reader.freadView_(sizeof(T) * num);
+                const auto ptr = reinterpret_cast<const T*>(view.get());
+                return std::shared_ptr<const T>(std::move(view), ptr);
+            }
+
+            /**
+             * Skips over the encoding of an arbitrary collection of trivially-copyable types in an STFIFstream
+             * \param reader STFIFstream to use
+             */
+            template<typename... Ts>
+            __attribute__((always_inline))
+            static inline std::enable_if_t<type_utils::are_pod_v<Ts...>, size_t>
+            skip_(STFIFstream& reader) {
+                constexpr size_t size = PackedContainerView<Ts...>::size();
+                reader.fskip_(size);
+
+                return size;
+            }
+
+            /**
+             * Skips over an array of the given type in an STFIFstream
+             * \param reader STFIFstream to use
+             * \param num Number of elements to skip
+             */
+            template<typename T>
+            __attribute__((always_inline))
+            static inline size_t skip_(STFIFstream& reader, const size_t num) {
+                const size_t size = sizeof(T) * num;
+                reader.fskip_(size);
+
+                return size;
+            }
+
         public:
             /**:
              * Writes the object to an STFOFstream
@@ -228,6 +274,7 @@ namespace stf {
     class STFObject : public STFBaseObject {
         protected:
             const TypeIdEnum id_; /**< Enum value that was used to construct the object */
+            mutable bool holds_view_ = false; /**< Set to true while the object holds a view that keeps a stream buffer alive */
 
         public:
             /**
@@ -290,6 +337,14 @@ namespace stf {
                 return id_;
             }
 
+            /**
+             * Returns whether this object holds a view that keeps a stream buffer alive. Such objects are destroyed
+             * instead of being cached by the pool so that the buffer can be released.
+             */
+            inline bool holdsView() const {
+                return holds_view_;
+            }
+
             /**
              * Formats a object into an ostream
              * \param os ostream to use
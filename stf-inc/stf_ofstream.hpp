@@ -6,6 +6,7 @@
 #include <memory>
 #include <vector>
 #include "boost_wrappers/small_vector.hpp"
+#include "stf_compressed_chunk.hpp"
 
 #include "stf_enum_utils.hpp"
 #include "stf_fstream.hpp"
@@ -182,6 +183,21 @@ namespace stf {
              */
             virtual STFOFstream& operator<<(const STFBaseObject& rec);
 
+            /**
+             * Appends a chunk that was read from another compressed trace without recompressing it. Must be called
+             * when the previous chunk has just ended. Returns false if the stream can't take the chunk, e.g. because
+             * it isn't chunked or the chunk is missing a summary or snapshot that this stream writes.
+             * \param chunk Chunk to append
+             */
+            virtual bool appendCompressedChunk(const CompressedChunk& chunk);
+
+            /**
+             * Sets the state that the following records are written in, so that chunk summaries and snapshots stay
+             * correct when records from another trace are spliced in
+             * \param state State to switch to
+             */
+            virtual void setChunkState(const ChunkStateSnapshot& state);
+
             friend class STFBaseObject;
 
             template<typename T, typename SerializedSizeT>
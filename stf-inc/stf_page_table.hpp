@@ -1,7 +1,10 @@
 #ifndef __STF_PAGE_TABLE_HPP__
 #define __STF_PAGE_TABLE_HPP__
 
+#include <algorithm>
+#include <array>
 #include <iostream>
+#include <limits>
 #include <numeric>
 #include <functional>
 #include <unordered_map>
@@ -89,9 +92,179 @@ namespace stf {
      * \class STFPageTable
      * \brief Tracks page table entries by the instruction index they become
      * valid, providing the correct address translation at any point in a trace
+     *
+     * Completed translations are cached, so translate() modifies internal state even though it is const. Callers
+     * that share a page table between threads must serialize calls to translate() along with updates.
      */
     class STFPageTable {
         private:
+            /**
+             * \class TranslationCache
+             * \brief Direct-mapped cache of completed translations. Each entry covers one 4KB virtual page and records
+             * the range of instruction indices where the mode, SATP value and every PTE used by the walk stay the same.
+             * Any change to those tables flushes the whole cache.
+             */
+            class TranslationCache {
+                public:
+                    /**
+                     * \class Result
+                     * \brief A completed translation along with the instruction indices it is valid for
+                     */
+                    class Result {
+                        private:
+                            uint64_t start_index_ = 0; /**< First instruction index the translation is valid for */
+                            uint64_t end_index_ = std::numeric_limits<uint64_t>::max(); /**< Instruction index where the translation stops being valid */
+                            uint64_t base_addr_ = 0; /**< Physical base address of the page */
+                            uint64_t offset_mask_ = std::numeric_limits<uint64_t>::max(); /**< Selects the page offset bits from the VA */
+
+                        public:
+                            /**
+                             * Narrows the valid range to the instruction indices in [start_index, end_index)
+                             * \param start_index First index of the range
+                             * \param end_index End of the range
+                             */
+                            __attribute__((always_inline))
+                            inline void narrow(const uint64_t start_index, const uint64_t end_index) {
+                                start_index_ = std::max(start_index_, start_index);
+                                end_index_ = std::min(end_index_, end_index);
+                            }
+
+                            /**
+                             * Narrows the valid range to the version of a flat_map entry that upper_bound() found
+                             * \param map Map that was searched
+                             * \param it Iterator returned by upper_bound(). Must not be map.begin().
+                             */
+                            template<typename MapType>
+                            __attribute__((always_inline))
+                            inline void narrow(const MapType& map, const typename MapType::const_iterator& it) {
+                                narrow(std::prev(it)->first,
+                                       it == map.end() ? std::numeric_limits<uint64_t>::max() : it->first);
+                            }
+
+                            /**
+                             * Sets the physical page the translation maps to
+                             * \param base_addr Physical base address
+                             * \param offset_mask Mask that selects the page offset bits from the VA
+                             */
+                            __attribute__((always_inline))
+                            inline void setPage(const uint64_t base_addr, const uint64_t offset_mask) {
+                                base_addr_ = base_addr;
+                                offset_mask_ = offset_mask;
+                            }
+
+                            /**
+                             * Returns whether the translation is valid at the given instruction index
+                             */
+                            __attribute__((always_inline))
+                            inline bool contains(const uint64_t index) const {
+                                return index >= start_index_ && index < end_index_;
+                            }
+
+                            /**
+                             * Translates the given VA
+                             */
+                            __attribute__((always_inline))
+                            inline uint64_t translate(const uint64_t orig_va) const {
+                                return base_addr_ | (orig_va & offset_mask_);
+                            }
+                    };
+
+                private:
+                    static constexpr unsigned int INDEX_BITS = 9; /**< Number of bits in a cache entry index */
+                    static constexpr size_t NUM_ENTRIES = 1ULL << INDEX_BITS; /**< Number of cache entries */
+
+                    /**
+                     * \struct Entry
+                     * \brief Cache entry
+                     */
+                    struct Entry {
+                        uint64_t vpn = 0; /**< 4KB virtual page number */
+                        uint64_t generation = 0; /**< Cache generation the entry was filled in. Entries from older generations are invalid. */
+                        Result result; /**< Cached translation */
+                    };
+
+                    std::array<Entry, NUM_ENTRIES> entries_; /**< Cache entries */
+                    uint64_t generation_ = 1; /**< Current cache generation */
+                    uint64_t hits_ = 0; /**< Number of lookups that hit */
+                    uint64_t misses_ = 0; /**< Number of lookups that missed */
+
+                    __attribute__((always_inline))
+                    static inline uint64_t getVPN_(const uint64_t orig_va) {
+                        return orig_va >> PAGE_OFFSET_SIZE;
+                    }
+
+                    __attribute__((always_inline))
+                    inline Entry& getEntry_(const uint64_t vpn) {
+                        // Hash the whole VPN so that pages at the same offset in different regions (e.g. code,
+                        // heap and stack) don't all land in the same entry
+                        static constexpr uint64_t HASH_MULTIPLIER = 0x9e3779b97f4a7c15ULL;
+                        return entries_[(vpn * HASH_MULTIPLIER) >> (byte_utils::bitSize<uint64_t>() - INDEX_BITS)];
+                    }
+
+                public:
+                    /**
+                     * Looks up a translation
+                     * \param orig_va VA to translate
+                     * \param index Instruction index
+                     * \param pa Set to the translated address on a hit
+                     * \return true on a hit
+                     */
+                    __attribute__((always_inline))
+                    inline bool lookup(const uint64_t orig_va, const uint64_t index, uint64_t& pa) {
+                        const uint64_t vpn = getVPN_(orig_va);
+                        if(const auto& entry = getEntry_(vpn);
+                           STF_EXPECT_TRUE(entry.generation == generation_ && entry.vpn == vpn && entry.result.contains(index))) {
+                            ++hits_;
+                            pa = entry.result.translate(orig_va);
+                            return true;
+                        }
+
+                        ++misses_;
+                        return false;
+                    }
+
+                    /**
+                     * Adds a translation to the cache
+                     * \param orig_va Translated VA
+                     * \param result Translation result
+                     */
+                    __attribute__((always_inline))
+                    inline void insert(const uint64_t orig_va, const Result& result) {
+                        const uint64_t vpn = getVPN_(orig_va);
+                        auto& entry = getEntry_(vpn);
+                        entry.vpn = vpn;
+                        entry.generation = generation_;
+                        entry.result = result;
+                    }
+
+                    /**
+                     * Invalidates every entry in the cache
+                     */
+                    __attribute__((always_inline))
+                    inline void invalidate() {
+                        ++generation_;
+                    }
+
+                    /**
+                     * Gets the number of lookups that hit
+                     */
+                    inline uint64_t getHits() const {
+                        return hits_;
+                    }
+
+                    /**
+                     * Gets the number of lookups that missed
+                     */
+                    inline uint64_t getMisses() const {
+                        return misses_;
+                    }
+            };
+
+            /**
+             * \typedef TranslationResult
+             * \brief Convenience typedef for TranslationCache::Result
+             */
+            using TranslationResult = TranslationCache::Result;
 
             /**
              * \class STFPageTableImplBase
@@ -101,6 +274,7 @@ namespace stf {
                 protected:
                     // If the trace doesn't start with a mode change event, assume it is in machine mode
                     boost::container::flat_map<uint64_t, EXECUTION_MODE> modes_{{0, EXECUTION_MODE::MACHINE_MODE}}; /**< Maps instruction indices to the correct execution mode */
+                    mutable TranslationCache translation_cache_; /**< Caches completed translations */
 
                 public:
                     virtual inline ~STFPageTableImplBase() = default;
@@ -116,9 +290,17 @@ namespace stf {
                         // Don't use emplace() because we need to overwrite the default index 0 entry if
                         // the trace specifies something different
                         modes_[index] = mode;
+                        translation_cache_.invalidate();
                     }
 
                     virtual void clear() = 0;
+
+                    /**
+                     * Gets the translation cache
+                     */
+                    inline const TranslationCache& getTranslationCache() const {
+                        return translation_cache_;
+                    }
             };
 
             /**
@@ -152,9 +334,10 @@ namespace stf {
                             class PageTableMapBase {
                                 public:
                                     virtual ~PageTableMapBase() = default;
-                                    virtual void update(const PageTableWalkRecord& pte) = 0;
-                                    virtual uint64_t translate(const uint64_t orig_va,
-                                                               const uint64_t index) const = 0;
+                                    virtual bool update(const PageTableWalkRecord& pte) = 0;
+                                    virtual void translate(const uint64_t orig_va,
+                                                           const uint64_t index,
+                                                           TranslationResult& result) const = 0;
                             };
 
                             /**
@@ -258,9 +441,12 @@ namespace stf {
 
                                     /**
                                      * Updates the page table with a new page table walk record
+                                     * \return true if an existing PTE got a new version, which can change the
+                                     * result of previous translations
                                      */
-                                    void update(const PageTableWalkRecord& rec) final {
+                                    bool update(const PageTableWalkRecord& rec) final {
                                         const uint64_t index = rec.getFirstAccessIndex();
+                                        bool added_version = false;
 
                                         for(const auto& pte: rec.getPTEs()) {
                                             PageTableEntry new_entry(pte.getPTE());
@@ -291,12 +477,21 @@ namespace stf {
                                                                               std::piecewise_construct,
                                                                               std::forward_as_tuple(index),
                                                                               std::forward_as_tuple(std::move(new_entry)));
+                                                    added_version = true;
                                                 }
                                             }
                                         }
+
+                                        return added_version;
                                     }
 
-                                    uint64_t translate(const uint64_t orig_va, const uint64_t index) const final {
+                                    /**
+                                     * Translates the given VA, narrowing the valid range of the result to the
+                                     * versions of each PTE used by the walk
+                                     */
+                                    void translate(const uint64_t orig_va,
+                                                   const uint64_t index,
+                                                   TranslationResult& result) const final {
                                         static constexpr uint64_t VIRT_ADDR_MASK = mask_<va_props::VIRT_ADDR_SIZE>();
                                         static constexpr unsigned int NUM_VPNS = (va_props::VIRT_ADDR_SIZE - PAGE_OFFSET_SIZE) / va_props::VPN_SIZE;
                                         static constexpr uint64_t VPN_MASK = mask_<va_props::VPN_SIZE>();
@@ -323,6 +518,7 @@ namespace stf {
                                             // Same reasoning as above
                                             stf_translation_assert(it != pte_versions.begin(), orig_va, index);
 
+                                            result.narrow(pte_versions, it);
                                             const auto& pte = std::prev(it)->second;
 
                                             is_leaf = pte.isLeaf();
@@ -340,7 +536,7 @@ namespace stf {
 
                                         // Accounts for hugepages (vpn_shift_amount != 0 case)
                                         const uint64_t va_offset_mask = byte_utils::bitMask<uint64_t>(static_cast<unsigned int>(vpn_shift_amount) + PAGE_OFFSET_SIZE);
-                                        return pte_base_addr | (orig_va & va_offset_mask);
+                                        result.setPage(pte_base_addr, va_offset_mask);
                                     }
                             };
 
@@ -348,15 +544,15 @@ namespace stf {
                             template<typename Dummy>
                             class PageTableMap<VAMode::NO_TRANSLATION, Dummy> : public PageTableMapBase {
                                 public:
-                                    void update(const PageTableWalkRecord&) final {
+                                    bool update(const PageTableWalkRecord&) final {
                                         // There's nothing to update if translation isn't enabled
                                         stf_throw("SATP says translation not enabled, but we're doing translation!");
                                     }
 
-                                    uint64_t translate(const uint64_t orig_va,
-                                                       const uint64_t) const final {
-                                        // VA == PA
-                                        return orig_va;
+                                    void translate(const uint64_t,
+                                                   const uint64_t,
+                                                   TranslationResult&) const final {
+                                        // VA == PA, which is the default result
                                     }
                             };
 
@@ -406,20 +602,29 @@ namespace stf {
                      * Translates the given VA using the page table setup that was valid at the given instruction index
                      */
                     uint64_t translate(const uint64_t orig_va, const uint64_t index) const final {
+                        if(uint64_t pa; STF_EXPECT_TRUE(translation_cache_.lookup(orig_va, index, pa))) {
+                            return pa;
+                        }
+
                         auto mode_it = modes_.upper_bound(index);
 
                         stf_assert(mode_it != modes_.begin(), "Failed to find execution mode for index " << index);
 
+                        TranslationResult result;
+                        result.narrow(modes_, mode_it);
+
                         // If we're in machine mode, translation is disabled.
-                        if(std::prev(mode_it)->second == EXECUTION_MODE::MACHINE_MODE) {
-                            return orig_va;
-                        }
+                        if(std::prev(mode_it)->second != EXECUTION_MODE::MACHINE_MODE) {
+                            const auto satp_it = indexed_satp_entries_.upper_bound(index);
 
-                        const auto satp_it = indexed_satp_entries_.upper_bound(index);
+                            stf_translation_assert(satp_it != indexed_satp_entries_.begin(), orig_va, index);
 
-                        stf_translation_assert(satp_it != indexed_satp_entries_.begin(), orig_va, index);
+                            result.narrow(indexed_satp_entries_, satp_it);
+                            std::prev(satp_it)->second->translate(orig_va, index, result);
+                        }
 
-                        return std::prev(satp_it)->second->translate(orig_va, index);
+                        translation_cache_.insert(orig_va, result);
+                        return result.translate(orig_va);
                     }
 
                     /**
@@ -433,7 +638,9 @@ namespace stf {
                         stf_assert(satp_it != indexed_satp_entries_.begin(),
                                    "No SATP values known, but we're doing translation!");
 
-                        std::prev(satp_it)->second->update(rec);
+                        if(std::prev(satp_it)->second->update(rec)) {
+                            translation_cache_.invalidate();
+                        }
                     }
 
                     /**
@@ -442,7 +649,9 @@ namespace stf {
                     void updateSatp(const InstRegRecord& reg_rec, const uint64_t index) final {
                         const uint64_t satp_data = reg_rec.getScalarData();
                         const auto it = satp_entries_.try_emplace(satp_data, satp_data).first;
-                        indexed_satp_entries_.try_emplace(index, it->second.get());
+                        if(indexed_satp_entries_.try_emplace(index, it->second.get()).second) {
+                            translation_cache_.invalidate();
+                        }
                     }
 
                     /**
@@ -452,6 +661,7 @@ namespace stf {
                         modes_.clear();
                         indexed_satp_entries_.clear();
                         satp_entries_.clear();
+                        translation_cache_.invalidate();
                     }
             };
 
@@ -526,6 +736,20 @@ namespace stf {
             inline void clear() {
                 ptr_->clear();
             }
+
+            /**
+             * Gets the number of translations that were served from the translation cache
+             */
+            inline uint64_t getTranslationCacheHits() const {
+                return ptr_ ? ptr_->getTranslationCache().getHits() : 0;
+            }
+
+            /**
+             * Gets the number of translations that missed the translation cache and walked the page table
+             */
+            inline uint64_t getTranslationCacheMisses() const {
+                return ptr_ ? ptr_->getTranslationCache().getMisses() : 0;
+            }
     };
 
     // Page table factory method for RV32 IEM
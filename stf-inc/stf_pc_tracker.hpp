@@ -1,6 +1,7 @@
 #ifndef __STF_PC_TRACKER_HPP__
 #define __STF_PC_TRACKER_HPP__
 
+#include <cstddef>
 #include <cstdint>
 #include <type_traits>
 
@@ -30,6 +31,22 @@ namespace stf {
                 target_pc_ = pc + pc_offset_;
                 is_branch_ = true;
             }
+            /**
+             * Advances the PC past an instruction with the given opcode size
+             * \param opcode_size Opcode size
+             */
+            void trackOpcode_(const size_t opcode_size) {
+                pc_ = next_pc_;
+
+                if(STF_EXPECT_FALSE(is_branch_)) {
+                    next_pc_ = target_pc_;
+                    is_branch_ = false;
+                }
+                else {
+                    next_pc_ += opcode_size;
+                }
+            }
+
             /**
              * Updates the target PC for branch-like records
              */
@@ -98,14 +115,24 @@ namespace stf {
              */
             template<typename ClassT, typename OpcodeT, descriptors::internal::Descriptor desc>
             void track(const GenericOpcodeRecord<ClassT, OpcodeT, desc>& rec) {
-                pc_ = next_pc_;
+                trackOpcode_(rec.getOpcodeSize());
+            }
 
-                if(STF_EXPECT_FALSE(is_branch_)) {
-                    next_pc_ = target_pc_;
-                    is_branch_ = false;
+            /**
+             * Tracks the PC for a record that was skipped without being constructed
+             * \tparam RecordType Type of the skipped record
+             * \param addr Address held by the record. Unused for opcode records.
+             */
+            template<typename RecordType>
+            void trackSkipped(const uint64_t addr = 0) {
+                if constexpr(std::is_same_v<RecordType, ForcePCRecord>) {
+                    next_pc_ = addr + pc_offset_;
+                }
+                else if constexpr(requires { RecordType::getOpcodeSize(); }) {
+                    trackOpcode_(RecordType::getOpcodeSize());
                 }
                 else {
-                    next_pc_ += rec.getOpcodeSize();
+                    setTargetPC_(addr);
                 }
             }
 
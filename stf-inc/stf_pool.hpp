@@ -319,7 +319,7 @@ namespace stf {
                     return;
                 }
 
-                if(auto& cache = STFObjectCache<BaseObjectType>::get(); STF_EXPECT_FALSE(!cache.add(obj))) {
+                if(STF_EXPECT_FALSE(obj->holdsView()) || STF_EXPECT_FALSE(!STFObjectCache<BaseObjectType>::get().add(obj))) {
                     getDeleter_(obj)(obj);
                 }
             }
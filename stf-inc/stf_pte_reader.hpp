@@ -1,10 +1,16 @@
 #ifndef __STF_PTE_READER_HPP__
 #define __STF_PTE_READER_HPP__
 
+#include <algorithm>
 #include <atomic>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <string>
+#include <string_view>
 #include <thread>
+#include <utility>
+#include <vector>
 #include "stf_compressed_chunked_base.hpp"
 #include "stf_descriptor.hpp"
 #include "stf_reader.hpp"
@@ -15,6 +21,12 @@ namespace stf {
      * \class STFPTEReader
      * \brief Opens an STF and reads only records related to page translation. Reading takes place in a separate
      * thread to (hopefully) read and process page translation info before it is needed by the main STFInstReader.
+     *
+     * Alternatively, the page table can be fed inline by a reader that is already decoding the trace (see
+     * openInline() and update()). No thread is started in that case, and translations only see the records that
+     * have been passed to update() so far. A reader that skips part of the trace calls catchUp() to feed the
+     * skipped records, and records read by another reader (e.g. a chunk decoder) can be collected in an
+     * UpdateBuffer and applied later.
      */
     class STFPTEReader {
         private:
@@ -29,6 +41,71 @@ namespace stf {
             bool done_reading_ = true; /**< If true, the reader thread has completed */
             std::atomic_bool stop_reading_ = false; /**< Stops the reader thread if set to true */
 
+            std::string filename_; /**< Trace that is being fed inline */
+            uint64_t inline_num_insts_ = 0; /**< Every record up to this instruction has been fed inline */
+            std::unique_ptr<STFReader> catch_up_reader_; /**< Reads the records skipped by the inline reader */
+
+            /**
+             * Returns whether the record can change the result of a translation
+             */
+            __attribute__((always_inline))
+            static inline bool affectsTranslation_(const STFRecord& rec) {
+                switch(rec.getId()) {
+                    case IntDescriptor::STF_PAGE_TABLE_WALK:
+                        return true;
+                    case IntDescriptor::STF_INST_REG:
+                        return isSatpUpdate_(rec.as<InstRegRecord>());
+                    case IntDescriptor::STF_EVENT:
+                        return rec.as<EventRecord>().isModeChange();
+                    default:
+                        return false;
+                }
+            }
+
+            /**
+             * Returns whether the register record changes the SATP register
+             */
+            __attribute__((always_inline))
+            static inline bool isSatpUpdate_(const InstRegRecord& reg_rec) {
+                const auto operand_type = reg_rec.getOperandType();
+                return STF_EXPECT_FALSE(reg_rec.getReg() == Registers::STF_REG::STF_REG_CSR_SATP) &&
+                       (operand_type == Registers::STF_REG_OPERAND_TYPE::REG_STATE ||
+                        operand_type == Registers::STF_REG_OPERAND_TYPE::REG_DEST);
+            }
+
+            /**
+             * Updates the SATP register value in the page table
+             * \param reg_rec SATP register record
+             * \param num_insts_read Number of instructions read before the record
+             */
+            __attribute__((always_inline))
+            inline void updateSatp_(const InstRegRecord& reg_rec, const uint64_t num_insts_read) {
+                const bool is_state = reg_rec.getOperandType() == Registers::STF_REG_OPERAND_TYPE::REG_STATE;
+                // num_insts_read == index of *previous* instruction
+                // If this is a state record, we should set its effective index to that value
+                // If this is a dest record, we should set its effective index to the instruction
+                // *after* this one (i.e., num_insts_read + 2)
+                //
+                // NOTE: If an instruction has both a dest and a state record attached, this index
+                // math will ensure they don't interfere with each other
+                page_table_.updateSatp(reg_rec, num_insts_read + 2*(!is_state));
+            }
+
+            /**
+             * Updates the execution mode in the page table
+             * \param event_rec Mode change event record
+             * \param num_insts_read Number of instructions read before the record
+             */
+            __attribute__((always_inline))
+            inline void updateMode_(const EventRecord& event_rec, uint64_t num_insts_read) {
+                // num_insts_read == index of *previous* instruction
+                // If num_insts_read == 0, this is the first instruction in the trace, and we should insert that
+                // mode at index 0.
+                // Otherwise, increment the index by 2 so it points to the instruction *after* this one
+                num_insts_read += 2*(num_insts_read != 0);
+                page_table_.updateMode(static_cast<EXECUTION_MODE>(event_rec.getData().front()), num_insts_read);
+            }
+
             /**
              * Reads the page translation info from a trace in a separate thread
              */
@@ -63,19 +140,9 @@ namespace stf {
                             }
                             else if(STF_EXPECT_FALSE(urec->getId() == IntDescriptor::STF_INST_REG)) {
                                 const auto& reg_rec = urec->as<InstRegRecord>();
-                                const auto operand_type = reg_rec.getOperandType();
-                                const bool is_state = operand_type == Registers::STF_REG_OPERAND_TYPE::REG_STATE;
-                                if(STF_EXPECT_FALSE((reg_rec.getReg() == Registers::STF_REG::STF_REG_CSR_SATP) &&
-                                                    (is_state || (operand_type == Registers::STF_REG_OPERAND_TYPE::REG_DEST)))) {
+                                if(STF_EXPECT_FALSE(isSatpUpdate_(reg_rec))) {
                                     std::lock_guard<std::mutex> guard(page_table_mutex_);
-                                    // reader.numInstsRead() == index of *previous* instruction
-                                    // If this is a state record, we should set its effective index to that value
-                                    // If this is a dest record, we should set its effective index to the instruction
-                                    // *after* this one (i.e., numInstsRead() + 2)
-                                    //
-                                    // NOTE: If an instruction has both a dest and a state record attached, this index
-                                    // math will ensure they don't interfere with each other
-                                    page_table_.updateSatp(reg_rec, reader.numInstsRead() + 2*(!is_state));
+                                    updateSatp_(reg_rec, reader.numInstsRead());
                                 }
                             }
                             else if(STF_EXPECT_FALSE(urec->getId() == IntDescriptor::STF_INST_OPCODE16 ||
@@ -97,17 +164,8 @@ namespace stf {
                             else if(STF_EXPECT_FALSE(urec->getId() == IntDescriptor::STF_EVENT)) {
                                 const auto& event_rec = urec->as<EventRecord>();
                                 if(STF_EXPECT_FALSE(event_rec.isModeChange())) {
-                                    {
-                                        std::lock_guard<std::mutex> guard(page_table_mutex_);
-                                        uint64_t index = reader.numInstsRead();
-
-                                        // index == index of *previous* instruction
-                                        // If index == 0, this is the first instruction in the trace, and we should insert that
-                                        // mode at index 0.
-                                        // Otherwise, increment the index by 2 so it points to the instruction *after* this one
-                                        index += 2*(index != 0);
-                                        page_table_.updateMode(static_cast<EXECUTION_MODE>(event_rec.getData().front()), index);
-                                    }
+                                    std::lock_guard<std::mutex> guard(page_table_mutex_);
+                                    updateMode_(event_rec, reader.numInstsRead());
                                 }
                             }
                         }
@@ -119,13 +177,48 @@ namespace stf {
 
                 {
                     std::lock_guard<std::mutex> guard(page_table_mutex_);
-                    // Let the main thread know it doesn't need to use the mutex anymore
+                    // Let the main thread know it doesn't need to wait for the reader anymore
                     done_reading_ = true;
                 }
                 sync_cv_.notify_one();
             }
 
         public:
+            /**
+             * \class UpdateBuffer
+             * \brief Holds copies of the page translation records read by another reader, so that they can be
+             * applied to an inline page table later on in trace order
+             */
+            class UpdateBuffer {
+                private:
+                    friend class STFPTEReader;
+
+                    std::vector<std::pair<STFRecord::UniqueHandle, uint64_t>> updates_; /**< Records and the number of instructions read before each one */
+                    uint64_t num_insts_ = 0; /**< Number of instructions read by the time the last record was added */
+
+                public:
+                    /**
+                     * Clears the buffer. Must be called from the thread that filled it.
+                     */
+                    inline void clear() {
+                        updates_.clear();
+                        num_insts_ = 0;
+                    }
+
+                    /**
+                     * Copies the record into the buffer if it affects page translation
+                     * \param rec Record to process
+                     * \param num_insts_read Number of instructions read before the record
+                     */
+                    __attribute__((always_inline))
+                    inline void add(const STFRecord& rec, const uint64_t num_insts_read) {
+                        num_insts_ = num_insts_read;
+                        if(STF_EXPECT_FALSE(affectsTranslation_(rec))) {
+                            updates_.emplace_back(rec.clone(), num_insts_read);
+                        }
+                    }
+            };
+
             /**
              * Constructs an STFPTEReader
              */
@@ -158,10 +251,106 @@ namespace stf {
                 reader_thread_ = std::thread(&STFPTEReader::readerThread_, this, std::string(filename));
             }
 
+            /**
+             * Prepares the page table to be fed inline through update() instead of by a separate thread
+             * \param filename Trace that will be fed inline. Only opened if catchUp() needs to read skipped records.
+             * \param iem Initial IEM of the trace
+             */
+            inline void openInline(const std::string_view filename, const INST_IEM iem) {
+                close();
+                std::lock_guard<std::mutex> guard(page_table_mutex_);
+                page_table_.reset(iem);
+                last_valid_insts_ = 0;
+                done_reading_ = true;
+                filename_ = filename;
+                inline_num_insts_ = 0;
+            }
+
+            /**
+             * Updates the page table with a record from a trace opened with openInline(). Records that don't affect
+             * page translation are ignored. Must be called on every record in trace order.
+             * \param rec Record to process
+             * \param num_insts_read Number of instructions read before the record
+             */
+            __attribute__((always_inline))
+            inline void update(const STFRecord& rec, const uint64_t num_insts_read) {
+                inline_num_insts_ = std::max(inline_num_insts_, num_insts_read);
+
+                switch(rec.getId()) {
+                    case IntDescriptor::STF_PAGE_TABLE_WALK:
+                        {
+                            std::lock_guard<std::mutex> guard(page_table_mutex_);
+                            page_table_.update(rec.as<PageTableWalkRecord>());
+                        }
+                        break;
+                    case IntDescriptor::STF_INST_REG:
+                        if(const auto& reg_rec = rec.as<InstRegRecord>(); STF_EXPECT_FALSE(isSatpUpdate_(reg_rec))) {
+                            std::lock_guard<std::mutex> guard(page_table_mutex_);
+                            updateSatp_(reg_rec, num_insts_read);
+                        }
+                        break;
+                    case IntDescriptor::STF_EVENT:
+                        if(const auto& event_rec = rec.as<EventRecord>(); STF_EXPECT_FALSE(event_rec.isModeChange())) {
+                            std::lock_guard<std::mutex> guard(page_table_mutex_);
+                            updateMode_(event_rec, num_insts_read);
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+
+            /**
+             * Applies the records collected in an UpdateBuffer to a page table opened with openInline(). Buffers
+             * must be applied in trace order, and must not skip any records that haven't been fed already.
+             * \param buffer Buffer to apply
+             */
+            inline void update(const UpdateBuffer& buffer) {
+                for(const auto& [rec, num_insts_read]: buffer.updates_) {
+                    update(*rec, num_insts_read);
+                }
+                inline_num_insts_ = std::max(inline_num_insts_, buffer.num_insts_);
+            }
+
+            /**
+             * Feeds the records between the furthest point fed so far and the given instruction to a page table
+             * opened with openInline(). Called when the inline reader is about to skip ahead in the trace. Only the
+             * skipped records are read, and a trace position that has already been fed is never read again.
+             * \param num_insts Number of instructions the inline reader has read after skipping ahead
+             */
+            inline void catchUp(const uint64_t num_insts) {
+                if(STF_EXPECT_TRUE(num_insts <= inline_num_insts_)) {
+                    return;
+                }
+
+                if(!catch_up_reader_) {
+                    catch_up_reader_ = std::make_unique<STFReader>(filename_, true);
+                }
+
+                auto& reader = *catch_up_reader_;
+
+                // Everything up to inline_num_insts_ has already been fed
+                if(const size_t pos = reader.numInstsRead(); pos < inline_num_insts_) {
+                    reader.seek(inline_num_insts_ - pos);
+                }
+
+                STFRecord::UniqueHandle urec;
+                try {
+                    while(reader.numInstsRead() < num_insts) {
+                        reader >> urec;
+                        update(*urec, reader.numInstsRead());
+                    }
+                }
+                catch(const EOFException&) {
+                }
+            }
+
             /**
              * Closes the reader
              */
             inline void close() {
+                catch_up_reader_.reset();
+
                 // Reader thread is still running and/or needs cleanup
                 if(!done_reading_ || reader_thread_.joinable()) {
                     // Tell the thread to stop
@@ -176,23 +365,34 @@ namespace stf {
              */
             __attribute__((always_inline))
             inline uint64_t translate(const uint64_t va, const uint64_t index) const {
-                // If the reader thread has finished, there's no need to use the mutex anymore
-                if(done_reading_) {
-                    return page_table_.translate(va, index);
-                }
-
+                // Translating updates the page table's translation cache, so the mutex is needed even after the
+                // reader thread has finished
                 std::unique_lock lk(page_table_mutex_);
 
                 // We don't know when a table walk will happen in the trace, so wait until
                 // the reader thread has advanced past the current instruction index
-                sync_cv_.wait(lk, [this, index](){ return index <= this->last_valid_insts_ || this->done_reading_; });
+                if(STF_EXPECT_FALSE(!done_reading_)) {
+                    sync_cv_.wait(lk, [this, index](){ return index <= this->last_valid_insts_ || this->done_reading_; });
+                }
+
+                // We know the reader has valid translation info for the current index, so do the translation
+                return page_table_.translate(va, index);
+            }
 
-                // We know the reader has valid translation info for the current index, so grab the mutex and do
-                // the translation
-                const uint64_t pa = page_table_.translate(va, index);
-                lk.unlock();
+            /**
+             * Gets the number of translations that were served from the page table's translation cache
+             */
+            inline uint64_t getTranslationCacheHits() const {
+                std::lock_guard<std::mutex> guard(page_table_mutex_);
+                return page_table_.getTranslationCacheHits();
+            }
 
-                return pa;
+            /**
+             * Gets the number of translations that missed the page table's translation cache
+             */
+            inline uint64_t getTranslationCacheMisses() const {
+                std::lock_guard<std::mutex> guard(page_table_mutex_);
+                return page_table_.getTranslationCacheMisses();
             }
     };
 } // end namespace stf
@@ -121,6 +121,13 @@ namespace stf {
                 return stream_->getPC();
             }
 
+            /**
+             * Gets the PC of the next instruction
+             */
+            inline uint64_t getNextPC() const {
+                return stream_->getNextPC();
+            }
+
             /**
              * Dumps the header to the specified std::ostream
              * \param os ostream to use
@@ -61,6 +61,12 @@ namespace stf {
              */
             void initSimpleStreamAndOpenProcess_(std::string_view cmd, std::string_view filename);
 
+            /**
+             * Opens the specified gzip or xz file with an STFDecompressingIFstream
+             */
+            template<typename Decoder>
+            void initDecompressingStreamAndOpen_(std::string_view filename, bool force_single_threaded_stream);
+
             /**
              * Rewinds the underlying stream to the beginning
              */
@@ -173,6 +179,75 @@ namespace stf {
                 return stream_->tell();
             }
 
+            /**
+             * Gets the summaries for each compressed chunk in the trace, or an empty vector if the trace doesn't
+             * have them
+             */
+            inline const std::vector<ChunkSummary>& getChunkSummaries() const {
+                return stream_->getChunkSummaries();
+            }
+
+            /**
+             * Gets the state at the start of each compressed chunk in the trace, or an empty vector if the trace
+             * doesn't have it
+             */
+            inline const std::vector<ChunkStateSnapshot>& getChunkStateSnapshots() const {
+                return stream_->getChunkStateSnapshots();
+            }
+
+            /**
+             * Gets the number of compressed chunks in the trace. Uncompressed traces are treated as a single chunk.
+             */
+            inline size_t getNumChunks() const {
+                return stream_->getNumChunks();
+            }
+
+            /**
+             * Gets the number of marker records in each compressed chunk, or 0 if the trace isn't compressed
+             */
+            inline size_t getChunkSize() const {
+                return stream_->getChunkSize();
+            }
+
+            /**
+             * Reads a compressed chunk without decompressing it, e.g. to copy it into another trace. Returns false if
+             * the trace isn't compressed, the chunk is the last one in the trace, or the trace is being read from a
+             * pipe.
+             * \param chunk_idx Index of the chunk to read
+             * \param chunk Receives the chunk
+             */
+            inline bool readCompressedChunk(const size_t chunk_idx, CompressedChunk& chunk) {
+                return stream_->readCompressedChunk(chunk_idx, chunk);
+            }
+
+            /**
+             * Gets the hit, miss, and eviction counts of the decompressed chunk cache. The cache is sized by the
+             * STF_CHUNK_CACHE_MB environment variable and is disabled by default. Readers in this process that are
+             * reading the same trace share the cache, so the counts include their lookups too.
+             */
+            inline STFChunkCache::Stats getChunkCacheStats() const {
+                return stream_->getChunkCacheStats();
+            }
+
+            /**
+             * Gets the statistics of the decompressed chunk cache shared with other processes reading the same trace.
+             * The shared cache is sized by the STF_SHARED_CHUNK_CACHE_MB environment variable and is disabled by
+             * default.
+             */
+            inline STFSharedChunkCache::Stats getSharedChunkCacheStats() const {
+                return stream_->getSharedChunkCacheStats();
+            }
+
+            /**
+             * Sets whether records may hold views into the decompressed trace instead of copying their data.
+             * Currently used for vector register data. Has no effect on uncompressed traces. Defaults to the value
+             * of the STF_RECORD_VIEWS environment variable, and can be changed at any time after the trace is opened.
+             * \param use_record_views If true, enable record views
+             */
+            inline void setUseRecordViews(const bool use_record_views) {
+                stream_->setUseRecordViews(use_record_views);
+            }
+
             /**
              * Dumps the header to the specified std::ostream
              * \param os ostream to use
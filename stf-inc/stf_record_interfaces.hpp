@@ -253,6 +253,17 @@ namespace stf {
                 GenericAddressRecord<T, desc>::unpack_impl(reader);
                 reader.trackPC(*static_cast<T*>(this));
             }
+
+            /**
+             * Skips over a GenericPCTargetRecord in an STFIFstream without constructing it. The PC is still tracked.
+             * \param reader STFIFstream to use
+             */
+            __attribute__((always_inline))
+            static inline void skip(STFIFstream& reader) {
+                uint64_t addr;
+                GenericAddressRecord<T, desc>::read_(reader, addr);
+                reader.template trackSkippedPC<T>(addr);
+            }
     };
 
     /**
@@ -315,6 +326,18 @@ namespace stf {
                 reader.markerRecordCallback();
             }
 
+            /**
+             * Skips over a GenericOpcodeRecord in an STFIFstream without constructing it. The PC and the marker
+             * record count are still tracked.
+             * \param reader STFIFstream to use
+             */
+            __attribute__((always_inline))
+            static inline void skip(STFIFstream& reader) {
+                GenericSingleDataRecord<ClassT, OpcodeT, desc>::template skip_<OpcodeT>(reader);
+                reader.template trackSkippedPC<ClassT>();
+                reader.markerRecordCallback();
+            }
+
             /**
              * Gets the size of the opcode
              */
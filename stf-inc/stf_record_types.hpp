@@ -6,6 +6,7 @@
 #include <locale>
 #include <memory>
 #include <ostream>
+#include <span>
 #include <string>
 #include <tuple>
 #include <vector>
@@ -1023,6 +1024,15 @@ namespace stf {
                 read_(reader, hw_thread_id_, pid_, tid_);
             }
 
+            /**
+             * Skips over a ProcessIDExtRecord in an STFIFstream without unpacking it
+             * \param reader STFIFstream to use
+             */
+            __attribute__((always_inline))
+            static inline void skip(STFIFstream& reader) {
+                skip_<decltype(hw_thread_id_), decltype(pid_), decltype(tid_)>(reader);
+            }
+
             /**
              * Formats a ProcessIDExtRecord to an std::ostream
              * \param os ostream to use
@@ -1249,6 +1259,24 @@ namespace stf {
                 }
             }
 
+            /**
+             * Skips over an EventRecord in an STFIFstream without unpacking it
+             * \param reader STFIFstream to use
+             */
+            __attribute__((always_inline))
+            static inline void skip(STFIFstream& reader) {
+                if(reader.has32BitEvents()) {
+                    skip_<uint32_t>(reader);
+                }
+                else {
+                    skip_<TYPE>(reader);
+                }
+
+                uint8_t content_size;
+                read_(reader, content_size);
+                skip_<uint64_t>(reader, content_size);
+            }
+
             /**
              * Gets the event
              */
@@ -1403,13 +1431,64 @@ namespace stf {
         private:
             Registers::STF_REG reg_ = Registers::STF_REG::STF_REG_INVALID;         /**< operand register number */
             Registers::STF_REG_OPERAND_TYPE operand_type_ = Registers::STF_REG_OPERAND_TYPE::REG_RESERVED; /**< Whether this is a state, source, or dest */
-            VectorType data_ = VectorType(1); /**< Register record data */
+            mutable VectorType data_ = VectorType(1); /**< Register record data */
+            mutable std::shared_ptr<const ValueType> vector_view_; /**< Vector data viewed directly from the trace, if record views are enabled */
             mutable vlen_t vlen_ = 0;
 
             inline size_t calcVectorLen_() const {
                 return calcVectorLen(vlen_);
             }
 
+            /**
+             * Sets the record view that holds the vector data
+             * \param vector_view View to set
+             */
+            inline void setVectorView_(std::shared_ptr<const ValueType> vector_view) const {
+                vector_view_ = std::move(vector_view);
+                holds_view_ = static_cast<bool>(vector_view_);
+            }
+
+            /**
+             * Copies vector data held in a record view into data_ and releases the view
+             */
+            inline void materializeVectorData_() const {
+                if(STF_EXPECT_FALSE(vector_view_)) {
+                    const auto view_ptr = vector_view_.get();
+                    data_.assign(view_ptr, view_ptr + calcVectorLen_());
+                    setVectorView_(nullptr);
+                }
+            }
+
+            /**
+             * Unpacks an InstRegRecord from an STFIFstream that has record views enabled. Vector data is viewed in
+             * place instead of being copied.
+             * \param reader STFIFstream to use
+             */
+            inline void unpackView_(STFIFstream& reader) {
+                Registers::STF_REG_packed_int reg;
+                Registers::STF_REG_metadata_int reg_metadata;
+                read_(reader, reg, reg_metadata);
+                Registers::Codec::decode(reg, reg_metadata, reg_, operand_type_);
+
+                if(isVector()) {
+                    vlen_ = reader.getVLen();
+                    stf_assert(vlen_, "Attempted to read vector register without setting vlen first");
+                    const auto vector_len = calcVectorLen_();
+                    setVectorView_(readView_<ValueType>(reader, vector_len));
+                    if(vector_view_) {
+                        data_.resize(1);
+                        return;
+                    }
+                    data_.resize(vector_len);
+                    read_(reader, VectorView(data_, 0));
+                }
+                else {
+                    setVectorView_(nullptr);
+                    read_(reader, data_.front());
+                    data_.resize(1);
+                }
+            }
+
         public:
             InstRegRecord() = default;
 
@@ -1449,6 +1528,7 @@ namespace stf {
                           const Registers::STF_REG_OPERAND_TYPE operand_type) :
                 InstRegRecord(rec.reg_, operand_type, rec.data_)
             {
+                setVectorView_(rec.vector_view_);
                 vlen_ = rec.vlen_;
             }
 
@@ -1617,15 +1697,35 @@ namespace stf {
              */
             inline const VectorType& getVectorData() const {
                 stf_assert(isVector(), "Attempted to get vector data from a non-vector register");
+                materializeVectorData_();
                 return data_;
             }
 
+            /**
+             * Gets the vector register data. Unlike getVectorData(), data held in a record view is not copied.
+             */
+            inline std::span<const ValueType> getVectorDataView() const {
+                stf_assert(isVector(), "Attempted to get vector data from a non-vector register");
+                if(vector_view_) {
+                    return {vector_view_.get(), calcVectorLen_()};
+                }
+                return {data_.data(), data_.size()};
+            }
+
+            /**
+             * Returns whether the vector data is held in a record view
+             */
+            inline bool isVectorDataView() const {
+                return static_cast<bool>(vector_view_);
+            }
+
             /**
              * Sets the register data
              * \param data new value to set
              */
             inline void setVectorData(const VectorType& data) {
                 stf_assert(isVector(), "Attempted to set vector data on a scalar register");
+                materializeVectorData_();
                 stf_assert(data_.size() == data.size(), "Invalid data size for vector register");
                 data_ = data;
             }
@@ -1636,6 +1736,7 @@ namespace stf {
              */
             inline void setVectorData(const std::vector<ValueType>& data) {
                 stf_assert(isVector(), "Attempted to set vector data on a scalar register");
+                materializeVectorData_();
                 stf_assert(data_.size() == data.size(), "Invalid data size for vector register");
                 std::copy(data.begin(), data.end(), data_.begin());
             }
@@ -1648,6 +1749,7 @@ namespace stf {
                 stf_assert(reg_ == rhs.reg_,
                            "Attempted to copy from register " << rhs.reg_ << " into register " << reg_);
                 data_ = rhs.data_;
+                setVectorView_(rhs.vector_view_);
                 vlen_ = rhs.vlen_;
             }
 
@@ -1656,6 +1758,8 @@ namespace stf {
              * \param writer STFOFstream to use
              */
             inline void pack_impl(STFOFstream& writer) const {
+                materializeVectorData_();
+
                 // Pack everything including the first data record
                 write_(writer,
                        Registers::Codec::packRegNum(reg_),
@@ -1683,6 +1787,11 @@ namespace stf {
              */
             __attribute__((always_inline))
             inline void unpack_impl(STFIFstream& reader) {
+                if(STF_EXPECT_FALSE(reader.usesRecordViews())) {
+                    unpackView_(reader);
+                    return;
+                }
+
                 // Unpack assuming it's a scalar register record
                 Registers::STF_REG_packed_int reg;
                 Registers::STF_REG_metadata_int reg_metadata;
@@ -1701,6 +1810,28 @@ namespace stf {
                 }
             }
 
+            /**
+             * Skips over an InstRegRecord in an STFIFstream without unpacking its data
+             * \param reader STFIFstream to use
+             */
+            __attribute__((always_inline))
+            static inline void skip(STFIFstream& reader) {
+                // Only the register number is needed to tell how much vector data follows the first value
+                Registers::STF_REG_packed_int reg;
+                Registers::STF_REG_metadata_int reg_metadata;
+                ValueType first_value;
+                Registers::STF_REG regno;
+                Registers::STF_REG_OPERAND_TYPE operand_type;
+                read_(reader, reg, reg_metadata, first_value);
+                Registers::Codec::decode(reg, reg_metadata, regno, operand_type);
+
+                if(STF_EXPECT_FALSE(Registers::isVector(regno))) {
+                    const auto vlen = reader.getVLen();
+                    stf_assert(vlen, "Attempted to read vector register without setting vlen first");
+                    skip_<ValueType>(reader, calcVectorLen(vlen) - 1);
+                }
+            }
+
             /**
              * Formats an InstRegRecord to an std::ostream
              * \param os ostream to use
@@ -1711,9 +1842,10 @@ namespace stf {
                     ss << operand_type_ << ' ' << reg_ << ' ';
                     const size_t padding = static_cast<size_t>(ss.tellp());
                     os << ss.str();
-                    format_utils::formatHex(os, data_.front());
+                    const auto data = getVectorDataView();
+                    format_utils::formatHex(os, data.front());
 
-                    for(auto it = std::next(data_.begin()); it != data_.end(); ++it) {
+                    for(auto it = std::next(data.begin()); it != data.end(); ++it) {
                         os << std::endl;
                         format_utils::formatSpaces(os, padding);
                         format_utils::formatHex(os, *it);
@@ -1765,6 +1897,7 @@ namespace stf {
              */
             inline void setVLen(const vlen_t vlen) const {
                 stf_assert(isVector(), "VLen should only be set on vector register records");
+                materializeVectorData_();
                 vlen_ = vlen;
                 stf_assert(vlen_, "VLen cannot be 0");
                 const auto expected_vector_len = calcVectorLen_();
@@ -1805,6 +1938,15 @@ namespace stf {
              * Gets the data
              */
             uint64_t getData() const { return GenericSingleDataRecord::getData_(); }
+
+            /**
+             * Skips over an InstMemContentRecord in an STFIFstream without unpacking it
+             * \param reader STFIFstream to use
+             */
+            __attribute__((always_inline))
+            static inline void skip(STFIFstream& reader) {
+                skip_<uint64_t>(reader);
+            }
     };
 
     REGISTER_RECORD(InstMemContentRecord)
@@ -1919,6 +2061,15 @@ namespace stf {
                 read_(reader, address_, size_, attr_, type_);
             }
 
+            /**
+             * Skips over an InstMemAccessRecord in an STFIFstream without unpacking it
+             * \param reader STFIFstream to use
+             */
+            __attribute__((always_inline))
+            static inline void skip(STFIFstream& reader) {
+                skip_<decltype(address_), decltype(size_), decltype(attr_), decltype(type_)>(reader);
+            }
+
             /**
              * Formats an InstMemAccessRecord to an std::ostream
              * \param os ostream to use
@@ -2054,6 +2205,15 @@ namespace stf {
                 read_(reader, size_, microop_);
             }
 
+            /**
+             * Skips over an InstMicroOpRecord in an STFIFstream without unpacking it
+             * \param reader STFIFstream to use
+             */
+            __attribute__((always_inline))
+            static inline void skip(STFIFstream& reader) {
+                skip_<decltype(size_), decltype(microop_)>(reader);
+            }
+
             /**
              * Formats an InstMicroOpRecord to an std::ostream
              * \param os ostream to use
@@ -2097,6 +2257,15 @@ namespace stf {
              * Gets the register number
              */
             uint16_t getReg() const { return GenericSingleDataRecord::getData_(); }
+
+            /**
+             * Skips over an InstReadyRegRecord in an STFIFstream without unpacking it
+             * \param reader STFIFstream to use
+             */
+            __attribute__((always_inline))
+            static inline void skip(STFIFstream& reader) {
+                skip_<uint16_t>(reader);
+            }
     };
 
     REGISTER_RECORD(InstReadyRegRecord)
@@ -2168,6 +2337,20 @@ namespace stf {
                 read_(reader, address_, size_, src_type_, src_idx_, attr_, access_type_);
             }
 
+            /**
+             * Skips over a BusMasterAccessRecord in an STFIFstream without unpacking it
+             * \param reader STFIFstream to use
+             */
+            __attribute__((always_inline))
+            static inline void skip(STFIFstream& reader) {
+                skip_<decltype(address_),
+                      decltype(size_),
+                      decltype(src_type_),
+                      decltype(src_idx_),
+                      decltype(attr_),
+                      decltype(access_type_)>(reader);
+            }
+
             /**
              * Formats a BusMasterAccessRecord to an std::ostream
              * \param os ostream to use
@@ -2213,6 +2396,15 @@ namespace stf {
              * Gets the data
              */
             uint64_t getData() const { return GenericSingleDataRecord::getData_(); }
+
+            /**
+             * Skips over a BusMasterContentRecord in an STFIFstream without unpacking it
+             * \param reader STFIFstream to use
+             */
+            __attribute__((always_inline))
+            static inline void skip(STFIFstream& reader) {
+                skip_<uint64_t>(reader);
+            }
     };
 
     REGISTER_RECORD(BusMasterContentRecord)
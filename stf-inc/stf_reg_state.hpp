@@ -9,8 +9,17 @@
 #ifndef __STF_REG_STATE_HPP__
 #define __STF_REG_STATE_HPP__
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cstdint>
+#include <limits>
+#include <span>
+#include <sstream>
 #include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include "boost_wrappers/flat_map.hpp"
 
@@ -106,34 +115,157 @@ namespace stf {
     /**
      * \typedef RegStateMap
      * Maps Registers::STF_REG to corresponding InstRegRecord
+     * \deprecated STFRegState no longer stores its state in a RegStateMap. applyRegState callbacks should take a
+     * const InstRegRecord& instead of a RegStateMap::value_type.
      */
-    using RegStateMap = boost::container::flat_map<Registers::STF_REG, STFRecord::Handle<InstRegRecord>>;
+    using RegStateMap [[deprecated("STFRegState no longer uses RegStateMap")]] =
+        boost::container::flat_map<Registers::STF_REG, STFRecord::Handle<InstRegRecord>>;
 
     /**
      * \typedef RegBankMap
      * Maps Registers::STF_REG to corresponding RegMapInfo
+     * \deprecated STFRegState no longer stores its register bank in a RegBankMap
      */
-    using RegBankMap = boost::container::flat_map<Registers::STF_REG, RegMapInfo>;
+    using RegBankMap [[deprecated("STFRegState no longer uses RegBankMap")]] =
+        boost::container::flat_map<Registers::STF_REG, RegMapInfo>;
 
     /**
      * \class STFRegState
      *
      * Class that holds register state information
+     *
+     * Register values are kept in flat arrays indexed by a dense register code. GPRs (plus the PC), FPRs and vector
+     * registers each have a fixed block of codes, followed by one code for every CSR address. A slot table maps each
+     * code onto its RegMapInfo and scalar value, so lookups never search and copying the state is a few memcpys.
      */
     class STFRegState {
         private:
-            RegStateMap regstate_;
-            RegBankMap regbank_;
+            static constexpr size_t NUM_BANK_REGS_ = 32; /**< Number of registers in the FPR and vector banks */
+            static constexpr size_t NUM_GPRS_ = NUM_BANK_REGS_ + 1; /**< Number of GPR codes (the PC is encoded as GPR 32) */
+            static constexpr size_t NUM_CSRS_ = 4096; /**< Number of CSR addresses */
+            static constexpr size_t GPR_BASE_ = 0; /**< First GPR code */
+            static constexpr size_t FPR_BASE_ = GPR_BASE_ + NUM_GPRS_; /**< First FPR code */
+            static constexpr size_t VECTOR_BASE_ = FPR_BASE_ + NUM_BANK_REGS_; /**< First vector register code */
+            static constexpr size_t CSR_BASE_ = VECTOR_BASE_ + NUM_BANK_REGS_; /**< First CSR code */
+            static constexpr size_t NUM_CODES_ = CSR_BASE_ + NUM_CSRS_; /**< Total number of register codes */
+            static constexpr size_t INVALID_CODE_ = NUM_CODES_; /**< Code returned for unrepresentable registers */
+            static constexpr uint16_t INVALID_SLOT_ = std::numeric_limits<uint16_t>::max(); /**< Slot value for unknown registers */
+            static constexpr size_t VALID_WORD_BITS_ = byte_utils::bitSize<uint64_t>(); /**< Bits per word in the valid bitset */
+            static constexpr size_t NUM_VALID_WORDS_ = (NUM_CODES_ + VALID_WORD_BITS_ - 1) / VALID_WORD_BITS_; /**< Size of the valid bitset */
+
+            static_assert(NUM_CODES_ < INVALID_SLOT_, "Register slots must fit in a uint16_t");
+
+            std::array<uint16_t, NUM_CODES_> slots_; /**< Maps register codes to slots */
+            std::vector<RegMapInfo> reg_info_; /**< Mapping info for each slot */
+            std::vector<uint64_t> values_; /**< Scalar value for each slot */
+            std::array<uint64_t, NUM_VALID_WORDS_> valid_{}; /**< Bitset of register codes that have a value */
+            size_t num_valid_ = 0; /**< Number of register codes that have a value */
+            std::vector<uint64_t> vector_values_; /**< Vector register bank, vector_len_ words per register */
+            size_t vector_len_ = 0; /**< Number of words in each vector register */
+            vlen_t vlen_ = 0; /**< Vector length that the vector register values were recorded with */
+
+            /**
+             * Converts a register number to its dense code. Returns INVALID_CODE_ if the register can't be represented.
+             * \param reg register number
+             */
+            static inline size_t getCode_(const Registers::STF_REG reg) {
+                const size_t reg_num = Registers::Codec::packRegNum(reg);
+                switch(Registers::Codec::getRegType(reg)) {
+                    case Registers::STF_REG_TYPE::INTEGER:
+                        return STF_EXPECT_TRUE(reg_num < NUM_GPRS_) ? GPR_BASE_ + reg_num : INVALID_CODE_;
+                    case Registers::STF_REG_TYPE::FLOATING_POINT:
+                        return STF_EXPECT_TRUE(reg_num < NUM_BANK_REGS_) ? FPR_BASE_ + reg_num : INVALID_CODE_;
+                    case Registers::STF_REG_TYPE::VECTOR:
+                        return STF_EXPECT_TRUE(reg_num < NUM_BANK_REGS_) ? VECTOR_BASE_ + reg_num : INVALID_CODE_;
+                    case Registers::STF_REG_TYPE::CSR:
+                        return STF_EXPECT_TRUE(reg_num < NUM_CSRS_) ? CSR_BASE_ + reg_num : INVALID_CODE_;
+                    default:
+                        return INVALID_CODE_;
+                }
+            }
+
+            /**
+             * Gets the slot for a register code, or INVALID_SLOT_ if the register isn't in the register bank
+             * \param code register code
+             */
+            inline uint16_t getSlot_(const size_t code) const {
+                return STF_EXPECT_TRUE(code != INVALID_CODE_) ? slots_[code] : INVALID_SLOT_;
+            }
+
+            /**
+             * Gets the slot for a register code, throwing an exception if the register isn't in the register bank
+             * \param reg register number
+             * \param code register code
+             */
+            inline uint16_t findSlot_(const Registers::STF_REG reg, const size_t code) const {
+                const auto slot = getSlot_(code);
+                if(STF_EXPECT_FALSE(slot == INVALID_SLOT_)) {
+                    throw RegNotFoundException(reg);
+                }
+                return slot;
+            }
+
+            /**
+             * Checks whether a register code has a value
+             * \param code register code
+             */
+            inline bool isValid_(const size_t code) const {
+                return (valid_[code / VALID_WORD_BITS_] >> (code % VALID_WORD_BITS_)) & 1;
+            }
+
+            /**
+             * Marks a register code as having a value
+             * \param code register code
+             */
+            inline void setValid_(const size_t code) {
+                auto& word = valid_[code / VALID_WORD_BITS_];
+                const uint64_t bit = 1ULL << (code % VALID_WORD_BITS_);
+                num_valid_ += !(word & bit);
+                word |= bit;
+            }
+
+            /**
+             * Clears the register bank
+             */
+            inline void clearRegBank_() {
+                slots_.fill(INVALID_SLOT_);
+                // GPR, FPR and vector register slots are preallocated so that their values stay contiguous
+                reg_info_.assign(CSR_BASE_, RegMapInfo(Registers::STF_REG::STF_REG_INVALID));
+                values_.assign(CSR_BASE_, 0);
+            }
+
+            /**
+             * Adds a register to the register bank. Registers that are already in the bank are left as-is.
+             * Returns the register's slot.
+             * \param info register mapping info
+             */
+            inline uint16_t insertRegister_(const RegMapInfo& info) {
+                const auto reg = info.getReg();
+                const auto code = getCode_(reg);
+                stf_assert(code != INVALID_CODE_, "Register " << reg << " cannot be stored in the register state");
+
+                auto& slot = slots_[code];
+                if(slot == INVALID_SLOT_) {
+                    if(code < CSR_BASE_) {
+                        slot = static_cast<uint16_t>(code);
+                        reg_info_[slot] = info;
+                    }
+                    else {
+                        slot = static_cast<uint16_t>(reg_info_.size());
+                        reg_info_.emplace_back(info);
+                        values_.emplace_back(0);
+                    }
+                }
+                return slot;
+            }
 
             /**
              * Inserts a simple (non-mapped) register
              * \param reg register number
              * \param mask mask to apply to register values
              */
-            inline auto insertSimpleRegister_(const Registers::STF_REG reg, const uint64_t mask = RegMapInfo::MASK64) {
-                return regbank_.emplace(std::piecewise_construct,
-                                        std::forward_as_tuple(reg),
-                                        std::forward_as_tuple(reg, mask));
+            inline uint16_t insertSimpleRegister_(const Registers::STF_REG reg, const uint64_t mask = RegMapInfo::MASK64) {
+                return insertRegister_(RegMapInfo(reg, mask));
             }
 
             /**
@@ -143,49 +275,94 @@ namespace stf {
              * \param mask mask to apply to field values
              * \param shift shift to apply to field values
              */
-            inline auto insertMappedRegister_(const Registers::STF_REG reg,
-                                              const Registers::STF_REG mapped_reg,
-                                              const uint64_t mask,
-                                              const uint32_t shift = 0) {
+            inline uint16_t insertMappedRegister_(const Registers::STF_REG reg,
+                                                  const Registers::STF_REG mapped_reg,
+                                                  const uint64_t mask,
+                                                  const uint32_t shift = 0) {
                 stf_assert(!Registers::isVector(reg), "Mapped vector registers are not currently supported");
-                return regbank_.emplace(std::piecewise_construct,
-                                        std::forward_as_tuple(reg),
-                                        std::forward_as_tuple(reg, mapped_reg, mask, shift));
+                return insertRegister_(RegMapInfo(reg, mapped_reg, mask, shift));
             }
 
             /**
-             * Looks up a register in a map, throwing an exception if it isn't found
-             * \param map Map to use
-             * \param reg Register number
+             * Copies a vector register value into the vector register bank
+             * \param code register code
+             * \param rec record holding the value
              */
-            template<typename MapType>
-            static inline typename MapType::const_iterator find_(const MapType& map, const Registers::STF_REG reg) {
-                auto it = map.find(reg);
-                if(STF_EXPECT_FALSE(it == map.end())) {
-                    throw RegNotFoundException(reg);
+            inline void setVectorValue_(const size_t code, const InstRegRecord& rec) {
+                const auto data = rec.getVectorDataView();
+                if(STF_EXPECT_FALSE(data.size() != vector_len_)) {
+                    // The vector length changed, so values recorded with the old length are meaningless
+                    for(size_t i = VECTOR_BASE_; i < VECTOR_BASE_ + NUM_BANK_REGS_; ++i) {
+                        auto& word = valid_[i / VALID_WORD_BITS_];
+                        const uint64_t bit = 1ULL << (i % VALID_WORD_BITS_);
+                        num_valid_ -= static_cast<bool>(word & bit);
+                        word &= ~bit;
+                    }
+                    vector_len_ = data.size();
+                    vector_values_.assign(NUM_BANK_REGS_ * vector_len_, 0);
                 }
-                return it;
+                vlen_ = rec.getVLen();
+                std::copy(data.begin(), data.end(), vector_values_.data() + (code - VECTOR_BASE_) * vector_len_);
             }
 
             /**
-             * Looks up a register in a map, throwing an exception if it isn't found
-             * \param map Map to use
-             * \param reg Register number
+             * Gets the value of a vector register
+             * \param code register code
              */
-            template<typename MapType>
-            static inline typename MapType::iterator find_(MapType& map, const Registers::STF_REG reg) {
-                auto it = map.find(reg);
-                if(STF_EXPECT_FALSE(it == map.end())) {
-                    throw RegNotFoundException(reg);
+            inline std::span<const uint64_t> getVectorValue_(const size_t code) const {
+                return std::span<const uint64_t>(vector_values_).subspan((code - VECTOR_BASE_) * vector_len_, vector_len_);
+            }
+
+            /**
+             * Iterates over the register state in register number order, passing a REG_STATE InstRegRecord holding
+             * each register value to a callback function
+             * \param func Callback function
+             */
+            template<typename FuncType>
+            inline void applyRegState_(FuncType&& func) const {
+                for(size_t i = 0; i < NUM_VALID_WORDS_; ++i) {
+                    for(uint64_t word = valid_[i]; word; word &= word - 1) {
+                        const size_t code = i * VALID_WORD_BITS_ + static_cast<size_t>(std::countr_zero(word));
+                        const auto slot = slots_[code];
+                        const auto reg = reg_info_[slot].getReg();
+
+                        if(STF_EXPECT_FALSE(code >= VECTOR_BASE_ && code < CSR_BASE_)) {
+                            const auto data = getVectorValue_(code);
+                            const InstRegRecord rec(reg,
+                                                    Registers::STF_REG_OPERAND_TYPE::REG_STATE,
+                                                    InstRegRecord::VectorType(data.begin(), data.end()));
+                            if(vlen_) {
+                                rec.setVLen(vlen_);
+                            }
+                            func(rec);
+                        }
+                        else {
+                            func(InstRegRecord(reg, Registers::STF_REG_OPERAND_TYPE::REG_STATE, values_[slot]));
+                        }
+                    }
                 }
-                return it;
+            }
+
+            /**
+             * Iterates over the register state, passing (register, record handle) pairs to a callback written against
+             * the RegStateMap-based interface. Each record is a pool-allocated copy. Deprecated along with RegStateMap.
+             * \param func Callback function
+             */
+            template<typename FuncType>
+            inline void applyLegacyRegState_(FuncType&& func) const {
+                applyRegState_(
+                    [&func](const InstRegRecord& rec) {
+                        const std::pair<Registers::STF_REG, STFRecord::Handle<InstRegRecord>> entry(rec.getReg(), rec.copy());
+                        func(entry);
+                    }
+                );
             }
 
         public:
             /**
              * \class RegNotFoundException
              *
-             * Exception type thrown by getRegScalarValue/getRegVectorValue if a register is not found
+             * Exception type thrown by getRegScalarValue/getRegVectorView if a register is not found
              */
             class RegNotFoundException : public std::exception {
                 private:
@@ -246,14 +423,7 @@ namespace stf {
             /**
              * Copy assignment operator
              */
-            STFRegState& operator=(const STFRegState& rhs) {
-                regbank_ = rhs.regbank_;
-                regstate_.clear();
-                for(const auto& r: rhs.regstate_) {
-                    regstate_.emplace(r.first, r.second->copy());
-                }
-                return *this;
-            }
+            STFRegState& operator=(const STFRegState& rhs) = default;
 
             /**
              * Reinitializes state
@@ -276,7 +446,8 @@ namespace stf {
              * Clears register value state
              */
             inline void stateClear() {
-                regstate_.clear();
+                valid_.fill(0);
+                num_valid_ = 0;
             }
 
             /**
@@ -284,7 +455,10 @@ namespace stf {
              */
             inline void clear() {
                 stateClear();
-                regbank_.clear();
+                clearRegBank_();
+                vector_values_.clear();
+                vector_len_ = 0;
+                vlen_ = 0;
             }
 
             /**
@@ -293,48 +467,35 @@ namespace stf {
              */
             inline void regStateUpdate(const InstRegRecord& rec) {
                 const auto reg_num = rec.getReg();
-                RegBankMap::iterator rbit;
-                try {
-                    rbit = find_(regbank_, reg_num);
-                }
-                catch(const RegNotFoundException&) {
+                const auto code = getCode_(reg_num);
+                auto slot = getSlot_(code);
+
+                if(STF_EXPECT_FALSE(slot == INVALID_SLOT_)) {
                     if(!Registers::Codec::isNonstandardCSR(reg_num)) {
-                        throw;
+                        throw RegNotFoundException(reg_num);
                     }
                     // It's a nonstandard (e.g. vendor-specific) CSR. Go ahead and register it.
-                    rbit = insertSimpleRegister_(reg_num).first;
+                    slot = insertSimpleRegister_(reg_num);
                 }
 
-                const Registers::STF_REG mapped_reg_num = rbit->second.getMappedReg();
-
                 // If reg_num != mapped_reg_num, that means this register is mapped as a field of another, larger register
                 // In this case, we also need to update the mapped register value
-                if(STF_EXPECT_FALSE(reg_num != mapped_reg_num)) {
-                    const auto mapped_it = regstate_.find(mapped_reg_num);
-                    // Insert the map entry if it doesn't exist
-                    if(STF_EXPECT_FALSE(mapped_it == regstate_.end())) {
-                        regstate_.emplace(mapped_reg_num,
-                                          InstRegRecord::make(mapped_reg_num,
-                                                              Registers::STF_REG_OPERAND_TYPE::REG_STATE,
-                                                              rbit->second.apply(0, rec.getScalarData())));
-                    }
-                    // Otherwise update the entry
-                    else {
-                        auto& mapped_reg = *mapped_it->second;
-                        mapped_reg.setScalarData(rbit->second.apply(mapped_reg.getScalarData(), rec.getScalarData()));
-                    }
+                if(const auto& info = reg_info_[slot]; STF_EXPECT_FALSE(info.getMappedReg() != reg_num)) {
+                    const auto field_info = info;
+                    const auto mapped_code = getCode_(field_info.getMappedReg());
+                    const auto mapped_slot = insertSimpleRegister_(field_info.getMappedReg());
+                    const uint64_t parent_val = isValid_(mapped_code) ? values_[mapped_slot] : 0;
+                    values_[mapped_slot] = field_info.apply(parent_val, rec.getScalarData());
+                    setValid_(mapped_code);
                 }
 
-                const auto it = regstate_.find(reg_num);
-                // Insert the entry if it doesn't exist
-                if(STF_EXPECT_FALSE(it == regstate_.end())) {
-                    regstate_.emplace(reg_num,
-                                      InstRegRecord::make(rec, Registers::STF_REG_OPERAND_TYPE::REG_STATE));
+                if(STF_EXPECT_FALSE(rec.isVector())) {
+                    setVectorValue_(code, rec);
                 }
-                // Otherwise update the entry
                 else {
-                    it->second->copyFrom(rec);
+                    values_[slot] = rec.getScalarData();
                 }
+                setValid_(code);
             }
 
             /**
@@ -342,38 +503,55 @@ namespace stf {
              * \param regno Register number to look up
              */
             inline uint64_t getRegScalarValue(const Registers::STF_REG regno) const {
-                Registers::STF_REG mapped_reg;
+                const auto& info = reg_info_[findSlot_(regno, getCode_(regno))];
+                const auto mapped_reg = info.getMappedReg();
+                const auto mapped_code = getCode_(mapped_reg);
+                const auto mapped_slot = findSlot_(mapped_reg, mapped_code);
 
-                const auto rbit = find_(regbank_, regno);
-                mapped_reg = rbit->second.getMappedReg();
-
-                const auto it = find_(regstate_, mapped_reg);
-                return (it->second->getScalarData() >> rbit->second.getShiftBits()) & rbit->second.getMask();
+                if(STF_EXPECT_FALSE(!isValid_(mapped_code))) {
+                    throw RegNotFoundException(mapped_reg);
+                }
+                return (values_[mapped_slot] >> info.getShiftBits()) & info.getMask();
             }
 
             /**
-             * Gets register value (vector version)
+             * Gets register value (vector version) without copying it
              * \param regno Register number to look up
              */
-            const InstRegRecord::VectorType& getRegVectorValue(const Registers::STF_REG regno) const {
-                Registers::STF_REG mapped_reg;
+            inline std::span<const uint64_t> getRegVectorView(const Registers::STF_REG regno) const {
+                const auto code = getCode_(regno);
+                findSlot_(regno, code);
 
-                const auto rbit = find_(regbank_, regno);
-                mapped_reg = rbit->second.getMappedReg();
+                if(STF_EXPECT_FALSE(!Registers::isVector(regno) || !isValid_(code))) {
+                    throw RegNotFoundException(regno);
+                }
+                return getVectorValue_(code);
+            }
 
-                const auto it = find_(regstate_, mapped_reg);
-                return it->second->getVectorData();
+            /**
+             * Gets register value (vector version)
+             * \param regno Register number to look up
+             * \deprecated Returns a copy of the value. Use getRegVectorView instead.
+             */
+            [[deprecated("Use getRegVectorView instead")]]
+            inline InstRegRecord::VectorType getRegVectorValue(const Registers::STF_REG regno) const {
+                const auto data = getRegVectorView(regno);
+                return InstRegRecord::VectorType(data.begin(), data.end());
             }
 
             /**
-             * Iterates over the register state, applying a callback function to each entry
+             * Iterates over the register state in register number order, applying a callback function to each entry.
+             * The callback receives a REG_STATE InstRegRecord holding the register value. Callbacks that take a
+             * RegStateMap::value_type are still accepted, but are deprecated.
              * \param func Callback function
              */
             template<typename FuncType>
-            __attribute__((always_inline))
             inline void applyRegState(FuncType&& func) const {
-                for(const auto& r: regstate_) {
-                    func(r);
+                if constexpr(std::is_invocable_v<FuncType&, const InstRegRecord&>) {
+                    applyRegState_(func);
+                }
+                else {
+                    applyLegacyRegState_(func);
                 }
             }
 
@@ -381,7 +559,7 @@ namespace stf {
              * Gets the number of register states currently stored
              */
             inline size_t size() const {
-                return regstate_.size();
+                return num_valid_;
             }
 
             /**
@@ -0,0 +1,194 @@
+#ifndef __STF_SHARED_CHUNK_CACHE_HPP__
+#define __STF_SHARED_CHUNK_CACHE_HPP__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+
+#include <sys/stat.h>
+
+#include "stf_compression_buffer.hpp"
+
+namespace stf {
+    /**
+     * \class STFSharedChunkCache
+     *
+     * Cache of decompressed chunks that lives in a POSIX shared memory region, so that every process reading the same
+     * trace on a host can reuse the chunks the others have already decompressed. The region is named after the
+     * identity of the trace file (device, inode, size and modification time), and is split into fixed-size slots
+     * that are each keyed by a chunk index.
+     *
+     * A process that misses in the cache reserves a slot for the chunk, decompresses it, and publishes it into the
+     * slot. Other processes that want the same chunk in the meantime wait for it to be published instead of
+     * decompressing it themselves. Readers hold a reference to a slot while copying out of it, and slots are evicted
+     * in least recently used order among those that aren't referenced. Each reference records the process that holds
+     * it, so references left behind by processes that have exited are dropped once every slot is in use.
+     * Reservations held by processes that have exited are reclaimed by the next process that wants the chunk, and a
+     * process only publishes into a slot if its reservation is still intact.
+     *
+     * The first process to open the region decides its size. The region is removed when the last process using it
+     * closes it. If a process dies without closing it, the region stays behind in /dev/shm under a name starting with
+     * stf-chunks- until it is removed by hand.
+     */
+    class STFSharedChunkCache {
+        public:
+            static constexpr size_t NO_SLOT = std::numeric_limits<size_t>::max(); /**< Returned by find() when no slot could be reserved */
+
+            /**
+             * \struct Stats
+             * Snapshot of the cache statistics, as seen by this process
+             */
+            struct Stats {
+                size_t num_slots = 0; /**< Number of chunk slots in the region */
+                size_t slot_size = 0; /**< Size of each slot in bytes */
+                size_t hits = 0; /**< Number of chunks copied out of the cache */
+                size_t misses = 0; /**< Number of chunks this process had to decompress */
+                size_t waits = 0; /**< Number of lookups that waited for another process to publish a chunk */
+                size_t num_published = 0; /**< Number of chunks this process published */
+                size_t num_bypassed = 0; /**< Number of misses that couldn't reserve a slot because every slot was in use */
+            };
+
+        private:
+            struct Header;
+            struct Slot;
+
+            std::string name_; /**< Name of the shared memory region */
+            void* region_ = nullptr; /**< Start of the mapped region */
+            size_t region_size_ = 0; /**< Size of the mapped region */
+            Header* header_ = nullptr; /**< Region header */
+            Slot* slots_ = nullptr; /**< Slot table */
+            uint8_t* data_ = nullptr; /**< Start of the slot data */
+            size_t num_slots_ = 0; /**< Number of slots */
+            size_t slot_size_ = 0; /**< Size of each slot in bytes */
+
+            std::atomic<size_t> hits_ = 0; /**< Number of hits */
+            std::atomic<size_t> misses_ = 0; /**< Number of misses */
+            std::atomic<size_t> waits_ = 0; /**< Number of lookups that waited on another process */
+            std::atomic<size_t> num_published_ = 0; /**< Number of chunks published */
+            std::atomic<size_t> num_bypassed_ = 0; /**< Number of misses that couldn't reserve a slot */
+
+            STFSharedChunkCache() = default;
+
+            /**
+             * Maps an open shared memory region, initializing it first if this process created it
+             * \param fd File descriptor of the region
+             * \param created True if this process created the region
+             * \param region_size Size of the region, if this process created it
+             * \param num_slots Number of slots, if this process created it
+             * \param slot_size Slot size, if this process created it
+             * \returns False if the region couldn't be mapped or is invalid
+             */
+            bool map_(int fd, bool created, size_t region_size, size_t num_slots, size_t slot_size);
+
+            /**
+             * Locks the region mutex, recovering it if its previous owner died while holding it
+             */
+            void lock_();
+
+            /**
+             * Unlocks the region mutex
+             */
+            void unlock_();
+
+            /**
+             * Waits for another process to publish a chunk. Must be called with the region mutex held.
+             */
+            void wait_();
+
+            /**
+             * Wakes up processes waiting for a chunk. Must be called with the region mutex held.
+             */
+            void notify_();
+
+            /**
+             * Adds a reference to a slot on behalf of this process. Must be called with the region mutex held.
+             * \param slot Slot to reference
+             * \returns Index of the reader entry holding the reference, or NO_SLOT if every entry is in use
+             */
+            static size_t addReader_(Slot& slot);
+
+            /**
+             * Drops a reference added by addReader_(). Must be called with the region mutex held.
+             * \param slot Referenced slot
+             * \param reader Reader entry returned by addReader_()
+             */
+            static void removeReader_(Slot& slot, size_t reader);
+
+            /**
+             * Drops the references to a slot held by processes that have exited. Must be called with the region mutex
+             * held.
+             * \param slot Slot to check
+             * \returns True if any references were dropped
+             */
+            static bool reclaimReaders_(Slot& slot);
+
+            /**
+             * Returns whether this process still holds the reservation it made for a chunk. Must be called with the
+             * region mutex held.
+             * \param slot Reserved slot
+             * \param chunk_idx Chunk the slot was reserved for
+             */
+            static bool ownsSlot_(const Slot& slot, size_t chunk_idx);
+
+            /**
+             * Gets the size of a region with the given geometry
+             * \param num_slots Number of slots
+             * \param slot_size Slot size
+             */
+            static size_t getRegionSize_(size_t num_slots, size_t slot_size);
+
+        public:
+            STFSharedChunkCache(const STFSharedChunkCache&) = delete;
+            STFSharedChunkCache& operator=(const STFSharedChunkCache&) = delete;
+
+            ~STFSharedChunkCache();
+
+            /**
+             * Opens the shared cache for a trace file, creating it if no other process has. Returns nullptr and prints
+             * a warning if the cache can't be used, in which case chunks should just be decompressed as usual.
+             * \param file_stat Result of calling fstat() on the trace file
+             * \param num_bytes Size of the region to create
+             * \param max_chunk_size Size of the largest decompressed chunk in the trace
+             */
+            static std::unique_ptr<STFSharedChunkCache> open(const struct stat& file_stat,
+                                                             size_t num_bytes,
+                                                             size_t max_chunk_size);
+
+            /**
+             * Looks up a chunk, waiting for it if another process is decompressing it. On a hit the chunk is appended
+             * to buf, which must already be large enough and not shared with anything. On a miss, a slot is reserved
+             * for the chunk if possible. The caller must then either publish() the chunk into it or abandon() it.
+             * \param chunk_idx Chunk index
+             * \param buf Buffer that receives the chunk
+             * \param reserved_slot Set to the slot reserved on a miss, or NO_SLOT
+             * \returns True if the chunk was found
+             */
+            bool find(size_t chunk_idx, STFCompressionBuffer& buf, size_t& reserved_slot);
+
+            /**
+             * Publishes a decompressed chunk into a slot reserved by find(). Nothing is published if the reservation
+             * was reclaimed in the meantime.
+             * \param slot Reserved slot
+             * \param chunk_idx Chunk the slot was reserved for
+             * \param buf Buffer holding the decompressed chunk
+             */
+            void publish(size_t slot, size_t chunk_idx, const STFCompressionBuffer& buf);
+
+            /**
+             * Gives up a slot reserved by find() without publishing anything into it
+             * \param slot Reserved slot
+             * \param chunk_idx Chunk the slot was reserved for
+             */
+            void abandon(size_t slot, size_t chunk_idx);
+
+            /**
+             * Gets a snapshot of the cache statistics
+             */
+            Stats getStats() const;
+    };
+} // end namespace stf
+
+#endif
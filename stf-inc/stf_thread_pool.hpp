@@ -0,0 +1,133 @@
+#ifndef __STF_THREAD_POOL_HPP__
+#define __STF_THREAD_POOL_HPP__
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+
+namespace stf {
+    /**
+     * \class STFThreadPool
+     *
+     * Process-wide pool of helper threads used for background work, such as compressing and decompressing
+     * chunks in compressed STF streams.
+     *
+     * The maximum number of helper threads defaults to the number of hardware threads, and can be capped with the
+     * STF_NUM_HELPER_THREADS environment variable or setNumThreads(). Threads are started lazily as jobs are
+     * submitted, so the pool never runs more threads than it needs.
+     */
+    class STFThreadPool {
+        public:
+            /**
+             * \struct Stats
+             * Snapshot of the thread pool state
+             */
+            struct Stats {
+                size_t num_threads = 0; /**< Maximum number of helper threads */
+                size_t num_running_threads = 0; /**< Number of helper threads that have been started */
+                size_t num_busy_threads = 0; /**< Number of helper threads currently executing a job */
+                size_t queue_depth = 0; /**< Number of jobs waiting for a thread */
+                size_t max_queue_depth = 0; /**< Largest queue depth seen since the last reset */
+                size_t num_jobs_completed = 0; /**< Number of jobs completed since the last reset */
+                double utilization = 0.0; /**< Fraction of the available thread time spent executing jobs since the last reset */
+            };
+
+        private:
+            using Job = std::function<void()>;
+            using Clock = std::chrono::steady_clock;
+
+            mutable std::mutex mutex_; /**< Guards all pool state */
+            std::condition_variable cv_; /**< Used to wake up idle threads */
+            std::deque<Job> queue_; /**< Jobs waiting for a thread */
+            size_t num_threads_; /**< Maximum number of helper threads */
+            size_t num_running_threads_ = 0; /**< Number of helper threads that have been started */
+            size_t num_idle_threads_ = 0; /**< Number of helper threads waiting for a job */
+            size_t num_busy_threads_ = 0; /**< Number of helper threads executing a job */
+            size_t num_threads_to_stop_ = 0; /**< Number of helper threads that should exit after shrinking the pool */
+            size_t max_queue_depth_ = 0; /**< Largest queue depth seen since the last reset */
+            size_t num_jobs_completed_ = 0; /**< Number of jobs completed since the last reset */
+            Clock::duration busy_time_ = Clock::duration::zero(); /**< Total time spent executing jobs since the last reset */
+            Clock::time_point stats_start_ = Clock::now(); /**< Time of the last reset */
+
+            STFThreadPool();
+
+            /**
+             * Main loop for a helper thread
+             */
+            void workerLoop_();
+
+            /**
+             * Adds a job to the queue, starting a new helper thread if needed
+             * \param job Job to add
+             */
+            void enqueue_(Job&& job);
+
+            /**
+             * Calculates the pool utilization. The caller must hold mutex_.
+             */
+            double calcUtilization_() const;
+
+        public:
+            STFThreadPool(const STFThreadPool&) = delete;
+            STFThreadPool& operator=(const STFThreadPool&) = delete;
+
+            /**
+             * Gets the process-wide thread pool
+             */
+            static STFThreadPool& get();
+
+            /**
+             * Submits a job to the pool
+             * \param func Callable to run on a helper thread
+             * \returns Future that will hold the result of the job
+             */
+            template<typename Func>
+            inline auto submit(Func&& func) {
+                using ResultType = std::invoke_result_t<std::decay_t<Func>>;
+                auto task = std::make_shared<std::packaged_task<ResultType()>>(std::forward<Func>(func));
+                auto result = task->get_future();
+                enqueue_([task]() { (*task)(); });
+                return result;
+            }
+
+            /**
+             * Sets the maximum number of helper threads. If the pool shrinks, excess threads exit once they finish
+             * their current jobs.
+             * \param num_threads Number of threads
+             */
+            void setNumThreads(size_t num_threads);
+
+            /**
+             * Gets the maximum number of helper threads
+             */
+            size_t getNumThreads() const;
+
+            /**
+             * Gets the number of jobs waiting for a thread
+             */
+            size_t getQueueDepth() const;
+
+            /**
+             * Gets the fraction of the available thread time spent executing jobs since the last reset
+             */
+            double getUtilization() const;
+
+            /**
+             * Gets a snapshot of the thread pool statistics
+             */
+            Stats getStats() const;
+
+            /**
+             * Resets the accumulated statistics
+             */
+            void resetStats();
+    };
+} // end namespace stf
+
+#endif
@@ -70,6 +70,15 @@ namespace stf {
                 }
             }
 
+            /**
+             * Restores the skipping flags when decoding restarts partway through a trace
+             * \param in_user_mode Whether the trace is in user mode at the restart point
+             */
+            inline void restoreSkipping_(const bool in_user_mode) {
+                skipping_enabled_ = only_user_mode_ && !in_user_mode;
+                disable_skipping_on_next_item_ = false;
+            }
+
             /**
              * Disables fast seeking when non-user mode skipping is enabled
              */
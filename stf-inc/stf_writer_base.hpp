@@ -82,8 +82,13 @@ namespace stf {
              * \param filename The trace file name
              * \param compression_level Compression level to use (-1 for default).
              * \param chunk_size Chunk size to use (Defaults to DEFAULT_CHUNK_SIZE)
+             * \param num_compression_threads Number of chunks that can be compressed concurrently
+             * (0 to use the STF_COMPRESSION_THREADS environment variable, which defaults to 1)
              */
-            void open(std::string_view filename, int compression_level = -1, size_t chunk_size = DEFAULT_CHUNK_SIZE);
+            void open(std::string_view filename,
+                      int compression_level = -1,
+                      size_t chunk_size = DEFAULT_CHUNK_SIZE,
+                      size_t num_compression_threads = 0);
 
             /**
              * \brief Flush the stream
@@ -212,6 +217,25 @@ namespace stf {
                 *stream_ << rec;
                 return *this;
             }
+
+            /**
+             * Appends a chunk that was read from another compressed trace without recompressing it. Must be called
+             * when the previous chunk has just ended, i.e. after a multiple of the chunk size marker records have been
+             * written. Returns false if the trace can't take the chunk, e.g. because it isn't a compressed trace.
+             * \param chunk Chunk to append
+             */
+            inline bool appendCompressedChunk(const CompressedChunk& chunk) {
+                return stream_->appendCompressedChunk(chunk);
+            }
+
+            /**
+             * Sets the state that the following records are written in, so that chunk summaries and snapshots stay
+             * correct when records from another trace are spliced in
+             * \param state State to switch to
+             */
+            inline void setChunkState(const ChunkStateSnapshot& state) {
+                stream_->setChunkState(state);
+            }
     };
 } // end namespace stf
 
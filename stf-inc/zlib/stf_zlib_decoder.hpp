@@ -0,0 +1,300 @@
+#ifndef __STF_ZLIB_DECODER_HPP__
+#define __STF_ZLIB_DECODER_HPP__
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <sys/types.h>
+#include <zlib.h>
+
+#include "stf_exception.hpp"
+
+namespace stf {
+    /**
+     * \class ZlibDecoder
+     *
+     * Decodes gzip-compressed traces in-process for STFDecompressingIFstream
+     *
+     * Deflate streams can't be entered at arbitrary points, so the decoder records a restart point at the first
+     * deflate block boundary after every RESTART_INTERVAL bytes of output. A restart point holds the bit offset of
+     * the block in the compressed file along with the 32KB window that precedes it, which is all zlib needs to resume
+     * decoding there. Restart points are only recorded for regular files, since a pipe can't be repositioned anyway.
+     */
+    class ZlibDecoder {
+        private:
+            static constexpr size_t IN_BUF_SIZE_ = 256 * 1024; /**< Size of the compressed input buffer */
+            static constexpr int GZIP_WINDOW_BITS_ = 15 + 32; /**< Window bits for decoding a gzip or zlib stream with its header */
+            static constexpr int RAW_WINDOW_BITS_ = -15; /**< Window bits for decoding a raw deflate stream */
+            static constexpr size_t MAX_WINDOW_SIZE_ = 32768; /**< Size of the deflate window */
+            static constexpr size_t GZIP_TRAILER_SIZE_ = 8; /**< Size of the CRC and length that follow each gzip member */
+            static constexpr uint8_t GZIP_MAGIC_ = 0x1f; /**< First byte of a gzip member */
+
+            /**
+             * \struct RestartPoint
+             * Decoder state needed to resume decoding at a deflate block boundary
+             */
+            struct RestartPoint {
+                size_t out_offset = 0; /**< Uncompressed offset of the block */
+                off_t in_offset = 0; /**< Offset of the first compressed byte that hasn't been completely consumed */
+                int bits = 0; /**< Number of bits in the byte before in_offset that belong to the block */
+                std::vector<uint8_t> window; /**< Uncompressed data preceding the block */
+            };
+
+            FILE* file_ = nullptr; /**< Compressed file */
+            bool seekable_ = false; /**< Whether the compressed file can be repositioned */
+            z_stream strm_{}; /**< zlib state */
+            bool initialized_ = false; /**< Set once strm_ has been initialized */
+            std::unique_ptr<uint8_t[]> in_buf_; /**< Compressed input buffer */ // NOLINT: modernize-avoid-c-arrays
+            off_t in_pos_ = 0; /**< File offset just past the data in in_buf_ */
+            size_t out_pos_ = 0; /**< Number of uncompressed bytes produced so far */
+            bool raw_ = false; /**< True if we resumed from a restart point and are decoding a raw deflate stream */
+            bool member_ended_ = false; /**< True if the current gzip member has ended */
+            size_t trailer_bytes_to_skip_ = 0; /**< Remaining trailer bytes to skip after a member decoded in raw mode */
+            bool done_ = false; /**< True once all of the data has been decoded */
+            std::vector<RestartPoint> restart_points_; /**< Restart points, sorted by uncompressed offset */
+
+            /**
+             * Refills the input buffer. Returns false if the file has ended.
+             */
+            inline bool refill_() {
+                const size_t num_read = fread(in_buf_.get(), 1, IN_BUF_SIZE_, file_);
+                in_pos_ += static_cast<off_t>(num_read);
+                strm_.next_in = in_buf_.get();
+                strm_.avail_in = static_cast<uInt>(num_read);
+                return num_read;
+            }
+
+            /**
+             * Resets the decoder state at the start of a gzip member or a restart point
+             * \param window_bits Window bits to reset zlib with
+             */
+            inline void resetState_(const int window_bits) {
+                stf_assert(inflateReset2(&strm_, window_bits) == Z_OK, "Failed to reset zlib decoder");
+                raw_ = window_bits == RAW_WINDOW_BITS_;
+                member_ended_ = false;
+                trailer_bytes_to_skip_ = 0;
+                done_ = false;
+            }
+
+            /**
+             * Moves the compressed file to the given offset and discards any buffered input
+             * \param offset Offset to move to
+             */
+            inline void seekInput_(const off_t offset) {
+                stf_assert(fseeko(file_, offset, SEEK_SET) == 0, "Failed to seek gzip trace");
+                in_pos_ = offset;
+                strm_.next_in = in_buf_.get();
+                strm_.avail_in = 0;
+            }
+
+            /**
+             * Gets the first restart point after the given uncompressed offset
+             * \param offset Uncompressed offset
+             */
+            inline auto findRestartPoint_(const size_t offset) const {
+                return std::upper_bound(restart_points_.begin(),
+                                        restart_points_.end(),
+                                        offset,
+                                        [](const size_t val, const RestartPoint& point) {
+                                            return val < point.out_offset;
+                                        });
+            }
+
+            /**
+             * Records a restart point if zlib is at a block boundary and we are far enough past the last one
+             */
+            inline void recordRestartPoint_() {
+                // Bit 7 of data_type is set at the end of a block, and bit 6 is set while decoding the last block
+                if((strm_.data_type & 0xc0) != 0x80) {
+                    return;
+                }
+
+                const size_t next_restart_offset = restart_points_.empty() ?
+                                                   RESTART_INTERVAL : restart_points_.back().out_offset + RESTART_INTERVAL;
+                if(out_pos_ < next_restart_offset) {
+                    return;
+                }
+
+                auto& point = restart_points_.emplace_back();
+                point.out_offset = out_pos_;
+                point.in_offset = in_pos_ - static_cast<off_t>(strm_.avail_in);
+                point.bits = strm_.data_type & 7;
+                point.window.resize(MAX_WINDOW_SIZE_);
+                uInt window_size = 0;
+                stf_assert(inflateGetDictionary(&strm_, point.window.data(), &window_size) == Z_OK,
+                           "Failed to get zlib window");
+                point.window.resize(window_size);
+            }
+
+            /**
+             * Handles the start of the next gzip member. Returns false if there are no more members.
+             */
+            inline bool startNextMember_() {
+                const uInt num_skipped = std::min(strm_.avail_in, static_cast<uInt>(trailer_bytes_to_skip_));
+                strm_.next_in += num_skipped;
+                strm_.avail_in -= num_skipped;
+                trailer_bytes_to_skip_ -= num_skipped;
+
+                if(trailer_bytes_to_skip_ || !strm_.avail_in) {
+                    return true;
+                }
+
+                // Anything other than another member is trailing garbage, which gzip also ignores
+                if(*strm_.next_in != GZIP_MAGIC_) {
+                    return false;
+                }
+
+                resetState_(GZIP_WINDOW_BITS_);
+                return true;
+            }
+
+        public:
+            static constexpr size_t RESTART_INTERVAL = 4 * 1024 * 1024; /**< Minimum uncompressed distance between restart points */
+
+            ZlibDecoder() = default;
+
+            ZlibDecoder(const ZlibDecoder&) = delete;
+            ZlibDecoder& operator=(const ZlibDecoder&) = delete;
+
+            ~ZlibDecoder() {
+                close();
+            }
+
+            /**
+             * Starts decoding a file from the beginning
+             * \param file Compressed file
+             * \param seekable Whether the file can be repositioned
+             */
+            inline void open(FILE* file, const bool seekable) {
+                close();
+                file_ = file;
+                seekable_ = seekable;
+                in_buf_ = std::make_unique<uint8_t[]>(IN_BUF_SIZE_); // NOLINT: modernize-avoid-c-arrays
+                strm_ = z_stream{};
+                stf_assert(inflateInit2(&strm_, GZIP_WINDOW_BITS_) == Z_OK, "Failed to initialize zlib decoder");
+                initialized_ = true;
+                in_pos_ = 0;
+                out_pos_ = 0;
+                strm_.next_in = in_buf_.get();
+                strm_.avail_in = 0;
+                resetState_(GZIP_WINDOW_BITS_);
+            }
+
+            /**
+             * Releases the zlib state and forgets all of the restart points
+             */
+            inline void close() {
+                if(initialized_) {
+                    inflateEnd(&strm_);
+                    initialized_ = false;
+                }
+                file_ = nullptr;
+                in_buf_.reset();
+                restart_points_.clear();
+            }
+
+            /**
+             * Decodes up to size bytes. Returns the number of bytes decoded, which is only less than size at the end
+             * of the file.
+             * \param out Buffer to decode into
+             * \param size Size of out
+             */
+            inline size_t decode(uint8_t* out, const size_t size) {
+                strm_.next_out = out;
+                strm_.avail_out = static_cast<uInt>(size);
+
+                while(strm_.avail_out && !done_) {
+                    if(!strm_.avail_in && !refill_()) {
+                        if(!member_ended_ || trailer_bytes_to_skip_) {
+                            std::cerr << "WARNING: gzip trace ended unexpectedly. It may be truncated." << std::endl;
+                        }
+                        done_ = true;
+                        break;
+                    }
+
+                    if(STF_EXPECT_FALSE(member_ended_)) {
+                        done_ = !startNextMember_();
+                        continue;
+                    }
+
+                    const uInt avail_out = strm_.avail_out;
+                    const int result = inflate(&strm_, Z_BLOCK);
+                    out_pos_ += avail_out - strm_.avail_out;
+
+                    if(result == Z_STREAM_END) {
+                        // A member decoded with its gzip wrapper has already consumed its trailer
+                        member_ended_ = true;
+                        trailer_bytes_to_skip_ = raw_ ? GZIP_TRAILER_SIZE_ : 0;
+                        continue;
+                    }
+
+                    stf_assert(result == Z_OK || result == Z_BUF_ERROR,
+                               "zlib error: " << (strm_.msg ? strm_.msg : zError(result)));
+
+                    if(seekable_) {
+                        recordRestartPoint_();
+                    }
+                }
+
+                return size - strm_.avail_out;
+            }
+
+            /**
+             * Gets the number of uncompressed bytes decoded so far
+             */
+            inline size_t tell() const {
+                return out_pos_;
+            }
+
+            /**
+             * Gets the uncompressed offset that restart() would resume decoding from
+             * \param offset Uncompressed offset to restart at
+             */
+            inline size_t getRestartOffset(const size_t offset) const {
+                const auto it = findRestartPoint_(offset);
+                return it == restart_points_.begin() ? 0 : std::prev(it)->out_offset;
+            }
+
+            /**
+             * Resumes decoding from the closest restart point at or before the given offset. Returns the uncompressed
+             * offset of the restart point.
+             * \param offset Uncompressed offset to restart at
+             */
+            inline size_t restart(const size_t offset) {
+                stf_assert(seekable_, "Cannot seek in a gzip trace that is being read from a pipe");
+
+                const auto it = findRestartPoint_(offset);
+                if(it == restart_points_.begin()) {
+                    seekInput_(0);
+                    out_pos_ = 0;
+                    resetState_(GZIP_WINDOW_BITS_);
+                    return out_pos_;
+                }
+
+                const auto& point = *std::prev(it);
+                // A partially consumed byte has to be fed to zlib separately
+                seekInput_(point.in_offset - (point.bits ? 1 : 0));
+                resetState_(RAW_WINDOW_BITS_);
+
+                if(point.bits) {
+                    const int partial_byte = fgetc(file_);
+                    stf_assert(partial_byte != EOF, "Failed to read gzip trace");
+                    ++in_pos_;
+                    stf_assert(inflatePrime(&strm_, point.bits, partial_byte >> (8 - point.bits)) == Z_OK,
+                               "Failed to restart zlib decoder");
+                }
+
+                stf_assert(inflateSetDictionary(&strm_,
+                                                point.window.data(),
+                                                static_cast<uInt>(point.window.size())) == Z_OK,
+                           "Failed to restart zlib decoder");
+                out_pos_ = point.out_offset;
+                return out_pos_;
+            }
+    };
+} // end namespace stf
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef __STF_ZSTD_DECOMPRESSOR_HPP__
 #define __STF_ZSTD_DECOMPRESSOR_HPP__
 
+#include <array>
+#include <cstdint>
 #include <zstd.h>
 
 #include "stf_compression_buffer.hpp"
@@ -56,6 +58,84 @@ namespace stf {
                 return out_.pos < out_.size;
             }
 
+            /**
+             * Finds the compressed size of the ZSTD frame at the start of a data source by walking its block headers
+             * \param read Callable with the signature size_t(size_t offset, void* data, size_t num_bytes) that reads
+             * from the data source and returns the number of bytes read
+             * \param frame_size Set to the compressed size of the frame
+             * \return False if the data source does not start with a complete set of frame and block headers
+             */
+            template<typename ReadFunc>
+            static bool findFrameSize(ReadFunc&& read, size_t& frame_size) {
+                static constexpr size_t MAX_FRAME_HEADER_SIZE = 18;
+                static constexpr size_t BLOCK_HEADER_SIZE = 3;
+                static constexpr size_t CHECKSUM_SIZE = 4;
+                static constexpr std::array<size_t, 4> DICT_ID_SIZES = {0, 1, 2, 4};
+                static constexpr std::array<size_t, 4> CONTENT_SIZE_SIZES = {0, 2, 4, 8};
+                static constexpr uint32_t BLOCK_TYPE_RLE = 1;
+                static constexpr uint32_t BLOCK_TYPE_RESERVED = 3;
+
+                std::array<uint8_t, MAX_FRAME_HEADER_SIZE> header;
+                const size_t header_bytes = read(0, header.data(), header.size());
+
+                if(header_bytes <= sizeof(uint32_t)) {
+                    return false;
+                }
+
+                const uint32_t magic = static_cast<uint32_t>(header[0]) |
+                                       (static_cast<uint32_t>(header[1]) << 8) |
+                                       (static_cast<uint32_t>(header[2]) << 16) |
+                                       (static_cast<uint32_t>(header[3]) << 24);
+                if(magic != ZSTD_MAGICNUMBER) {
+                    return false;
+                }
+
+                // Decode the frame header descriptor to get the size of the frame header
+                const uint8_t descriptor = header[4];
+                const size_t content_size_flag = descriptor >> 6;
+                const bool single_segment = (descriptor >> 5) & 1;
+                const bool has_checksum = (descriptor >> 2) & 1;
+                const size_t dict_id_flag = descriptor & 3;
+
+                size_t offset = sizeof(uint32_t) + 1 + (single_segment ? 0 : 1) + DICT_ID_SIZES[dict_id_flag] +
+                                ((content_size_flag == 0 && single_segment) ? 1 : CONTENT_SIZE_SIZES[content_size_flag]);
+
+                if(offset > header_bytes) {
+                    return false;
+                }
+
+                // Skip over each block
+                bool last_block = false;
+                while(!last_block) {
+                    std::array<uint8_t, BLOCK_HEADER_SIZE> block_header;
+                    if(read(offset, block_header.data(), block_header.size()) != block_header.size()) {
+                        return false;
+                    }
+
+                    const uint32_t block_desc = static_cast<uint32_t>(block_header[0]) |
+                                                (static_cast<uint32_t>(block_header[1]) << 8) |
+                                                (static_cast<uint32_t>(block_header[2]) << 16);
+                    last_block = block_desc & 1;
+                    const uint32_t block_type = (block_desc >> 1) & 3;
+                    const size_t block_size = block_desc >> 3;
+
+                    if(block_type == BLOCK_TYPE_RESERVED) {
+                        return false;
+                    }
+
+                    // RLE blocks only store a single byte
+                    offset += BLOCK_HEADER_SIZE + (block_type == BLOCK_TYPE_RLE ? 1 : block_size);
+                }
+
+                if(has_checksum) {
+                    offset += CHECKSUM_SIZE;
+                }
+
+                frame_size = offset;
+
+                return true;
+            }
+
             /**
              * Resets the decompression context so we can decompress a new chunk
              */
@@ -1,6 +1,7 @@
 #ifndef __STF_ZSTD_INTERFACE_HPP__
 #define __STF_ZSTD_INTERFACE_HPP__
 
+#include <cstdint>
 #include <string_view>
 #include <zstd.h>
 
@@ -13,6 +14,9 @@ namespace stf {
     class ZSTDInterface {
         private:
             static constexpr std::string_view MAGIC_ = "ZSTF"; /**< Magic string placed at the head of the file to identify its format */
+            static constexpr uint32_t JOURNAL_MAGIC_ = 0x184D2A5E; /**< ZSTD skippable frame magic used for chunk journal entries */
+            static constexpr uint32_t STREAM_FRAME_MAGIC_ = 0x184D2A5D; /**< ZSTD skippable frame magic used for streaming chunk frames */
+            static constexpr uint32_t STREAM_END_MAGIC_ = 0x184D2A5C; /**< ZSTD skippable frame magic that ends a streaming trace */
         protected:
             ZSTD_inBuffer in_ = {nullptr, 0, 0}; /**< ZSTD input buffer - holds uncompressed data */
             ZSTD_outBuffer out_ = {nullptr, 0, 0}; /**< ZSTD output buffer - holds compressed data */
@@ -26,6 +30,29 @@ namespace stf {
             static constexpr std::string_view getMagic() {
                 return MAGIC_;
             }
+
+            /**
+             * Get the magic number that identifies chunk journal entries.
+             * Journal entries are stored as ZSTD skippable frames so that decompressors ignore them.
+             */
+            static constexpr uint32_t getJournalMagic() {
+                return JOURNAL_MAGIC_;
+            }
+
+            /**
+             * Get the magic number that identifies the frame header preceding each chunk in a streaming trace.
+             * Frame headers are stored as ZSTD skippable frames so that decompressors ignore them.
+             */
+            static constexpr uint32_t getStreamFrameMagic() {
+                return STREAM_FRAME_MAGIC_;
+            }
+
+            /**
+             * Get the magic number that identifies the frame following the last chunk in a streaming trace
+             */
+            static constexpr uint32_t getStreamEndMagic() {
+                return STREAM_END_MAGIC_;
+            }
     };
 } // end namespace stf
 
@@ -0,0 +1,212 @@
+#ifndef __STF_TEST_INST_TRACE_CHECKS_HPP__
+#define __STF_TEST_INST_TRACE_CHECKS_HPP__
+
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "stf-inc/stf_inst_reader.hpp"
+
+namespace stf::test {
+    /**
+     * \struct InstInfo
+     *
+     * Identifying fields of an instruction, used to compare the instructions read from a trace against a reference
+     */
+    struct InstInfo {
+        uint64_t index = 0; /**< Instruction index */
+        uint64_t unskipped_index = 0; /**< Instruction index, including skipped instructions */
+        uint64_t pc = 0; /**< PC */
+        uint32_t opcode = 0; /**< Opcode */
+
+        InstInfo() = default;
+
+        template<typename InstType>
+        explicit InstInfo(const InstType& inst) :
+            index(inst.index()),
+            unskipped_index(inst.unskippedIndex()),
+            pc(inst.pc()),
+            opcode(inst.opcode())
+        {
+        }
+
+        bool operator==(const InstInfo& rhs) const = default;
+    };
+
+    /**
+     * \class InstContents
+     *
+     * Everything an instruction exposes through its operands, register states, memory accesses and events, flattened
+     * so that two reads of the same instruction can be compared field by field
+     */
+    class InstContents {
+        private:
+            std::vector<uint64_t> fields_; // Flattened instruction contents
+
+            template<typename Container>
+            void appendValues_(const Container& values) {
+                const size_t count_idx = fields_.size();
+                fields_.emplace_back(0);
+                for(const auto val: values) {
+                    fields_.emplace_back(val);
+                    ++fields_[count_idx];
+                }
+            }
+
+            void appendOperands_(const STFInst::OperandVector& operands) {
+                fields_.emplace_back(operands.size());
+                for(const auto& op: operands) {
+                    fields_.emplace_back(static_cast<uint64_t>(op.getReg()));
+                    fields_.emplace_back(static_cast<uint64_t>(op.getType()));
+                    if(op.isVector()) {
+                        appendValues_(op.getVectorValueView());
+                    }
+                    else {
+                        fields_.emplace_back(op.getScalarValue());
+                    }
+                }
+            }
+
+        public:
+            /**
+             * Constructs an InstContents
+             * \param inst Instruction to flatten
+             * \param include_index If false, the index that doesn't count skipped instructions is left out
+             */
+            explicit InstContents(const STFInst& inst, const bool include_index = true) :
+                fields_ {include_index ? inst.index() : 0, inst.unskippedIndex(), inst.pc(), inst.opcode(), inst.flags()}
+            {
+                appendOperands_(inst.getRegisterStates());
+                appendOperands_(inst.getSourceOperands());
+                appendOperands_(inst.getDestOperands());
+
+                for(const auto& access: inst.getMemoryAccesses()) {
+                    fields_.emplace_back(static_cast<uint64_t>(access.getType()));
+                    fields_.emplace_back(access.getAddress());
+                    fields_.emplace_back(access.getSize());
+                    appendValues_(access.getData());
+                }
+
+                for(const auto& event: inst.getEvents()) {
+                    fields_.emplace_back(static_cast<uint64_t>(event.getEvent()));
+                    appendValues_(event.getData());
+                    fields_.emplace_back(event.targetValid() ? event.getTarget() : 0);
+                }
+            }
+
+            bool operator==(const InstContents& rhs) const = default;
+    };
+
+    /**
+     * Reads every remaining instruction from a reader
+     * \tparam Info Type constructed from each instruction
+     * \param reader Reader to read from
+     */
+    template<typename Info = InstInfo, typename ReaderType>
+    inline std::vector<Info> readInsts(ReaderType& reader) {
+        std::vector<Info> insts;
+        for(const auto& inst: reader) {
+            insts.emplace_back(inst);
+        }
+
+        return insts;
+    }
+
+    /**
+     * Reads every instruction in a trace
+     * \tparam Info Type constructed from each instruction
+     * \param filename Trace to read
+     * \param only_user_mode If true, skips non-user-mode instructions
+     * \param enable_address_translation If true, translates addresses
+     */
+    template<typename Info = InstInfo>
+    inline std::vector<Info> readTrace(const std::string& filename,
+                                       const bool only_user_mode = false,
+                                       const bool enable_address_translation = false) {
+        STFInstReader reader(filename, only_user_mode, enable_address_translation);
+        return readInsts<Info>(reader);
+    }
+
+    /**
+     * Checks that actual holds exactly the first num_insts instructions of expected
+     * \param what Description of the trace, used in error messages
+     * \param actual Instructions that were read
+     * \param expected Reference instructions
+     * \param num_insts Number of instructions that should have been read
+     */
+    template<typename Info>
+    inline bool checkPrefix(const std::string& what,
+                            const std::vector<Info>& actual,
+                            const std::vector<Info>& expected,
+                            const size_t num_insts) {
+        if(actual.size() != num_insts || num_insts > expected.size()) {
+            std::cerr << what << ": read " << actual.size() << " instructions, expected " << num_insts << std::endl;
+            return false;
+        }
+
+        for(size_t i = 0; i < num_insts; ++i) {
+            if(!(actual[i] == expected[i])) {
+                std::cerr << what << ": instruction " << i << " differs" << std::endl;
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * Checks that actual holds exactly the instructions in expected
+     * \param what Description of the trace, used in error messages
+     * \param actual Instructions that were read
+     * \param expected Reference instructions
+     */
+    template<typename Info>
+    inline bool checkInsts(const std::string& what, const std::vector<Info>& actual, const std::vector<Info>& expected) {
+        return checkPrefix(what, actual, expected, expected.size());
+    }
+
+    /**
+     * Checks the instructions recovered from a trace that was cut off partway through. Only whole chunks can be
+     * recovered, and at least one of them has to survive.
+     * \param what Description of the trace, used in error messages
+     * \param actual Instructions that were recovered
+     * \param expected Instructions in the complete trace
+     * \param chunk_size Chunk size of the trace
+     */
+    template<typename Info>
+    inline bool checkRecovered(const std::string& what,
+                               const std::vector<Info>& actual,
+                               const std::vector<Info>& expected,
+                               const size_t chunk_size) {
+        if(actual.empty() || actual.size() % chunk_size != 0 || actual.size() >= expected.size()) {
+            std::cerr << what << ": recovered " << actual.size() << " instructions" << std::endl;
+            return false;
+        }
+
+        return checkPrefix(what, actual, expected, actual.size());
+    }
+
+    /**
+     * Copies a file and cuts the copy off partway through, as if its writer had been killed
+     * \param src File to copy
+     * \param dest Copy to create or overwrite
+     * \param fraction Fraction of the file to keep
+     * \returns True on success
+     */
+    inline bool truncatedCopy(const std::string& src, const std::string& dest, const double fraction) {
+        std::filesystem::copy_file(src, dest, std::filesystem::copy_options::overwrite_existing);
+        const auto size = static_cast<double>(std::filesystem::file_size(src)) * fraction;
+        if(truncate(dest.c_str(), static_cast<off_t>(size)) != 0) {
+            std::cerr << "Failed to truncate " << dest << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+} // end namespace stf::test
+
+#endif
@@ -0,0 +1,109 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "stf-inc/stf_inst_reader.hpp"
+#include "common/synthetic_trace_generator.hpp"
+
+// Physical PC followed by the physical address of each memory access
+using Translations = std::vector<uint64_t>;
+
+template<typename InstType>
+static Translations translate(const InstType& inst) {
+    Translations pas{inst.physPc()};
+    for(const auto& access: inst.getMemoryAccesses()) {
+        pas.emplace_back(access.getPhysAddress());
+    }
+    return pas;
+}
+
+static bool check(const std::string& what, const size_t idx, const Translations& actual, const Translations& expected) {
+    if(actual != expected) {
+        std::cerr << what << ": instruction " << idx << " translated differently" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static std::vector<Translations> readSerial(const std::string& filename) {
+    stf::STFInstReader reader(filename, false, true);
+
+    std::vector<Translations> insts;
+    for(const auto& inst: reader) {
+        insts.emplace_back(translate(inst));
+    }
+
+    return insts;
+}
+
+static bool testParallelDecode(const std::string& filename, const std::vector<Translations>& serial) {
+    for(const size_t depth: {1, 2, 4}) {
+        stf::STFInstReader reader(filename, false, true);
+        reader.setParallelDecodeDepth(depth);
+
+        const std::string what = filename + " (depth = " + std::to_string(depth) + ")";
+        size_t i = 0;
+        for(const auto& inst: reader) {
+            if(i >= serial.size() || !check(what, i, translate(inst), serial[i])) {
+                return false;
+            }
+            ++i;
+        }
+
+        if(i != serial.size()) {
+            std::cerr << what << ": read " << i << " instructions, expected " << serial.size() << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Jumps forward past records the page table hasn't seen yet, then backwards, translating a window after each jump
+static bool testJumpToIndex(const std::string& filename, const std::vector<Translations>& serial) {
+    static constexpr size_t WINDOW = 100;
+
+    stf::STFIndexedInstReader reader(filename, false, true);
+
+    const std::string what = filename + " (jumpToIndex)";
+    for(const size_t target: {serial.size() / 2, serial.size() / 4, serial.size() - WINDOW, size_t(0), serial.size() * 3 / 4}) {
+        auto it = reader.jumpToIndex(target);
+        for(size_t i = target; i < target + WINDOW; ++i, ++it) {
+            if(!check(what, i, translate(*it), serial[i])) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+int main() {
+    // Parallel decoding needs chunk snapshots
+    setenv("STF_CHUNK_SNAPSHOTS", "1", 1);
+
+    stf::synthetic::SyntheticTraceConfig config;
+    config.num_insts = 20000;
+    config.chunk_size = 1000;
+    config.mem_footprint = 4ULL << 20;
+
+    bool passed = true;
+
+    for(const std::string filename: {"stf_address_translation_test.zstf", "stf_address_translation_test.stf"}) {
+        stf::synthetic::SyntheticTraceGenerator(config).writeInstTrace(filename);
+
+        const auto serial = readSerial(filename);
+        if(serial.size() != config.num_insts) {
+            std::cerr << filename << ": read " << serial.size() << " instructions, expected " << config.num_insts << std::endl;
+            return 1;
+        }
+
+        if(filename.ends_with(".zstf")) {
+            passed &= testParallelDecode(filename, serial);
+        }
+        passed &= testJumpToIndex(filename, serial);
+    }
+
+    return passed ? 0 : 1;
+}
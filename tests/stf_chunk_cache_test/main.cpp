@@ -0,0 +1,179 @@
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "stf-inc/stf_chunk_cache.hpp"
+#include "stf-inc/stf_inst_reader.hpp"
+#include "common/synthetic_trace_generator.hpp"
+
+#define CHECK(cond) \
+    if(!(cond)) { \
+        std::cerr << __FILE__ << ':' << __LINE__ << ": check failed: " #cond << std::endl; \
+        return false; \
+    }
+
+static constexpr size_t CHUNK_BYTES = 1000;
+
+static stf::STFCompressionBuffer makeChunk(const uint8_t marker) {
+    stf::STFCompressionBuffer buf;
+    buf.resize(CHUNK_BYTES);
+    *buf.getPtrAs<uint8_t>() = marker;
+    buf.setWritePtr(CHUNK_BYTES);
+    return buf;
+}
+
+static uint8_t getMarker(const stf::STFCompressionBuffer& buf) {
+    return *buf.getPtrAs<uint8_t>();
+}
+
+static bool checkLRU() {
+    stf::STFChunkCache cache;
+    stf::STFCompressionBuffer buf;
+
+    // A disabled cache ignores inserts and doesn't count lookups
+    cache.insert(0, makeChunk(0));
+    CHECK(!cache.find(0, buf));
+    CHECK(cache.getStats().num_chunks == 0 && cache.getStats().misses == 0);
+
+    cache.setCapacity(3 * CHUNK_BYTES);
+    for(uint8_t i = 0; i < 3; ++i) {
+        cache.insert(i, makeChunk(i));
+    }
+
+    // Touching chunk 0 leaves chunk 1 as the least recently used one
+    CHECK(cache.find(0, buf) && getMarker(buf) == 0);
+    cache.insert(3, makeChunk(3));
+
+    CHECK(cache.find(2, buf) && getMarker(buf) == 2);
+    CHECK(cache.find(3, buf) && getMarker(buf) == 3);
+    CHECK(cache.find(0, buf) && getMarker(buf) == 0);
+    CHECK(!cache.find(1, buf));
+
+    auto stats = cache.getStats();
+    CHECK(stats.capacity == 3 * CHUNK_BYTES);
+    CHECK(stats.num_chunks == 3 && stats.num_bytes == 3 * CHUNK_BYTES);
+    CHECK(stats.hits == 4 && stats.misses == 1 && stats.evictions == 1);
+
+    // Overwriting a buffer handed out by the cache must not change the cached chunk
+    CHECK(cache.find(2, buf));
+    buf.unshare();
+    *buf.getPtrAs<uint8_t>() = 0xff;
+    CHECK(cache.find(2, buf) && getMarker(buf) == 2);
+
+    // Re-inserting a chunk replaces it instead of holding it twice
+    cache.insert(2, makeChunk(4));
+    CHECK(cache.find(2, buf) && getMarker(buf) == 4);
+    CHECK(cache.getStats().num_chunks == 3);
+
+    // Chunks that can never fit are not cached
+    stf::STFCompressionBuffer big;
+    big.resize(4 * CHUNK_BYTES);
+    cache.insert(5, big);
+    CHECK(!cache.find(5, buf));
+    CHECK(cache.getStats().num_chunks == 3);
+
+    // Shrinking the cache evicts the least recently used chunks, which are 3 and then 0
+    cache.resetStats();
+    cache.setCapacity(CHUNK_BYTES);
+    stats = cache.getStats();
+    CHECK(stats.num_chunks == 1 && stats.evictions == 2 && stats.hits == 0);
+    CHECK(cache.find(2, buf));
+    CHECK(!cache.find(0, buf) && !cache.find(3, buf));
+
+    cache.clear();
+    CHECK(cache.getStats().num_chunks == 0 && cache.getStats().num_bytes == 0);
+    CHECK(!cache.find(2, buf));
+
+    return true;
+}
+
+// Jumps back and forth between two regions of a trace. With the cache enabled, returning to a region should reuse
+// its decompressed chunks instead of decompressing them again.
+static bool checkReader(const std::string& filename, const std::vector<uint64_t>& pcs, const bool enabled) {
+    static constexpr size_t WINDOW = 50;
+
+    if(enabled) {
+        setenv("STF_CHUNK_CACHE_MB", "64", 1);
+    }
+    else {
+        unsetenv("STF_CHUNK_CACHE_MB");
+    }
+
+    stf::STFIndexedInstReader reader(filename);
+    reader.waitForIndexScan();
+
+    for(size_t pass = 0; pass < 3; ++pass) {
+        for(const size_t target: {size_t(1000), pcs.size() - 1000}) {
+            auto it = reader.jumpToIndex(target);
+            for(size_t i = target; i < target + WINDOW; ++i, ++it) {
+                CHECK(it->pc() == pcs[i]);
+            }
+        }
+    }
+
+    const auto stats = reader.getChunkCacheStats();
+    if(enabled) {
+        CHECK(stats.capacity == (64 << 20));
+        CHECK(stats.hits > 0);
+        CHECK(stats.num_chunks > 0);
+    }
+    else {
+        CHECK(stats.capacity == 0);
+        CHECK(stats.hits == 0 && stats.num_chunks == 0);
+    }
+
+    return true;
+}
+
+// A second reader opened on the same trace should reuse the chunks that the first one decompressed
+static bool checkSharedBetweenReaders(const std::string& filename, const std::vector<uint64_t>& pcs, const size_t chunk_size) {
+    setenv("STF_CHUNK_CACHE_MB", "64", 1);
+
+    stf::STFInstReader first(filename);
+    for(auto it = first.begin(); it != first.end(); ++it) {
+    }
+
+    const auto before = first.getChunkCacheStats();
+    CHECK(before.num_chunks > 0);
+
+    stf::STFInstReader second(filename);
+    size_t i = 0;
+    for(const auto& inst: second) {
+        CHECK(i < pcs.size() && inst.pc() == pcs[i]);
+        ++i;
+    }
+    CHECK(i == pcs.size());
+
+    const auto after = second.getChunkCacheStats();
+    CHECK(after.hits >= before.hits + pcs.size() / chunk_size);
+    CHECK(first.getChunkCacheStats().hits == after.hits);
+
+    return true;
+}
+
+int main() {
+    bool passed = checkLRU();
+
+    stf::synthetic::SyntheticTraceConfig config;
+    config.num_insts = 100000;
+    config.chunk_size = 1000;
+
+    const std::string filename = "stf_chunk_cache_test.zstf";
+    stf::synthetic::SyntheticTraceGenerator(config).writeInstTrace(filename);
+
+    std::vector<uint64_t> pcs;
+    {
+        stf::STFInstReader reader(filename);
+        for(const auto& inst: reader) {
+            pcs.emplace_back(inst.pc());
+        }
+    }
+
+    passed &= checkReader(filename, pcs, true);
+    passed &= checkSharedBetweenReaders(filename, pcs, config.chunk_size);
+    passed &= checkReader(filename, pcs, false);
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,39 @@
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+#include "common/synthetic_trace_generator.hpp"
+#include "tests/common/inst_trace_checks.hpp"
+
+int main() {
+    static constexpr uint64_t CHUNK_SIZE = 1000;
+
+    stf::synthetic::SyntheticTraceConfig config;
+    config.num_insts = 20000;
+    config.chunk_size = CHUNK_SIZE;
+
+    const std::string reference = "stf_chunk_journal_test_ref.zstf";
+    const std::string journaled = "stf_chunk_journal_test.zstf";
+    const std::string truncated = "stf_chunk_journal_test_truncated.zstf";
+
+    stf::synthetic::SyntheticTraceGenerator(config).writeInstTrace(reference);
+    setenv("STF_CHUNK_JOURNAL", "1", 1);
+    stf::synthetic::SyntheticTraceGenerator(config).writeInstTrace(journaled);
+    unsetenv("STF_CHUNK_JOURNAL");
+
+    const auto expected = stf::test::readTrace(reference);
+    bool passed = stf::test::checkInsts(journaled, stf::test::readTrace(journaled), expected);
+
+    // Cutting the trace off partway through drops the index, as if the writer had been killed. The reader has to
+    // rebuild it from the journal entries of the chunks that were completely written.
+    for(const double fraction: {0.3, 0.55, 0.8}) {
+        if(!stf::test::truncatedCopy(journaled, truncated, fraction)) {
+            return 1;
+        }
+
+        const std::string what = truncated + " (" + std::to_string(fraction) + ")";
+        passed &= stf::test::checkRecovered(what, stf::test::readTrace(truncated), expected, CHUNK_SIZE);
+    }
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "stf-inc/stf_chunk_parallel.hpp"
+#include "common/synthetic_trace_generator.hpp"
+#include "tests/common/inst_trace_checks.hpp"
+
+#define CHECK(cond) \
+    if(!(cond)) { \
+        std::cerr << __FILE__ << ':' << __LINE__ << ": check failed: " #cond << std::endl; \
+        return false; \
+    }
+
+static constexpr size_t CHUNK_SIZE = 1000;
+
+// Order-independent summary of the instructions in a trace
+struct TraceSummary {
+    uint64_t num_insts = 0;
+    uint64_t index_sum = 0;
+    uint64_t pc_sum = 0;
+    uint64_t opcode_xor = 0;
+    uint64_t num_mem_accesses = 0;
+
+    void add(const stf::STFInst& inst) {
+        ++num_insts;
+        index_sum += inst.index();
+        pc_sum += inst.pc();
+        opcode_xor ^= inst.opcode();
+        num_mem_accesses += inst.getMemoryAccesses().size();
+    }
+
+    void merge(const TraceSummary& rhs) {
+        num_insts += rhs.num_insts;
+        index_sum += rhs.index_sum;
+        pc_sum += rhs.pc_sum;
+        opcode_xor ^= rhs.opcode_xor;
+        num_mem_accesses += rhs.num_mem_accesses;
+    }
+
+    bool operator==(const TraceSummary& rhs) const = default;
+};
+
+static bool checkMapReduce(const std::string& filename) {
+    TraceSummary expected;
+    {
+        stf::STFInstReader reader(filename);
+        for(const auto& inst: reader) {
+            expected.add(inst);
+        }
+    }
+
+    for(const size_t max_workers: {1, 3, 0}) {
+        const auto summary = stf::mapReduceChunks<TraceSummary>(filename,
+                                                                 [](TraceSummary& acc, const stf::STFInst& inst) {
+                                                                     acc.add(inst);
+                                                                 },
+                                                                 max_workers);
+        CHECK(summary == expected);
+    }
+
+    return true;
+}
+
+// Reading the chunks one after another has to produce the same instructions as iterating over the trace
+static bool checkForEachInstInChunk(const std::string& filename) {
+    const auto expected = stf::test::readTrace(filename);
+
+    stf::STFInstReader reader(filename);
+    const size_t num_chunks = reader.getNumChunks();
+    CHECK(num_chunks == (expected.size() + CHUNK_SIZE - 1) / CHUNK_SIZE);
+
+    std::vector<stf::test::InstInfo> insts;
+    // Out of order, so that every chunk has to restore its own state
+    for(size_t i = num_chunks; i-- > 0;) {
+        std::vector<stf::test::InstInfo> chunk_insts;
+        const size_t num_read = reader.forEachInstInChunk(i, [&chunk_insts](const stf::STFInst& inst) {
+            chunk_insts.emplace_back(inst);
+        });
+        CHECK(num_read == chunk_insts.size());
+        insts.insert(insts.begin(), chunk_insts.begin(), chunk_insts.end());
+    }
+
+    return stf::test::checkInsts(filename + " (forEachInstInChunk)", insts, expected);
+}
+
+// An exception thrown by a helper worker has to be rethrown only after every other worker has stopped
+static bool checkException(const std::string& filename, const size_t num_chunks) {
+    std::atomic<size_t> num_active{0};
+    std::atomic<size_t> num_calls{0};
+    bool caught = false;
+
+    try {
+        stf::parallelForEachChunk(
+            filename,
+            [&num_active, &num_calls](const size_t worker_idx, stf::STFInstReader&, const size_t) {
+                ++num_calls;
+                if(worker_idx == 1) {
+                    throw std::runtime_error("chunk failed");
+                }
+                ++num_active;
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                --num_active;
+            },
+            4
+        );
+    }
+    catch(const std::runtime_error& e) {
+        caught = std::string(e.what()) == "chunk failed";
+    }
+
+    CHECK(caught);
+    CHECK(num_active == 0);
+
+    // Nothing may still be running once the exception has been rethrown, and the remaining chunks are abandoned
+    const size_t num_calls_at_return = num_calls;
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    CHECK(num_calls == num_calls_at_return);
+    CHECK(num_calls_at_return < num_chunks);
+
+    return true;
+}
+
+int main() {
+    stf::synthetic::SyntheticTraceConfig config;
+    config.num_insts = 20500;
+    config.chunk_size = CHUNK_SIZE;
+
+    bool passed = true;
+
+    for(const bool snapshots: {false, true}) {
+        if(snapshots) {
+            setenv("STF_CHUNK_SNAPSHOTS", "1", 1);
+        }
+        const std::string filename = std::string("stf_chunk_parallel_test") + (snapshots ? "_snapshots" : "") + ".zstf";
+        stf::synthetic::SyntheticTraceGenerator(config).writeInstTrace(filename);
+        unsetenv("STF_CHUNK_SNAPSHOTS");
+
+        passed &= checkMapReduce(filename);
+        passed &= checkForEachInstInChunk(filename);
+        passed &= checkException(filename, (config.num_insts + CHUNK_SIZE - 1) / CHUNK_SIZE);
+    }
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "stf-inc/stf_inst_reader.hpp"
+#include "common/synthetic_trace_generator.hpp"
+#include "tests/common/inst_trace_checks.hpp"
+
+// Jumps forwards and backwards through the trace, so that both restart points and rewinds are used
+static bool checkJumps(const std::string& filename, const std::vector<stf::test::InstInfo>& expected) {
+    static constexpr size_t WINDOW = 100;
+
+    stf::STFIndexedInstReader reader(filename);
+    reader.waitForIndexScan();
+
+    for(const size_t target: {expected.size() - WINDOW, expected.size() / 3, size_t(0), expected.size() * 2 / 3, size_t(12345)}) {
+        auto it = reader.jumpToIndex(target);
+        for(size_t i = target; i < target + WINDOW; ++i, ++it) {
+            if(!(stf::test::InstInfo(*it) == expected[i])) {
+                std::cerr << filename << ": instruction " << i << " differs after jumping to " << target << std::endl;
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+int main() {
+    stf::synthetic::SyntheticTraceConfig config;
+    // Large enough that the gzip decoder records a few restart points
+    config.num_insts = 400000;
+
+    const std::string reference = "stf_decompressing_stream_test.stf";
+    stf::synthetic::SyntheticTraceGenerator(config).writeInstTrace(reference);
+    const auto expected = stf::test::readTrace(reference);
+
+    std::vector<std::string> traces;
+
+    // The writer compresses through gzip and a single-threaded xz, which writes a single block
+    for(const std::string filename: {"stf_decompressing_stream_test.stf.gz", "stf_decompressing_stream_test.stf.xz"}) {
+        stf::synthetic::SyntheticTraceGenerator(config).writeInstTrace(filename);
+        traces.emplace_back(filename);
+    }
+
+    // Multi-block xz files can restart at any block
+    const std::string multi_block_xz = "stf_decompressing_stream_test_blocks.stf.xz";
+    const std::string xz_cmd = "xz -z -T1 --block-size=1MiB -c " + reference + " > " + multi_block_xz;
+    if(std::system(xz_cmd.c_str()) == 0) {
+        traces.emplace_back(multi_block_xz);
+    }
+    else {
+        std::cerr << "WARNING: Failed to run xz. Skipping the multi-block xz trace." << std::endl;
+    }
+
+    // Concatenated gzip members are read as one trace, as gzip -dc would
+    const std::string multi_member_gz = "stf_decompressing_stream_test_members.stf.gz";
+    const std::string gz_cmd = "head -c 3000000 " + reference + " | gzip -c > " + multi_member_gz +
+                               " && tail -c +3000001 " + reference + " | gzip -c >> " + multi_member_gz;
+    if(std::system(gz_cmd.c_str()) == 0) {
+        traces.emplace_back(multi_member_gz);
+    }
+    else {
+        std::cerr << "WARNING: Failed to run gzip. Skipping the multi-member gzip trace." << std::endl;
+    }
+
+    bool passed = true;
+    for(const auto& filename: traces) {
+        passed &= stf::test::checkInsts(filename, stf::test::readTrace(filename), expected);
+        passed &= checkJumps(filename, expected);
+    }
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,163 @@
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "stf-inc/stf_index_sidecar.hpp"
+#include "stf-inc/stf_indexer.hpp"
+#include "stf-inc/stf_inst_reader.hpp"
+#include "stf-inc/stf_reader.hpp"
+#include "common/synthetic_trace_generator.hpp"
+
+static constexpr size_t GRANULARITY = 1024;
+
+using Indexer = stf::STFIndexer<stf::STFReader, GRANULARITY>;
+
+static void writeTrace(const std::string& filename, const uint64_t num_insts) {
+    stf::synthetic::SyntheticTraceConfig config;
+    config.num_insts = num_insts;
+    stf::synthetic::SyntheticTraceGenerator(config).writeInstTrace(filename);
+}
+
+static bool loadSidecar(const std::string& filename, stf::STFIndexSidecar::IndexMap& index_map) {
+    index_map.clear();
+    return stf::STFIndexSidecar(filename).load(GRANULARITY, index_map);
+}
+
+static bool checkEntries(const std::string& what,
+                         const stf::STFIndexSidecar::IndexMap& index_map,
+                         const uint64_t num_insts) {
+    const size_t expected = (num_insts + GRANULARITY - 1) / GRANULARITY;
+    if(index_map.size() != expected) {
+        std::cerr << what << ": sidecar has " << index_map.size() << " entries, expected " << expected << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// A complete scan writes the sidecar, and the next open reuses it without scanning
+static bool testBuildAndReuse(const std::string& filename, const uint64_t num_insts) {
+    stf::STFIndexSidecar::IndexMap built;
+
+    {
+        Indexer indexer;
+        indexer.setUseSidecar(true);
+        indexer.open(filename);
+        indexer.waitForScanComplete();
+        indexer.close();
+    }
+
+    if(!loadSidecar(filename, built)) {
+        std::cerr << "Sidecar was not written after a complete scan" << std::endl;
+        return false;
+    }
+
+    if(!checkEntries("Built", built, num_insts)) {
+        return false;
+    }
+
+    Indexer indexer;
+    indexer.setUseSidecar(true);
+    indexer.open(filename);
+
+    if(!indexer.scanComplete()) {
+        std::cerr << "Indexer rescanned the trace instead of loading its sidecar" << std::endl;
+        return false;
+    }
+
+    for(const auto& [index, entry]: built) {
+        const auto it = indexer.findNearestEntry(index);
+        if(it == indexer.end() || it->first != index || it->second.offset != entry.offset || it->second.pc != entry.pc) {
+            std::cerr << "Loaded sidecar entry " << index << " differs from the scanned one" << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Closing the indexer mid-scan must never leave a partial sidecar behind
+static bool testEarlyClose(const std::string& filename, const uint64_t num_insts) {
+    std::remove(stf::STFIndexSidecar::getPath(filename).c_str());
+
+    {
+        Indexer indexer;
+        indexer.setUseSidecar(true);
+        indexer.open(filename);
+        indexer.close();
+    }
+
+    // The scan may have finished before close() was called, in which case the sidecar must be complete
+    stf::STFIndexSidecar::IndexMap index_map;
+    return !loadSidecar(filename, index_map) || checkEntries("Early close", index_map, num_insts);
+}
+
+// A sidecar left over from a different version of the trace is ignored and rebuilt
+static bool testStaleRebuild(const std::string& filename, const uint64_t num_insts) {
+    writeTrace(filename, num_insts);
+
+    {
+        Indexer indexer;
+        indexer.setUseSidecar(true);
+        indexer.open(filename);
+        indexer.waitForScanComplete();
+        indexer.close();
+    }
+
+    stf::STFIndexSidecar::IndexMap index_map;
+    if(!loadSidecar(filename, index_map)) {
+        std::cerr << "Stale sidecar was not rebuilt" << std::endl;
+        return false;
+    }
+
+    return checkEntries("Rebuilt", index_map, num_insts);
+}
+
+// Seeking with an index loaded from the sidecar lands on the same instructions as a sequential read
+static bool testJumpToIndex(const std::string& filename) {
+    std::vector<uint64_t> pcs;
+    {
+        stf::STFInstReader reader(filename);
+        for(const auto& inst: reader) {
+            pcs.push_back(inst.pc());
+        }
+    }
+
+    stf::STFIndexedInstReader reader(filename);
+    if(!reader.indexScanComplete()) {
+        std::cerr << "Indexed reader did not load the sidecar" << std::endl;
+        return false;
+    }
+
+    // jumpToIndex takes the number of instructions to skip, so it lands on the instruction with index + 1
+    for(const size_t index: {0UL, 1023UL, 1024UL, 1025UL, 5000UL, pcs.size() / 2, pcs.size() - 1}) {
+        const auto it = reader.jumpToIndex(index);
+        if(it->index() != index + 1 || it->pc() != pcs[index]) {
+            std::cerr << "jumpToIndex(" << index << ") landed on instruction " << it->index()
+                      << " with PC " << std::hex << it->pc() << ", expected " << pcs[index] << std::dec
+                      << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main() {
+    setenv("STF_INDEX_SIDECAR", "1", 1);
+
+    const std::string filename = "stf_index_sidecar_test.stf";
+    static constexpr uint64_t NUM_INSTS = 100000;
+    static constexpr uint64_t NUM_REWRITTEN_INSTS = 60000;
+
+    writeTrace(filename, NUM_INSTS);
+    std::remove(stf::STFIndexSidecar::getPath(filename).c_str());
+
+    bool passed = testBuildAndReuse(filename, NUM_INSTS);
+    passed &= testEarlyClose(filename, NUM_INSTS);
+    passed &= testStaleRebuild(filename, NUM_REWRITTEN_INSTS);
+    passed &= testJumpToIndex(filename);
+
+    return passed ? 0 : 1;
+}
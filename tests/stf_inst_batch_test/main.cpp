@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "stf-inc/stf_inst_batch.hpp"
+#include "stf-inc/stf_inst_reader.hpp"
+#include "common/synthetic_trace_generator.hpp"
+
+#define CHECK(cond) \
+    if(!(cond)) { \
+        std::cerr << __FILE__ << ':' << __LINE__ << ": check failed: " #cond << std::endl; \
+        return false; \
+    }
+
+// One instruction, laid out the way InstBatch describes its columns
+struct BatchRow {
+    struct Reg {
+        uint64_t reg = 0;
+        uint64_t type = 0;
+        uint64_t value = 0;
+        std::vector<uint64_t> vector_values;
+
+        bool operator==(const Reg& rhs) const = default;
+    };
+
+    struct Mem {
+        uint64_t address = 0;
+        uint64_t size = 0;
+        uint64_t type = 0;
+        std::vector<uint64_t> data;
+
+        bool operator==(const Mem& rhs) const = default;
+    };
+
+    uint64_t index = 0;
+    uint64_t pc = 0;
+    uint64_t opcode = 0;
+    uint64_t opcode_size = 0;
+    uint64_t flags = 0;
+    uint64_t branch_target = 0;
+    std::vector<Reg> regs;
+    std::vector<Mem> mems;
+
+    bool operator==(const BatchRow& rhs) const = default;
+};
+
+static BatchRow fromInst(const stf::STFInst& inst) {
+    BatchRow row;
+    row.index = inst.index();
+    row.pc = inst.pc();
+    row.opcode = inst.opcode();
+    row.opcode_size = inst.opcodeSize();
+    row.flags = inst.flags();
+    row.branch_target = inst.branchTarget();
+
+    for(const auto& op: inst.getOperands()) {
+        auto& reg = row.regs.emplace_back();
+        reg.reg = static_cast<uint64_t>(op.getReg());
+        reg.type = static_cast<uint64_t>(op.getType());
+        if(op.isVector()) {
+            const auto values = op.getVectorValueView();
+            reg.vector_values.assign(values.begin(), values.end());
+        }
+        else {
+            reg.value = op.getScalarValue();
+        }
+    }
+
+    for(const auto& access: inst.getMemoryAccesses()) {
+        auto& mem = row.mems.emplace_back();
+        mem.address = access.getAddress();
+        mem.size = access.getSize();
+        mem.type = static_cast<uint64_t>(access.getType());
+        const auto& data = access.getData();
+        mem.data.assign(data.begin(), data.end());
+    }
+
+    return row;
+}
+
+// Checks that every offset column starts at 0, never decreases, and ends at the size of the column it indexes
+static bool checkOffsets(const std::vector<size_t>& offsets, const size_t num_rows, const size_t column_size) {
+    CHECK(offsets.size() == num_rows + 1);
+    CHECK(offsets.front() == 0);
+    for(size_t i = 1; i < offsets.size(); ++i) {
+        CHECK(offsets[i - 1] <= offsets[i]);
+    }
+    CHECK(offsets.back() == column_size);
+
+    return true;
+}
+
+static bool appendRows(const stf::InstBatch& batch, std::vector<BatchRow>& rows) {
+    const size_t num_insts = batch.size();
+    CHECK(batch.getIndices().size() == num_insts);
+    CHECK(batch.getOpcodes().size() == num_insts);
+    CHECK(batch.getOpcodeSizes().size() == num_insts);
+    CHECK(batch.getFlags().size() == num_insts);
+    CHECK(batch.getBranchTargets().size() == num_insts);
+
+    const size_t num_regs = batch.getRegs().size();
+    CHECK(batch.getRegTypes().size() == num_regs && batch.getRegValues().size() == num_regs);
+    const size_t num_mems = batch.getMemAddresses().size();
+    CHECK(batch.getMemSizes().size() == num_mems && batch.getMemTypes().size() == num_mems);
+
+    CHECK(checkOffsets(batch.getRegOffsets(), num_insts, num_regs));
+    CHECK(checkOffsets(batch.getMemOffsets(), num_insts, num_mems));
+    CHECK(checkOffsets(batch.getRegVectorOffsets(), num_regs, batch.getRegVectorValues().size()));
+    CHECK(checkOffsets(batch.getMemDataOffsets(), num_mems, batch.getMemData().size()));
+
+    const auto& vector_offsets = batch.getRegVectorOffsets();
+    const auto& data_offsets = batch.getMemDataOffsets();
+
+    for(size_t i = 0; i < num_insts; ++i) {
+        auto& row = rows.emplace_back();
+        row.index = batch.getIndices()[i];
+        row.pc = batch.getPCs()[i];
+        row.opcode = batch.getOpcodes()[i];
+        row.opcode_size = batch.getOpcodeSizes()[i];
+        row.flags = batch.getFlags()[i];
+        row.branch_target = batch.getBranchTargets()[i];
+
+        for(size_t j = batch.getRegOffsets()[i]; j < batch.getRegOffsets()[i + 1]; ++j) {
+            auto& reg = row.regs.emplace_back();
+            reg.reg = static_cast<uint64_t>(batch.getRegs()[j]);
+            reg.type = static_cast<uint64_t>(batch.getRegTypes()[j]);
+            reg.value = batch.getRegValues()[j];
+            reg.vector_values.assign(batch.getRegVectorValues().begin() + static_cast<ptrdiff_t>(vector_offsets[j]),
+                                     batch.getRegVectorValues().begin() + static_cast<ptrdiff_t>(vector_offsets[j + 1]));
+        }
+
+        for(size_t j = batch.getMemOffsets()[i]; j < batch.getMemOffsets()[i + 1]; ++j) {
+            auto& mem = row.mems.emplace_back();
+            mem.address = batch.getMemAddresses()[j];
+            mem.size = batch.getMemSizes()[j];
+            mem.type = static_cast<uint64_t>(batch.getMemTypes()[j]);
+            mem.data.assign(batch.getMemData().begin() + static_cast<ptrdiff_t>(data_offsets[j]),
+                            batch.getMemData().begin() + static_cast<ptrdiff_t>(data_offsets[j + 1]));
+        }
+    }
+
+    return true;
+}
+
+// Reads the whole trace in batches of the given size, reusing one batch for every call
+static bool checkBatches(const std::string& filename,
+                         const bool only_user_mode,
+                         const size_t batch_size,
+                         const std::vector<BatchRow>& expected) {
+    stf::STFInstReader reader(filename, only_user_mode);
+    stf::InstBatch batch;
+    std::vector<BatchRow> rows;
+
+    size_t num_read;
+    while((num_read = reader.readBatch(batch, batch_size)) != 0) {
+        CHECK(num_read == batch.size());
+        // Only the last batch can come up short
+        const size_t num_left = expected.size() - rows.size();
+        CHECK(num_read == std::min(batch_size, num_left));
+        CHECK(appendRows(batch, rows));
+    }
+    CHECK(batch.empty());
+    CHECK(reader.readBatch(batch, batch_size) == 0);
+
+    CHECK(rows.size() == expected.size());
+    for(size_t i = 0; i < rows.size(); ++i) {
+        if(!(rows[i] == expected[i])) {
+            std::cerr << filename << " (batch size " << batch_size << ", only_user_mode = " << only_user_mode
+                      << "): instruction " << i << " differs" << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main() {
+    const std::string filename = "stf_inst_batch_test.zstf";
+
+    stf::synthetic::SyntheticTraceConfig config;
+    config.num_insts = 20000;
+    config.chunk_size = 1000;
+    config.vector_ratio = 0.05;
+    config.mode_switch_interval = 499;
+    config.mode_switch_length = 137;
+    stf::synthetic::SyntheticTraceGenerator(config).writeInstTrace(filename);
+
+    bool passed = true;
+
+    for(const bool only_user_mode: {false, true}) {
+        std::vector<BatchRow> expected;
+        {
+            stf::STFInstReader reader(filename, only_user_mode);
+            for(const auto& inst: reader) {
+                expected.emplace_back(fromInst(inst));
+            }
+        }
+
+        // Sizes that divide the trace evenly, leave a partial final batch, and cover the whole trace at once
+        for(const size_t batch_size: {size_t(1), size_t(7), size_t(1000), size_t(4096), expected.size() + 5}) {
+            passed &= checkBatches(filename, only_user_mode, batch_size, expected);
+        }
+    }
+
+    return passed ? 0 : 1;
+}
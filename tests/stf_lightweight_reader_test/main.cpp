@@ -0,0 +1,38 @@
+#include <string>
+#include <vector>
+
+#include "stf-inc/stf_inst_reader.hpp"
+#include "common/synthetic_trace_generator.hpp"
+#include "tests/common/inst_trace_checks.hpp"
+
+// The record copies only live in the lightweight instruction
+static_assert(sizeof(stf::STFInst) < sizeof(stf::STFLightweightInst));
+
+template<typename ReaderType>
+static std::vector<stf::test::InstContents> readTrace(const std::string& filename, const bool only_user_mode) {
+    ReaderType reader(filename, only_user_mode);
+    return stf::test::readInsts<stf::test::InstContents>(reader);
+}
+
+int main() {
+    const std::string filename = "stf_lightweight_reader_test.zstf";
+
+    stf::synthetic::SyntheticTraceConfig config;
+    config.num_insts = 20000;
+    config.chunk_size = 1000;
+    config.vector_ratio = 0.05;
+    config.mode_switch_interval = 499;
+    config.mode_switch_length = 137;
+    stf::synthetic::SyntheticTraceGenerator(config).writeInstTrace(filename);
+
+    bool passed = true;
+
+    for(const bool only_user_mode: {false, true}) {
+        const auto expected = readTrace<stf::STFInstReader>(filename, only_user_mode);
+        const auto insts = readTrace<stf::STFLightweightInstReader>(filename, only_user_mode);
+
+        passed &= stf::test::checkInsts("only_user_mode = " + std::to_string(only_user_mode), insts, expected);
+    }
+
+    return passed ? 0 : 1;
+}
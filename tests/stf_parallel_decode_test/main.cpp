@@ -0,0 +1,95 @@
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "stf-inc/stf_inst_reader.hpp"
+#include "common/synthetic_trace_generator.hpp"
+#include "tests/common/inst_trace_checks.hpp"
+
+static std::vector<stf::test::InstContents> readTrace(const std::string& filename, const bool only_user_mode, const size_t depth) {
+    stf::STFInstReader reader(filename, only_user_mode, false);
+    reader.setParallelDecodeDepth(depth);
+    return stf::test::readInsts<stf::test::InstContents>(reader);
+}
+
+static bool compareTraces(const std::string& filename, const bool only_user_mode) {
+    const auto serial = readTrace(filename, only_user_mode, 0);
+
+    for(const size_t depth: {1, 2, 4}) {
+        const std::string what = filename + " (only_user_mode = " + std::to_string(only_user_mode) +
+                                 ", depth = " + std::to_string(depth) + ")";
+        if(!stf::test::checkInsts(what, readTrace(filename, only_user_mode, depth), serial)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Reads every chunk on its own, in reverse order, and checks that the result matches iterating over the trace.
+// forEachInstInChunk numbers instructions by their unskipped index, so the other index isn't compared.
+static bool compareChunks(const std::string& filename) {
+    std::vector<stf::test::InstContents> serial;
+    {
+        stf::STFInstReader reader(filename, true, false);
+        for(const auto& inst: reader) {
+            serial.emplace_back(inst, false);
+        }
+    }
+
+    stf::STFInstReader reader(filename, true, false);
+    std::vector<std::vector<stf::test::InstContents>> chunks(reader.getNumChunks());
+    for(size_t i = chunks.size(); i-- > 0;) {
+        reader.forEachInstInChunk(i, [&chunk = chunks[i]](const stf::STFInst& inst) {
+            chunk.emplace_back(inst, false);
+        });
+    }
+
+    std::vector<stf::test::InstContents> insts;
+    for(const auto& chunk: chunks) {
+        insts.insert(insts.end(), chunk.begin(), chunk.end());
+    }
+
+    return stf::test::checkInsts(filename + " (forEachInstInChunk)", insts, serial);
+}
+
+int main() {
+    // Parallel decoding needs chunk snapshots
+    setenv("STF_CHUNK_SNAPSHOTS", "1", 1);
+
+    stf::synthetic::SyntheticTraceConfig config;
+    config.chunk_size = 1000;
+    config.vector_ratio = 0.05;
+    config.mode_switch_interval = 499;
+    config.mode_switch_length = 137;
+
+    bool passed = true;
+
+    // The first trace ends in user mode, the second one ends partway through a supervisor excursion
+    for(const uint64_t num_insts: {20000, 30000}) {
+        const std::string filename = "stf_parallel_decode_test_" + std::to_string(num_insts) + ".zstf";
+        config.num_insts = num_insts;
+        stf::synthetic::SyntheticTraceGenerator(config).writeInstTrace(filename);
+
+        for(const bool only_user_mode: {false, true}) {
+            passed &= compareTraces(filename, only_user_mode);
+        }
+        passed &= compareChunks(filename);
+    }
+
+    // Excursions that start on the last instruction of a chunk, and excursions that return to user mode on the last
+    // instruction of a chunk. The registers written before the chunk boundary have to show up in the register state of
+    // the first user mode instruction after it.
+    config.num_insts = 20000;
+    config.vector_ratio = 0.5;
+    config.mode_switch_interval = config.chunk_size;
+    for(const uint64_t length: {2, 1000}) {
+        config.mode_switch_length = length;
+        const std::string filename = "stf_parallel_decode_test_boundary_" + std::to_string(length) + ".zstf";
+        stf::synthetic::SyntheticTraceGenerator(config).writeInstTrace(filename);
+        passed &= compareTraces(filename, true);
+        passed &= compareChunks(filename);
+    }
+
+    return passed ? 0 : 1;
+}
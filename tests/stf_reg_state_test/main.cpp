@@ -0,0 +1,62 @@
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "stf-inc/stf_reg_state.hpp"
+
+using STF_REG = stf::Registers::STF_REG;
+using STF_REG_OPERAND_TYPE = stf::Registers::STF_REG_OPERAND_TYPE;
+
+static const stf::InstRegRecord::VectorType VECTOR_VALUE {0x0123456789abcdef, 0xfedcba9876543210, 1, 2};
+
+static bool check(const bool cond, const char* msg) {
+    if(!cond) {
+        std::cerr << msg << std::endl;
+    }
+    return cond;
+}
+
+int main() {
+    stf::STFRegState reg_state(stf::ISA::RISCV, stf::INST_IEM::STF_INST_IEM_RV64);
+
+    reg_state.regStateUpdate(stf::InstRegRecord(STF_REG::STF_REG_X1, STF_REG_OPERAND_TYPE::REG_STATE, 0x1234));
+    reg_state.regStateUpdate(stf::InstRegRecord(STF_REG::STF_REG_CSR_FFLAGS, STF_REG_OPERAND_TYPE::REG_STATE, 0x1f));
+    reg_state.regStateUpdate(stf::InstRegRecord(STF_REG::STF_REG_V2, STF_REG_OPERAND_TYPE::REG_STATE, VECTOR_VALUE));
+
+    bool passed = true;
+
+    passed &= check(reg_state.getRegScalarValue(STF_REG::STF_REG_X1) == 0x1234, "Wrong X1 value");
+    passed &= check(reg_state.getRegScalarValue(STF_REG::STF_REG_CSR_FFLAGS) == 0x1f, "Wrong FFLAGS value");
+
+    const auto vector_view = reg_state.getRegVectorView(STF_REG::STF_REG_V2);
+    passed &= check(std::equal(vector_view.begin(), vector_view.end(), VECTOR_VALUE.begin(), VECTOR_VALUE.end()),
+                    "Wrong V2 value");
+
+    std::vector<STF_REG> regs;
+    reg_state.applyRegState(
+        [&regs](const stf::InstRegRecord& rec) {
+            regs.emplace_back(rec.getReg());
+        }
+    );
+    passed &= check(regs.size() == reg_state.size(), "applyRegState visited the wrong number of registers");
+
+    // The pre-dense-array interface has to keep compiling for existing users
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+    const auto vector_value = reg_state.getRegVectorValue(STF_REG::STF_REG_V2);
+    passed &= check(vector_value == VECTOR_VALUE, "Wrong V2 value from getRegVectorValue");
+
+    std::vector<STF_REG> legacy_regs;
+    reg_state.applyRegState(
+        [&legacy_regs](const stf::RegStateMap::value_type& r) {
+            if(r.first == r.second->getReg()) {
+                legacy_regs.emplace_back(r.first);
+            }
+        }
+    );
+    passed &= check(legacy_regs == regs, "Legacy applyRegState callback saw different registers");
+#pragma GCC diagnostic pop
+
+    return passed ? 0 : 1;
+}
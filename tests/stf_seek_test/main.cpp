@@ -0,0 +1,48 @@
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "stf-inc/stf_inst_reader.hpp"
+#include "common/synthetic_trace_generator.hpp"
+#include "tests/common/inst_trace_checks.hpp"
+
+// Seeking skips records without constructing them, so the instructions after each seek have to match the ones read
+// the slow way, PCs included
+static bool checkSeek(const std::string& filename, const std::vector<stf::test::InstContents>& expected) {
+    static constexpr size_t WINDOW = 50;
+
+    for(const size_t distance: {size_t(1), size_t(999), size_t(1000), size_t(1001), size_t(4321), expected.size() - WINDOW - 1}) {
+        stf::STFInstReader reader(filename);
+        auto it = reader.begin();
+        reader.seek(it, distance);
+
+        for(size_t i = distance; i < distance + WINDOW; ++i, ++it) {
+            if(!(stf::test::InstContents(*it) == expected[i])) {
+                std::cerr << filename << ": instruction " << i << " differs after seeking " << distance << std::endl;
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+int main() {
+    stf::synthetic::SyntheticTraceConfig config;
+    config.num_insts = 20000;
+    config.chunk_size = 1000;
+    config.vector_ratio = 0.05;
+    config.mode_switch_interval = 499;
+    config.mode_switch_length = 137;
+
+    bool passed = true;
+
+    for(const std::string filename: {"stf_seek_test.zstf", "stf_seek_test.stf", "stf_seek_test.stf.gz"}) {
+        stf::synthetic::SyntheticTraceGenerator(config).writeInstTrace(filename);
+        const auto expected = stf::test::readTrace<stf::test::InstContents>(filename);
+        passed &= checkSeek(filename, expected);
+    }
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,192 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "stf-inc/stf_compression_buffer.hpp"
+#include "stf-inc/stf_shared_chunk_cache.hpp"
+
+static constexpr size_t CHUNK_SIZE = 4096;
+static constexpr size_t NUM_SLOTS = 4;
+
+using Cache = stf::STFSharedChunkCache;
+
+#define CHECK(cond) \
+    do { \
+        if(!(cond)) { \
+            std::cerr << __FILE__ << ':' << __LINE__ << ": check failed: " #cond << std::endl; \
+            return false; \
+        } \
+    } while(0)
+
+static std::string getRegionName(const struct stat& file_stat) {
+    std::ostringstream name;
+    name << "/stf-chunks-" << std::hex
+         << file_stat.st_dev << '-'
+         << file_stat.st_ino << '-'
+         << file_stat.st_size << '-'
+         << file_stat.st_mtim.tv_sec << '.' << file_stat.st_mtim.tv_nsec;
+    return name.str();
+}
+
+static std::unique_ptr<Cache> openCache(const struct stat& file_stat) {
+    return Cache::open(file_stat, NUM_SLOTS * CHUNK_SIZE, CHUNK_SIZE);
+}
+
+static stf::STFCompressionBuffer makeChunk(const size_t chunk_idx) {
+    stf::STFCompressionBuffer buf(CHUNK_SIZE);
+    std::fill_n(buf.get(), CHUNK_SIZE, static_cast<uint8_t>(chunk_idx * 7 + 1));
+    buf.advanceWritePtr(CHUNK_SIZE);
+    return buf;
+}
+
+// Looks up a chunk, returning true if it was found and holds the expected data
+static bool hit(Cache& cache, const size_t chunk_idx, size_t& reserved_slot) {
+    stf::STFCompressionBuffer buf(CHUNK_SIZE);
+    if(!cache.find(chunk_idx, buf, reserved_slot)) {
+        return false;
+    }
+
+    const auto expected = makeChunk(chunk_idx);
+    return buf.end() == CHUNK_SIZE && std::equal(buf.get(), buf.get() + CHUNK_SIZE, expected.get());
+}
+
+static bool hit(Cache& cache, const size_t chunk_idx) {
+    size_t reserved_slot;
+    const bool found = hit(cache, chunk_idx, reserved_slot);
+    if(reserved_slot != Cache::NO_SLOT) {
+        cache.abandon(reserved_slot, chunk_idx);
+    }
+    return found;
+}
+
+static bool load(Cache& cache, const size_t chunk_idx) {
+    size_t reserved_slot;
+    if(hit(cache, chunk_idx, reserved_slot) || reserved_slot == Cache::NO_SLOT) {
+        return false;
+    }
+    cache.publish(reserved_slot, chunk_idx, makeChunk(chunk_idx));
+    return true;
+}
+
+// Runs func in a child process, returning its result
+template<typename FuncType>
+static bool runChild(FuncType&& func) {
+    const pid_t pid = fork();
+    if(pid == 0) {
+        _exit(func() ? 0 : 1);
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// Published chunks are hit by this process and by others, and the least recently used chunk is evicted first
+static bool testHitsAndEviction(Cache& cache, const struct stat& file_stat) {
+    for(size_t i = 0; i < NUM_SLOTS; ++i) {
+        CHECK(load(cache, i));
+    }
+
+    CHECK(hit(cache, 0));
+    CHECK(runChild([&file_stat]() {
+        const auto child_cache = openCache(file_stat);
+        return child_cache && hit(*child_cache, 2) && hit(*child_cache, 3);
+    }));
+
+    // Chunk 1 is now the least recently used one
+    CHECK(load(cache, NUM_SLOTS));
+    CHECK(hit(cache, 0));
+    CHECK(hit(cache, NUM_SLOTS));
+    CHECK(!hit(cache, 1));
+
+    const auto stats = cache.getStats();
+    CHECK(stats.num_slots == NUM_SLOTS);
+    CHECK(stats.num_published == NUM_SLOTS + 1);
+
+    return true;
+}
+
+// A chunk reserved by a process that exited without publishing it is reclaimed instead of waited on forever
+static bool testDeadReservation(Cache& cache, const struct stat& file_stat) {
+    static constexpr size_t CHUNK_IDX = 100;
+
+    CHECK(runChild([&file_stat]() {
+        const auto child_cache = openCache(file_stat);
+        size_t reserved_slot;
+        const bool reserved = child_cache && !hit(*child_cache, CHUNK_IDX, reserved_slot) && reserved_slot != Cache::NO_SLOT;
+        // Exit without publishing or closing the cache
+        _exit(reserved ? 0 : 1);
+        return false;
+    }));
+
+    CHECK(load(cache, CHUNK_IDX));
+    CHECK(hit(cache, CHUNK_IDX));
+
+    return true;
+}
+
+// Publishing or abandoning a slot only takes effect if the reservation matches
+static bool testReservationOwnership(Cache& cache) {
+    static constexpr size_t CHUNK_IDX = 200;
+
+    size_t reserved_slot;
+    CHECK(!hit(cache, CHUNK_IDX, reserved_slot));
+    CHECK(reserved_slot != Cache::NO_SLOT);
+
+    const size_t num_published = cache.getStats().num_published;
+
+    cache.publish(reserved_slot, CHUNK_IDX + 1, makeChunk(CHUNK_IDX + 1));
+    CHECK(cache.getStats().num_published == num_published);
+    cache.abandon(reserved_slot, CHUNK_IDX + 1);
+
+    // The slot is still reserved for the original chunk
+    cache.publish(reserved_slot, CHUNK_IDX, makeChunk(CHUNK_IDX));
+    CHECK(cache.getStats().num_published == num_published + 1);
+    CHECK(hit(cache, CHUNK_IDX));
+    CHECK(!hit(cache, CHUNK_IDX + 1));
+
+    return true;
+}
+
+int main() {
+    const std::string filename = "stf_shared_chunk_cache_test.dat";
+    if(FILE* const file = fopen(filename.c_str(), "w")) {
+        fputs("stf_shared_chunk_cache_test", file);
+        fclose(file);
+    }
+
+    struct stat file_stat;
+    if(stat(filename.c_str(), &file_stat) != 0) {
+        std::cerr << "Failed to create " << filename << std::endl;
+        return 1;
+    }
+
+    bool passed = true;
+
+    {
+        const auto cache = openCache(file_stat);
+        if(!cache) {
+            std::cerr << "Failed to open the shared chunk cache" << std::endl;
+            return 1;
+        }
+
+        passed &= testHitsAndEviction(*cache, file_stat);
+        passed &= testDeadReservation(*cache, file_stat);
+        passed &= testReservationOwnership(*cache);
+    }
+
+    // The child that exited without closing the cache keeps the region from being removed
+    shm_unlink(getRegionName(file_stat).c_str());
+
+    return passed ? 0 : 1;
+}
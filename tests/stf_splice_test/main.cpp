@@ -0,0 +1,93 @@
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "stf-inc/stf_chunk_splicer.hpp"
+#include "stf-inc/stf_inst_reader.hpp"
+#include "common/synthetic_trace_generator.hpp"
+#include "tests/common/inst_trace_checks.hpp"
+
+// Spliced instructions are renumbered, so only their contents are compared
+struct SplicedInstInfo {
+    uint64_t pc;
+    uint64_t phys_pc;
+    uint32_t opcode;
+    std::vector<std::pair<uint64_t, uint64_t>> mem_accesses;
+
+    explicit SplicedInstInfo(const stf::STFInst& inst) :
+        pc(inst.pc()),
+        phys_pc(inst.physPc()),
+        opcode(inst.opcode())
+    {
+        for(const auto& access: inst.getMemoryAccesses()) {
+            mem_accesses.emplace_back(access.getAddress(), access.getPhysAddress());
+        }
+    }
+
+    bool operator==(const SplicedInstInfo& rhs) const = default;
+};
+
+static std::vector<SplicedInstInfo> readTrace(const std::string& filename) {
+    return stf::test::readTrace<SplicedInstInfo>(filename, false, true);
+}
+
+using Range = std::pair<uint64_t, uint64_t>;
+
+static bool checkSplice(const std::string& src,
+                        const std::vector<SplicedInstInfo>& src_insts,
+                        const std::vector<Range>& ranges,
+                        const bool expect_copies) {
+    const std::string output = "stf_splice_test_out.zstf";
+
+    std::vector<SplicedInstInfo> expected;
+    size_t num_copied_chunks = 0;
+    {
+        stf::STFChunkSplicer splicer(output);
+        for(const auto& [start, end]: ranges) {
+            splicer.append(src, start, end);
+            expected.insert(expected.end(), src_insts.begin() + static_cast<ptrdiff_t>(start), src_insts.begin() + static_cast<ptrdiff_t>(end));
+        }
+        splicer.close();
+        num_copied_chunks = splicer.getNumCopiedChunks();
+    }
+
+    if((num_copied_chunks != 0) != expect_copies) {
+        std::cerr << src << ": copied " << num_copied_chunks << " chunks, expected "
+                  << (expect_copies ? "some" : "none") << std::endl;
+        return false;
+    }
+
+    return stf::test::checkInsts("Spliced trace", readTrace(output), expected);
+}
+
+int main() {
+    const std::string src = "stf_splice_test_src.zstf";
+    const std::string src_no_pte = "stf_splice_test_src_no_pte.zstf";
+
+    stf::synthetic::SyntheticTraceConfig config;
+    config.num_insts = 20000;
+    config.chunk_size = 1000;
+    config.mem_footprint = 1ULL << 20;
+    stf::synthetic::SyntheticTraceGenerator(config).writeInstTrace(src);
+    config.pte = false;
+    stf::synthetic::SyntheticTraceGenerator(config).writeInstTrace(src_no_pte);
+
+    const auto src_insts = readTrace(src);
+    const auto src_no_pte_insts = readTrace(src_no_pte);
+
+    bool passed = true;
+
+    // Starts at the beginning of the source, so whole chunks are copied
+    passed &= checkSplice(src, src_insts, {{0, 12000}}, true);
+    // Starts partway through the source, so the page table has to be replayed and the page table walks in every
+    // chunk are rewritten
+    passed &= checkSplice(src, src_insts, {{2000, 19000}}, false);
+    passed &= checkSplice(src, src_insts, {{2500, 6000}, {12000, 15000}}, false);
+    // Traces without page table walks still copy the chunks in the middle of a range
+    passed &= checkSplice(src_no_pte, src_no_pte_insts, {{2000, 19000}}, true);
+    passed &= checkSplice(src_no_pte, src_no_pte_insts, {{2000, 6000}, {12000, 15000}}, true);
+
+    return passed ? 0 : 1;
+}
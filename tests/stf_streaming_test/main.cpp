@@ -0,0 +1,105 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "stf-inc/stf_thread_pool.hpp"
+#include "common/synthetic_trace_generator.hpp"
+#include "tests/common/inst_trace_checks.hpp"
+
+static constexpr uint64_t CHUNK_SIZE = 1000;
+
+// Copies a file into a FIFO from a separate thread while it is read from the other end
+static std::vector<stf::test::InstInfo> readThroughFifo(const std::string& filename, const std::string& fifo) {
+    std::thread writer([&filename, &fifo]() {
+        FILE* const in = fopen(filename.c_str(), "rb");
+        FILE* const out = fopen(fifo.c_str(), "wb");
+        std::vector<char> buf(1 << 16);
+        size_t num_read;
+        while((num_read = fread(buf.data(), 1, buf.size(), in)) > 0) {
+            fwrite(buf.data(), 1, num_read, out);
+        }
+        fclose(out);
+        fclose(in);
+    });
+
+    const auto insts = stf::test::readTrace(fifo);
+    writer.join();
+
+    return insts;
+}
+
+int main() {
+    stf::synthetic::SyntheticTraceConfig config;
+    config.num_insts = 20000;
+    config.chunk_size = CHUNK_SIZE;
+
+    const std::string reference = "stf_streaming_test_ref.zstf";
+    const std::string streamed = "stf_streaming_test.zstf";
+    const std::string truncated = "stf_streaming_test_truncated.zstf";
+    const std::string fifo = "stf_streaming_test_fifo.zstf";
+
+    std::filesystem::remove(fifo);
+    if(mkfifo(fifo.c_str(), 0600) != 0) {
+        std::cerr << "Failed to create " << fifo << std::endl;
+        return 1;
+    }
+
+    // Written and read through a pipe. The writer streams automatically because its output isn't a regular file.
+    // It runs in its own process, forked before this one starts any threads, so that the two ends of the pipe don't
+    // wait on each other for the same thread pool.
+    const pid_t writer_pid = fork();
+    if(writer_pid == 0) {
+        stf::synthetic::SyntheticTraceGenerator(config).writeInstTrace(fifo);
+        _exit(0);
+    }
+
+    const auto piped = stf::test::readTrace(fifo);
+    int writer_status = 0;
+    waitpid(writer_pid, &writer_status, 0);
+
+    stf::synthetic::SyntheticTraceGenerator(config).writeInstTrace(reference);
+    const auto expected = stf::test::readTrace(reference);
+
+    bool passed = WIFEXITED(writer_status) && WEXITSTATUS(writer_status) == 0;
+    passed &= stf::test::checkInsts("Pipe round trip", piped, expected);
+
+    // Streaming traces stored in regular files are indexed when they are opened
+    setenv("STF_ZSTF_STREAMING", "1", 1);
+    stf::synthetic::SyntheticTraceGenerator(config).writeInstTrace(streamed);
+    unsetenv("STF_ZSTF_STREAMING");
+
+    passed &= stf::test::checkInsts(streamed, stf::test::readTrace(streamed), expected);
+    passed &= stf::test::checkInsts(streamed + " (pipe)", readThroughFifo(streamed, fifo), expected);
+
+    // Traces that were cut off, as if the writer had been killed, are read up to their last complete chunk
+    for(const double fraction: {0.3, 0.75}) {
+        if(!stf::test::truncatedCopy(streamed, truncated, fraction)) {
+            return 1;
+        }
+
+        const std::string what = truncated + " (" + std::to_string(fraction) + ")";
+        passed &= stf::test::checkRecovered(what, stf::test::readTrace(truncated), expected, CHUNK_SIZE);
+        passed &= stf::test::checkRecovered(what + " (pipe)", readThroughFifo(truncated, fifo), expected, CHUNK_SIZE);
+    }
+
+    // Written and read through a pipe from the same process, sharing a single helper thread. Reading from the pipe
+    // must not tie up the helper thread that the writer needs to compress its chunks.
+    stf::STFThreadPool::get().setNumThreads(1);
+    std::thread writer([&config, &fifo]() { stf::synthetic::SyntheticTraceGenerator(config).writeInstTrace(fifo); });
+    const auto shared_pool = stf::test::readTrace(fifo);
+    writer.join();
+    passed &= stf::test::checkInsts("Pipe round trip (shared thread pool)", shared_pool, expected);
+
+    std::filesystem::remove(fifo);
+
+    return passed ? 0 : 1;
+}
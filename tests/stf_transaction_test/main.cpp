@@ -0,0 +1,132 @@
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "stf-inc/stf_record_id_manager.hpp"
+#include "stf-inc/stf_transaction_reader.hpp"
+#include "stf-inc/stf_transaction_writer.hpp"
+#include "stf-inc/protocols/tilelink.hpp"
+
+using stf::protocols::TileLink;
+namespace tilelink = stf::protocols::tilelink;
+
+static constexpr stf::ClockId CLOCK_ID = 1;
+static constexpr uint64_t NUM_TRANSACTIONS = 1000;
+static constexpr uint64_t CYCLE_DELTA = 1;
+
+// Every field gets a value derived from a different constant so that reading the fields in the wrong
+// order can't produce the expected values
+static uint8_t code(const uint64_t i) { return static_cast<uint8_t>(i % 7); }
+static uint8_t param(const uint64_t i) { return static_cast<uint8_t>(3 + i % 5); }
+static uint8_t size(const uint64_t i) { return static_cast<uint8_t>(1 + i % 6); }
+static uint64_t source(const uint64_t i) { return 0x100 + i; }
+static uint64_t address(const uint64_t i) { return 0x80000000 + (i << 6); }
+static uint64_t sink(const uint64_t i) { return 0xabcd0000 + i; }
+
+static std::vector<uint8_t> data(const uint64_t i) {
+    std::vector<uint8_t> result((i % 4) * 8);
+    for(size_t j = 0; j < result.size(); ++j) {
+        result[j] = static_cast<uint8_t>(i * 3 + j);
+    }
+    return result;
+}
+
+static std::vector<uint8_t> mask(const uint64_t i) {
+    std::vector<uint8_t> result(16);
+    for(size_t j = 0; j < result.size(); ++j) {
+        result[j] = (i >> (j % 8)) & 1;
+    }
+    return result;
+}
+
+static void writeTrace(const std::string& filename) {
+    stf::STFTransactionWriter writer(filename);
+    writer.addTraceInfo(stf::TraceInfoRecord(stf::STF_GEN::STF_GEN_RESERVED, 1, 0, 0, "stf_transaction_test"));
+    writer.setTraceFeature(stf::TRACE_FEATURES::STF_CONTAIN_TRANSACTIONS);
+    writer.setProtocolId(stf::protocols::ProtocolId::TILELINK);
+    writer.addClock(CLOCK_ID, "core");
+    writer.finalizeHeader();
+
+    stf::RecordIdManager id_manager;
+    for(uint64_t i = 0; i < NUM_TRANSACTIONS; ++i) {
+        switch(i % 3) {
+            case 0:
+                writer << TileLink::makeTransactionWithDelta<tilelink::ChannelA>(id_manager, CLOCK_ID, CYCLE_DELTA,
+                                                                                code(i), param(i), size(i),
+                                                                                source(i), data(i), address(i),
+                                                                                mask(i));
+                break;
+            case 1:
+                writer << TileLink::makeTransactionWithDelta<tilelink::ChannelC>(id_manager, CLOCK_ID, CYCLE_DELTA,
+                                                                                code(i), param(i), size(i),
+                                                                                source(i), data(i), address(i));
+                break;
+            case 2:
+                writer << TileLink::makeTransactionWithDelta<tilelink::ChannelD>(id_manager, CLOCK_ID, CYCLE_DELTA,
+                                                                                code(i), param(i), size(i),
+                                                                                source(i), data(i), sink(i));
+                break;
+        }
+    }
+
+    writer.close();
+}
+
+template<typename ChannelType>
+static bool checkCommonFields(const ChannelType& channel, const uint64_t i) {
+    return channel.getCode() == code(i) &&
+           channel.getParam() == param(i) &&
+           channel.getSize() == size(i) &&
+           channel.getSource() == source(i) &&
+           channel.getData() == data(i);
+}
+
+static bool checkTransaction(const stf::STFTransaction& transaction, const uint64_t i) {
+    const auto& protocol = transaction.getProtocol().as<TileLink>();
+
+    switch(i % 3) {
+        case 0:
+        {
+            const auto& channel = protocol.getChannelAs<tilelink::ChannelA>();
+            return checkCommonFields(channel, i) &&
+                   channel.getAddress() == address(i) &&
+                   channel.getMask() == mask(i);
+        }
+        case 1:
+        {
+            const auto& channel = protocol.getChannelAs<tilelink::ChannelC>();
+            return checkCommonFields(channel, i) && channel.getAddress() == address(i);
+        }
+        case 2:
+        {
+            const auto& channel = protocol.getChannelAs<tilelink::ChannelD>();
+            return checkCommonFields(channel, i) && channel.getSink() == sink(i);
+        }
+    }
+
+    return false;
+}
+
+int main() {
+    const std::string filename = "stf_transaction_test.zstf";
+    writeTrace(filename);
+
+    stf::STFTransactionReader reader(filename);
+
+    uint64_t i = 0;
+    for(const auto& transaction: reader) {
+        if(!checkTransaction(transaction, i)) {
+            std::cerr << "Transaction " << i << " was not read back correctly" << std::endl;
+            return 1;
+        }
+        ++i;
+    }
+
+    if(i != NUM_TRANSACTIONS) {
+        std::cerr << "Read " << i << " transactions, expected " << NUM_TRANSACTIONS << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "stf-inc/stf_chunk_splicer.hpp"
+
+namespace {
+    /**
+     * \struct Range
+     *
+     * Range of instructions to take from an input trace
+     */
+    struct Range {
+        std::string filename;
+        uint64_t start = 0;
+        uint64_t end = stf::STFChunkSplicer::END_OF_TRACE;
+    };
+
+    void usage(const char* prog) {
+        std::cerr << "Usage: " << prog << " -o OUTPUT [-s START] [-e END] INPUT [[-s START] [-e END] INPUT]..." << std::endl
+                  << "Extracts and concatenates instruction ranges from STF traces. Whole .zstf chunks are copied" << std::endl
+                  << "without decompressing them, so only the chunks at the edges of each range are rewritten." << std::endl
+                  << std::endl
+                  << "Options:" << std::endl
+                  << "  -o OUTPUT   output trace" << std::endl
+                  << "  -s START    number of instructions to skip at the start of the next input (default 0)" << std::endl
+                  << "  -e END      number of instructions in the next input to stop after (default: end of trace)" << std::endl
+                  << std::endl
+                  << "Ranges that start on a chunk boundary, and that hold a multiple of the chunk size when more" << std::endl
+                  << "ranges follow them, are copied with the least amount of rewriting." << std::endl
+                  << std::endl
+                  << "Traces with page table walks are slower to splice. Each range is replayed from the start of" << std::endl
+                  << "its input to rebuild the page table, and its chunks are rewritten instead of copied unless" << std::endl
+                  << "the range lands at the same instruction index in the output as in its input." << std::endl;
+    }
+} // end anonymous namespace
+
+int main(int argc, char** argv) {
+    std::string output;
+    std::vector<Range> ranges;
+    Range next;
+
+    for(int i = 1; i < argc; ++i) {
+        const std::string_view opt = argv[i];
+        if(opt == "-h" || opt == "--help") {
+            usage(argv[0]);
+            return 0;
+        }
+        if(opt == "-o" || opt == "-s" || opt == "-e") {
+            if(i + 1 == argc) {
+                usage(argv[0]);
+                return 1;
+            }
+
+            const char* val = argv[++i];
+            if(opt == "-o") {
+                output = val;
+            }
+            else if(opt == "-s") {
+                next.start = std::strtoull(val, nullptr, 0);
+            }
+            else {
+                next.end = std::strtoull(val, nullptr, 0);
+            }
+        }
+        else if(opt[0] == '-' && opt.size() > 1) {
+            usage(argv[0]);
+            return 1;
+        }
+        else {
+            next.filename = opt;
+            ranges.emplace_back(std::move(next));
+            next = Range();
+        }
+    }
+
+    if(output.empty() || ranges.empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    stf::STFChunkSplicer splicer(output);
+    for(const auto& range: ranges) {
+        splicer.append(range.filename, range.start, range.end);
+    }
+    splicer.close();
+
+    std::cout << output << ": " << splicer.getNumMarkers() << " instructions, "
+              << splicer.getNumCopiedChunks() << " chunks copied, "
+              << splicer.getNumRewrittenChunks() << " chunks rewritten" << std::endl;
+
+    return 0;
+}